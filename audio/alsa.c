@@ -173,11 +173,11 @@ static ssize_t alsa_write(void *data, const void *buf_, size_t size_)
             continue;
          }
          else
-            return written;
+            return snd_pcm_frames_to_bytes(alsa->pcm, written);
       }
       else if (frames == -EAGAIN) // Expected if we're running nonblock.
       {
-         return written;
+         return snd_pcm_frames_to_bytes(alsa->pcm, written);
       }
       else if (frames < 0)
       {
@@ -190,7 +190,7 @@ static ssize_t alsa_write(void *data, const void *buf_, size_t size_)
       size    -= frames;
    }
 
-   return written;
+   return snd_pcm_frames_to_bytes(alsa->pcm, written);
 }
 
 static bool alsa_stop(void *data)
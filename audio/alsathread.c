@@ -20,7 +20,7 @@
 #include <alsa/asoundlib.h>
 #include "../general.h"
 #include "../thread.h"
-#include "../fifo_buffer.h"
+#include "../spsc_fifo.h"
 
 #define TRY_ALSA(x) if (x < 0) { \
                   goto error; \
@@ -37,11 +37,8 @@ typedef struct alsa_thread
    size_t period_size;
    snd_pcm_uframes_t period_frames;
 
-   fifo_buffer_t *buffer;
+   spsc_fifo_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
-   scond_t *cond;
-   slock_t *cond_lock;
 } alsa_thread_t;
 
 static void alsa_worker_thread(void *data)
@@ -57,12 +54,9 @@ static void alsa_worker_thread(void *data)
 
    while (!alsa->thread_dead)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_read_avail(alsa->buffer);
+      size_t avail = spsc_fifo_read_avail(alsa->buffer);
       size_t fifo_size = min(alsa->period_size, avail);
-      fifo_read(alsa->buffer, buf, fifo_size);
-      scond_signal(alsa->cond);
-      slock_unlock(alsa->fifo_lock);
+      spsc_fifo_read(alsa->buffer, buf, fifo_size);
 
       // If underrun, fill rest with silence.
       memset(buf + fifo_size, 0, alsa->period_size - fifo_size);
@@ -88,10 +82,9 @@ static void alsa_worker_thread(void *data)
    }
 
 end:
-   slock_lock(alsa->cond_lock);
+   // Wake up a blocking writer.
    alsa->thread_dead = true;
-   scond_signal(alsa->cond);
-   slock_unlock(alsa->cond_lock);
+   spsc_fifo_shutdown(alsa->buffer);
    free(buf);
 }
 
@@ -124,13 +117,7 @@ static void alsa_thread_free(void *data)
          sthread_join(alsa->worker_thread);
       }
       if (alsa->buffer)
-         fifo_free(alsa->buffer);
-      if (alsa->cond)
-         scond_free(alsa->cond);
-      if (alsa->fifo_lock)
-         slock_free(alsa->fifo_lock);
-      if (alsa->cond_lock)
-         slock_free(alsa->cond_lock);
+         spsc_fifo_free(alsa->buffer);
       if (alsa->pcm)
       {
          snd_pcm_drop(alsa->pcm);
@@ -192,11 +179,8 @@ static void *alsa_thread_init(const char *device, unsigned rate, unsigned latenc
    snd_pcm_hw_params_free(params);
    snd_pcm_sw_params_free(sw_params);
 
-   alsa->fifo_lock = slock_new();
-   alsa->cond_lock = slock_new();
-   alsa->cond = scond_new();
-   alsa->buffer = fifo_new(alsa->buffer_size);
-   if (!alsa->fifo_lock || !alsa->cond_lock || !alsa->cond || !alsa->buffer)
+   alsa->buffer = spsc_fifo_new(alsa->buffer_size, NULL);
+   if (!alsa->buffer)
       goto error;
 
    alsa->worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -230,11 +214,9 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
 
    if (alsa->nonblock)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_write_avail(alsa->buffer);
+      size_t avail = spsc_fifo_write_avail(alsa->buffer);
       size_t write_amt = min(avail, size);
-      fifo_write(alsa->buffer, buf, write_amt);
-      slock_unlock(alsa->fifo_lock);
+      spsc_fifo_write(alsa->buffer, buf, write_amt);
       return write_amt;
    }
    else
@@ -242,24 +224,14 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
       size_t written = 0;
       while (written < size && !alsa->thread_dead)
       {
-         slock_lock(alsa->fifo_lock);
-         size_t avail = fifo_write_avail(alsa->buffer);
+         // Only sleeps when the buffer is full. Fails if the worker thread died.
+         if (!spsc_fifo_wait_write_avail(alsa->buffer, 1))
+            break;
 
-         if (avail == 0)
-         {
-            slock_unlock(alsa->fifo_lock);
-            slock_lock(alsa->cond_lock);
-            if (!alsa->thread_dead)
-               scond_wait(alsa->cond, alsa->cond_lock);
-            slock_unlock(alsa->cond_lock);
-         }
-         else
-         {
-            size_t write_amt = min(size - written, avail);
-            fifo_write(alsa->buffer, (const char*)buf + written, write_amt);
-            slock_unlock(alsa->fifo_lock);
-            written += write_amt;
-         }
+         size_t avail = spsc_fifo_write_avail(alsa->buffer);
+         size_t write_amt = min(size - written, avail);
+         spsc_fifo_write(alsa->buffer, (const char*)buf + written, write_amt);
+         written += write_amt;
       }
       return written;
    }
@@ -289,10 +261,7 @@ static size_t alsa_thread_write_avail(void *data)
 
    if (alsa->thread_dead)
       return 0;
-   slock_lock(alsa->fifo_lock);
-   size_t val = fifo_write_avail(alsa->buffer);
-   slock_unlock(alsa->fifo_lock);
-   return val;
+   return spsc_fifo_write_avail(alsa->buffer);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -0,0 +1,587 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dsp_filter.h"
+#include "../conf/config_file.h"
+#include "../general.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846264338327
+#endif
+
+enum dsp_filter_type
+{
+   DSP_FILTER_EQ = 0,
+   DSP_FILTER_LOWSHELF,
+   DSP_FILTER_HIGHSHELF,
+   DSP_FILTER_LOWPASS,
+   DSP_FILTER_HIGHPASS,
+   DSP_FILTER_WIDENER,
+   DSP_FILTER_COMPRESSOR,
+   DSP_FILTER_LIMITER,
+};
+
+static const struct
+{
+   const char *ident;
+   enum dsp_filter_type type;
+} dsp_filter_types[] = {
+   { "eq", DSP_FILTER_EQ },
+   { "lowshelf", DSP_FILTER_LOWSHELF },
+   { "highshelf", DSP_FILTER_HIGHSHELF },
+   { "lowpass", DSP_FILTER_LOWPASS },
+   { "highpass", DSP_FILTER_HIGHPASS },
+   { "widener", DSP_FILTER_WIDENER },
+   { "compressor", DSP_FILTER_COMPRESSOR },
+   { "limiter", DSP_FILTER_LIMITER },
+};
+
+// Transposed direct form II. State is kept per channel.
+struct dsp_biquad
+{
+   float b0, b1, b2, a1, a2;
+   float z1[AUDIO_MAX_CHANNELS], z2[AUDIO_MAX_CHANNELS];
+};
+
+// Mid/side scaling, folded into a 2x2 matrix. Only the front pair is widened.
+struct dsp_widener
+{
+   float direct, cross;
+};
+
+// Feed-forward peak compressor with all channels linked.
+struct dsp_compressor
+{
+   float threshold; // Linear.
+   float slope;     // 1 - 1 / ratio.
+   float attack, release;
+   float makeup;
+   float env;
+};
+
+struct dsp_stage
+{
+   enum dsp_filter_type type;
+   union
+   {
+      struct dsp_biquad biquad;
+      struct dsp_widener widener;
+      struct dsp_compressor comp;
+   } u;
+};
+
+struct rarch_dsp_filter
+{
+   struct dsp_stage stages[RARCH_DSP_MAX_FILTERS];
+   unsigned num_stages;
+   unsigned channels;
+};
+
+// Keeps long decays from running into denormals, which are very slow on x86.
+static inline float flush_denormal(float val)
+{
+   return fabsf(val) < 1e-15f ? 0.0f : val;
+}
+
+static void biquad_process_channel(struct dsp_biquad *bq, float *samples, size_t frames,
+      unsigned channels, unsigned c)
+{
+   size_t i;
+   float z1 = bq->z1[c];
+   float z2 = bq->z2[c];
+   for (i = 0; i < frames; i++)
+   {
+      float x = samples[channels * i + c];
+      float y = bq->b0 * x + z1;
+      z1 = bq->b1 * x - bq->a1 * y + z2;
+      z2 = bq->b2 * x - bq->a2 * y;
+      samples[channels * i + c] = y;
+   }
+   bq->z1[c] = flush_denormal(z1);
+   bq->z2[c] = flush_denormal(z2);
+}
+
+static void widener_process_frames(struct dsp_widener *w, float *samples, size_t frames,
+      unsigned channels)
+{
+   size_t i;
+   for (i = 0; i < frames; i++, samples += channels)
+   {
+      float l = samples[0];
+      float r = samples[1];
+      samples[0] = l * w->direct + r * w->cross;
+      samples[1] = r * w->direct + l * w->cross;
+   }
+}
+
+#if defined(__SSE__)
+// Channels are filtered in groups of four or two, one per lane.
+// The recursion rules out vectorizing over time.
+static inline void biquad_process_lanes(struct dsp_biquad *bq, float *samples, size_t frames,
+      unsigned channels, unsigned first, unsigned lanes)
+{
+   size_t i;
+   unsigned c;
+   float state[4] = {0.0f};
+   __m128 b0 = _mm_set1_ps(bq->b0);
+   __m128 b1 = _mm_set1_ps(bq->b1);
+   __m128 b2 = _mm_set1_ps(bq->b2);
+   __m128 a1 = _mm_set1_ps(bq->a1);
+   __m128 a2 = _mm_set1_ps(bq->a2);
+
+   memcpy(state, bq->z1 + first, lanes * sizeof(float));
+   __m128 z1 = _mm_loadu_ps(state);
+   memcpy(state, bq->z2 + first, lanes * sizeof(float));
+   __m128 z2 = _mm_loadu_ps(state);
+
+   samples += first;
+   for (i = 0; i < frames; i++, samples += channels)
+   {
+      __m128 x = lanes == 4 ? _mm_loadu_ps(samples) :
+         _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)samples);
+      __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+      z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+      z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+
+      if (lanes == 4)
+         _mm_storeu_ps(samples, y);
+      else
+         _mm_storel_pi((__m64*)samples, y);
+   }
+
+   _mm_storeu_ps(state, z1);
+   for (c = 0; c < lanes; c++)
+      bq->z1[first + c] = flush_denormal(state[c]);
+   _mm_storeu_ps(state, z2);
+   for (c = 0; c < lanes; c++)
+      bq->z2[first + c] = flush_denormal(state[c]);
+}
+
+static void biquad_process(struct dsp_biquad *bq, float *samples, size_t frames, unsigned channels)
+{
+   unsigned c = 0;
+   for (; c + 4 <= channels; c += 4)
+      biquad_process_lanes(bq, samples, frames, channels, c, 4);
+   for (; c + 2 <= channels; c += 2)
+      biquad_process_lanes(bq, samples, frames, channels, c, 2);
+   for (; c < channels; c++)
+      biquad_process_channel(bq, samples, frames, channels, c);
+}
+
+// Two stereo frames at a time. Swapping L and R within each frame turns the matrix into two multiplies.
+static void widener_process(struct dsp_widener *w, float *samples, size_t frames, unsigned channels)
+{
+   size_t i = 0;
+   __m128 direct = _mm_set1_ps(w->direct);
+   __m128 cross = _mm_set1_ps(w->cross);
+
+   if (channels == 2)
+   {
+      for (; i + 2 <= frames; i += 2)
+      {
+         __m128 v = _mm_loadu_ps(samples + 2 * i);
+         __m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+         _mm_storeu_ps(samples + 2 * i, _mm_add_ps(_mm_mul_ps(v, direct), _mm_mul_ps(swapped, cross)));
+      }
+   }
+
+   widener_process_frames(w, samples + channels * i, frames - i, channels);
+}
+#elif defined(__ARM_NEON__)
+static void biquad_process_lanes4(struct dsp_biquad *bq, float *samples, size_t frames,
+      unsigned channels, unsigned first)
+{
+   size_t i;
+   unsigned c;
+   float32x4_t z1 = vld1q_f32(bq->z1 + first);
+   float32x4_t z2 = vld1q_f32(bq->z2 + first);
+
+   samples += first;
+   for (i = 0; i < frames; i++, samples += channels)
+   {
+      float32x4_t x = vld1q_f32(samples);
+      float32x4_t y = vmlaq_n_f32(z1, x, bq->b0);
+      z1 = vmlsq_n_f32(vmlaq_n_f32(z2, x, bq->b1), y, bq->a1);
+      z2 = vmlsq_n_f32(vmulq_n_f32(x, bq->b2), y, bq->a2);
+      vst1q_f32(samples, y);
+   }
+
+   vst1q_f32(bq->z1 + first, z1);
+   vst1q_f32(bq->z2 + first, z2);
+   for (c = first; c < first + 4; c++)
+   {
+      bq->z1[c] = flush_denormal(bq->z1[c]);
+      bq->z2[c] = flush_denormal(bq->z2[c]);
+   }
+}
+
+static void biquad_process_lanes2(struct dsp_biquad *bq, float *samples, size_t frames,
+      unsigned channels, unsigned first)
+{
+   size_t i;
+   unsigned c;
+   float32x2_t z1 = vld1_f32(bq->z1 + first);
+   float32x2_t z2 = vld1_f32(bq->z2 + first);
+
+   samples += first;
+   for (i = 0; i < frames; i++, samples += channels)
+   {
+      float32x2_t x = vld1_f32(samples);
+      float32x2_t y = vmla_n_f32(z1, x, bq->b0);
+      z1 = vmls_n_f32(vmla_n_f32(z2, x, bq->b1), y, bq->a1);
+      z2 = vmls_n_f32(vmul_n_f32(x, bq->b2), y, bq->a2);
+      vst1_f32(samples, y);
+   }
+
+   vst1_f32(bq->z1 + first, z1);
+   vst1_f32(bq->z2 + first, z2);
+   for (c = first; c < first + 2; c++)
+   {
+      bq->z1[c] = flush_denormal(bq->z1[c]);
+      bq->z2[c] = flush_denormal(bq->z2[c]);
+   }
+}
+
+static void biquad_process(struct dsp_biquad *bq, float *samples, size_t frames, unsigned channels)
+{
+   unsigned c = 0;
+   for (; c + 4 <= channels; c += 4)
+      biquad_process_lanes4(bq, samples, frames, channels, c);
+   for (; c + 2 <= channels; c += 2)
+      biquad_process_lanes2(bq, samples, frames, channels, c);
+   for (; c < channels; c++)
+      biquad_process_channel(bq, samples, frames, channels, c);
+}
+
+static void widener_process(struct dsp_widener *w, float *samples, size_t frames, unsigned channels)
+{
+   size_t i = 0;
+   if (channels == 2)
+   {
+      for (; i + 2 <= frames; i += 2)
+      {
+         float32x4_t v = vld1q_f32(samples + 2 * i);
+         float32x4_t swapped = vrev64q_f32(v);
+         vst1q_f32(samples + 2 * i, vmlaq_n_f32(vmulq_n_f32(v, w->direct), swapped, w->cross));
+      }
+   }
+
+   widener_process_frames(w, samples + channels * i, frames - i, channels);
+}
+#else
+static void biquad_process(struct dsp_biquad *bq, float *samples, size_t frames, unsigned channels)
+{
+   unsigned c;
+   for (c = 0; c < channels; c++)
+      biquad_process_channel(bq, samples, frames, channels, c);
+}
+
+static void widener_process(struct dsp_widener *w, float *samples, size_t frames, unsigned channels)
+{
+   widener_process_frames(w, samples, frames, channels);
+}
+#endif
+
+// The envelope follower is serial per frame, so this one stays scalar.
+static void compressor_process(struct dsp_compressor *comp, float *samples, size_t frames,
+      unsigned channels)
+{
+   size_t i;
+   unsigned c;
+   float env = comp->env;
+
+   for (i = 0; i < frames; i++, samples += channels)
+   {
+      float level = 0.0f;
+      for (c = 0; c < channels; c++)
+         level = max(level, fabsf(samples[c]));
+
+      float coeff = level > env ? comp->attack : comp->release;
+      env = level + coeff * (env - level);
+
+      float gain = comp->makeup;
+      if (env > comp->threshold)
+         gain *= powf(env / comp->threshold, -comp->slope);
+
+      for (c = 0; c < channels; c++)
+         samples[c] *= gain;
+   }
+
+   comp->env = flush_denormal(env);
+}
+
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp, float *samples, size_t frames)
+{
+   unsigned i;
+   unsigned channels = dsp->channels;
+   for (i = 0; i < dsp->num_stages; i++)
+   {
+      struct dsp_stage *stage = &dsp->stages[i];
+      switch (stage->type)
+      {
+         case DSP_FILTER_WIDENER:
+            if (channels >= 2)
+               widener_process(&stage->u.widener, samples, frames, channels);
+            break;
+
+         case DSP_FILTER_COMPRESSOR:
+         case DSP_FILTER_LIMITER:
+            compressor_process(&stage->u.comp, samples, frames, channels);
+            break;
+
+         default:
+            biquad_process(&stage->u.biquad, samples, frames, channels);
+            break;
+      }
+   }
+}
+
+static void dsp_get_float(config_file_t *conf, const char *name, unsigned i, float *val)
+{
+   char key[64];
+   snprintf(key, sizeof(key), "%s%u", name, i);
+   config_get_float(conf, key, val);
+}
+
+// Coefficients from the Audio EQ Cookbook by Robert Bristow-Johnson.
+static void biquad_init(struct dsp_biquad *bq, enum dsp_filter_type type,
+      float sample_rate, float frequency, float gain, float q)
+{
+   double a = pow(10.0, gain / 40.0);
+   double w0 = 2.0 * M_PI * frequency / sample_rate;
+   double cosw = cos(w0);
+   double alpha = sin(w0) / (2.0 * q);
+   double sqrt_a_alpha = 2.0 * sqrt(a) * alpha;
+   double b0, b1, b2, a0, a1, a2;
+
+   switch (type)
+   {
+      case DSP_FILTER_LOWSHELF:
+         b0 = a * ((a + 1.0) - (a - 1.0) * cosw + sqrt_a_alpha);
+         b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosw);
+         b2 = a * ((a + 1.0) - (a - 1.0) * cosw - sqrt_a_alpha);
+         a0 = (a + 1.0) + (a - 1.0) * cosw + sqrt_a_alpha;
+         a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosw);
+         a2 = (a + 1.0) + (a - 1.0) * cosw - sqrt_a_alpha;
+         break;
+
+      case DSP_FILTER_HIGHSHELF:
+         b0 = a * ((a + 1.0) + (a - 1.0) * cosw + sqrt_a_alpha);
+         b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw);
+         b2 = a * ((a + 1.0) + (a - 1.0) * cosw - sqrt_a_alpha);
+         a0 = (a + 1.0) - (a - 1.0) * cosw + sqrt_a_alpha;
+         a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosw);
+         a2 = (a + 1.0) - (a - 1.0) * cosw - sqrt_a_alpha;
+         break;
+
+      case DSP_FILTER_LOWPASS:
+         b0 = (1.0 - cosw) / 2.0;
+         b1 = 1.0 - cosw;
+         b2 = (1.0 - cosw) / 2.0;
+         a0 = 1.0 + alpha;
+         a1 = -2.0 * cosw;
+         a2 = 1.0 - alpha;
+         break;
+
+      case DSP_FILTER_HIGHPASS:
+         b0 = (1.0 + cosw) / 2.0;
+         b1 = -(1.0 + cosw);
+         b2 = (1.0 + cosw) / 2.0;
+         a0 = 1.0 + alpha;
+         a1 = -2.0 * cosw;
+         a2 = 1.0 - alpha;
+         break;
+
+      default:
+         b0 = 1.0 + alpha * a;
+         b1 = -2.0 * cosw;
+         b2 = 1.0 - alpha * a;
+         a0 = 1.0 + alpha / a;
+         a1 = -2.0 * cosw;
+         a2 = 1.0 - alpha / a;
+         break;
+   }
+
+   memset(bq, 0, sizeof(*bq));
+   bq->b0 = b0 / a0;
+   bq->b1 = b1 / a0;
+   bq->b2 = b2 / a0;
+   bq->a1 = a1 / a0;
+   bq->a2 = a2 / a0;
+}
+
+static bool dsp_parse_stage(config_file_t *conf, struct dsp_stage *stage,
+      unsigned i, float sample_rate)
+{
+   unsigned j;
+   char key[64];
+   char ident[64];
+   snprintf(key, sizeof(key), "filter%u", i);
+   if (!config_get_array(conf, key, ident, sizeof(ident)))
+   {
+      RARCH_ERR("[DSP]: Couldn't find \"%s\".\n", key);
+      return false;
+   }
+
+   for (j = 0; j < ARRAY_SIZE(dsp_filter_types); j++)
+   {
+      if (strcmp(dsp_filter_types[j].ident, ident) == 0)
+         break;
+   }
+
+   if (j == ARRAY_SIZE(dsp_filter_types))
+   {
+      RARCH_ERR("[DSP]: Unknown filter \"%s\" (%s).\n", ident, key);
+      return false;
+   }
+
+   stage->type = dsp_filter_types[j].type;
+
+   switch (stage->type)
+   {
+      case DSP_FILTER_WIDENER:
+      {
+         float width = 1.0f;
+         dsp_get_float(conf, "width", i, &width);
+         stage->u.widener.direct = (1.0f + width) / 2.0f;
+         stage->u.widener.cross = (1.0f - width) / 2.0f;
+         RARCH_LOG("[DSP]: #%u: %s, width %.2f.\n", i, ident, width);
+         break;
+      }
+
+      case DSP_FILTER_COMPRESSOR:
+      case DSP_FILTER_LIMITER:
+      {
+         bool limiter = stage->type == DSP_FILTER_LIMITER;
+         float threshold = limiter ? -1.0f : -12.0f;
+         float ratio = 4.0f;
+         float attack = limiter ? 1.0f : 5.0f;
+         float release = limiter ? 50.0f : 100.0f;
+         float makeup = 0.0f;
+
+         dsp_get_float(conf, "threshold", i, &threshold);
+         if (!limiter)
+            dsp_get_float(conf, "ratio", i, &ratio);
+         dsp_get_float(conf, "attack", i, &attack);
+         dsp_get_float(conf, "release", i, &release);
+         dsp_get_float(conf, "makeup", i, &makeup);
+
+         struct dsp_compressor *comp = &stage->u.comp;
+         memset(comp, 0, sizeof(*comp));
+         comp->threshold = pow(10.0, threshold / 20.0);
+         comp->slope = limiter ? 1.0f : 1.0f - 1.0f / max(ratio, 1.0f);
+         comp->attack = exp(-1000.0 / (max(attack, 0.01f) * sample_rate));
+         comp->release = exp(-1000.0 / (max(release, 0.01f) * sample_rate));
+         comp->makeup = pow(10.0, makeup / 20.0);
+
+         if (limiter)
+            RARCH_LOG("[DSP]: #%u: %s, threshold %.1f dB.\n", i, ident, threshold);
+         else
+            RARCH_LOG("[DSP]: #%u: %s, threshold %.1f dB, ratio %.1f:1.\n", i, ident, threshold, ratio);
+         break;
+      }
+
+      default:
+      {
+         float frequency = 1000.0f;
+         float gain = 0.0f;
+         float q = 0.707f;
+         dsp_get_float(conf, "frequency", i, &frequency);
+         dsp_get_float(conf, "gain", i, &gain);
+         dsp_get_float(conf, "q", i, &q);
+
+         if (frequency <= 0.0f || frequency >= 0.49f * sample_rate)
+         {
+            RARCH_WARN("[DSP]: #%u: Frequency %.1f Hz is out of range, clamping.\n", i, frequency);
+            frequency = min(max(frequency, 1.0f), 0.49f * sample_rate);
+         }
+         if (q <= 0.0f)
+            q = 0.707f;
+
+         biquad_init(&stage->u.biquad, stage->type, sample_rate, frequency, gain, q);
+         RARCH_LOG("[DSP]: #%u: %s, %.1f Hz, %.1f dB, Q %.2f.\n", i, ident, frequency, gain, q);
+         break;
+      }
+   }
+
+   return true;
+}
+
+rarch_dsp_filter_t *rarch_dsp_filter_new(const char *path, float sample_rate, unsigned channels)
+{
+   unsigned i, filters = 0;
+   rarch_dsp_filter_t *dsp = NULL;
+   config_file_t *conf = NULL;
+
+   if (!channels || channels > AUDIO_MAX_CHANNELS)
+   {
+      RARCH_ERR("[DSP]: %u channels are not supported.\n", channels);
+      return NULL;
+   }
+
+   conf = config_file_new(path);
+   if (!conf)
+   {
+      RARCH_ERR("[DSP]: Failed to load DSP filter config \"%s\".\n", path);
+      return NULL;
+   }
+
+   if (!config_get_uint(conf, "filters", &filters))
+   {
+      RARCH_ERR("[DSP]: Cannot find \"filters\" param.\n");
+      goto error;
+   }
+
+   if (filters > RARCH_DSP_MAX_FILTERS)
+   {
+      RARCH_WARN("[DSP]: Only %u filters are supported.\n", RARCH_DSP_MAX_FILTERS);
+      filters = RARCH_DSP_MAX_FILTERS;
+   }
+
+   dsp = (rarch_dsp_filter_t*)calloc(1, sizeof(*dsp));
+   if (!dsp)
+      goto error;
+
+   for (i = 0; i < filters; i++)
+   {
+      if (!dsp_parse_stage(conf, &dsp->stages[i], i, sample_rate))
+         goto error;
+   }
+   dsp->num_stages = filters;
+   dsp->channels = channels;
+
+   config_file_free(conf);
+   return dsp;
+
+error:
+   free(dsp);
+   config_file_free(conf);
+   return NULL;
+}
+
+void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
+{
+   free(dsp);
+}
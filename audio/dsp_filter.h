@@ -0,0 +1,60 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_DSP_FILTER_H__
+#define RARCH_DSP_FILTER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Built-in chain of audio filters, described by a config file:
+//
+// filters = 3
+//
+// filter0 = eq            # Peaking EQ. Also: lowshelf, highshelf, lowpass, highpass.
+// frequency0 = 100        # Center or cutoff frequency in Hz.
+// gain0 = 4.0             # dB, for eq and shelves.
+// q0 = 0.707
+//
+// filter1 = widener
+// width1 = 1.5            # Stereo width. 0.0 is mono, 1.0 leaves the image unchanged.
+//
+// filter2 = compressor    # Also: limiter, which is a compressor with infinite ratio.
+// threshold2 = -12.0      # dB
+// ratio2 = 4.0
+// attack2 = 5.0           # ms
+// release2 = 100.0        # ms
+// makeup2 = 3.0           # dB
+//
+// Filters run in order, in place on interleaved float samples.
+// The widener only acts on the front left/right pair, compressors link all channels.
+#define RARCH_DSP_MAX_FILTERS 16
+
+typedef struct rarch_dsp_filter rarch_dsp_filter_t;
+
+rarch_dsp_filter_t *rarch_dsp_filter_new(const char *path, float sample_rate, unsigned channels);
+void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp);
+
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp, float *samples, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -30,19 +30,25 @@ extern "C" {
 #define RARCH_TRUE 1
 #endif
 
-#define RARCH_DSP_API_VERSION 5
+#define RARCH_DSP_API_VERSION 6
 
 typedef struct rarch_dsp_info
 {
    // Input sample rate that the DSP plugin receives.
    float input_rate;
+
+   // Channels in one input frame. Added in API version 6.
+   // Plugins built for version 5 always receive stereo.
+   // Channels are ordered front left, front right, center, LFE, back left, back right, side left, side right.
+   unsigned input_channels;
 } rarch_dsp_info_t;
 
 typedef struct rarch_dsp_output
 {
    // The DSP plugin has to provide the buffering for the output samples.
    // This is for performance reasons to avoid redundant copying of data.
-   // The samples are laid out in interleaving order: LRLRLRLR
+   // The samples are laid out in interleaving order: LRLRLRLR,
+   // or with as many channels as output_channels() returns.
    // The range of the samples are [-1.0, 1.0]. 
    // This range cannot be exceeded without horrible audio glitches.
    const float *samples;
@@ -57,7 +63,8 @@ typedef struct rarch_dsp_output
 
 typedef struct rarch_dsp_input
 {
-   // Input data for the DSP. The samples are interleaved in order: LRLRLRLR
+   // Input data for the DSP. The samples are interleaved in order: LRLRLRLR,
+   // or with input_channels channels.
    const float *samples;
 
    // Number of frames for input data.
@@ -99,6 +106,11 @@ typedef struct rarch_dsp_plugin
    // GUI events can be processed here in a non-blocking fashion.
    // Can be set to NULL to ignore it.
    void (*events)(void *data);
+
+   // Channels in one output frame, e.g. 6 for an upmixer producing 5.1. Added in API version 6.
+   // Called once after init, and must not change afterwards.
+   // Can be set to NULL, in which case the output has as many channels as the input.
+   unsigned (*output_channels)(void *data);
 } rarch_dsp_plugin_t;
 
 // Called by RetroArch at startup to get the callback struct.
@@ -22,13 +22,42 @@
 
 #include "../general.h"
 
-bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend, const char *ident, double bw_ratio)
+static const rarch_resampler_t *backends[] = {
+   &sinc_resampler,
+   &sinc_lowest_resampler,
+   &sinc_lower_resampler,
+   &sinc_normal_resampler,
+   &sinc_higher_resampler,
+   &sinc_highest_resampler,
+};
+
+static const rarch_resampler_t *find_resampler_driver(const char *ident)
+{
+   unsigned i;
+   if (!ident || !*ident)
+      return backends[0];
+
+   for (i = 0; i < ARRAY_SIZE(backends); i++)
+      if (strcmp(backends[i]->ident, ident) == 0)
+         return backends[i];
+
+   RARCH_WARN("Couldn't find any resampler driver named \"%s\"\n", ident);
+   RARCH_LOG_OUTPUT("Available resampler drivers are:\n");
+   for (i = 0; i < ARRAY_SIZE(backends); i++)
+      RARCH_LOG_OUTPUT("\t%s\n", backends[i]->ident);
+   RARCH_WARN("Falling back to \"%s\".\n", backends[0]->ident);
+
+   return backends[0];
+}
+
+bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend, const char *ident, double bw_ratio,
+      unsigned channels)
 {
    if (*re && *backend)
       (*backend)->free(*re);
 
-   *backend = &sinc_resampler;
-   *re = (*backend)->init(bw_ratio);
+   *backend = find_resampler_driver(ident);
+   *re = (*backend)->init(bw_ratio, channels);
 
    if (!*re)
    {
@@ -42,19 +42,38 @@ struct resampler_data
    double ratio;
 };
 
+// Frames are interleaved, with as many channels as the resampler was created for.
+#define RESAMPLER_MAX_CHANNELS 8
+
 typedef struct rarch_resampler
 {
-   void *(*init)(double bandwidth_mod); // Bandwidth factor. Will be < 1.0 for downsampling, > 1.0 for upsamling. Corresponds to expected resampling ratio.
+   void *(*init)(double bandwidth_mod, unsigned channels); // Bandwidth factor. Will be < 1.0 for downsampling, > 1.0 for upsamling. Corresponds to expected resampling ratio.
    void (*process)(void *re, struct resampler_data *data);
    void (*free)(void *re);
    const char *ident;
 } rarch_resampler_t;
 
+// "sinc" uses the quality tier picked at build time (SINC_*_QUALITY).
+// The others pin a tier, and can be selected with audio_resampler.
 extern const rarch_resampler_t sinc_resampler;
+extern const rarch_resampler_t sinc_lowest_resampler;
+extern const rarch_resampler_t sinc_lower_resampler;
+extern const rarch_resampler_t sinc_normal_resampler;
+extern const rarch_resampler_t sinc_higher_resampler;
+extern const rarch_resampler_t sinc_highest_resampler;
+
+#ifdef RESAMPLER_TEST
+// Lets test programs compare SIMD paths of the sinc resampler ("C", "SSE", "AVX", "NEON").
+// Applies to resamplers created afterwards. NULL picks the best available path.
+// An unavailable path also picks the best one; sinc_test_get_simd() reports what was used.
+void sinc_test_set_simd(const char *simd);
+const char *sinc_test_get_simd(void);
+#endif
 
 // Reallocs resampler. Will free previous handle before allocating a new one.
 // If ident is NULL, first resampler will be used.
-bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend, const char *ident, double bw_ratio);
+bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend, const char *ident, double bw_ratio,
+      unsigned channels);
 
 // Convenience macros.
 // freep makes sure to set handles to NULL to avoid double-free in rarch_resampler_realloc.
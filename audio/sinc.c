@@ -36,89 +36,154 @@
 #include <xmmintrin.h>
 #endif
 
+// The multichannel NEON kernels use intrinsics, so they need NEON enabled at build time.
+#if defined(HAVE_NEON) && defined(__ARM_NEON__)
+#define SINC_HAVE_NEON_MULTI
+#include <arm_neon.h>
+#endif
+
+// AVX kernels can be built into a baseline binary, and are only used when the CPU has it.
+#if defined(__AVX__)
+#define SINC_HAVE_AVX
+#define SINC_TARGET_AVX
+#elif defined(__SSE__) && defined(RARCH_HAVE_TARGET_AVX)
+#define SINC_HAVE_AVX
+#define SINC_TARGET_AVX RARCH_TARGET_AVX
+#endif
+
+#ifdef SINC_HAVE_AVX
+#include <immintrin.h>
+#endif
+
+enum sinc_window
+{
+   SINC_WINDOW_LANCZOS = 0,
+   SINC_WINDOW_KAISER
+};
+
+// Every quality tier is its own resampler backend, so one binary can use any of them.
+struct sinc_quality
+{
+   const char *ident;
+   enum sinc_window window;
+   double kaiser_beta;
+   double cutoff;
+   unsigned phase_bits;
+   unsigned subphase_bits;
+   unsigned sidelobes;
+   bool coeff_lerp; // Interpolate between phases, rather than rounding down to the closest one.
+   // For the little amount of taps the lower tiers use,
+   // SSE1 is faster than AVX for some reason.
+   // By increasing number of sinc taps, the AVX code is clearly faster than SSE1.
+   bool avx;
+};
+
+enum sinc_quality_level
+{
+   SINC_QUALITY_LOWEST = 0,
+   SINC_QUALITY_LOWER,
+   SINC_QUALITY_NORMAL,
+   SINC_QUALITY_HIGHER,
+   SINC_QUALITY_HIGHEST
+};
+
 // Rough SNR values for upsampling:
 // LOWEST: 40 dB
 // LOWER: 55 dB
 // NORMAL: 70 dB
 // HIGHER: 110 dB
 // HIGHEST: 140 dB
+static const struct sinc_quality sinc_qualities[] = {
+   { "lowest",  SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, 2,   false, false },
+   { "lower",   SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, 4,   false, false },
+   { "normal",  SINC_WINDOW_KAISER,  5.5,  0.825, 8,  16, 8,   true,  false },
+   { "higher",  SINC_WINDOW_KAISER,  10.5, 0.90,  10, 14, 32,  true,  true },
+   { "highest", SINC_WINDOW_KAISER,  14.5, 0.962, 10, 14, 128, true,  true },
+};
 
-// TODO, make all this more configurable.
+// The SINC_*_QUALITY build flags now only pick the tier of the plain "sinc" backend.
 #if defined(SINC_LOWEST_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 2
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY SINC_QUALITY_LOWEST
 #elif defined(SINC_LOWER_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SUBPHASE_BITS 10
-#define SINC_COEFF_LERP 0
-#define SIDELOBES 4
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY SINC_QUALITY_LOWER
 #elif defined(SINC_HIGHER_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 10.5
-#define CUTOFF 0.90
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 32
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY SINC_QUALITY_HIGHER
 #elif defined(SINC_HIGHEST_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 14.5
-#define CUTOFF 0.962
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 128
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY SINC_QUALITY_HIGHEST
 #else
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 5.5
-#define CUTOFF 0.825
-#define PHASE_BITS 8
-#define SUBPHASE_BITS 16
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 8
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY SINC_QUALITY_NORMAL
 #endif
 
-// For the little amount of taps we're using,
-// SSE1 is faster than AVX for some reason.
-// AVX code is kept here though as by increasing number
-// of sinc taps, the AVX code is clearly faster than SSE1.
+typedef struct rarch_sinc_resampler rarch_sinc_resampler_t;
 
-#if defined(__AVX__) && ENABLE_AVX
-#include <immintrin.h>
-#endif
-
-#define PHASES (1 << (PHASE_BITS + SUBPHASE_BITS))
-
-#define TAPS (SIDELOBES * 2)
-#define SUBPHASE_MASK ((1 << SUBPHASE_BITS) - 1)
-#define SUBPHASE_MOD (1.0f / (1 << SUBPHASE_BITS))
+// Computes one output frame.
+// phase_table points to the coefficients of the current phase. For lerping kernels,
+// the deltas to the next phase follow, and are weighted by delta.
+typedef void (*sinc_kernel_t)(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer);
 
-typedef struct rarch_sinc_resampler
+struct rarch_sinc_resampler
 {
    float *phase_table;
    float *buffer_l;
    float *buffer_r;
 
+   // Any channel count but stereo keeps history frame by frame in buffer instead,
+   // so kernels can vectorize across the channels of a frame.
+   // Frames are padded to frame_stride floats, and the padding stays zero.
+   float *buffer;
+   unsigned channels;
+   unsigned frame_stride;
+
    unsigned taps;
 
    unsigned ptr;
    uint32_t time;
 
-   // A buffer for phase_table, buffer_l and buffer_r are created in a single calloc().
+   uint32_t phases; // Time it takes to consume one input frame.
+   unsigned subphase_bits;
+   uint32_t subphase_mask;
+   float subphase_mod;
+   unsigned phase_stride; // Floats per phase, including deltas.
+
+   sinc_kernel_t process;
+
+   // Fixed-ratio polyphase path.
+   // When the ratio is a small rational L / M, every output lands exactly on one of L phases.
+   // A bank of those phases replaces coefficient interpolation,
+   // and time is counted in 1 / L input frames instead.
+   const struct sinc_quality *quality;
+   double cutoff;
+   float *fixed_table;
+   double fixed_ratio; // Ratio fixed_table was built for.
+   double fixed_miss; // Last ratio which wasn't a usable rational, to skip the search next time.
+   uint32_t fixed_phases; // L
+   uint32_t fixed_step; // M
+   uint32_t fixed_time;
+   bool fixed; // Whether fixed_time rather than time holds the current position.
+   sinc_kernel_t process_fixed;
+
+   // A buffer for phase_table and the history buffers are created in a single calloc().
    // Ensure that we get as good cache locality as we can hope for.
    float *main_buffer;
-} rarch_sinc_resampler_t;
+};
+
+#ifdef RESAMPLER_TEST
+// Test programs are built for the machine they run on.
+static uint64_t sinc_cpu_features(void)
+{
+   uint64_t cpu = 0;
+#ifdef __AVX__
+   cpu |= RETRO_SIMD_AVX;
+#endif
+#ifdef HAVE_NEON
+   cpu |= RETRO_SIMD_NEON;
+#endif
+   return cpu;
+}
+#else
+#define sinc_cpu_features rarch_get_cpu_features
+#endif
 
 static inline double sinc(double val)
 {
@@ -128,12 +193,6 @@ static inline double sinc(double val)
       return sin(val) / val;
 }
 
-#if defined(SINC_WINDOW_LANCZOS)
-static inline double window_function(double index)
-{
-   return sinc(M_PI * index);
-}
-#elif defined(SINC_WINDOW_KAISER)
 // Modified Bessel function of first order.
 // Check Wiki for mathematical definition ...
 static inline double besseli0(double x)
@@ -162,19 +221,19 @@ static inline double besseli0(double x)
    return sum;
 }
 
-static inline double window_function(double index)
+static inline double window_function(const struct sinc_quality *quality, double index)
 {
-   return besseli0(SINC_WINDOW_KAISER_BETA * sqrt(1 - index * index));
+   if (quality->window == SINC_WINDOW_LANCZOS)
+      return sinc(M_PI * index);
+   else
+      return besseli0(quality->kaiser_beta * sqrt(1 - index * index));
 }
-#else
-#error "No SINC window function defined."
-#endif
 
-static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
+static void init_sinc_table(const struct sinc_quality *quality, double cutoff,
       float *phase_table, int phases, int taps, bool calculate_delta)
 {
    int i, j, p;
-   double window_mod = window_function(0.0); // Need to normalize w(0) to 1.0.
+   double window_mod = window_function(quality, 0.0); // Need to normalize w(0) to 1.0.
    int stride = calculate_delta ? 2 : 1;
 
    double sidelobes = taps / 2.0;
@@ -187,7 +246,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          window_phase = 2.0 * window_phase - 1.0; // [-1, 1)
          double sinc_phase = sidelobes * window_phase;
 
-         float val = cutoff * sinc(M_PI * sinc_phase * cutoff) * window_function(window_phase) / window_mod;
+         float val = cutoff * sinc(M_PI * sinc_phase * cutoff) * window_function(quality, window_phase) / window_mod;
          phase_table[i * stride * taps + j] = val;
       }
    }
@@ -211,7 +270,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          window_phase = 2.0 * window_phase - 1.0; // (-1, 1]
          double sinc_phase = sidelobes * window_phase;
 
-         float val = cutoff * sinc(M_PI * sinc_phase * cutoff) * window_function(window_phase) / window_mod;
+         float val = cutoff * sinc(M_PI * sinc_phase * cutoff) * window_function(quality, window_phase) / window_mod;
          float delta = (val - phase_table[phase * stride * taps + j]);
          phase_table[(phase * stride + 1) * taps + j] = delta;
       }
@@ -238,8 +297,11 @@ static void aligned_free__(void *ptr)
    free(p[-1]);
 }
 
-#if !(defined(__AVX__) && ENABLE_AVX) && !defined(__SSE__)
-static inline void process_sinc_C(rarch_sinc_resampler_t *resamp, float *out_buffer)
+// Kernels are written once with taps and lerp as arguments.
+// The entry points below pass constants where they can, so each gets compiled for its tier.
+
+static inline void process_sinc_C_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, unsigned taps, bool lerp)
 {
    unsigned i;
    float sum_l = 0.0f;
@@ -247,23 +309,14 @@ static inline void process_sinc_C(rarch_sinc_resampler_t *resamp, float *out_buf
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
-   unsigned taps  = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
    const float *delta_table = phase_table + taps;
-   float delta = (float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
 
    for (i = 0; i < taps; i++)
    {
-#if SINC_COEFF_LERP
-      float sinc_val = phase_table[i] + delta_table[i] * delta;
-#else
       float sinc_val = phase_table[i];
-#endif
+      if (lerp)
+         sinc_val += delta_table[i] * delta;
+
       sum_l         += buffer_l[i] * sinc_val;
       sum_r         += buffer_r[i] * sinc_val;
    }
@@ -271,11 +324,22 @@ static inline void process_sinc_C(rarch_sinc_resampler_t *resamp, float *out_buf
    out_buffer[0] = sum_l;
    out_buffer[1] = sum_r;
 }
-#endif
 
-#if defined(__AVX__) && ENABLE_AVX
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+static void process_sinc_C(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_C_common(resamp, phase_table, delta, out_buffer, resamp->taps, false);
+}
+
+static void process_sinc_C_lerp(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_C_common(resamp, phase_table, delta, out_buffer, resamp->taps, true);
+}
+
+#ifdef SINC_HAVE_AVX
+static inline SINC_TARGET_AVX void process_sinc_AVX_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, bool lerp)
 {
    unsigned i;
    __m256 sum_l = _mm256_setzero_ps();
@@ -285,26 +349,18 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
    const float *delta_table = phase_table + taps;
-   __m256 delta = _mm256_set1_ps((float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   __m256 delta_vec = _mm256_set1_ps(delta);
 
    for (i = 0; i < taps; i += 8)
    {
       __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
       __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
 
-#if SINC_COEFF_LERP
-      __m256 deltas = _mm256_load_ps(delta_table + i);
-      __m256 sinc = _mm256_add_ps(_mm256_load_ps(phase_table + i), _mm256_mul_ps(deltas, delta));
-#else
       __m256 sinc = _mm256_load_ps(phase_table + i);
-#endif
+      if (lerp)
+         sinc = _mm256_add_ps(sinc, _mm256_mul_ps(_mm256_load_ps(delta_table + i), delta_vec));
+
       sum_l       = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
       sum_r       = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
    }
@@ -322,9 +378,23 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    _mm_store_ss(out_buffer + 0, _mm256_extractf128_ps(res_l, 0));
    _mm_store_ss(out_buffer + 1, _mm256_extractf128_ps(res_r, 0));
 }
-#elif defined(__SSE__)
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+
+static SINC_TARGET_AVX void process_sinc_AVX(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_AVX_common(resamp, phase_table, delta, out_buffer, false);
+}
+
+static SINC_TARGET_AVX void process_sinc_AVX_lerp(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_AVX_common(resamp, phase_table, delta, out_buffer, true);
+}
+#endif
+
+#ifdef __SSE__
+static inline void process_sinc_SSE_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, unsigned taps, bool lerp)
 {
    unsigned i;
    __m128 sum_l = _mm_setzero_ps();
@@ -333,27 +403,18 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
-   unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
    const float *delta_table = phase_table + taps;
-   __m128 delta = _mm_set1_ps((float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   __m128 delta_vec = _mm_set1_ps(delta);
 
    for (i = 0; i < taps; i += 4)
    {
       __m128 buf_l = _mm_loadu_ps(buffer_l + i);
       __m128 buf_r = _mm_loadu_ps(buffer_r + i);
 
-#if SINC_COEFF_LERP
-      __m128 deltas = _mm_load_ps(delta_table + i);
-      __m128 sinc = _mm_add_ps(_mm_load_ps(phase_table + i), _mm_mul_ps(deltas, delta));
-#else
       __m128 sinc = _mm_load_ps(phase_table + i);
-#endif
+      if (lerp)
+         sinc = _mm_add_ps(sinc, _mm_mul_ps(_mm_load_ps(delta_table + i), delta_vec));
+
       sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, sinc));
       sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, sinc));
    }
@@ -371,7 +432,7 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
 
    // sum   = {R1, R1, L1, L1 } + { R1, R0, L1, L0 }
-   // sum   = { X,  R,  X,  L } 
+   // sum   = { X,  R,  X,  L }
 
    // Store L
    _mm_store_ss(out_buffer + 0, sum);
@@ -379,39 +440,566 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    // movehl { X, R, X, L } == { X, R, X, R }
    _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
 }
-#elif defined(HAVE_NEON)
 
-#if SINC_COEFF_LERP
-#error "NEON asm does not support SINC lerp."
-#endif
+static void process_sinc_SSE(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, resamp->taps, false);
+}
+
+static void process_sinc_SSE_lerp(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, resamp->taps, true);
+}
+
+// Tap counts of the lower tiers when upsampling. The loop unrolls completely.
+static void process_sinc_SSE_4(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, 4, false);
+}
+
+static void process_sinc_SSE_8(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, 8, false);
+}
 
-// Need to make this function pointer as Android doesn't have built-in targets
-// for NEON and plain ARMv7a.
-static void (*process_sinc_func)(rarch_sinc_resampler_t *resamp, float *out_buffer);
+// The normal tier on the fixed-ratio path.
+static void process_sinc_SSE_16(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, 16, false);
+}
 
+static void process_sinc_SSE_lerp_16(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_common(resamp, phase_table, delta, out_buffer, 16, true);
+}
+#endif
+
+#ifdef HAVE_NEON
 // Assumes that taps >= 8, and that taps is a multiple of 8.
+// Does not interpolate coefficients, so only serves the tiers which don't either.
 void process_sinc_neon_asm(float *out, const float *left, const float *right, const float *coeff, unsigned taps);
 
-static void process_sinc_neon(rarch_sinc_resampler_t *resamp, float *out_buffer)
+static void process_sinc_neon(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
 {
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
+   (void)delta;
+
+   process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, resamp->taps);
+}
+#endif
 
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
+// Kernels for other channel counts. Every tap scales a whole frame of history,
+// so these vectorize across channels rather than taps.
+
+static inline void process_sinc_C_multi_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, bool lerp)
+{
+   unsigned i, c;
+   float sum[RESAMPLER_MAX_CHANNELS] = {0.0f};
+   unsigned taps = resamp->taps;
+   unsigned channels = resamp->channels;
+   unsigned stride = resamp->frame_stride;
+   const float *buffer = resamp->buffer + resamp->ptr * stride;
+   const float *delta_table = phase_table + taps;
+
+   for (i = 0; i < taps; i++, buffer += stride)
+   {
+      float sinc_val = phase_table[i];
+      if (lerp)
+         sinc_val += delta_table[i] * delta;
+
+      for (c = 0; c < channels; c++)
+         sum[c] += buffer[c] * sinc_val;
+   }
+
+   for (c = 0; c < channels; c++)
+      out_buffer[c] = sum[c];
+}
+
+static void process_sinc_C_multi(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_C_multi_common(resamp, phase_table, delta, out_buffer, false);
+}
+
+static void process_sinc_C_multi_lerp(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_C_multi_common(resamp, phase_table, delta, out_buffer, true);
+}
+
+#ifdef SINC_HAVE_AVX
+// 5 to 8 channels fit in one register.
+// Taps are a multiple of 8 here. Four of them are in flight at once,
+// as a single accumulator would be bound by add latency.
+static inline SINC_TARGET_AVX void process_sinc_AVX_multi_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, bool lerp)
+{
+   unsigned i;
+   float sum_buf[8];
+   __m256 sum0 = _mm256_setzero_ps();
+   __m256 sum1 = _mm256_setzero_ps();
+   __m256 sum2 = _mm256_setzero_ps();
+   __m256 sum3 = _mm256_setzero_ps();
    unsigned taps = resamp->taps;
-   const float *phase_table = resamp->phase_table + phase * taps;
+   const float *buffer = resamp->buffer + resamp->ptr * 8;
+   const float *delta_table = phase_table + taps;
+   __m128 delta_vec = _mm_set1_ps(delta);
+
+   for (i = 0; i < taps; i += 4, buffer += 32)
+   {
+      __m128 sinc = _mm_load_ps(phase_table + i);
+      if (lerp)
+         sinc = _mm_add_ps(sinc, _mm_mul_ps(_mm_load_ps(delta_table + i), delta_vec));
+
+      // No broadcast from register without AVX2.
+      __m256 sinc2 = _mm256_insertf128_ps(_mm256_castps128_ps256(sinc), sinc, 1);
+      sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_load_ps(buffer +  0), _mm256_permute_ps(sinc2, 0x00)));
+      sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_load_ps(buffer +  8), _mm256_permute_ps(sinc2, 0x55)));
+      sum2 = _mm256_add_ps(sum2, _mm256_mul_ps(_mm256_load_ps(buffer + 16), _mm256_permute_ps(sinc2, 0xaa)));
+      sum3 = _mm256_add_ps(sum3, _mm256_mul_ps(_mm256_load_ps(buffer + 24), _mm256_permute_ps(sinc2, 0xff)));
+   }
 
-   process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, taps);
+   // Padding lanes must not spill into the next output frame.
+   _mm256_storeu_ps(sum_buf, _mm256_add_ps(_mm256_add_ps(sum0, sum1), _mm256_add_ps(sum2, sum3)));
+   memcpy(out_buffer, sum_buf, resamp->channels * sizeof(float));
+}
+
+static SINC_TARGET_AVX void process_sinc_AVX_multi(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_AVX_multi_common(resamp, phase_table, delta, out_buffer, false);
+}
+
+static SINC_TARGET_AVX void process_sinc_AVX_multi_lerp(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_AVX_multi_common(resamp, phase_table, delta, out_buffer, true);
 }
-#else // Plain ol' C99
-#define process_sinc_func process_sinc_C
 #endif
 
-static void resampler_sinc_process(void *re_, struct resampler_data *data)
+#ifdef __SSE__
+// Frames are padded to 4 or 8 floats, the stride is passed as a constant.
+// Four taps at a time, each with its own accumulators.
+static inline void process_sinc_SSE_multi_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, unsigned stride, bool lerp)
 {
-   rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
+   unsigned i, j;
+   float sum_buf[8];
+   __m128 sum_lo[4], sum_hi[4];
+   unsigned taps = resamp->taps;
+   const float *buffer = resamp->buffer + resamp->ptr * stride;
+   const float *delta_table = phase_table + taps;
+   __m128 delta_vec = _mm_set1_ps(delta);
+
+   for (j = 0; j < 4; j++)
+      sum_lo[j] = sum_hi[j] = _mm_setzero_ps();
+
+   for (i = 0; i < taps; i += 4, buffer += 4 * stride)
+   {
+      __m128 sinc = _mm_load_ps(phase_table + i);
+      if (lerp)
+         sinc = _mm_add_ps(sinc, _mm_mul_ps(_mm_load_ps(delta_table + i), delta_vec));
+
+      __m128 sinc_tap[4];
+      sinc_tap[0] = _mm_shuffle_ps(sinc, sinc, _MM_SHUFFLE(0, 0, 0, 0));
+      sinc_tap[1] = _mm_shuffle_ps(sinc, sinc, _MM_SHUFFLE(1, 1, 1, 1));
+      sinc_tap[2] = _mm_shuffle_ps(sinc, sinc, _MM_SHUFFLE(2, 2, 2, 2));
+      sinc_tap[3] = _mm_shuffle_ps(sinc, sinc, _MM_SHUFFLE(3, 3, 3, 3));
+
+      for (j = 0; j < 4; j++)
+      {
+         sum_lo[j] = _mm_add_ps(sum_lo[j], _mm_mul_ps(_mm_load_ps(buffer + j * stride), sinc_tap[j]));
+         if (stride == 8)
+            sum_hi[j] = _mm_add_ps(sum_hi[j], _mm_mul_ps(_mm_load_ps(buffer + j * stride + 4), sinc_tap[j]));
+      }
+   }
+
+   _mm_storeu_ps(sum_buf, _mm_add_ps(_mm_add_ps(sum_lo[0], sum_lo[1]), _mm_add_ps(sum_lo[2], sum_lo[3])));
+   _mm_storeu_ps(sum_buf + 4, _mm_add_ps(_mm_add_ps(sum_hi[0], sum_hi[1]), _mm_add_ps(sum_hi[2], sum_hi[3])));
+   memcpy(out_buffer, sum_buf, resamp->channels * sizeof(float));
+}
+
+static void process_sinc_SSE_multi_4(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_multi_common(resamp, phase_table, delta, out_buffer, 4, false);
+}
+
+static void process_sinc_SSE_multi_lerp_4(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_multi_common(resamp, phase_table, delta, out_buffer, 4, true);
+}
+
+static void process_sinc_SSE_multi_8(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_multi_common(resamp, phase_table, delta, out_buffer, 8, false);
+}
+
+static void process_sinc_SSE_multi_lerp_8(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_SSE_multi_common(resamp, phase_table, delta, out_buffer, 8, true);
+}
+#endif
+
+#ifdef SINC_HAVE_NEON_MULTI
+static inline void process_sinc_neon_multi_common(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer, unsigned stride, bool lerp)
+{
+   unsigned i;
+   float sum_buf[8];
+   float32x4_t sum_lo0 = vdupq_n_f32(0.0f), sum_lo1 = vdupq_n_f32(0.0f);
+   float32x4_t sum_hi0 = vdupq_n_f32(0.0f), sum_hi1 = vdupq_n_f32(0.0f);
+   unsigned taps = resamp->taps;
+   const float *buffer = resamp->buffer + resamp->ptr * stride;
+   const float *delta_table = phase_table + taps;
+
+   for (i = 0; i < taps; i += 4, buffer += 4 * stride)
+   {
+      float32x4_t sinc = vld1q_f32(phase_table + i);
+      if (lerp)
+         sinc = vmlaq_n_f32(sinc, vld1q_f32(delta_table + i), delta);
+
+      float32x2_t sinc_lo = vget_low_f32(sinc);
+      float32x2_t sinc_hi = vget_high_f32(sinc);
+
+      sum_lo0 = vmlaq_lane_f32(sum_lo0, vld1q_f32(buffer + 0 * stride), sinc_lo, 0);
+      sum_lo1 = vmlaq_lane_f32(sum_lo1, vld1q_f32(buffer + 1 * stride), sinc_lo, 1);
+      sum_lo0 = vmlaq_lane_f32(sum_lo0, vld1q_f32(buffer + 2 * stride), sinc_hi, 0);
+      sum_lo1 = vmlaq_lane_f32(sum_lo1, vld1q_f32(buffer + 3 * stride), sinc_hi, 1);
+      if (stride == 8)
+      {
+         sum_hi0 = vmlaq_lane_f32(sum_hi0, vld1q_f32(buffer + 0 * stride + 4), sinc_lo, 0);
+         sum_hi1 = vmlaq_lane_f32(sum_hi1, vld1q_f32(buffer + 1 * stride + 4), sinc_lo, 1);
+         sum_hi0 = vmlaq_lane_f32(sum_hi0, vld1q_f32(buffer + 2 * stride + 4), sinc_hi, 0);
+         sum_hi1 = vmlaq_lane_f32(sum_hi1, vld1q_f32(buffer + 3 * stride + 4), sinc_hi, 1);
+      }
+   }
+
+   vst1q_f32(sum_buf, vaddq_f32(sum_lo0, sum_lo1));
+   vst1q_f32(sum_buf + 4, vaddq_f32(sum_hi0, sum_hi1));
+   memcpy(out_buffer, sum_buf, resamp->channels * sizeof(float));
+}
+
+static void process_sinc_neon_multi_4(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_neon_multi_common(resamp, phase_table, delta, out_buffer, 4, false);
+}
+
+static void process_sinc_neon_multi_lerp_4(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_neon_multi_common(resamp, phase_table, delta, out_buffer, 4, true);
+}
+
+static void process_sinc_neon_multi_8(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_neon_multi_common(resamp, phase_table, delta, out_buffer, 8, false);
+}
+
+static void process_sinc_neon_multi_lerp_8(const rarch_sinc_resampler_t *resamp,
+      const float *phase_table, float delta, float *out_buffer)
+{
+   process_sinc_neon_multi_common(resamp, phase_table, delta, out_buffer, 8, true);
+}
+#endif
+
+enum sinc_simd
+{
+   SINC_SIMD_C = 0,
+   SINC_SIMD_SSE,
+   SINC_SIMD_AVX,
+   SINC_SIMD_NEON
+};
 
-   uint32_t ratio = PHASES / data->ratio;
+static const char *sinc_simd_names[] = { "C", "SSE", "AVX", "NEON" };
+
+static bool simd_available(enum sinc_simd simd, const struct sinc_quality *quality,
+      unsigned channels, uint64_t cpu)
+{
+   (void)quality;
+   (void)channels;
+   (void)cpu;
+
+   switch (simd)
+   {
+#ifdef SINC_HAVE_AVX
+      // Across channels, AVX only pays off when a frame fills the register.
+      case SINC_SIMD_AVX:
+         if (channels != 2)
+            return channels > 4 && (cpu & RETRO_SIMD_AVX);
+         return quality->avx && (cpu & RETRO_SIMD_AVX);
+#endif
+#ifdef __SSE__
+      case SINC_SIMD_SSE:
+         return true;
+#endif
+#ifdef HAVE_NEON
+      // Need to check at runtime as Android doesn't have built-in targets
+      // for NEON and plain ARMv7a.
+      // The stereo kernel is assembly without coefficient interpolation, the others are not.
+      case SINC_SIMD_NEON:
+         if (channels != 2)
+#ifdef SINC_HAVE_NEON_MULTI
+            return cpu & RETRO_SIMD_NEON;
+#else
+            return false;
+#endif
+         return !quality->coeff_lerp && (cpu & RETRO_SIMD_NEON);
+#endif
+      case SINC_SIMD_C:
+         return true;
+      default:
+         return false;
+   }
+}
+
+#ifdef RESAMPLER_TEST
+static const char *sinc_test_simd;
+static const char *sinc_test_simd_used;
+
+void sinc_test_set_simd(const char *simd)
+{
+   sinc_test_simd = simd;
+}
+
+const char *sinc_test_get_simd(void)
+{
+   return sinc_test_simd_used;
+}
+#endif
+
+static enum sinc_simd find_simd(const struct sinc_quality *quality, unsigned channels)
+{
+   unsigned i;
+   // In order of preference.
+   static const enum sinc_simd simds[] = {
+      SINC_SIMD_AVX, SINC_SIMD_SSE, SINC_SIMD_NEON, SINC_SIMD_C,
+   };
+   uint64_t cpu = sinc_cpu_features();
+
+#ifdef RESAMPLER_TEST
+   for (i = 0; sinc_test_simd && i < sizeof(sinc_simd_names) / sizeof(sinc_simd_names[0]); i++)
+   {
+      if (strcmp(sinc_test_simd, sinc_simd_names[i]) == 0 &&
+            simd_available((enum sinc_simd)i, quality, channels, cpu))
+         return (enum sinc_simd)i;
+   }
+#endif
+
+   for (i = 0; i < sizeof(simds) / sizeof(simds[0]); i++)
+   {
+      if (simd_available(simds[i], quality, channels, cpu))
+         return simds[i];
+   }
+
+   return SINC_SIMD_C;
+}
+
+static sinc_kernel_t find_kernel_multi(enum sinc_simd simd, unsigned frame_stride, bool lerp)
+{
+   (void)frame_stride;
+
+   switch (simd)
+   {
+#ifdef SINC_HAVE_AVX
+      case SINC_SIMD_AVX:
+         return lerp ? process_sinc_AVX_multi_lerp : process_sinc_AVX_multi;
+#endif
+#ifdef __SSE__
+      case SINC_SIMD_SSE:
+         if (frame_stride == 4)
+            return lerp ? process_sinc_SSE_multi_lerp_4 : process_sinc_SSE_multi_4;
+         return lerp ? process_sinc_SSE_multi_lerp_8 : process_sinc_SSE_multi_8;
+#endif
+#ifdef SINC_HAVE_NEON_MULTI
+      case SINC_SIMD_NEON:
+         if (frame_stride == 4)
+            return lerp ? process_sinc_neon_multi_lerp_4 : process_sinc_neon_multi_4;
+         return lerp ? process_sinc_neon_multi_lerp_8 : process_sinc_neon_multi_8;
+#endif
+      default:
+         return lerp ? process_sinc_C_multi_lerp : process_sinc_C_multi;
+   }
+}
+
+static sinc_kernel_t find_kernel(enum sinc_simd simd, unsigned channels, unsigned frame_stride,
+      unsigned taps, bool lerp)
+{
+   if (channels != 2)
+      return find_kernel_multi(simd, frame_stride, lerp);
+
+   switch (simd)
+   {
+#ifdef SINC_HAVE_AVX
+      case SINC_SIMD_AVX:
+         return lerp ? process_sinc_AVX_lerp : process_sinc_AVX;
+#endif
+#ifdef __SSE__
+      case SINC_SIMD_SSE:
+         if (lerp)
+            return taps == 16 ? process_sinc_SSE_lerp_16 : process_sinc_SSE_lerp;
+         else if (taps == 4)
+            return process_sinc_SSE_4;
+         else if (taps == 8)
+            return process_sinc_SSE_8;
+         else if (taps == 16)
+            return process_sinc_SSE_16;
+         return process_sinc_SSE;
+#endif
+#ifdef HAVE_NEON
+      case SINC_SIMD_NEON:
+         return process_sinc_neon;
+#endif
+      default:
+         return lerp ? process_sinc_C_lerp : process_sinc_C;
+   }
+}
+
+// Largest L of the fixed-ratio path.
+// Covers the usual rates, e.g. 44100 -> 48000 is 160 / 147, 22050 -> 48000 is 320 / 147.
+#define SINC_FIXED_MAX_PHASES 1024
+// How close a ratio must be to L / M. The drift this causes is well below what rate control corrects anyway.
+#define SINC_FIXED_TOLERANCE 1e-9
+
+// Finds L / M close to ratio with L <= SINC_FIXED_MAX_PHASES, using continued fractions.
+static bool find_rational(double ratio, uint32_t *num, uint32_t *den)
+{
+   unsigned i;
+   double x = ratio;
+   uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+
+   for (i = 0; i < 32; i++)
+   {
+      double a_f = floor(x);
+      if (a_f > SINC_FIXED_MAX_PHASES * 2.0)
+         return false;
+
+      uint64_t a = (uint64_t)a_f;
+      uint64_t p = a * p1 + p0;
+      uint64_t q = a * q1 + q0;
+      if (p > SINC_FIXED_MAX_PHASES || q > SINC_FIXED_MAX_PHASES * 8)
+         return false;
+
+      if (fabs((double)p / q - ratio) <= SINC_FIXED_TOLERANCE * ratio)
+      {
+         *num = p;
+         *den = q;
+         return true;
+      }
+
+      p0 = p1; q0 = q1;
+      p1 = p;  q1 = q;
+
+      if (x - a_f < 1e-12)
+         return false;
+      x = 1.0 / (x - a_f);
+   }
+
+   return false;
+}
+
+static bool build_fixed_table(rarch_sinc_resampler_t *re, double ratio)
+{
+   uint32_t num, den;
+   if (!find_rational(ratio, &num, &den))
+      return false;
+
+   if (num != re->fixed_phases || !re->fixed_table)
+   {
+      float *table = (float*)aligned_alloc__(128, sizeof(float) * num * re->taps);
+      if (!table)
+         return false;
+
+      init_sinc_table(re->quality, re->cutoff, table, num, re->taps, false);
+
+      // Convert the position before the old bank goes away.
+      if (re->fixed)
+      {
+         re->time = (uint64_t)re->fixed_time * re->phases / re->fixed_phases;
+         re->fixed = false;
+      }
+
+      if (re->fixed_table)
+         aligned_free__(re->fixed_table);
+      re->fixed_table = table;
+      re->fixed_phases = num;
+   }
+
+   re->fixed_step = den;
+   re->fixed_ratio = ratio;
+   return true;
+}
+
+// Picks the path for this ratio, and carries the current position over when it changes.
+static bool use_fixed_path(rarch_sinc_resampler_t *re, double ratio)
+{
+   bool fixed = false;
+
+   if (ratio == re->fixed_ratio && re->fixed_table)
+      fixed = true;
+   else if (ratio != re->fixed_miss)
+   {
+      fixed = build_fixed_table(re, ratio);
+      if (!fixed)
+         re->fixed_miss = ratio;
+   }
+
+   if (fixed && !re->fixed)
+   {
+      // Round to the closest phase. Moves the output by less than half a phase, once.
+      re->fixed_time = ((uint64_t)re->time * re->fixed_phases + (re->phases >> 1)) / re->phases;
+      re->fixed = true;
+   }
+   else if (!fixed && re->fixed)
+   {
+      re->time = (uint64_t)re->fixed_time * re->phases / re->fixed_phases;
+      re->fixed = false;
+   }
+
+   return fixed;
+}
+
+static inline void resampler_sinc_push(rarch_sinc_resampler_t *re, const float *input)
+{
+   // Push in reverse to make filter more obvious.
+   if (!re->ptr)
+      re->ptr = re->taps;
+   re->ptr--;
+
+   if (re->channels == 2)
+   {
+      re->buffer_l[re->ptr + re->taps] = re->buffer_l[re->ptr] = input[0];
+      re->buffer_r[re->ptr + re->taps] = re->buffer_r[re->ptr] = input[1];
+   }
+   else
+   {
+      size_t size = re->channels * sizeof(float);
+      memcpy(re->buffer + re->ptr * re->frame_stride, input, size);
+      memcpy(re->buffer + (re->ptr + re->taps) * re->frame_stride, input, size);
+   }
+}
+
+static size_t resampler_sinc_process_fixed(rarch_sinc_resampler_t *re, struct resampler_data *data)
+{
+   uint32_t phases = re->fixed_phases;
+   uint32_t step = re->fixed_step;
+   unsigned taps = re->taps;
+   unsigned channels = re->channels;
+   sinc_kernel_t process = re->process_fixed;
 
    const float *input = data->data_in;
    float *output      = data->data_out;
@@ -420,41 +1008,87 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
 
    while (frames)
    {
-      while (frames && re->time >= PHASES)
+      while (frames && re->fixed_time >= phases)
+      {
+         resampler_sinc_push(re, input);
+         input += channels;
+         re->fixed_time -= phases;
+         frames--;
+      }
+
+      while (re->fixed_time < phases)
       {
-         // Push in reverse to make filter more obvious.
-         if (!re->ptr)
-            re->ptr = re->taps;
-         re->ptr--;
+         process(re, re->fixed_table + re->fixed_time * taps, 0.0f, output);
+         output += channels;
+         out_frames++;
+         re->fixed_time += step;
+      }
+   }
+
+   return out_frames;
+}
+
+static size_t resampler_sinc_process_interp(rarch_sinc_resampler_t *re, struct resampler_data *data)
+{
+   uint32_t phases = re->phases;
+   uint32_t ratio = phases / data->ratio;
+   unsigned phase_size = re->taps * re->phase_stride;
+   unsigned channels = re->channels;
 
-         re->buffer_l[re->ptr + re->taps] = re->buffer_l[re->ptr] = *input++;
-         re->buffer_r[re->ptr + re->taps] = re->buffer_r[re->ptr] = *input++;
+   const float *input = data->data_in;
+   float *output      = data->data_out;
+   size_t frames         = data->input_frames;
+   size_t out_frames     = 0;
 
-         re->time -= PHASES;
+   while (frames)
+   {
+      while (frames && re->time >= phases)
+      {
+         resampler_sinc_push(re, input);
+         input += channels;
+         re->time -= phases;
          frames--;
       }
 
-      while (re->time < PHASES)
+      while (re->time < phases)
       {
-         process_sinc_func(re, output);
-         output += 2;
+         unsigned phase = re->time >> re->subphase_bits;
+         float delta = (float)(re->time & re->subphase_mask) * re->subphase_mod;
+
+         re->process(re, re->phase_table + phase * phase_size, delta, output);
+         output += channels;
          out_frames++;
          re->time += ratio;
       }
    }
 
-   data->output_frames = out_frames;
+   return out_frames;
+}
+
+static void resampler_sinc_process(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
+
+   if (use_fixed_path(re, data->ratio))
+      data->output_frames = resampler_sinc_process_fixed(re, data);
+   else
+      data->output_frames = resampler_sinc_process_interp(re, data);
 }
 
 static void resampler_sinc_free(void *re)
 {
    rarch_sinc_resampler_t *resampler = (rarch_sinc_resampler_t*)re;
    if (resampler)
-      aligned_free__(resampler->main_buffer);
+   {
+      if (resampler->main_buffer)
+         aligned_free__(resampler->main_buffer);
+      if (resampler->fixed_table)
+         aligned_free__(resampler->fixed_table);
+   }
    free(resampler);
 }
 
-static void *resampler_sinc_new(double bandwidth_mod)
+static void *resampler_sinc_new(const struct sinc_quality *quality, double bandwidth_mod, unsigned channels)
 {
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)calloc(1, sizeof(*re));
    if (!re)
@@ -462,8 +1096,8 @@ static void *resampler_sinc_new(double bandwidth_mod)
 
    memset(re, 0, sizeof(*re));
 
-   re->taps = TAPS;
-   double cutoff = CUTOFF;
+   re->taps = quality->sidelobes * 2;
+   double cutoff = quality->cutoff;
 
    // Downsampling, must lower cutoff, and extend number of taps accordingly to keep same stopband attenuation.
    if (bandwidth_mod < 1.0)
@@ -472,42 +1106,54 @@ static void *resampler_sinc_new(double bandwidth_mod)
       re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
    }
 
-   // Be SIMD-friendly.
-#if (defined(__AVX__) && ENABLE_AVX) || defined(HAVE_NEON)
-   re->taps = (re->taps + 7) & ~7;
-#else
-   re->taps = (re->taps + 3) & ~3;
-#endif
+   if (!channels || channels > RESAMPLER_MAX_CHANNELS)
+      goto error;
 
-   size_t phase_elems = (1 << PHASE_BITS) * re->taps;
-#if SINC_COEFF_LERP
-   phase_elems *= 2;
-#endif
-   size_t elems = phase_elems + 4 * re->taps;
+   re->channels = channels;
+   re->frame_stride = channels <= 4 ? 4 : 8;
+
+   enum sinc_simd simd = find_simd(quality, channels);
+
+   // Be SIMD-friendly.
+   if (simd == SINC_SIMD_AVX || simd == SINC_SIMD_NEON)
+      re->taps = (re->taps + 7) & ~7;
+   else
+      re->taps = (re->taps + 3) & ~3;
+
+   re->phases = 1 << (quality->phase_bits + quality->subphase_bits);
+   re->subphase_bits = quality->subphase_bits;
+   re->subphase_mask = (1 << quality->subphase_bits) - 1;
+   re->subphase_mod = 1.0f / (1 << quality->subphase_bits);
+   re->phase_stride = quality->coeff_lerp ? 2 : 1;
+   re->process = find_kernel(simd, channels, re->frame_stride, re->taps, quality->coeff_lerp);
+   re->process_fixed = find_kernel(simd, channels, re->frame_stride, re->taps, false);
+   re->quality = quality;
+   re->cutoff = cutoff;
+
+   size_t phase_elems = (1 << quality->phase_bits) * re->taps;
+   if (quality->coeff_lerp)
+      phase_elems *= 2;
+   size_t elems = phase_elems + 2 * re->taps * (channels == 2 ? 2 : re->frame_stride);
 
    re->main_buffer = (float*)aligned_alloc__(128, sizeof(float) * elems);
    if (!re->main_buffer)
       goto error;
+   memset(re->main_buffer, 0, sizeof(float) * elems);
 
    re->phase_table = re->main_buffer;
    re->buffer_l = re->main_buffer + phase_elems;
    re->buffer_r = re->buffer_l + 2 * re->taps;
+   re->buffer = re->buffer_l;
 
-   init_sinc_table(re, cutoff, re->phase_table, 1 << PHASE_BITS, re->taps, SINC_COEFF_LERP);
+   init_sinc_table(quality, cutoff, re->phase_table, 1 << quality->phase_bits, re->taps, quality->coeff_lerp);
 
-#if defined(__AVX__) && ENABLE_AVX
-   RARCH_LOG("Sinc resampler [AVX]\n");
-#elif defined(__SSE__)
-   RARCH_LOG("Sinc resampler [SSE]\n");
-#elif defined(HAVE_NEON)
-   unsigned cpu = rarch_get_cpu_features();
-   process_sinc_func = cpu & RETRO_SIMD_NEON ? process_sinc_neon : process_sinc_C;
-   RARCH_LOG("Sinc resampler [%s]\n", cpu & RETRO_SIMD_NEON ? "NEON" : "C");
-#else
-   RARCH_LOG("Sinc resampler [C]\n");
+#ifdef RESAMPLER_TEST
+   sinc_test_simd_used = sinc_simd_names[simd];
 #endif
 
-   RARCH_LOG("SINC params (%u phase bits, %u taps).\n", PHASE_BITS, re->taps);
+   RARCH_LOG("Sinc resampler [%s]\n", sinc_simd_names[simd]);
+   RARCH_LOG("SINC params (%s quality, %u phase bits, %u taps, %u channels).\n",
+         quality->ident, quality->phase_bits, re->taps, channels);
    return re;
 
 error:
@@ -515,10 +1161,75 @@ error:
    return NULL;
 }
 
+static void *resampler_sinc_default_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_DEFAULT_QUALITY], bandwidth_mod, channels);
+}
+
+static void *resampler_sinc_lowest_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_QUALITY_LOWEST], bandwidth_mod, channels);
+}
+
+static void *resampler_sinc_lower_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_QUALITY_LOWER], bandwidth_mod, channels);
+}
+
+static void *resampler_sinc_normal_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_QUALITY_NORMAL], bandwidth_mod, channels);
+}
+
+static void *resampler_sinc_higher_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_QUALITY_HIGHER], bandwidth_mod, channels);
+}
+
+static void *resampler_sinc_highest_new(double bandwidth_mod, unsigned channels)
+{
+   return resampler_sinc_new(&sinc_qualities[SINC_QUALITY_HIGHEST], bandwidth_mod, channels);
+}
+
 const rarch_resampler_t sinc_resampler = {
-   resampler_sinc_new,
+   resampler_sinc_default_new,
    resampler_sinc_process,
    resampler_sinc_free,
    "sinc",
 };
 
+const rarch_resampler_t sinc_lowest_resampler = {
+   resampler_sinc_lowest_new,
+   resampler_sinc_process,
+   resampler_sinc_free,
+   "sinc-lowest",
+};
+
+const rarch_resampler_t sinc_lower_resampler = {
+   resampler_sinc_lower_new,
+   resampler_sinc_process,
+   resampler_sinc_free,
+   "sinc-lower",
+};
+
+const rarch_resampler_t sinc_normal_resampler = {
+   resampler_sinc_normal_new,
+   resampler_sinc_process,
+   resampler_sinc_free,
+   "sinc-normal",
+};
+
+const rarch_resampler_t sinc_higher_resampler = {
+   resampler_sinc_higher_new,
+   resampler_sinc_process,
+   resampler_sinc_free,
+   "sinc-higher",
+};
+
+const rarch_resampler_t sinc_highest_resampler = {
+   resampler_sinc_highest_new,
+   resampler_sinc_process,
+   resampler_sinc_free,
+   "sinc-highest",
+};
+
@@ -0,0 +1,265 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures resampler throughput in ns per output frame for every sinc quality,
+// SIMD path, channel layout and a few common ratios.
+// Results can be saved as a baseline and later compared against it to catch regressions.
+
+#include "../resampler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_FRAMES 1024
+#define BENCH_BLOCKS 256
+#define BENCH_RUNS 5
+#define BENCH_MAX_RATIO 2.0
+#define BENCH_MAX_CHANNELS 8
+
+static const char *backends[] = {
+   "sinc-lowest",
+   "sinc-lower",
+   "sinc-normal",
+   "sinc-higher",
+   "sinc-highest",
+};
+
+static const char *simds[] = { "C", "SSE", "AVX", "NEON" };
+
+// Stereo, 5.1 and 7.1. The latter two go through the kernels which vectorize across channels.
+static const unsigned channel_counts[] = { 2, 6, 8 };
+
+// The last ratio is not rational with a small denominator and exercises the interpolating path.
+static const struct
+{
+   double in_rate;
+   double out_rate;
+} ratios[] = {
+   { 44100.0, 48000.0 },
+   { 32000.0, 48000.0 },
+   { 48000.0, 44100.0 },
+   { 32040.5, 48000.0 },
+};
+
+struct bench_result
+{
+   char name[64];
+   double ns_per_frame;
+};
+
+static double get_time_ns(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec * 1000000000.0 + tv.tv_nsec;
+}
+
+// Returns best-of-runs ns per output frame, or a negative value if the combination is unavailable.
+static double bench_one(const char *backend, const char *simd, double ratio, unsigned channels,
+      const float *input, float *output)
+{
+   sinc_test_set_simd(simd);
+
+   void *re = NULL;
+   const rarch_resampler_t *resampler = NULL;
+   if (!rarch_resampler_realloc(&re, &resampler, backend, ratio, channels))
+      return -1.0;
+
+   const char *used = sinc_test_get_simd();
+   if (!used || strcmp(used, simd) != 0)
+   {
+      rarch_resampler_freep(&resampler, &re);
+      return -1.0;
+   }
+
+   double best = INFINITY;
+   for (unsigned run = 0; run < BENCH_RUNS; run++)
+   {
+      size_t frames = 0;
+      double start = get_time_ns();
+
+      for (unsigned i = 0; i < BENCH_BLOCKS; i++)
+      {
+         struct resampler_data data = {
+            .data_in = input,
+            .data_out = output,
+            .input_frames = BENCH_FRAMES,
+            .ratio = ratio,
+         };
+
+         rarch_resampler_process(resampler, re, &data);
+         frames += data.output_frames;
+      }
+
+      double ns = (get_time_ns() - start) / frames;
+      if (ns < best)
+         best = ns;
+   }
+
+   rarch_resampler_freep(&resampler, &re);
+   return best;
+}
+
+static unsigned run_bench(struct bench_result *results, unsigned max_results)
+{
+   float *input = malloc(BENCH_FRAMES * BENCH_MAX_CHANNELS * sizeof(float));
+   float *output = malloc((size_t)(BENCH_FRAMES * BENCH_MAX_RATIO + 16) * BENCH_MAX_CHANNELS * sizeof(float));
+   if (!input || !output)
+   {
+      free(input);
+      free(output);
+      return 0;
+   }
+
+   srand(0);
+   for (unsigned i = 0; i < BENCH_FRAMES * BENCH_MAX_CHANNELS; i++)
+      input[i] = (2.0f * rand()) / RAND_MAX - 1.0f;
+
+   unsigned count = 0;
+   for (unsigned b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+   {
+      for (unsigned s = 0; s < sizeof(simds) / sizeof(simds[0]); s++)
+      {
+         for (unsigned c = 0; c < sizeof(channel_counts) / sizeof(channel_counts[0]); c++)
+         {
+            for (unsigned r = 0; r < sizeof(ratios) / sizeof(ratios[0]) && count < max_results; r++)
+            {
+               double ratio = ratios[r].out_rate / ratios[r].in_rate;
+               double ns = bench_one(backends[b], simds[s], ratio, channel_counts[c], input, output);
+               if (ns < 0.0)
+                  break;
+
+               struct bench_result *res = &results[count++];
+               snprintf(res->name, sizeof(res->name), "%s/%s/%uch/%g->%g",
+                     backends[b], simds[s], channel_counts[c], ratios[r].in_rate, ratios[r].out_rate);
+               res->ns_per_frame = ns;
+            }
+         }
+      }
+   }
+
+   sinc_test_set_simd(NULL);
+   free(input);
+   free(output);
+   return count;
+}
+
+static const struct bench_result *find_result(const struct bench_result *results, unsigned count,
+      const char *name)
+{
+   for (unsigned i = 0; i < count; i++)
+      if (strcmp(results[i].name, name) == 0)
+         return &results[i];
+   return NULL;
+}
+
+static bool save_baseline(const char *path, const struct bench_result *results, unsigned count)
+{
+   FILE *file = fopen(path, "w");
+   if (!file)
+      return false;
+
+   for (unsigned i = 0; i < count; i++)
+      fprintf(file, "%s %.3f\n", results[i].name, results[i].ns_per_frame);
+
+   fclose(file);
+   return true;
+}
+
+// Returns nonzero if any entry in the baseline regressed by more than tolerance.
+// Entries missing from either side are reported, but do not fail the check,
+// since the available SIMD paths depend on the machine.
+static int check_baseline(const char *path, double tolerance,
+      const struct bench_result *results, unsigned count)
+{
+   FILE *file = fopen(path, "r");
+   if (!file)
+   {
+      fprintf(stderr, "Failed to open baseline \"%s\".\n", path);
+      return 1;
+   }
+
+   int ret = 0;
+   char name[64];
+   double baseline;
+   while (fscanf(file, "%63s %lf", name, &baseline) == 2)
+   {
+      const struct bench_result *res = find_result(results, count, name);
+      if (!res)
+      {
+         printf("SKIP %-40s not available.\n", name);
+         continue;
+      }
+
+      double change = res->ns_per_frame / baseline - 1.0;
+      bool pass = change <= tolerance;
+      printf("%s %-40s %8.2f ns/frame (baseline %8.2f, %+6.1f %%)\n",
+            pass ? "PASS" : "FAIL", name, res->ns_per_frame, baseline, 100.0 * change);
+
+      if (!pass)
+         ret = 1;
+   }
+
+   fclose(file);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   const char *save_path = NULL;
+   const char *check_path = NULL;
+   double tolerance = 0.2;
+
+   if (argc == 3 && strcmp(argv[1], "--save") == 0)
+      save_path = argv[2];
+   else if ((argc == 3 || argc == 4) && strcmp(argv[1], "--check") == 0)
+   {
+      check_path = argv[2];
+      if (argc == 4)
+         tolerance = strtod(argv[3], NULL);
+   }
+   else if (argc != 1)
+   {
+      fprintf(stderr, "Usage: %s [--save <baseline> | --check <baseline> [tolerance]]\n", argv[0]);
+      fprintf(stderr, "       Tolerance is the allowed slowdown relative to baseline (default: 0.2).\n");
+      return 1;
+   }
+
+   static struct bench_result results[sizeof(backends) / sizeof(backends[0]) *
+      sizeof(simds) / sizeof(simds[0]) * sizeof(channel_counts) / sizeof(channel_counts[0]) *
+      sizeof(ratios) / sizeof(ratios[0])];
+   unsigned count = run_bench(results, sizeof(results) / sizeof(results[0]));
+   if (!count)
+   {
+      fprintf(stderr, "No resampler could be benchmarked.\n");
+      return 1;
+   }
+
+   if (check_path)
+      return check_baseline(check_path, tolerance, results, count);
+
+   for (unsigned i = 0; i < count; i++)
+      printf("%-40s %8.2f ns/frame\n", results[i].name, results[i].ns_per_frame);
+
+   if (save_path && !save_baseline(save_path, results, count))
+   {
+      fprintf(stderr, "Failed to save baseline \"%s\".\n", save_path);
+      return 1;
+   }
+
+   return 0;
+}
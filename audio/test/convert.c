@@ -0,0 +1,208 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks every audio_convert backend the CPU supports against the C version,
+// and measures throughput in GB/s (bytes read + written) for each kernel.
+// Returns nonzero if any backend disagrees with C.
+// Tests build with -march=native, so the C version is likely auto-vectorized here.
+
+#include "../utils.h"
+#include "../../libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define CONVERT_SAMPLES (16 * 1024 + 7) // Odd size to exercise the scalar tails.
+#define CONVERT_RUNS 5
+#define CONVERT_ITERATIONS 256
+#define CONVERT_DOWNMIX_CHANNELS 6
+
+static double get_time_ns(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec * 1000000000.0 + tv.tv_nsec;
+}
+
+static bool backend_available(const audio_convert_backend_t *backend)
+{
+   if ((backend->simd & RETRO_SIMD_SSE4) && !__builtin_cpu_supports("sse4.1"))
+      return false;
+   if ((backend->simd & RETRO_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+      return false;
+   return true;
+}
+
+enum convert_kernel
+{
+   KERNEL_S16_TO_FLOAT = 0,
+   KERNEL_FLOAT_TO_S16,
+   KERNEL_DOWNMIX,
+   KERNEL_COUNT
+};
+
+static const char *kernel_names[] = { "s16_to_float", "float_to_s16", "downmix_float" };
+
+static void run_kernel(const audio_convert_backend_t *backend, enum convert_kernel kernel,
+      float *f, int16_t *s, float *mix)
+{
+   switch (kernel)
+   {
+      case KERNEL_S16_TO_FLOAT:
+         backend->s16_to_float(f, s, CONVERT_SAMPLES, 0.5f);
+         break;
+      case KERNEL_FLOAT_TO_S16:
+         backend->float_to_s16(s, f, CONVERT_SAMPLES);
+         break;
+      case KERNEL_DOWNMIX:
+         backend->downmix_float(mix, f, CONVERT_SAMPLES / CONVERT_DOWNMIX_CHANNELS,
+               CONVERT_DOWNMIX_CHANNELS);
+         break;
+      default:
+         break;
+   }
+}
+
+static size_t kernel_bytes(enum convert_kernel kernel)
+{
+   switch (kernel)
+   {
+      case KERNEL_S16_TO_FLOAT:
+      case KERNEL_FLOAT_TO_S16:
+         return CONVERT_SAMPLES * (sizeof(float) + sizeof(int16_t));
+      case KERNEL_DOWNMIX:
+         return (CONVERT_SAMPLES / CONVERT_DOWNMIX_CHANNELS) * (CONVERT_DOWNMIX_CHANNELS + 2) * sizeof(float);
+      default:
+         return 0;
+   }
+}
+
+static double bench_kernel(const audio_convert_backend_t *backend, enum convert_kernel kernel,
+      const float *input_f, const int16_t *input_s, float *f, int16_t *s, float *mix)
+{
+   double best = INFINITY;
+   for (unsigned run = 0; run < CONVERT_RUNS; run++)
+   {
+      memcpy(f, input_f, CONVERT_SAMPLES * sizeof(float));
+      memcpy(s, input_s, CONVERT_SAMPLES * sizeof(int16_t));
+
+      double start = get_time_ns();
+      for (unsigned i = 0; i < CONVERT_ITERATIONS; i++)
+         run_kernel(backend, kernel, f, s, mix);
+      double ns = get_time_ns() - start;
+      if (ns < best)
+         best = ns;
+   }
+
+   return (double)kernel_bytes(kernel) * CONVERT_ITERATIONS / best;
+}
+
+// s16 output is allowed to differ by one step, since SIMD paths round rather than truncate.
+static bool verify_backend(const audio_convert_backend_t *backend,
+      const float *input_f, const int16_t *input_s)
+{
+   static float ref_f[CONVERT_SAMPLES], test_f[CONVERT_SAMPLES];
+   static int16_t ref_s[CONVERT_SAMPLES], test_s[CONVERT_SAMPLES];
+   bool ok = true;
+
+   audio_convert_s16_to_float_C(ref_f, input_s, CONVERT_SAMPLES, 0.5f);
+   backend->s16_to_float(test_f, input_s, CONVERT_SAMPLES, 0.5f);
+   for (unsigned i = 0; i < CONVERT_SAMPLES; i++)
+   {
+      if (fabsf(ref_f[i] - test_f[i]) > 1e-7f)
+      {
+         printf("FAIL %s s16_to_float: sample %u is %f, expected %f.\n",
+               backend->ident, i, test_f[i], ref_f[i]);
+         ok = false;
+         break;
+      }
+   }
+
+   audio_convert_float_to_s16_C(ref_s, input_f, CONVERT_SAMPLES);
+   backend->float_to_s16(test_s, input_f, CONVERT_SAMPLES);
+   for (unsigned i = 0; i < CONVERT_SAMPLES; i++)
+   {
+      if (abs(ref_s[i] - test_s[i]) > 1)
+      {
+         printf("FAIL %s float_to_s16: sample %u (%f) is %d, expected %d.\n",
+               backend->ident, i, input_f[i], test_s[i], ref_s[i]);
+         ok = false;
+         break;
+      }
+   }
+
+   for (unsigned channels = 2; channels <= 8; channels++)
+   {
+      size_t frames = CONVERT_SAMPLES / channels;
+      audio_convert_downmix_float_C(ref_f, input_f, frames, channels);
+      memcpy(test_f, input_f, frames * channels * sizeof(float));
+      backend->downmix_float(test_f, test_f, frames, channels); // In place.
+      for (unsigned i = 0; i < frames * 2; i++)
+      {
+         if (fabsf(ref_f[i] - test_f[i]) > 1e-5f * fmaxf(1.0f, fabsf(ref_f[i])))
+         {
+            printf("FAIL %s downmix_float: %u channels, sample %u is %f, expected %f.\n",
+                  backend->ident, channels, i, test_f[i], ref_f[i]);
+            ok = false;
+            break;
+         }
+      }
+   }
+
+   return ok;
+}
+
+int main(void)
+{
+   static float input_f[CONVERT_SAMPLES], f[CONVERT_SAMPLES], mix[CONVERT_SAMPLES];
+   static int16_t input_s[CONVERT_SAMPLES], s[CONVERT_SAMPLES];
+
+   // Floats go past full scale to check saturation.
+   srand(0);
+   for (unsigned i = 0; i < CONVERT_SAMPLES; i++)
+   {
+      input_f[i] = (4.0f * rand()) / RAND_MAX - 2.0f;
+      input_s[i] = (int16_t)(rand() & 0xffff);
+   }
+   input_f[0] = 1e10f;
+   input_f[1] = -1e10f;
+
+   int ret = 0;
+   for (unsigned b = 0; audio_convert_backends[b]; b++)
+   {
+      const audio_convert_backend_t *backend = audio_convert_backends[b];
+      if (!backend_available(backend))
+      {
+         printf("SKIP %-8s not supported by CPU.\n", backend->ident);
+         continue;
+      }
+
+      if (!verify_backend(backend, input_f, input_s))
+      {
+         ret = 1;
+         continue;
+      }
+
+      for (unsigned k = 0; k < KERNEL_COUNT; k++)
+      {
+         double gbps = bench_kernel(backend, (enum convert_kernel)k, input_f, input_s, f, s, mix);
+         printf("%-8s %-14s %7.2f GB/s\n", backend->ident, kernel_names[k], gbps);
+      }
+   }
+
+   return ret;
+}
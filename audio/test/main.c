@@ -56,7 +56,7 @@ int main(int argc, char *argv[])
 
    const rarch_resampler_t *resampler = NULL;
    void *re = NULL;
-   if (!rarch_resampler_realloc(&re, &resampler, NULL, out_rate / in_rate))
+   if (!rarch_resampler_realloc(&re, &resampler, NULL, out_rate / in_rate, 2))
    {
       fprintf(stderr, "Failed to allocate resampler ...\n");
       return 1;
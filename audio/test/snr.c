@@ -39,6 +39,7 @@ struct snr_result
 {
    double snr;
    double gain;
+   double thd; // Power of harmonics 2 through 5 relative to the signal, in dB.
 
    unsigned alias_freq[3];
    double alias_power[3];
@@ -218,6 +219,10 @@ static void calculate_snr(struct snr_result *res,
    double signal = cabs(butterfly_buf[in_rate] * butterfly_buf[in_rate]);
    butterfly_buf[in_rate] = 0.0;
 
+   double harmonics = 0.0;
+   for (unsigned h = 2; h <= 5 && h * in_rate <= max_rate; h++)
+      harmonics += cabs(butterfly_buf[h * in_rate] * butterfly_buf[h * in_rate]);
+
    double noise = 0.0;
 
    // Aliased frequencies above half the original sampling rate are not considered.
@@ -230,21 +235,25 @@ static void calculate_snr(struct snr_result *res,
 
    res->snr = 10.0 * log10(signal / noise);
    res->gain = 10.0 * log10(signal);
+   res->thd = harmonics > 0.0 ? 10.0 * log10(harmonics / signal) : -INFINITY;
 
    for (unsigned i = 0; i < 3; i++)
       res->alias_power[i] = 10.0 * log10(res->alias_power[i]);
 }
 
-int main(int argc, char *argv[])
+struct snr_summary
 {
-   if (argc != 2)
-   {
-      fprintf(stderr, "Usage: %s <ratio> (out-rate is fixed for FFT).\n", argv[0]);
-      return 1;
-   }
-
-   double ratio = strtod(argv[1], NULL);
+   double worst_snr;
+   float worst_snr_freq;
+   double worst_thd;
+   float worst_thd_freq;
+};
 
+// Runs a sweep of sines through the resampler.
+// Only frequencies up to passband * the lower Nyquist frequency count towards the summary.
+static bool run_sweep(const char *backend, double ratio, double passband, bool verbose,
+      struct snr_summary *summary)
+{
    const unsigned fft_samples = 1024 * 128;
    unsigned out_rate = fft_samples / 2;
    unsigned in_rate = round(out_rate / ratio);
@@ -269,10 +278,13 @@ int main(int argc, char *argv[])
 
    void *re = NULL;
    const rarch_resampler_t *resampler = NULL;
-   if (!rarch_resampler_realloc(&re, &resampler, NULL, ratio))
-      return 1;
+   if (!rarch_resampler_realloc(&re, &resampler, backend, ratio, 2))
+      return false;
 
-   test_fft();
+   summary->worst_snr = INFINITY;
+   summary->worst_snr_freq = 0.0f;
+   summary->worst_thd = -INFINITY;
+   summary->worst_thd_freq = 0.0f;
 
    for (unsigned i = 0; i < sizeof(freq_list) / sizeof(freq_list[0]); i++)
    {
@@ -297,18 +309,123 @@ int main(int argc, char *argv[])
 
       calculate_snr(&res, freq, max_freq, output + fft_samples - 2048, butterfly_buf, fft_samples);
 
-      printf("SNR @ w = %5.3f : %6.2lf dB, Gain: %6.1lf dB\n",
-            freq_list[i], res.snr, res.gain);
+      if (verbose)
+      {
+         printf("SNR @ w = %5.3f : %6.2lf dB, Gain: %6.1lf dB, THD: %7.2lf dB\n",
+               freq_list[i], res.snr, res.gain, res.thd);
 
-      printf("\tAliases: #1 (w = %5.3f, %6.2lf dB), #2 (w = %5.3f, %6.2lf dB), #3 (w = %5.3f, %6.2lf dB)\n",
-            res.alias_freq[0] / (float)in_rate, res.alias_power[0],
-            res.alias_freq[1] / (float)in_rate, res.alias_power[1],
-            res.alias_freq[2] / (float)in_rate, res.alias_power[2]);
+         printf("\tAliases: #1 (w = %5.3f, %6.2lf dB), #2 (w = %5.3f, %6.2lf dB), #3 (w = %5.3f, %6.2lf dB)\n",
+               res.alias_freq[0] / (float)in_rate, res.alias_power[0],
+               res.alias_freq[1] / (float)in_rate, res.alias_power[1],
+               res.alias_freq[2] / (float)in_rate, res.alias_power[2]);
+      }
+
+      if (freq > passband * max_freq)
+         continue;
+
+      if (res.snr < summary->worst_snr)
+      {
+         summary->worst_snr = res.snr;
+         summary->worst_snr_freq = freq_list[i];
+      }
+
+      if (res.thd > summary->worst_thd)
+      {
+         summary->worst_thd = res.thd;
+         summary->worst_thd_freq = freq_list[i];
+      }
    }
 
    rarch_resampler_freep(&resampler, &re);
    free(input);
    free(output);
    free(butterfly_buf);
+   return true;
 }
 
+// Quality regression limits are what the resamplers measured at the time of writing, minus CHECK_MARGIN dB.
+// Each tier is only checked up to its own share of the lower Nyquist frequency, where it is still in its passband.
+// THD far below CHECK_THD_FLOOR is rounding noise, which differs between SIMD paths, so limits stop there.
+#define CHECK_MARGIN 3.0
+#define CHECK_THD_FLOOR -120.0
+#define CHECK_RATIOS 3
+
+static const double check_ratios[CHECK_RATIOS] = {
+   48000.0 / 44100.0,
+   48000.0 / 32000.0,
+   44100.0 / 48000.0,
+};
+
+// Measured SNR and THD per ratio above.
+static const struct
+{
+   const char *backend;
+   double passband;
+   double snr[CHECK_RATIOS];
+   double thd[CHECK_RATIOS];
+} check_limits[] = {
+   { "sinc-lowest",  0.5, {  27.5,  48.0,  48.6 }, { -158.7,  -49.1, -102.1 } },
+   { "sinc-lower",   0.6, {  38.9,  57.3,  51.4 }, { -173.0,  -63.9, -109.2 } },
+   { "sinc-normal",  0.8, {  65.4,  65.4,  65.5 }, { -121.1,  -71.0, -104.7 } },
+   { "sinc-higher",  0.8, { 113.6, 125.5, 121.4 }, { -171.1, -137.1, -149.5 } },
+   { "sinc-highest", 0.8, { 132.1, 134.7, 133.6 }, { -169.6, -165.4, -163.5 } },
+};
+
+static int run_check(void)
+{
+   int ret = 0;
+   for (unsigned i = 0; i < sizeof(check_limits) / sizeof(check_limits[0]); i++)
+   {
+      for (unsigned j = 0; j < CHECK_RATIOS; j++)
+      {
+         struct snr_summary summary;
+         double min_snr = check_limits[i].snr[j] - CHECK_MARGIN;
+         double max_thd = check_limits[i].thd[j] + CHECK_MARGIN;
+         if (max_thd < CHECK_THD_FLOOR)
+            max_thd = CHECK_THD_FLOOR;
+
+         if (!run_sweep(check_limits[i].backend, check_ratios[j], check_limits[i].passband, false, &summary))
+         {
+            printf("FAIL %-12s ratio %.4f: failed to create resampler.\n",
+                  check_limits[i].backend, check_ratios[j]);
+            ret = 1;
+            continue;
+         }
+
+         bool pass = summary.worst_snr >= min_snr && summary.worst_thd <= max_thd;
+
+         printf("%s %-12s ratio %.4f: worst SNR %6.2f dB (w = %5.3f, limit %5.1f), worst THD %7.2f dB (w = %5.3f, limit %6.1f)\n",
+               pass ? "PASS" : "FAIL", check_limits[i].backend, check_ratios[j],
+               summary.worst_snr, summary.worst_snr_freq, min_snr,
+               summary.worst_thd, summary.worst_thd_freq, max_thd);
+
+         if (!pass)
+            ret = 1;
+      }
+   }
+
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   if (argc == 2 && strcmp(argv[1], "--check") == 0)
+      return run_check();
+
+   if (argc != 2 && argc != 3)
+   {
+      fprintf(stderr, "Usage: %s <ratio> [resampler] (out-rate is fixed for FFT).\n", argv[0]);
+      fprintf(stderr, "       %s --check (checks every resampler against quality limits).\n", argv[0]);
+      return 1;
+   }
+
+   double ratio = strtod(argv[1], NULL);
+
+   test_fft();
+
+   struct snr_summary summary;
+   if (!run_sweep(argc == 3 ? argv[2] : NULL, ratio, 1.0, true, &summary))
+      return 1;
+
+   return 0;
+}
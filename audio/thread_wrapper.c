@@ -17,7 +17,7 @@
 #include "../thread.h"
 #include "../general.h"
 #include "../performance.h"
-#include "../fifo_buffer.h"
+#include "../spsc_fifo.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -181,3 +181,241 @@ bool rarch_threaded_audio_init(const audio_driver_t **out_driver, void **out_dat
    return true;
 }
 
+
+typedef struct audio_push_thread
+{
+   const audio_driver_t *driver;
+   void *driver_data;
+
+   spsc_fifo_t *fifo;
+   size_t buffer_size;
+   size_t chunk_size;
+   size_t frame_size; // The fifo and the driver only ever see whole frames.
+
+   sthread_t *thread;
+   slock_t *lock; // Serializes calls into the real driver.
+   scond_t *cond;
+   volatile bool alive;
+   volatile bool dead;
+   bool stopped;
+   bool nonblock;
+} audio_push_thread_t;
+
+static void audio_push_thread_loop(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+
+   uint8_t *buf = (uint8_t*)malloc(thr->chunk_size);
+   if (!buf)
+   {
+      RARCH_ERR("[Audio Thread]: Failed to allocate buffer.\n");
+      goto end;
+   }
+
+   while (spsc_fifo_wait_read_avail(thr->fifo, thr->frame_size))
+   {
+      size_t size = min(spsc_fifo_read_avail(thr->fifo), thr->chunk_size);
+      size -= size % thr->frame_size;
+      if (!size) // Shut down with less than a frame left.
+         break;
+      spsc_fifo_read(thr->fifo, buf, size);
+
+      slock_lock(thr->lock);
+      while (thr->stopped && thr->alive)
+         scond_wait(thr->cond, thr->lock);
+
+      // The real driver is always blocking. It paces this thread, not the main thread.
+      size_t written = 0;
+      while (thr->alive && written < size)
+      {
+         ssize_t ret = thr->driver->write(thr->driver_data, buf + written, size - written);
+         if (ret < 0)
+         {
+            RARCH_ERR("[Audio Thread]: Audio driver failed to write.\n");
+            thr->dead = true;
+            break;
+         }
+         written += ret;
+      }
+      slock_unlock(thr->lock);
+
+      if (!thr->alive || thr->dead)
+         break;
+   }
+
+end:
+   // Wake up a blocking writer.
+   thr->dead = true;
+   spsc_fifo_shutdown(thr->fifo);
+   free(buf);
+}
+
+static void audio_push_thread_free(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   if (!thr)
+      return;
+
+   if (thr->thread)
+   {
+      slock_lock(thr->lock);
+      thr->alive = false;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+
+      spsc_fifo_shutdown(thr->fifo);
+      sthread_join(thr->thread);
+   }
+
+   if (thr->driver_data)
+      thr->driver->free(thr->driver_data);
+   if (thr->fifo)
+      spsc_fifo_free(thr->fifo);
+   if (thr->lock)
+      slock_free(thr->lock);
+   if (thr->cond)
+      scond_free(thr->cond);
+   free(thr);
+}
+
+static bool audio_push_thread_stop(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   slock_lock(thr->lock);
+   bool ret = thr->driver->stop(thr->driver_data);
+   thr->stopped = true;
+   slock_unlock(thr->lock);
+   return ret;
+}
+
+static bool audio_push_thread_start(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   slock_lock(thr->lock);
+   bool ret = thr->driver->start(thr->driver_data);
+   thr->stopped = false;
+   scond_signal(thr->cond);
+   slock_unlock(thr->lock);
+   return ret;
+}
+
+// Only changes how the main thread writes into the fifo.
+// The driver keeps blocking, so the fifo simply fills up and excess audio is dropped.
+static void audio_push_thread_set_nonblock_state(void *data, bool state)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   thr->nonblock = state;
+}
+
+static bool audio_push_thread_use_float(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   return thr->driver->use_float && thr->driver->use_float(thr->driver_data);
+}
+
+static ssize_t audio_push_thread_write(void *data, const void *buf, size_t size)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+
+   if (thr->dead)
+      return -1;
+
+   if (thr->nonblock)
+   {
+      size_t avail = spsc_fifo_write_avail(thr->fifo);
+      size_t write_amt = min(avail - avail % thr->frame_size, size);
+      spsc_fifo_write(thr->fifo, buf, write_amt);
+      return write_amt;
+   }
+
+   size_t written = 0;
+   while (written < size)
+   {
+      // Only sleeps when the fifo has no room for a frame. Fails if the thread died.
+      if (!spsc_fifo_wait_write_avail(thr->fifo, thr->frame_size))
+         return -1;
+
+      size_t avail = spsc_fifo_write_avail(thr->fifo);
+      size_t write_amt = min(avail - avail % thr->frame_size, size - written);
+      spsc_fifo_write(thr->fifo, (const uint8_t*)buf + written, write_amt);
+      written += write_amt;
+   }
+
+   return written;
+}
+
+// Rate control sees the fifo. The thread drains it at the rate of the device.
+static size_t audio_push_thread_write_avail(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   if (thr->dead)
+      return 0;
+   return spsc_fifo_write_avail(thr->fifo);
+}
+
+static size_t audio_push_thread_buffer_size(void *data)
+{
+   audio_push_thread_t *thr = (audio_push_thread_t*)data;
+   return thr->buffer_size;
+}
+
+static const audio_driver_t audio_push_thread = {
+   NULL,
+   audio_push_thread_write,
+   audio_push_thread_stop,
+   audio_push_thread_start,
+   audio_push_thread_set_nonblock_state,
+   audio_push_thread_free,
+   audio_push_thread_use_float,
+   "audio-push-thread",
+   audio_push_thread_write_avail,
+   audio_push_thread_buffer_size,
+};
+
+bool rarch_threaded_push_audio_init(const audio_driver_t **out_driver, void **out_data,
+      const char *device, unsigned out_rate, unsigned latency,
+      const audio_driver_t *driver)
+{
+   void *audio_handle = driver->init(device, out_rate, latency);
+   if (!audio_handle)
+      return false;
+
+   audio_push_thread_t *thr = (audio_push_thread_t*)calloc(1, sizeof(*thr));
+   if (!thr)
+   {
+      driver->free(audio_handle);
+      return false;
+   }
+
+   thr->driver = driver;
+   thr->driver_data = audio_handle;
+
+   // The device buffer already covers the requested latency, so keep the fifo at half of it.
+   size_t frame_size = (driver->use_float && driver->use_float(audio_handle) ? sizeof(float) : sizeof(int16_t)) * 2;
+   size_t frames = max(out_rate * latency / 2000, 256);
+   thr->frame_size = frame_size;
+   thr->buffer_size = frames * frame_size;
+   thr->chunk_size = (frames / 4) * frame_size;
+
+   thr->fifo = spsc_fifo_new(thr->buffer_size, NULL);
+   thr->lock = slock_new();
+   thr->cond = scond_new();
+   thr->alive = true;
+   if (!thr->fifo || !thr->lock || !thr->cond)
+      goto error;
+
+   thr->thread = sthread_create(audio_push_thread_loop, thr);
+   if (!thr->thread)
+      goto error;
+
+   RARCH_LOG("[Audio Thread]: Buffering %u frames in front of \"%s\".\n",
+         (unsigned)frames, driver->ident);
+
+   *out_driver = &audio_push_thread;
+   *out_data   = thr;
+   return true;
+
+error:
+   audio_push_thread_free(thr);
+   return false;
+}
@@ -26,5 +26,12 @@ bool rarch_threaded_audio_init(const audio_driver_t **out_driver, void **out_dat
       const char *device, unsigned out_rate, unsigned latency,
       const audio_driver_t *driver);
 
+// Starts a regular push audio driver in a new thread.
+// Samples written to the returned driver are buffered in a lock-free fifo,
+// and the thread feeds them to the real driver, so it can block without stalling the main thread.
+bool rarch_threaded_push_audio_init(const audio_driver_t **out_driver, void **out_data,
+      const char *device, unsigned out_rate, unsigned latency,
+      const audio_driver_t *driver);
+
 #endif
 
@@ -25,6 +25,50 @@
 #include <altivec.h>
 #endif
 
+#if defined(HAVE_NEON) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// SSE4.1 and AVX2 kernels are built into a baseline binary, and are only used when the CPU has them.
+#if defined(__SSE2__) && defined(RARCH_HAVE_TARGET_AVX2)
+#define AUDIO_CONVERT_HAVE_SSE4
+#define AUDIO_CONVERT_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef RESAMPLER_TEST
+#undef RARCH_LOG
+#define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
+
+// Test programs are built for the machine they run on.
+static uint64_t audio_convert_cpu_features(void)
+{
+   uint64_t cpu = 0;
+#ifdef __SSE4_1__
+   cpu |= RETRO_SIMD_SSE4;
+#endif
+#ifdef __AVX2__
+   cpu |= RETRO_SIMD_AVX2;
+#endif
+#ifdef HAVE_NEON
+   cpu |= RETRO_SIMD_NEON;
+#endif
+   return cpu;
+}
+#else
+#define audio_convert_cpu_features rarch_get_cpu_features
+#endif
+
+#define DOWNMIX_SIDE 0.7071f
+
+static const float downmix_left[AUDIO_MAX_CHANNELS] = {
+   1.0f, 0.0f, DOWNMIX_SIDE, 0.0f, DOWNMIX_SIDE, 0.0f, DOWNMIX_SIDE, 0.0f,
+};
+
+static const float downmix_right[AUDIO_MAX_CHANNELS] = {
+   0.0f, 1.0f, DOWNMIX_SIDE, 0.0f, 0.0f, DOWNMIX_SIDE, 0.0f, DOWNMIX_SIDE,
+};
+
 void audio_convert_s16_to_float_C(float *out,
       const int16_t *in, size_t samples, float gain)
 {
@@ -40,13 +84,70 @@ void audio_convert_float_to_s16_C(int16_t *out,
    size_t i;
    for (i = 0; i < samples; i++)
    {
-      int32_t val = (int32_t)(in[i] * 0x8000);
+      float val = in[i] * 0x8000;
       out[i] = (val > 0x7FFF) ? 0x7FFF : (val < -0x8000 ? -0x8000 : (int16_t)val);
    }
 }
 
+void audio_convert_downmix_float_C(float *out,
+      const float *in, size_t frames, unsigned channels)
+{
+   size_t i;
+   unsigned c;
+   for (i = 0; i < frames; i++, in += channels, out += 2)
+   {
+      float l = 0.0f, r = 0.0f;
+      for (c = 0; c < channels; c++)
+      {
+         l += in[c] * downmix_left[c];
+         r += in[c] * downmix_right[c];
+      }
+      out[0] = l;
+      out[1] = r;
+   }
+}
+
 #if defined(__SSE2__)
-void audio_convert_s16_to_float_SSE2(float *out,
+// Vectorized across the channels of a frame, for 4, 6 and 8 channels.
+// A whole frame is loaded before its output is stored, so this works in place as well.
+static void audio_convert_downmix_float_SSE2(float *out,
+      const float *in, size_t frames, unsigned channels)
+{
+   size_t i;
+   if (channels != 4 && channels != 6 && channels != 8)
+   {
+      audio_convert_downmix_float_C(out, in, frames, channels);
+      return;
+   }
+
+   __m128 left_lo = _mm_loadu_ps(downmix_left);
+   __m128 left_hi = _mm_loadu_ps(downmix_left + 4);
+   __m128 right_lo = _mm_loadu_ps(downmix_right);
+   __m128 right_hi = _mm_loadu_ps(downmix_right + 4);
+
+   for (i = 0; i < frames; i++, in += channels, out += 2)
+   {
+      __m128 lo = _mm_loadu_ps(in);
+      __m128 hi = _mm_setzero_ps();
+      if (channels == 8)
+         hi = _mm_loadu_ps(in + 4);
+      else if (channels == 6)
+         hi = _mm_loadl_pi(hi, (const __m64*)(in + 4));
+
+      __m128 l = _mm_add_ps(_mm_mul_ps(lo, left_lo), _mm_mul_ps(hi, left_hi));
+      __m128 r = _mm_add_ps(_mm_mul_ps(lo, right_lo), _mm_mul_ps(hi, right_hi));
+
+      // { l0 + l2, l1 + l3, r0 + r2, r1 + r3 }
+      __m128 sum = _mm_add_ps(_mm_shuffle_ps(l, r, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm_shuffle_ps(l, r, _MM_SHUFFLE(3, 2, 3, 2)));
+      // { L, R, L, R }
+      sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 0, 2, 0)),
+            _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 1, 3, 1)));
+      _mm_storel_pi((__m64*)out, sum);
+   }
+}
+
+static void audio_convert_s16_to_float_SSE2(float *out,
       const int16_t *in, size_t samples, float gain)
 {
    float fgain = gain / UINT32_C(0x80000000);
@@ -72,15 +173,22 @@ void audio_convert_s16_to_float_SSE2(float *out,
    audio_convert_s16_to_float_C(out, in, samples - i, gain);
 }
 
-void audio_convert_float_to_s16_SSE2(int16_t *out,
+// Clamps before converting. Out of range floats convert to 0x80000000,
+// which would turn into -0x8000 no matter the sign.
+static void audio_convert_float_to_s16_SSE2(int16_t *out,
       const float *in, size_t samples)
 {
    __m128 factor = _mm_set1_ps((float)0x8000);
+   __m128 min = _mm_set1_ps(-(float)0x8000);
+   __m128 max = _mm_set1_ps((float)0x7FFF);
    size_t i;
    for (i = 0; i + 8 <= samples; i += 8, in += 8, out += 8)
    {
       __m128 input[2] = { _mm_loadu_ps(in + 0), _mm_loadu_ps(in + 4) };
-      __m128 res[2] = { _mm_mul_ps(input[0], factor), _mm_mul_ps(input[1], factor) };
+      __m128 res[2] = {
+         _mm_min_ps(_mm_max_ps(_mm_mul_ps(input[0], factor), min), max),
+         _mm_min_ps(_mm_max_ps(_mm_mul_ps(input[1], factor), min), max),
+      };
 
       __m128i ints[2] = { _mm_cvtps_epi32(res[0]), _mm_cvtps_epi32(res[1]) };
       __m128i packed = _mm_packs_epi32(ints[0], ints[1]);
@@ -90,8 +198,112 @@ void audio_convert_float_to_s16_SSE2(int16_t *out,
 
    audio_convert_float_to_s16_C(out, in, samples - i);
 }
+
+#ifdef AUDIO_CONVERT_HAVE_SSE4
+// Sign extends with PMOVSXWD, so gain is applied as is, like the C version.
+static RARCH_TARGET_SSE4 void audio_convert_s16_to_float_SSE4(float *out,
+      const int16_t *in, size_t samples, float gain)
+{
+   __m128 factor = _mm_set1_ps(gain / 0x8000);
+   size_t i;
+   for (i = 0; i + 16 <= samples; i += 16, in += 16, out += 16)
+   {
+      __m128i input[2] = {
+         _mm_loadu_si128((const __m128i *)(in + 0)),
+         _mm_loadu_si128((const __m128i *)(in + 8)),
+      };
+
+      __m128i regs[4] = {
+         _mm_cvtepi16_epi32(input[0]),
+         _mm_cvtepi16_epi32(_mm_srli_si128(input[0], 8)),
+         _mm_cvtepi16_epi32(input[1]),
+         _mm_cvtepi16_epi32(_mm_srli_si128(input[1], 8)),
+      };
+
+      _mm_storeu_ps(out +  0, _mm_mul_ps(_mm_cvtepi32_ps(regs[0]), factor));
+      _mm_storeu_ps(out +  4, _mm_mul_ps(_mm_cvtepi32_ps(regs[1]), factor));
+      _mm_storeu_ps(out +  8, _mm_mul_ps(_mm_cvtepi32_ps(regs[2]), factor));
+      _mm_storeu_ps(out + 12, _mm_mul_ps(_mm_cvtepi32_ps(regs[3]), factor));
+   }
+
+   audio_convert_s16_to_float_C(out, in, samples - i, gain);
+}
+
+static RARCH_TARGET_SSE4 void audio_convert_float_to_s16_SSE4(int16_t *out,
+      const float *in, size_t samples)
+{
+   __m128 factor = _mm_set1_ps((float)0x8000);
+   __m128 min = _mm_set1_ps(-(float)0x8000);
+   __m128 max = _mm_set1_ps((float)0x7FFF);
+   size_t i;
+   for (i = 0; i + 16 <= samples; i += 16, in += 16, out += 16)
+   {
+      __m128i ints[4];
+      unsigned j;
+      for (j = 0; j < 4; j++)
+      {
+         __m128 res = _mm_mul_ps(_mm_loadu_ps(in + 4 * j), factor);
+         ints[j] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(res, min), max));
+      }
+
+      _mm_storeu_si128((__m128i *)(out + 0), _mm_packs_epi32(ints[0], ints[1]));
+      _mm_storeu_si128((__m128i *)(out + 8), _mm_packs_epi32(ints[2], ints[3]));
+   }
+
+   audio_convert_float_to_s16_C(out, in, samples - i);
+}
+#endif
+
+#ifdef AUDIO_CONVERT_HAVE_AVX2
+static RARCH_TARGET_AVX2 void audio_convert_s16_to_float_AVX2(float *out,
+      const int16_t *in, size_t samples, float gain)
+{
+   __m256 factor = _mm256_set1_ps(gain / 0x8000);
+   size_t i;
+   for (i = 0; i + 16 <= samples; i += 16, in += 16, out += 16)
+   {
+      __m256i regs[2] = {
+         _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + 0))),
+         _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + 8))),
+      };
+
+      _mm256_storeu_ps(out + 0, _mm256_mul_ps(_mm256_cvtepi32_ps(regs[0]), factor));
+      _mm256_storeu_ps(out + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(regs[1]), factor));
+   }
+
+   audio_convert_s16_to_float_C(out, in, samples - i, gain);
+}
+
+static RARCH_TARGET_AVX2 void audio_convert_float_to_s16_AVX2(int16_t *out,
+      const float *in, size_t samples)
+{
+   __m256 factor = _mm256_set1_ps((float)0x8000);
+   __m256 min = _mm256_set1_ps(-(float)0x8000);
+   __m256 max = _mm256_set1_ps((float)0x7FFF);
+   size_t i;
+   for (i = 0; i + 16 <= samples; i += 16, in += 16, out += 16)
+   {
+      __m256 res[2] = {
+         _mm256_mul_ps(_mm256_loadu_ps(in + 0), factor),
+         _mm256_mul_ps(_mm256_loadu_ps(in + 8), factor),
+      };
+
+      __m256i ints[2] = {
+         _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(res[0], min), max)),
+         _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(res[1], min), max)),
+      };
+
+      // Packing works within 128-bit lanes, so the middle quarters end up swapped.
+      __m256i packed = _mm256_packs_epi32(ints[0], ints[1]);
+      packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+      _mm256_storeu_si256((__m256i *)out, packed);
+   }
+
+   audio_convert_float_to_s16_C(out, in, samples - i);
+}
+#endif
 #elif defined(__ALTIVEC__)
-void audio_convert_s16_to_float_altivec(float *out,
+static void audio_convert_s16_to_float_altivec(float *out,
       const int16_t *in, size_t samples, float gain)
 {
    const vector float gain_vec = vec_splats(gain);
@@ -118,7 +330,7 @@ void audio_convert_s16_to_float_altivec(float *out,
       audio_convert_s16_to_float_C(out, in, samples, gain);
 }
 
-void audio_convert_float_to_s16_altivec(int16_t *out,
+static void audio_convert_float_to_s16_altivec(int16_t *out,
       const float *in, size_t samples)
 {
    // Unaligned loads/store is a bit expensive, so we optimize for the good path (very likely).
@@ -165,15 +377,148 @@ static void audio_convert_float_to_s16_neon(int16_t *out, const float *in, size_
 }
 #endif
 
-void audio_convert_init_simd(void)
+#if defined(HAVE_NEON) && defined(__ARM_NEON__)
+// Same as the SSE2 version. Pairwise adds do the horizontal sums.
+static void audio_convert_downmix_float_neon(float *out,
+      const float *in, size_t frames, unsigned channels)
 {
-#ifdef HAVE_NEON
-   unsigned cpu = rarch_get_cpu_features();
-   audio_convert_s16_to_float_arm = cpu & RETRO_SIMD_NEON ?
-      audio_convert_s16_to_float_neon : audio_convert_s16_to_float_C;
-   audio_convert_float_to_s16_arm = cpu & RETRO_SIMD_NEON ?
-      audio_convert_float_to_s16_neon : audio_convert_float_to_s16_C;
+   size_t i;
+   if (channels != 4 && channels != 6 && channels != 8)
+   {
+      audio_convert_downmix_float_C(out, in, frames, channels);
+      return;
+   }
+
+   float32x4_t left_lo = vld1q_f32(downmix_left);
+   float32x4_t left_hi = vld1q_f32(downmix_left + 4);
+   float32x4_t right_lo = vld1q_f32(downmix_right);
+   float32x4_t right_hi = vld1q_f32(downmix_right + 4);
+
+   for (i = 0; i < frames; i++, in += channels, out += 2)
+   {
+      float32x4_t lo = vld1q_f32(in);
+      float32x4_t hi = vdupq_n_f32(0.0f);
+      if (channels == 8)
+         hi = vld1q_f32(in + 4);
+      else if (channels == 6)
+         hi = vcombine_f32(vld1_f32(in + 4), vdup_n_f32(0.0f));
+
+      float32x4_t l = vmlaq_f32(vmulq_f32(lo, left_lo), hi, left_hi);
+      float32x4_t r = vmlaq_f32(vmulq_f32(lo, right_lo), hi, right_hi);
+
+      float32x2_t l2 = vpadd_f32(vget_low_f32(l), vget_high_f32(l));
+      float32x2_t r2 = vpadd_f32(vget_low_f32(r), vget_high_f32(r));
+      vst1_f32(out, vpadd_f32(l2, r2));
+   }
+}
 #endif
+
+static const audio_convert_backend_t audio_convert_C = {
+   audio_convert_s16_to_float_C,
+   audio_convert_float_to_s16_C,
+   audio_convert_downmix_float_C,
+   0,
+   "C",
+};
+
+// SSE2 and AltiVec are enabled at build time, so they need no runtime check.
+#if defined(__SSE2__)
+static const audio_convert_backend_t audio_convert_SSE2 = {
+   audio_convert_s16_to_float_SSE2,
+   audio_convert_float_to_s16_SSE2,
+   audio_convert_downmix_float_SSE2,
+   0,
+   "SSE2",
+};
+#endif
+
+#ifdef AUDIO_CONVERT_HAVE_SSE4
+static const audio_convert_backend_t audio_convert_SSE4 = {
+   audio_convert_s16_to_float_SSE4,
+   audio_convert_float_to_s16_SSE4,
+   audio_convert_downmix_float_SSE2,
+   RETRO_SIMD_SSE4,
+   "SSE4.1",
+};
+#endif
+
+#ifdef AUDIO_CONVERT_HAVE_AVX2
+static const audio_convert_backend_t audio_convert_AVX2 = {
+   audio_convert_s16_to_float_AVX2,
+   audio_convert_float_to_s16_AVX2,
+   audio_convert_downmix_float_SSE2,
+   RETRO_SIMD_AVX2,
+   "AVX2",
+};
+#endif
+
+#if defined(__ALTIVEC__)
+static const audio_convert_backend_t audio_convert_altivec = {
+   audio_convert_s16_to_float_altivec,
+   audio_convert_float_to_s16_altivec,
+   audio_convert_downmix_float_C,
+   0,
+   "AltiVec",
+};
+#endif
+
+#if defined(HAVE_NEON)
+static const audio_convert_backend_t audio_convert_neon = {
+   audio_convert_s16_to_float_neon,
+   audio_convert_float_to_s16_neon,
+#ifdef __ARM_NEON__
+   audio_convert_downmix_float_neon,
+#else
+   audio_convert_downmix_float_C,
+#endif
+   RETRO_SIMD_NEON,
+   "NEON",
+};
+#endif
+
+const audio_convert_backend_t *audio_convert_backends[] = {
+#ifdef AUDIO_CONVERT_HAVE_AVX2
+   &audio_convert_AVX2,
+#endif
+#ifdef AUDIO_CONVERT_HAVE_SSE4
+   &audio_convert_SSE4,
+#endif
+#if defined(__SSE2__)
+   &audio_convert_SSE2,
+#endif
+#if defined(__ALTIVEC__)
+   &audio_convert_altivec,
+#endif
+#if defined(HAVE_NEON)
+   &audio_convert_neon,
+#endif
+   &audio_convert_C,
+   NULL,
+};
+
+#if defined(__SSE2__)
+const audio_convert_backend_t *audio_convert_impl = &audio_convert_SSE2;
+#elif defined(__ALTIVEC__)
+const audio_convert_backend_t *audio_convert_impl = &audio_convert_altivec;
+#else
+const audio_convert_backend_t *audio_convert_impl = &audio_convert_C;
+#endif
+
+void audio_convert_init_simd(void)
+{
+   unsigned i;
+   uint64_t cpu = audio_convert_cpu_features();
+
+   for (i = 0; audio_convert_backends[i]; i++)
+   {
+      if ((audio_convert_backends[i]->simd & cpu) == audio_convert_backends[i]->simd)
+      {
+         audio_convert_impl = audio_convert_backends[i];
+         break;
+      }
+   }
+
+   RARCH_LOG("Audio conversion: %s.\n", audio_convert_impl->ident);
 }
 
 #ifdef HAVE_RSOUND
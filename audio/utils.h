@@ -23,45 +23,42 @@
 #include "../config.h"
 #endif
 
-#if defined(__SSE2__)
-#define audio_convert_s16_to_float audio_convert_s16_to_float_SSE2
-#define audio_convert_float_to_s16 audio_convert_float_to_s16_SSE2
-
-void audio_convert_s16_to_float_SSE2(float *out,
-      const int16_t *in, size_t samples, float gain);
-
-void audio_convert_float_to_s16_SSE2(int16_t *out,
-      const float *in, size_t samples);
-
-#elif defined(__ALTIVEC__)
-#define audio_convert_s16_to_float audio_convert_s16_to_float_altivec
-#define audio_convert_float_to_s16 audio_convert_float_to_s16_altivec
-
-void audio_convert_s16_to_float_altivec(float *out,
-      const int16_t *in, size_t samples, float gain);
-
-void audio_convert_float_to_s16_altivec(int16_t *out,
-      const float *in, size_t samples);
-
-#elif defined(HAVE_NEON)
-#define audio_convert_s16_to_float audio_convert_s16_to_float_arm
-#define audio_convert_float_to_s16 audio_convert_float_to_s16_arm
-
-void (*audio_convert_s16_to_float_arm)(float *out,
-      const int16_t *in, size_t samples, float gain);
-void (*audio_convert_float_to_s16_arm)(int16_t *out,
-      const float *in, size_t samples);
-
-#else
-#define audio_convert_s16_to_float audio_convert_s16_to_float_C
-#define audio_convert_float_to_s16 audio_convert_float_to_s16_C
-#endif
-
 void audio_convert_s16_to_float_C(float *out,
       const int16_t *in, size_t samples, float gain);
 void audio_convert_float_to_s16_C(int16_t *out,
       const float *in, size_t samples);
 
+// Folds interleaved frames down to stereo, for audio drivers which only take stereo.
+// Channel order is as described at AUDIO_MAX_CHANNELS in driver.h.
+// Center and surrounds go to both sides at -3 dB, LFE is dropped.
+// Can work in place, i.e. out == in.
+void audio_convert_downmix_float_C(float *out,
+      const float *in, size_t frames, unsigned channels);
+
+// One set of conversion kernels for an instruction set.
+typedef struct audio_convert_backend
+{
+   void (*s16_to_float)(float *out, const int16_t *in, size_t samples, float gain);
+   void (*float_to_s16)(int16_t *out, const float *in, size_t samples); // Saturates.
+   void (*downmix_float)(float *out, const float *in, size_t frames, unsigned channels);
+   uint64_t simd; // RETRO_SIMD_* flags the CPU needs, beyond what the build targets.
+   const char *ident;
+} audio_convert_backend_t;
+
+// Every backend built in, in order of preference. NULL terminated.
+extern const audio_convert_backend_t *audio_convert_backends[];
+
+// Backend in use. Starts out as the best one the build flags guarantee,
+// audio_convert_init_simd() picks the best one the CPU supports.
+extern const audio_convert_backend_t *audio_convert_impl;
+
+#define audio_convert_s16_to_float(out, in, samples, gain) \
+   audio_convert_impl->s16_to_float(out, in, samples, gain)
+#define audio_convert_float_to_s16(out, in, samples) \
+   audio_convert_impl->float_to_s16(out, in, samples)
+#define audio_convert_downmix_float(out, in, frames, channels) \
+   audio_convert_impl->downmix_float(out, in, frames, channels)
+
 void audio_convert_init_simd(void);
 
 #ifdef HAVE_RSOUND
@@ -26,6 +26,8 @@
 #include "compat/posix_string.h"
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
 
 #ifndef _WIN32
 #include <fcntl.h>
@@ -45,6 +47,10 @@ struct rarch_cmd
 
 #ifdef HAVE_NETWORK_CMD
    int net_fd;
+
+   // Sender of the message being parsed, so queries can be answered.
+   struct sockaddr_storage reply_addr;
+   socklen_t reply_addr_len;
 #endif
 
    bool state[RARCH_BIND_LIST_END];
@@ -237,10 +243,86 @@ static bool cmd_set_shader(const char *arg)
    return video_set_shader_func(type, arg);
 }
 
+static bool cmd_rewind_seek(const char *arg)
+{
+   char *end;
+   unsigned long frames;
+
+   // strtoul() would quietly negate "-1" into a huge count.
+   if (!isdigit((unsigned char)*arg))
+      return false;
+
+   frames = strtoul(arg, &end, 10);
+   if (*end != '\0')
+      return false;
+
+   // Seeking stops at the oldest state anyway.
+   if (frames > UINT_MAX)
+      frames = UINT_MAX;
+
+   return rarch_rewind_seek(frames);
+}
+
 static const struct cmd_action_map action_map[] = {
-   { "SET_SHADER", cmd_set_shader, "<shader path>" },
+   { "SET_SHADER",  cmd_set_shader,  "<shader path>" },
+   { "REWIND_SEEK", cmd_rewind_seek, "<frames>" },
+};
+
+// Queries are answered with a single line, starting with the query itself.
+struct cmd_query_map
+{
+   const char *str;
+   void (*query)(char *reply, size_t size);
+};
+
+static void cmd_audio_status(char *reply, size_t size)
+{
+   double ratio = g_extern.audio_data.src_ratio;
+   double orig_ratio = g_extern.audio_data.orig_src_ratio;
+
+   if (!g_extern.audio_active)
+      snprintf(reply, size, "AUDIO_STATUS active=0\n");
+   else if (!g_extern.audio_data.rate_control)
+      snprintf(reply, size, "AUDIO_STATUS active=1 rate_control=0 ratio=%.6f\n", ratio);
+   else
+   {
+      snprintf(reply, size, "AUDIO_STATUS active=1 rate_control=1 ratio=%.6f adjust=%.6f "
+            "fill=%.3f integral=%.4f underruns=%u\n",
+            ratio, orig_ratio > 0.0 ? ratio / orig_ratio : 1.0,
+            g_extern.audio_data.rate_control_fill, g_extern.audio_data.rate_control_integral,
+            g_extern.audio_data.underruns);
+   }
+}
+
+static const struct cmd_query_map query_map[] = {
+   { "AUDIO_STATUS", cmd_audio_status },
 };
 
+static int command_get_query(const char *tok)
+{
+   unsigned i;
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+      if (strcmp(tok, query_map[i].str) == 0)
+         return i;
+   return -1;
+}
+
+static void cmd_reply(rarch_cmd_t *handle, const char *msg)
+{
+#ifdef HAVE_NETWORK_CMD
+   if (handle->reply_addr_len)
+   {
+      sendto(handle->net_fd, msg, strlen(msg), 0,
+            (struct sockaddr*)&handle->reply_addr, handle->reply_addr_len);
+      return;
+   }
+#endif
+
+   // Commands from stdin get their answers on stdout.
+   fputs(msg, stdout);
+   fflush(stdout);
+}
+
 static bool command_get_arg(const char *tok, const char **arg, unsigned *index)
 {
    unsigned i;
@@ -284,8 +366,15 @@ static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
 {
    const char *arg = NULL;
    unsigned index  = 0;
+   int query       = command_get_query(tok);
 
-   if (command_get_arg(tok, &arg, &index))
+   if (query >= 0)
+   {
+      char reply[256];
+      query_map[query].query(reply, sizeof(reply));
+      cmd_reply(handle, reply);
+   }
+   else if (command_get_arg(tok, &arg, &index))
    {
       if (arg)
       {
@@ -341,13 +430,17 @@ static void network_cmd_pre_frame(rarch_cmd_t *handle)
    for (;;)
    {
       char buf[1024];
-      ssize_t ret = recvfrom(handle->net_fd, buf, sizeof(buf) - 1, 0, NULL, NULL);
+      handle->reply_addr_len = sizeof(handle->reply_addr);
+      ssize_t ret = recvfrom(handle->net_fd, buf, sizeof(buf) - 1, 0,
+            (struct sockaddr*)&handle->reply_addr, &handle->reply_addr_len);
       if (ret <= 0)
          break;
 
       buf[ret] = '\0';
       parse_msg(handle, buf);
    }
+
+   handle->reply_addr_len = 0;
 }
 #endif
 
@@ -503,7 +596,8 @@ void rarch_cmd_pre_frame(rarch_cmd_t *handle)
 }
 
 #ifdef HAVE_NETWORK_CMD
-static bool send_udp_packet(const char *host, uint16_t port, const char *msg)
+// With wait_reply, the first answer received within a second is printed to stdout.
+static bool send_udp_packet(const char *host, uint16_t port, const char *msg, bool wait_reply)
 {
    struct addrinfo hints, *res = NULL;
    memset(&hints, 0, sizeof(hints));
@@ -542,6 +636,31 @@ static bool send_udp_packet(const char *host, uint16_t port, const char *msg)
          goto end;
       }
 
+      if (wait_reply)
+      {
+         fd_set fds;
+         FD_ZERO(&fds);
+         FD_SET(fd, &fds);
+
+         struct timeval tv = { 1, 0 };
+         if (select(fd + 1, &fds, NULL, NULL, &tv) > 0)
+         {
+            char buf[1024];
+            ssize_t reply_len = recv(fd, buf, sizeof(buf) - 1, 0);
+            if (reply_len > 0)
+            {
+               buf[reply_len] = '\0';
+               fputs(buf, stdout);
+               fflush(stdout);
+               goto end;
+            }
+         }
+
+         // Try the next address "localhost" resolved to, if any.
+         if (!tmp->ai_next)
+            ret = false;
+      }
+
       close(fd);
       fd = -1;
       tmp = tmp->ai_next;
@@ -557,7 +676,7 @@ end:
 static bool verify_command(const char *cmd)
 {
    unsigned i;
-   if (command_get_arg(cmd, NULL, NULL))
+   if (command_get_arg(cmd, NULL, NULL) || command_get_query(cmd) >= 0)
       return true;
 
    RARCH_ERR("Command \"%s\" is not recognized by RetroArch.\n", cmd);
@@ -568,6 +687,9 @@ static bool verify_command(const char *cmd)
    for (i = 0; i < sizeof(action_map) / sizeof(action_map[0]); i++)
       RARCH_ERR("\t\t%s %s\n", action_map[i].str, action_map[i].arg_desc);
 
+   for (i = 0; i < sizeof(query_map) / sizeof(query_map[0]); i++)
+      RARCH_ERR("\t\t%s\n", query_map[i].str);
+
    return false;
 }
 
@@ -609,7 +731,7 @@ bool network_cmd_send(const char *cmd_)
 
    RARCH_LOG("Sending command: \"%s\" to %s:%hu\n", cmd, host, (unsigned short)port);
 
-   bool ret = verify_command(cmd) && send_udp_packet(host, port, cmd);
+   bool ret = verify_command(cmd) && send_udp_packet(host, port, cmd, command_get_query(cmd) >= 0);
    free(command);
 
    g_extern.verbose = old_verbose;
@@ -264,6 +264,12 @@ static const bool hard_sync = false;
 // 2: Etc ...
 static const unsigned hard_sync_frames = 0;
 
+// Delays the start of emulation by this many milliseconds after vsync, so input is read closer to when the frame is shown.
+// Too high a value makes frames miss vsync. Only applies with vsync on and threaded video off.
+static const unsigned frame_delay = 0;
+// Picks the frame delay automatically from how long the core takes to run a frame. Overrides frame_delay.
+static const bool frame_delay_auto = false;
+
 // Inserts a black frame inbetween frames.
 // Useful for 120 Hz monitors who want to play 60 Hz material with eliminated ghosting. video_refresh_rate should still be configured as if it is a 60 Hz monitor (divide refresh rate by 2).
 static bool black_frame_insertion = false;
@@ -275,6 +281,9 @@ static unsigned swap_interval = 1;
 // Threaded video. Will possibly increase performance significantly at cost of worse synchronization and latency.
 static const bool video_threaded = false;
 
+// Threads a CPU filter runs on, each filtering a horizontal slice of the frame. 0 picks one per CPU core.
+static const unsigned video_filter_threads = 0;
+
 // Smooths picture
 static const bool video_smooth = true;
 
@@ -439,6 +448,10 @@ static const int out_latency = 64;
 // Will sync audio. (recommended) 
 static const bool audio_sync = true;
 
+// Runs the audio driver in its own thread, so a driver blocking on a full device buffer
+// does not hold up the main loop. Adds up to half of out_latency of extra buffering.
+static const bool audio_threaded = false;
+
 // Experimental rate control
 #if defined(GEKKO) || !defined(RARCH_CONSOLE)
 static const bool rate_control = true;
@@ -453,6 +466,14 @@ static const float rate_control_delta = 0.000;
 static const float rate_control_delta = 0.005;
 #endif
 
+// Time constant (seconds) of the low-pass filter on the audio buffer fill level rate_control acts on.
+// Smooths out drivers which report their fill level in large steps. 0.0 disables the filter.
+static const float rate_control_filter = 0.1;
+
+// Integral time (seconds) of rate_control. Lets it settle with the buffer half full
+// instead of at an offset, so a smaller audio latency can be used. 0.0 disables the integral term.
+static const float rate_control_integral = 10.0;
+
 // Default audio volume in dB. (0.0 dB == unity gain).
 static const float audio_volume = 0.0;
 
@@ -469,6 +490,20 @@ static const unsigned rewind_buffer_size = 20 << 20; // 20MiB
 // How many frames to rewind at a time.
 static const unsigned rewind_granularity = 1;
 
+// Deflate rewind deltas before storing them. Fits more rewind into the buffer at some CPU cost.
+static const bool rewind_compress = false;
+
+// Generate rewind deltas on a separate thread. The main thread only serializes the state.
+static const bool rewind_threaded = false;
+
+// Store a keyframe every N rewind pushes. Keyframes are kept much longer than per-frame deltas,
+// so old history can still be rewound, just more coarsely. 0 disables keyframes.
+static const unsigned rewind_keyframe_interval = 0;
+
+// Fingerprint rewind states in 256 byte blocks, and only diff blocks that changed since the last push.
+// Cheaper for large states where little changes per frame.
+static const bool rewind_dirty_blocks = false;
+
 // Pause gameplay when gameplay loses focus.
 static const bool pause_nonactive = false;
 
@@ -478,6 +513,19 @@ static const unsigned autosave_interval = 0;
 // When being client over netplay, use keybinds for player 1 rather than player 2.
 static const bool netplay_client_swap_input = true;
 
+// How to guess the other netplay player's input until it arrives. Wrong guesses cause rollbacks.
+// "last" repeats their last input, "hold" learns how long buttons are typically held,
+// "markov" learns which input usually follows the previous two.
+static const char *netplay_predictor = "last";
+
+// Compare a checksum of the emulated state with the other netplay player every this many frames.
+// If they differ, the host sends its state over, which stalls both sides while it transfers.
+// 0 disables the check. Off by default, 30 is a sensible interval when turning it on.
+static const unsigned netplay_check_frames = 0;
+
+// How many seconds the netplay host waits for every player to connect before giving up. 0 waits forever.
+static const unsigned netplay_accept_timeout = 120;
+
 // On save state load, block SRAM from being overwritten.
 // This could potentially lead to buggy games.
 static const bool block_sram_overwrite = false;
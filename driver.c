@@ -948,6 +948,9 @@ void uninit_drivers(void)
 }
 
 #ifdef HAVE_DYLIB
+// Version 5 plugins take stereo only, and get a downmix of other layouts.
+#define DSP_PLUGIN_STEREO_API_VERSION 5
+
 static void init_dsp_plugin(void)
 {
    if (!(*g_settings.audio.dsp_plugin))
@@ -978,7 +981,8 @@ static void init_dsp_plugin(void)
       goto error;
    }
 
-   if (g_extern.audio_data.dsp_plugin->api_version != RARCH_DSP_API_VERSION)
+   int api_version = g_extern.audio_data.dsp_plugin->api_version;
+   if (api_version != RARCH_DSP_API_VERSION && api_version != DSP_PLUGIN_STEREO_API_VERSION)
    {
       RARCH_ERR("DSP plugin API mismatch. RetroArch: %d, Plugin: %d\n", RARCH_DSP_API_VERSION, g_extern.audio_data.dsp_plugin->api_version);
       goto error;
@@ -987,6 +991,7 @@ static void init_dsp_plugin(void)
    RARCH_LOG("Loaded DSP plugin: \"%s\"\n", g_extern.audio_data.dsp_plugin->ident ? g_extern.audio_data.dsp_plugin->ident : "Unknown");
 
    info.input_rate = g_settings.audio.in_rate;
+   info.input_channels = api_version == DSP_PLUGIN_STEREO_API_VERSION ? 2 : g_extern.audio_data.channels;
 
    g_extern.audio_data.dsp_handle = g_extern.audio_data.dsp_plugin->init(&info);
    if (!g_extern.audio_data.dsp_handle)
@@ -995,6 +1000,24 @@ static void init_dsp_plugin(void)
       goto error;
    }
 
+   g_extern.audio_data.dsp_plugin_channels = info.input_channels;
+   g_extern.audio_data.resampler_channels = info.input_channels;
+   if (api_version != DSP_PLUGIN_STEREO_API_VERSION && g_extern.audio_data.dsp_plugin->output_channels)
+      g_extern.audio_data.resampler_channels =
+         g_extern.audio_data.dsp_plugin->output_channels(g_extern.audio_data.dsp_handle);
+
+   if (g_extern.audio_data.resampler_channels < 2 || g_extern.audio_data.resampler_channels > AUDIO_MAX_CHANNELS)
+   {
+      RARCH_ERR("DSP plugin outputs %u channels, which is not supported.\n", g_extern.audio_data.resampler_channels);
+      g_extern.audio_data.dsp_plugin->free(g_extern.audio_data.dsp_handle);
+      g_extern.audio_data.resampler_channels = g_extern.audio_data.channels;
+      goto error;
+   }
+
+   if (g_extern.audio_data.dsp_plugin_channels != g_extern.audio_data.channels)
+      RARCH_WARN("DSP plugin only takes stereo, %u channels will be downmixed before it.\n",
+            g_extern.audio_data.channels);
+
    return;
 
 error:
@@ -1022,15 +1045,23 @@ void init_audio(void)
    if (driver.audio_data)
       return;
 
+   unsigned channels = g_extern.system.audio_channels ? g_extern.system.audio_channels : 2;
+   g_extern.audio_data.channels           = channels;
+   g_extern.audio_data.dsp_plugin_channels = channels;
+   g_extern.audio_data.resampler_channels  = channels;
+   if (channels != 2)
+      RARCH_LOG("Core outputs %u audio channels.\n", channels);
+
    // Accomodate rewind since at some point we might have two full buffers.
-   size_t max_bufsamples = AUDIO_CHUNK_SIZE_NONBLOCKING * 2;
+   size_t max_bufsamples = AUDIO_CHUNK_SIZE_NONBLOCKING * channels;
    size_t outsamples_max = max_bufsamples * AUDIO_MAX_RATIO * g_settings.slowmotion_ratio;
 
    // Used for recording even if audio isn't enabled.
    rarch_assert(g_extern.audio_data.conv_outsamples = (int16_t*)malloc(outsamples_max * sizeof(int16_t)));
 
-   g_extern.audio_data.block_chunk_size    = AUDIO_CHUNK_SIZE_BLOCKING;
-   g_extern.audio_data.nonblock_chunk_size = AUDIO_CHUNK_SIZE_NONBLOCKING;
+   // Chunk sizes count samples, so they cover the same time regardless of channels.
+   g_extern.audio_data.block_chunk_size    = AUDIO_CHUNK_SIZE_BLOCKING * channels / 2;
+   g_extern.audio_data.nonblock_chunk_size = AUDIO_CHUNK_SIZE_NONBLOCKING * channels / 2;
    g_extern.audio_data.chunk_size          = g_extern.audio_data.block_chunk_size;
 
    // Needs to be able to hold full content of a full max_bufsamples in addition to its own.
@@ -1057,6 +1088,15 @@ void init_audio(void)
          rarch_fail(1, "init_audio()");
       }
    }
+   else if (g_settings.audio.threaded)
+   {
+      RARCH_LOG("Starting threaded push audio driver ...\n");
+      if (!rarch_threaded_push_audio_init(&driver.audio, &driver.audio_data,
+               *g_settings.audio.device ? g_settings.audio.device : NULL,
+               g_settings.audio.out_rate, g_settings.audio.latency,
+               driver.audio))
+         RARCH_ERR("Cannot open threaded push audio driver.\n");
+   }
    else
 #endif
    {
@@ -1084,9 +1124,22 @@ void init_audio(void)
       g_extern.audio_data.src_ratio =
       (double)g_settings.audio.out_rate / g_settings.audio.in_rate;
 
+   if (*g_settings.audio.dsp_filter)
+   {
+      g_extern.audio_data.dsp_filter = rarch_dsp_filter_new(g_settings.audio.dsp_filter,
+            g_settings.audio.in_rate, channels);
+      if (!g_extern.audio_data.dsp_filter)
+         RARCH_ERR("Failed to load DSP filter chain \"%s\".\n", g_settings.audio.dsp_filter);
+   }
+
+   // An upmixing plugin decides how many channels the resampler sees.
+#ifdef HAVE_DYLIB
+   init_dsp_plugin();
+#endif
+
    const char *resampler = *g_settings.audio.resampler ? g_settings.audio.resampler : NULL;
    if (!rarch_resampler_realloc(&g_extern.audio_data.resampler_data, &g_extern.audio_data.resampler,
-         resampler, g_extern.audio_data.orig_src_ratio))
+         resampler, g_extern.audio_data.orig_src_ratio, g_extern.audio_data.resampler_channels))
    {
       RARCH_ERR("Failed to initialize resampler \"%s\".\n", resampler ? resampler : "(default)");
       g_extern.audio_active = false;
@@ -1096,6 +1149,10 @@ void init_audio(void)
 
    g_extern.audio_data.data_ptr = 0;
 
+   // Resampler output is folded down to stereo in place, so it must fit the widest layout.
+   if (g_extern.audio_data.resampler_channels > channels)
+      outsamples_max = outsamples_max / channels * g_extern.audio_data.resampler_channels;
+
    rarch_assert(g_settings.audio.out_rate < g_settings.audio.in_rate * AUDIO_MAX_RATIO);
    rarch_assert(g_extern.audio_data.outsamples = (float*)malloc(outsamples_max * sizeof(float)));
 
@@ -1106,6 +1163,10 @@ void init_audio(void)
       {
          g_extern.audio_data.driver_buffer_size = audio_buffer_size_func();
          g_extern.audio_data.rate_control = true;
+         g_extern.audio_data.rate_control_fill = 0.5f;
+         g_extern.audio_data.rate_control_integral = 0.0;
+         g_extern.audio_data.underrun = false;
+         g_extern.audio_data.underruns = 0;
       }
       else
          RARCH_WARN("Audio rate control was desired, but driver does not support needed features.\n");
@@ -1114,10 +1175,6 @@ void init_audio(void)
    g_extern.audio_data.volume_db   = g_settings.audio.volume;
    g_extern.audio_data.volume_gain = db_to_gain(g_settings.audio.volume);
 
-#ifdef HAVE_DYLIB
-   init_dsp_plugin();
-#endif
-
    g_extern.measure_data.buffer_free_samples_count = 0;
 
    if (g_extern.audio_active && !g_extern.audio_data.mute && g_extern.system.audio_callback.callback) // Threaded driver is initially stopped.
@@ -1259,6 +1316,9 @@ void uninit_audio(void)
    free(g_extern.audio_data.outsamples);
    g_extern.audio_data.outsamples = NULL;
 
+   rarch_dsp_filter_free(g_extern.audio_data.dsp_filter);
+   g_extern.audio_data.dsp_filter = NULL;
+
 #ifdef HAVE_DYLIB
    deinit_dsp_plugin();
 #endif
@@ -1266,14 +1326,19 @@ void uninit_audio(void)
    compute_audio_buffer_statistics();
 }
 
-#ifdef HAVE_DYLIB
 static void deinit_filter(void)
 {
-   g_extern.filter.active = false;
+   g_extern.filter.active     = false;
+   g_extern.filter.softfilter = NULL;
 
+#ifdef HAVE_DYLIB
    if (g_extern.filter.lib)
       dylib_close(g_extern.filter.lib);
    g_extern.filter.lib = NULL;
+#endif
+
+   slice_pool_free(g_extern.filter.pool);
+   g_extern.filter.pool = NULL;
 
    free(g_extern.filter.buffer);
    free(g_extern.filter.colormap);
@@ -1286,20 +1351,59 @@ static void deinit_filter(void)
    memset(&g_extern.filter.scaler, 0, sizeof(g_extern.filter.scaler));
 }
 
-static void init_filter(bool rgb32)
+// Filters which can render slices get a thread per core, unless video_filter_threads says otherwise.
+static bool init_filter_pool(bool slices)
 {
-   unsigned i;
-   if (g_extern.filter.active)
-      return;
-   if (!*g_settings.video.filter_path)
-      return;
+   unsigned threads = 1;
+   if (slices)
+   {
+      threads = g_settings.video.filter_threads;
+      if (!threads)
+         threads = rarch_get_cpu_cores();
+   }
 
-   if (g_extern.system.hw_render_callback.context_type)
+   g_extern.filter.pool = slice_pool_new(threads);
+   if (!g_extern.filter.pool)
+      return false;
+
+   RARCH_LOG("CPU filter runs on %u thread(s).\n", slice_pool_threads(g_extern.filter.pool));
+   return true;
+}
+
+static bool init_softfilter(const softfilter_implementation_t *impl, bool rgb32)
+{
+   const struct retro_game_geometry *geom = &g_extern.system.av_info.geometry;
+   if (impl->max_width && geom->max_width > impl->max_width)
    {
-      RARCH_WARN("Cannot use CPU filters when hardware rendering is used.\n");
-      return;
+      RARCH_ERR("CPU filter \"%s\" takes input up to %u pixels wide, core renders up to %u.\n",
+            impl->ident, impl->max_width, geom->max_width);
+      return false;
    }
 
+   RARCH_LOG("Using built-in CPU filter \"%s\" (%s).\n", impl->ident, rgb32 ? "XRGB8888" : "RGB565");
+
+   unsigned width   = geom->max_width * impl->scale_x;
+   unsigned height  = geom->max_height * impl->scale_y;
+   unsigned maxsize = max(next_pow2(width), next_pow2(height));
+   size_t   bpp     = rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
+
+   g_extern.filter.softfilter = impl;
+   g_extern.filter.rgb32      = rgb32;
+   g_extern.filter.active     = true;
+   g_extern.filter.scale      = max(maxsize / RARCH_SCALE_BASE, 1);
+   g_extern.filter.pitch      = width * bpp;
+   g_extern.filter.buffer     = (uint32_t*)malloc(width * height * bpp);
+   if (!g_extern.filter.buffer)
+      return false;
+
+   return init_filter_pool(true);
+}
+
+#ifdef HAVE_DYLIB
+static void init_filter_plugin(bool rgb32)
+{
+   unsigned i;
+
    RARCH_LOG("Loading bSNES filter from \"%s\"\n", g_settings.video.filter_path);
    g_extern.filter.lib = dylib_load(g_settings.video.filter_path);
    if (!g_extern.filter.lib)
@@ -1321,6 +1425,11 @@ static void init_filter(bool rgb32)
       (void (*)(uint32_t*, uint32_t*, 
                 unsigned, const uint16_t*, 
                 unsigned, unsigned, unsigned))dylib_proc(g_extern.filter.lib, "filter_render");
+   g_extern.filter.prender_slice = 
+      (void (*)(uint32_t*, uint32_t*, 
+                unsigned, const uint16_t*, 
+                unsigned, unsigned, unsigned,
+                unsigned, unsigned))dylib_proc(g_extern.filter.lib, "filter_render_slice");
 
    if (!g_extern.filter.psize || !g_extern.filter.prender)
    {
@@ -1371,6 +1480,10 @@ static void init_filter(bool rgb32)
    if (!scaler_ctx_gen_filter(&g_extern.filter.scaler))
       goto error;
 
+   // Filters without filter_render_slice only know how to render the whole frame.
+   if (!init_filter_pool(g_extern.filter.prender_slice))
+      goto error;
+
    return;
 
 error:
@@ -1379,6 +1492,38 @@ error:
 }
 #endif
 
+// video_filter is either the name of a built-in filter, or a path to a bSNES filter plugin.
+static void init_filter(bool rgb32)
+{
+   if (g_extern.filter.active)
+      return;
+   if (!*g_settings.video.filter_path)
+      return;
+
+   if (g_extern.system.hw_render_callback.context_type)
+   {
+      RARCH_WARN("Cannot use CPU filters when hardware rendering is used.\n");
+      return;
+   }
+
+   const softfilter_implementation_t *impl = softfilter_find(g_settings.video.filter_path);
+   if (impl)
+   {
+      if (!init_softfilter(impl, rgb32))
+      {
+         RARCH_ERR("CPU filter init failed.\n");
+         deinit_filter();
+      }
+      return;
+   }
+
+#ifdef HAVE_DYLIB
+   init_filter_plugin(rgb32);
+#else
+   RARCH_ERR("There is no built-in CPU filter named \"%s\".\n", g_settings.video.filter_path);
+#endif
+}
+
 static void deinit_shader_dir(void)
 {
    // It handles NULL, no worries :D
@@ -1441,9 +1586,7 @@ static bool init_video_pixel_converter(unsigned size)
 
 void init_video_input(void)
 {
-#ifdef HAVE_DYLIB
    init_filter(g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888);
-#endif
 
    init_shader_dir();
 
@@ -1517,7 +1660,9 @@ void init_video_input(void)
    video.force_aspect = g_settings.video.force_aspect;
    video.smooth = g_settings.video.smooth;
    video.input_scale = scale;
-   video.rgb32 = g_extern.filter.active || (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888);
+   // Filter plugins always output XRGB8888, built-in filters output what they take.
+   video.rgb32 = (g_extern.filter.active && !g_extern.filter.softfilter) ||
+      (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888);
 
    const input_driver_t *tmp = driver.input;
    find_video_driver(); // Need to grab the "real" video driver interface on a reinit.
@@ -1624,9 +1769,7 @@ void uninit_video_input(void)
 
    deinit_pixel_converter();
 
-#ifdef HAVE_DYLIB
    deinit_filter();
-#endif
 
    deinit_shader_dir();
    compute_monitor_fps_statistics();
@@ -42,6 +42,10 @@ extern "C" {
 #define AUDIO_CHUNK_SIZE_BLOCKING 512
 #define AUDIO_CHUNK_SIZE_NONBLOCKING 2048 // So we don't get complete line-noise when fast-forwarding audio.
 #define AUDIO_MAX_RATIO 16
+#define AUDIO_FLUSH_BLOCK_FRAMES 256 // audio_flush() runs all stages on blocks of this size.
+// Interleaved channel order for more than two channels:
+// front left, front right, center, LFE, back left, back right, side left, side right.
+#define AUDIO_MAX_CHANNELS 8
 
 // Specialized _POINTER that targets the full screen regardless of viewport.
 // Should not be used by a libretro implementation as coordinates returned make no sense.
@@ -196,7 +200,7 @@ typedef struct video_info
 typedef struct audio_driver
 {
    void *(*init)(const char *device, unsigned rate, unsigned latency);
-   ssize_t (*write)(void *data, const void *buf, size_t size);
+   ssize_t (*write)(void *data, const void *buf, size_t size); // Returns bytes written, or -1 on error.
    bool (*stop)(void *data);
    bool (*start)(void *data);
    void (*set_nonblock_state)(void *data, bool toggle); // Should we care about blocking in audio thread? Fast forwarding.
@@ -443,6 +447,9 @@ typedef struct video_poke_interface
 
    void (*show_mouse)(void *data, bool state);
    void (*grab_mouse_toggle)(void *data);
+
+   // Lends memory for the core to render its next software frame into. See RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER.
+   bool (*get_current_software_framebuffer)(void *data, struct retro_framebuffer *framebuffer);
 } video_poke_interface_t;
 
 typedef struct video_driver
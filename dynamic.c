@@ -791,6 +791,28 @@ bool rarch_environment_cb(unsigned cmd, void *data)
       }
 #endif
 
+      case RETRO_ENVIRONMENT_SET_AUDIO_CHANNELS:
+      {
+         unsigned channels = *(const unsigned*)data;
+         RARCH_LOG("Environ SET_AUDIO_CHANNELS: %u.\n", channels);
+
+         if (channels < 2 || channels > AUDIO_MAX_CHANNELS)
+         {
+            RARCH_ERR("Audio channel count must be between 2 and %u.\n", AUDIO_MAX_CHANNELS);
+            return false;
+         }
+
+         g_extern.system.audio_channels = channels;
+         break;
+      }
+
+      // Called every frame, so no logging.
+      case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+         if (!driver.video_poke || !driver.video_poke->get_current_software_framebuffer)
+            return false;
+         return driver.video_poke->get_current_software_framebuffer(driver.video_data,
+               (struct retro_framebuffer*)data);
+
       case RETRO_ENVIRONMENT_SET_FRAME_TIME_CALLBACK:
       {
          RARCH_LOG("Environ SET_FRAME_TIME_CALLBACK.\n");
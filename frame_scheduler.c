@@ -0,0 +1,231 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_scheduler.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "performance.h"
+#include "general.h"
+
+#define FRAME_SCHED_WINDOW 128 // Runs profiled.
+#define FRAME_SCHED_UPDATE_INTERVAL 32 // Runs between picking a new auto delay.
+#define FRAME_SCHED_MARGIN 1500 // usec left free before vsync, for presenting and wakeup jitter.
+#define FRAME_SCHED_BACKOFF 1000 // usec added to the margin for every late frame while delaying.
+#define FRAME_SCHED_BIN_SIZE 250 // usec per histogram bin.
+#define FRAME_SCHED_BINS 200
+#define FRAME_SCHED_MAX_GAP 250000 // Longer gaps between presents come from pausing or the menu, and are not counted.
+
+struct frame_scheduler
+{
+   retro_time_t period;
+   retro_time_t delay;
+   retro_time_t margin;
+   bool auto_delay;
+
+   retro_time_t run_times[FRAME_SCHED_WINDOW];
+   unsigned run_ptr;
+   unsigned run_count;
+   unsigned since_update;
+
+   retro_time_t run_start;
+   retro_time_t last_present;
+   bool in_run;
+   bool presented;
+
+   uint64_t histogram[FRAME_SCHED_BINS];
+   uint64_t frames;
+   uint64_t late_frames;
+   uint64_t delayed_runs;
+   retro_time_t total_time;
+   retro_time_t max_run_time;
+};
+
+frame_scheduler_t *frame_scheduler_new(float refresh_rate, unsigned fixed_delay_ms, bool auto_delay)
+{
+   if (refresh_rate <= 0.0f)
+      return NULL;
+
+   frame_scheduler_t *sched = (frame_scheduler_t*)calloc(1, sizeof(*sched));
+   if (!sched)
+      return NULL;
+
+   sched->period     = (retro_time_t)(1000000.0f / refresh_rate + 0.5f);
+   sched->auto_delay = auto_delay;
+   sched->margin     = FRAME_SCHED_MARGIN;
+   if (!auto_delay)
+      sched->delay = fixed_delay_ms * 1000;
+
+   // A delay of a whole period or more would just skip vsyncs.
+   if (sched->delay >= sched->period)
+      sched->delay = sched->period - FRAME_SCHED_MARGIN;
+   if (sched->delay < 0)
+      sched->delay = 0;
+
+   return sched;
+}
+
+void frame_scheduler_free(frame_scheduler_t *sched)
+{
+   free(sched);
+}
+
+static int time_cmp(const void *a_, const void *b_)
+{
+   retro_time_t a = *(const retro_time_t*)a_;
+   retro_time_t b = *(const retro_time_t*)b_;
+   return a < b ? -1 : a > b;
+}
+
+static void update_auto_delay(frame_scheduler_t *sched)
+{
+   retro_time_t sorted[FRAME_SCHED_WINDOW];
+   unsigned count = sched->run_count;
+   memcpy(sorted, sched->run_times, count * sizeof(retro_time_t));
+   qsort(sorted, count, sizeof(retro_time_t), time_cmp);
+
+   retro_time_t p95 = sorted[(count * 95) / 100];
+   retro_time_t delay = sched->period - p95 - sched->margin;
+   sched->delay = delay > 0 ? delay : 0;
+   sched->since_update = 0;
+}
+
+void frame_scheduler_run_begin(frame_scheduler_t *sched, bool allow_delay)
+{
+   retro_time_t now = rarch_get_time_usec();
+
+   if (allow_delay && sched->delay > 0 && sched->last_present)
+   {
+      retro_time_t target = sched->last_present + sched->delay;
+      // If we are already past vsync + delay, the run is late as it is.
+      if (target > now)
+      {
+         rarch_sleep_until_usec(target);
+         now = rarch_get_time_usec();
+         sched->delayed_runs++;
+      }
+   }
+
+   sched->run_start = now;
+   sched->in_run    = true;
+   sched->presented = false;
+}
+
+void frame_scheduler_run_end(frame_scheduler_t *sched)
+{
+   sched->in_run = false;
+}
+
+void frame_scheduler_present_begin(frame_scheduler_t *sched)
+{
+   if (!sched->in_run || sched->presented)
+      return;
+
+   // Input polling, emulation and frame processing.
+   // Presenting itself blocks on vsync, so it cannot be part of the profile.
+   retro_time_t run_time = rarch_get_time_usec() - sched->run_start;
+   sched->run_times[sched->run_ptr] = run_time;
+   sched->run_ptr = (sched->run_ptr + 1) % FRAME_SCHED_WINDOW;
+   if (sched->run_count < FRAME_SCHED_WINDOW)
+      sched->run_count++;
+   if (run_time > sched->max_run_time)
+      sched->max_run_time = run_time;
+
+   if (sched->auto_delay && ++sched->since_update >= FRAME_SCHED_UPDATE_INTERVAL)
+      update_auto_delay(sched);
+}
+
+void frame_scheduler_present_end(frame_scheduler_t *sched)
+{
+   if (!sched->in_run || sched->presented)
+      return;
+   sched->presented = true;
+
+   retro_time_t now = rarch_get_time_usec();
+   retro_time_t frame_time = now - sched->last_present;
+   bool counted = sched->last_present && frame_time < FRAME_SCHED_MAX_GAP;
+   sched->last_present = now;
+   if (!counted)
+      return;
+
+   unsigned bin = frame_time / FRAME_SCHED_BIN_SIZE;
+   if (bin >= FRAME_SCHED_BINS)
+      bin = FRAME_SCHED_BINS - 1;
+   sched->histogram[bin]++;
+   sched->frames++;
+   sched->total_time += frame_time;
+
+   // Missed a vsync.
+   if (frame_time > sched->period + sched->period / 2)
+   {
+      sched->late_frames++;
+      if (sched->auto_delay && sched->delay > 0 && sched->margin < sched->period / 2)
+      {
+         sched->margin += FRAME_SCHED_BACKOFF;
+         update_auto_delay(sched);
+      }
+   }
+}
+
+static retro_time_t histogram_percentile(const frame_scheduler_t *sched, unsigned percent)
+{
+   uint64_t target = (sched->frames * percent + 99) / 100;
+   uint64_t accum = 0;
+   for (unsigned i = 0; i < FRAME_SCHED_BINS; i++)
+   {
+      accum += sched->histogram[i];
+      if (accum >= target)
+         return i * FRAME_SCHED_BIN_SIZE + FRAME_SCHED_BIN_SIZE / 2;
+   }
+   return FRAME_SCHED_BINS * FRAME_SCHED_BIN_SIZE;
+}
+
+void frame_scheduler_log(frame_scheduler_t *sched)
+{
+   if (!sched->frames)
+      return;
+
+   RARCH_LOG("[Frame scheduler]: %llu frames, average %.3f ms (target %.3f ms).\n",
+         (unsigned long long)sched->frames,
+         sched->total_time / (1000.0 * sched->frames), sched->period / 1000.0);
+   RARCH_LOG("[Frame scheduler]: Frame time p50 %.2f ms, p95 %.2f ms, p99 %.2f ms. %llu late frames.\n",
+         histogram_percentile(sched, 50) / 1000.0,
+         histogram_percentile(sched, 95) / 1000.0,
+         histogram_percentile(sched, 99) / 1000.0,
+         (unsigned long long)sched->late_frames);
+   RARCH_LOG("[Frame scheduler]: Longest run %.2f ms. Frame delay %.2f ms%s, applied to %llu frames.\n",
+         sched->max_run_time / 1000.0, sched->delay / 1000.0,
+         sched->auto_delay ? " (auto)" : "", (unsigned long long)sched->delayed_runs);
+}
+
+bool frame_scheduler_write_histogram(frame_scheduler_t *sched, const char *path)
+{
+   FILE *file = fopen(path, "w");
+   if (!file)
+   {
+      RARCH_ERR("Failed to open frame time histogram: %s.\n", path);
+      return false;
+   }
+
+   fprintf(file, "# Frame times, %u usec bins. Target %lld usec.\n",
+         FRAME_SCHED_BIN_SIZE, (long long)sched->period);
+   for (unsigned i = 0; i < FRAME_SCHED_BINS; i++)
+      fprintf(file, "%u %llu\n", i * FRAME_SCHED_BIN_SIZE, (unsigned long long)sched->histogram[i]);
+
+   fclose(file);
+   return true;
+}
+
@@ -0,0 +1,54 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_FRAME_SCHEDULER_H
+#define __RARCH_FRAME_SCHEDULER_H
+
+#include "boolean.h"
+#include "libretro.h"
+
+typedef struct frame_scheduler frame_scheduler_t;
+
+// Paces emulation inside the vsync interval.
+// Instead of running the core right after the previous frame was presented and then blocking on vsync,
+// the start of pretro_run() is pushed back by a delay, so input is polled as late as possible.
+//
+// Time from the start of a run to the frame reaching the video driver is profiled over a sliding window.
+// With auto_delay, the delay is picked from that profile, leaving the 95th percentile plus a margin
+// before the next vsync, and backs off whenever a frame comes in late. Otherwise fixed_delay_ms is used.
+//
+// refresh_rate is the rate frames are presented at, i.e. the monitor rate divided by the swap interval.
+frame_scheduler_t *frame_scheduler_new(float refresh_rate, unsigned fixed_delay_ms, bool auto_delay);
+void frame_scheduler_free(frame_scheduler_t *sched);
+
+// Called around pretro_run(). run_begin sleeps out the delay if allow_delay is set.
+// The delay only makes sense when presenting blocks on vsync.
+void frame_scheduler_run_begin(frame_scheduler_t *sched, bool allow_delay);
+void frame_scheduler_run_end(frame_scheduler_t *sched);
+
+// Called around handing a frame to the video driver, after any CPU processing of it.
+// Only the first frame of a run is counted.
+void frame_scheduler_present_begin(frame_scheduler_t *sched);
+void frame_scheduler_present_end(frame_scheduler_t *sched);
+
+// Logs frame time percentiles, late frames and the delay in use.
+void frame_scheduler_log(frame_scheduler_t *sched);
+
+// Writes the histogram of frame times (time between presents) as text,
+// one "<bin start in usec> <count>" line per bin. The last bin holds everything above it.
+bool frame_scheduler_write_histogram(frame_scheduler_t *sched, const char *path);
+
+#endif
+
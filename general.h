@@ -25,6 +25,9 @@
 #include "record/ffemu.h"
 #include "message_queue.h"
 #include "rewind.h"
+#include "frame_scheduler.h"
+#include "gfx/slice_pool.h"
+#include "gfx/filters/softfilter.h"
 #include "movie.h"
 #include "autosave.h"
 #include "dynamic.h"
@@ -80,6 +83,7 @@
 #endif
 
 #include "audio/resampler.h"
+#include "audio/dsp_filter.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -142,6 +146,9 @@ struct settings
       bool black_frame_insertion;
       unsigned swap_interval;
       unsigned hard_sync_frames;
+      unsigned frame_delay;
+      bool frame_delay_auto;
+      char frame_histogram_path[PATH_MAX];
       bool smooth;
       bool force_aspect;
       bool crop_overscan;
@@ -155,6 +162,7 @@ struct settings
       bool shader_enable;
 
       char filter_path[PATH_MAX];
+      unsigned filter_threads;
       float refresh_rate;
       bool threaded;
 
@@ -215,11 +223,15 @@ struct settings
       char device[PATH_MAX];
       unsigned latency;
       bool sync;
+      bool threaded;
 
       char dsp_plugin[PATH_MAX];
+      char dsp_filter[PATH_MAX];
 
       bool rate_control;
       float rate_control_delta;
+      float rate_control_filter;
+      float rate_control_integral;
       float volume; // dB scale
       char resampler[32];
    } audio;
@@ -253,6 +265,9 @@ struct settings
       unsigned icade_count;
 #endif
       bool netplay_client_swap_input;
+      char netplay_predictor[32];
+      unsigned netplay_check_frames;
+      unsigned netplay_accept_timeout;
 
       unsigned turbo_period;
       unsigned turbo_duty_cycle;
@@ -279,6 +294,10 @@ struct settings
    bool rewind_enable;
    size_t rewind_buffer_size;
    unsigned rewind_granularity;
+   bool rewind_compress;
+   bool rewind_threaded;
+   unsigned rewind_keyframe_interval;
+   bool rewind_dirty_blocks;
 
    float slowmotion_ratio;
    float fastforward_ratio;
@@ -407,6 +426,8 @@ struct global
       retro_time_t last_frame_time;
    } frame_limit;
 
+   frame_scheduler_t *frame_scheduler;
+
    struct
    {
       struct retro_system_info info;
@@ -428,6 +449,7 @@ struct global
       retro_keyboard_event_t key_event;
 
       struct retro_audio_callback audio_callback;
+      unsigned audio_channels; // From SET_AUDIO_CHANNELS, 0 if the core didn't set it.
 
       struct retro_disk_control_callback disk_control; 
       struct retro_hw_render_callback hw_render_callback;
@@ -445,6 +467,11 @@ struct global
       void *resampler_data;
       const rarch_resampler_t *resampler;
 
+      // Interleaved channels per frame. Audio is folded down to stereo just before the driver.
+      unsigned channels; // From the core.
+      unsigned dsp_plugin_channels; // Into the DSP plugin.
+      unsigned resampler_channels; // Out of the DSP plugin, through the resampler.
+
       float *data;
 
       size_t data_ptr;
@@ -468,10 +495,18 @@ struct global
       const rarch_dsp_plugin_t *dsp_plugin;
       void *dsp_handle;
 
+      rarch_dsp_filter_t *dsp_filter;
+
       bool rate_control; 
       double orig_src_ratio;
       size_t driver_buffer_size;
 
+      // Rate control state. Reported by the AUDIO_STATUS command.
+      float rate_control_fill; // Filtered buffer fill, 0.0 is empty, 1.0 is full.
+      double rate_control_integral;
+      bool underrun;
+      unsigned underruns;
+
       float volume_db;
       float volume_gain;
    } audio_data;
@@ -499,6 +534,18 @@ struct global
       void (*psize)(unsigned *width, unsigned *height);
       void (*prender)(uint32_t *colormap, uint32_t *output, unsigned outpitch,
             const uint16_t *input, unsigned pitch, unsigned width, unsigned height);
+      // Set instead of the plugin functions when video_filter names a built-in filter.
+      // Built-in filters output the format they take, RGB565 or XRGB8888 (rgb32).
+      const softfilter_implementation_t *softfilter;
+      bool rgb32;
+
+      // Optional. Renders the output for input lines [first_line, last_line) only.
+      // input and output still point to the whole frame, so lines outside the band can be read.
+      void (*prender_slice)(uint32_t *colormap, uint32_t *output, unsigned outpitch,
+            const uint16_t *input, unsigned pitch, unsigned width, unsigned height,
+            unsigned first_line, unsigned last_line);
+      // Runs conversion and rendering in slices. Single threaded if the filter lacks prender_slice.
+      slice_pool_t *pool;
 
       // CPU filters only work on *XRGB1555*. We have to convert to XRGB1555 first.
       struct scaler_ctx scaler;
@@ -564,6 +611,8 @@ struct global
    bool netplay_is_client;
    bool netplay_is_spectate;
    unsigned netplay_sync_frames;
+   unsigned netplay_input_delay;
+   unsigned netplay_players;
    uint16_t netplay_port;
    char netplay_nick[32];
 #endif
@@ -708,6 +757,7 @@ void rarch_check_overlay(void);
 void rarch_check_block_hotkey(void);
 void rarch_init_rewind(void);
 void rarch_deinit_rewind(void);
+bool rarch_rewind_seek(unsigned frames);
 void rarch_set_fullscreen(bool fullscreen);
 void rarch_disk_control_set_eject(bool state, bool log);
 void rarch_disk_control_set_index(unsigned index);
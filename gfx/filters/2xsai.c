@@ -0,0 +1,175 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// 2xSaI, after Derek Liauw Kie Fa's original.
+// Unlike Scale2x, it blends. Averages use per-format masks, so no channel carries into the next.
+//
+// Neighbourhood of A, with border pixels repeated at the edges:
+//    I E F J
+//    G A B K
+//    H C D L
+//    M N O
+
+#include "softfilter.h"
+
+static inline uint16_t interpolate_rgb565(uint16_t a, uint16_t b)
+{
+   return ((a & 0xf7de) >> 1) + ((b & 0xf7de) >> 1) + (a & b & 0x0821);
+}
+
+static inline uint16_t q_interpolate_rgb565(uint16_t a, uint16_t b, uint16_t c, uint16_t d)
+{
+   unsigned high = ((a & 0xe79c) >> 2) + ((b & 0xe79c) >> 2) + ((c & 0xe79c) >> 2) + ((d & 0xe79c) >> 2);
+   unsigned low  = (((a & 0x1863) + (b & 0x1863) + (c & 0x1863) + (d & 0x1863)) >> 2) & 0x1863;
+   return high + low;
+}
+
+static inline uint32_t interpolate_xrgb8888(uint32_t a, uint32_t b)
+{
+   return ((a & 0xfefefe) >> 1) + ((b & 0xfefefe) >> 1) + (a & b & 0x010101);
+}
+
+static inline uint32_t q_interpolate_xrgb8888(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+   uint32_t high = ((a & 0xfcfcfc) >> 2) + ((b & 0xfcfcfc) >> 2) + ((c & 0xfcfcfc) >> 2) + ((d & 0xfcfcfc) >> 2);
+   uint32_t low  = (((a & 0x030303) + (b & 0x030303) + (c & 0x030303) + (d & 0x030303)) >> 2) & 0x030303;
+   return high + low;
+}
+
+// Votes for which diagonal of the 2x2 block continues into the neighbours.
+// Positive favours A, negative favours B. Only called with a != b.
+static inline int sai_result(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+   int x = 0, y = 0, r = 0;
+   if (a == c)
+      x++;
+   else if (b == c)
+      y++;
+   if (a == d)
+      x++;
+   else if (b == d)
+      y++;
+   if (x <= 1)
+      r++;
+   if (y <= 1)
+      r--;
+   return r;
+}
+
+#define SAI_LINE(type, ptr, stride, y) ((const type*)((const uint8_t*)(ptr) + (size_t)(y) * (stride)))
+
+#define SAI_RENDER(name, type, interpolate, q_interpolate) \
+static void name(type *out, size_t out_stride, const type *in, size_t in_stride, \
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line) \
+{ \
+   unsigned x, y; \
+   for (y = first_line; y < last_line; y++) \
+   { \
+      const type *row0 = SAI_LINE(type, in, in_stride, y > 0 ? y - 1 : 0); \
+      const type *row1 = SAI_LINE(type, in, in_stride, y); \
+      const type *row2 = SAI_LINE(type, in, in_stride, y + 1 < height ? y + 1 : height - 1); \
+      const type *row3 = SAI_LINE(type, in, in_stride, y + 2 < height ? y + 2 : height - 1); \
+      type *out0 = (type*)((uint8_t*)out + (size_t)(2 * y + 0) * out_stride); \
+      type *out1 = (type*)((uint8_t*)out + (size_t)(2 * y + 1) * out_stride); \
+      for (x = 0; x < width; x++) \
+      { \
+         unsigned xl  = x > 0 ? x - 1 : 0; \
+         unsigned xr  = x + 1 < width ? x + 1 : width - 1; \
+         unsigned xr2 = x + 2 < width ? x + 2 : width - 1; \
+         type I = row0[xl], E = row0[x], F = row0[xr], J = row0[xr2]; \
+         type G = row1[xl], A = row1[x], B = row1[xr], K = row1[xr2]; \
+         type H = row2[xl], C = row2[x], D = row2[xr], L = row2[xr2]; \
+         type M = row3[xl], N = row3[x], O = row3[xr]; \
+         type product, product1, product2; \
+         if (A == D && B != C) \
+         { \
+            if ((A == E && B == L) || (A == C && A == F && B != E && B == J)) \
+               product = A; \
+            else \
+               product = interpolate(A, B); \
+            if ((A == G && C == O) || (A == B && A == H && G != C && C == M)) \
+               product1 = A; \
+            else \
+               product1 = interpolate(A, C); \
+            product2 = A; \
+         } \
+         else if (B == C && A != D) \
+         { \
+            if ((B == F && A == H) || (B == E && B == D && A != F && A == I)) \
+               product = B; \
+            else \
+               product = interpolate(A, B); \
+            if ((C == H && A == F) || (C == G && C == D && A != H && A == I)) \
+               product1 = C; \
+            else \
+               product1 = interpolate(A, C); \
+            product2 = B; \
+         } \
+         else if (A == D && B == C) \
+         { \
+            if (A == B) \
+               product = product1 = product2 = A; \
+            else \
+            { \
+               int r = 0; \
+               product1 = interpolate(A, C); \
+               product  = interpolate(A, B); \
+               r += sai_result(A, B, G, E); \
+               r += sai_result(A, B, K, F); \
+               r += sai_result(A, B, H, N); \
+               r += sai_result(A, B, L, O); \
+               if (r > 0) \
+                  product2 = A; \
+               else if (r < 0) \
+                  product2 = B; \
+               else \
+                  product2 = q_interpolate(A, B, C, D); \
+            } \
+         } \
+         else \
+         { \
+            product2 = q_interpolate(A, B, C, D); \
+            if (A == C && A == F && B != E && B == J) \
+               product = A; \
+            else if (B == E && B == D && A != F && A == I) \
+               product = B; \
+            else \
+               product = interpolate(A, B); \
+            if (A == B && A == H && G != C && C == M) \
+               product1 = A; \
+            else if (C == G && C == D && A != H && A == I) \
+               product1 = C; \
+            else \
+               product1 = interpolate(A, C); \
+         } \
+         out0[2 * x + 0] = A; \
+         out0[2 * x + 1] = product; \
+         out1[2 * x + 0] = product1; \
+         out1[2 * x + 1] = product2; \
+      } \
+   } \
+}
+
+SAI_RENDER(sai_render_rgb565, uint16_t, interpolate_rgb565, q_interpolate_rgb565)
+SAI_RENDER(sai_render_xrgb8888, uint32_t, interpolate_xrgb8888, q_interpolate_xrgb8888)
+
+const softfilter_implementation_t softfilter_2xsai = {
+   sai_render_rgb565,
+   sai_render_xrgb8888,
+   2, 2,
+   0,
+   "2xsai",
+};
+
@@ -0,0 +1,172 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Composite video, in the spirit of blargg's NTSC filters.
+// Every line is encoded to a composite signal, two samples per input pixel, with the color
+// subcarrier at a quarter of the sample rate. The phase flips every line.
+// It is then decoded with short filters, which do not separate luma and chroma fully,
+// so sharp edges get color fringes and colors bleed, like on a TV.
+//
+// Luma is filtered with [1 2 2 2 1] / 8 and chroma with [1 2 2 2 2 2 2 2 1] / 16.
+// Both windows cancel the other signal exactly on flat areas, so flat colors come out unchanged.
+
+#include "softfilter.h"
+
+#define NTSC_MAX_WIDTH 1024
+#define NTSC_PAD 4 // One subcarrier period of padding each side, so the filters need no edge checks.
+
+static inline void ntsc_encode(float *signal, unsigned x, unsigned phase, float r, float g, float b)
+{
+   float y = 0.299f * r + 0.587f * g + 0.114f * b;
+   float i = 0.596f * r - 0.274f * g - 0.322f * b;
+   float q = 0.211f * r - 0.523f * g + 0.312f * b;
+
+   // Subcarrier goes I, Q, -I, -Q. Pixels start on an even sample, and the line phase is even,
+   // so a pixel is either I, Q or -I, -Q.
+   unsigned n = 2 * x;
+   bool negate = (n + phase) & 2;
+   signal[n + 0] = y + (negate ? -i : i);
+   signal[n + 1] = y + (negate ? -q : q);
+}
+
+static void ntsc_pad(float *signal, unsigned samples)
+{
+   unsigned k;
+   if (samples < NTSC_PAD) // Not even a whole period, phase does not matter.
+   {
+      for (k = 1; k <= NTSC_PAD; k++)
+         signal[-(int)k] = signal[samples - 1 + k] = signal[0];
+      return;
+   }
+
+   // Repeat the outermost period, which keeps the subcarrier phase.
+   for (k = 1; k <= NTSC_PAD; k++)
+   {
+      signal[-(int)k] = signal[NTSC_PAD - k];
+      signal[samples - 1 + k] = signal[samples - 1 + k - NTSC_PAD];
+   }
+}
+
+static inline float ntsc_clamp(float v)
+{
+   return v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+}
+
+static inline void ntsc_decode(const float *s, int n, unsigned phase, float *r, float *g, float *b)
+{
+   float y = (s[n - 2] + 2.0f * (s[n - 1] + s[n] + s[n + 1]) + s[n + 2]) * (1.0f / 8.0f);
+
+   // Demodulating is multiplying with 2 * cos / 2 * sin of the subcarrier, which is 0 on every other sample.
+   // Samples at even offsets from n share the phase of n, up to sign.
+   float even = s[n - 4] + 2.0f * (-s[n - 2] + s[n] - s[n + 2]) + s[n + 4];
+   float odd  = 2.0f * (-s[n - 3] + s[n - 1] - s[n + 1] + s[n + 3]);
+   float i, q;
+
+   switch ((n + (int)phase) & 3)
+   {
+      case 0: // I at n.
+         i = even;
+         q = -odd;
+         break;
+      case 1: // Q at n.
+         q = even;
+         i = odd;
+         break;
+      case 2: // -I at n.
+         i = -even;
+         q = odd;
+         break;
+      default: // -Q at n.
+         q = -even;
+         i = -odd;
+         break;
+   }
+   i *= 2.0f / 16.0f;
+   q *= 2.0f / 16.0f;
+
+   *r = ntsc_clamp(y + 0.956f * i + 0.621f * q);
+   *g = ntsc_clamp(y - 0.272f * i - 0.647f * q);
+   *b = ntsc_clamp(y - 1.106f * i + 1.703f * q);
+}
+
+static inline void ntsc_read_rgb565(uint16_t col, float *r, float *g, float *b)
+{
+   *r = ((col >> 11) & 0x1f) * (1.0f / 31.0f);
+   *g = ((col >>  5) & 0x3f) * (1.0f / 63.0f);
+   *b = ((col >>  0) & 0x1f) * (1.0f / 31.0f);
+}
+
+static inline uint16_t ntsc_write_rgb565(float r, float g, float b)
+{
+   return ((unsigned)(r * 31.0f + 0.5f) << 11) |
+      ((unsigned)(g * 63.0f + 0.5f) << 5) |
+      ((unsigned)(b * 31.0f + 0.5f) << 0);
+}
+
+static inline void ntsc_read_xrgb8888(uint32_t col, float *r, float *g, float *b)
+{
+   *r = ((col >> 16) & 0xff) * (1.0f / 255.0f);
+   *g = ((col >>  8) & 0xff) * (1.0f / 255.0f);
+   *b = ((col >>  0) & 0xff) * (1.0f / 255.0f);
+}
+
+static inline uint32_t ntsc_write_xrgb8888(float r, float g, float b)
+{
+   return ((uint32_t)(r * 255.0f + 0.5f) << 16) |
+      ((uint32_t)(g * 255.0f + 0.5f) << 8) |
+      ((uint32_t)(b * 255.0f + 0.5f) << 0);
+}
+
+#define NTSC_RENDER(name, type, read, write) \
+static void name(type *out, size_t out_stride, const type *in, size_t in_stride, \
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line) \
+{ \
+   float buffer[2 * NTSC_MAX_WIDTH + 2 * NTSC_PAD]; \
+   float *signal = buffer + NTSC_PAD; \
+   unsigned samples = 2 * width; \
+   unsigned x, y; \
+   (void)height; \
+   for (y = first_line; y < last_line; y++) \
+   { \
+      const type *line = (const type*)((const uint8_t*)in + (size_t)y * in_stride); \
+      type *out_line = (type*)((uint8_t*)out + (size_t)y * out_stride); \
+      unsigned phase = (y & 1) * 2; \
+      for (x = 0; x < width; x++) \
+      { \
+         float r, g, b; \
+         read(line[x], &r, &g, &b); \
+         ntsc_encode(signal, x, phase, r, g, b); \
+      } \
+      ntsc_pad(signal, samples); \
+      for (x = 0; x < samples; x++) \
+      { \
+         float r, g, b; \
+         ntsc_decode(signal, (int)x, phase, &r, &g, &b); \
+         out_line[x] = write(r, g, b); \
+      } \
+   } \
+}
+
+NTSC_RENDER(ntsc_render_rgb565, uint16_t, ntsc_read_rgb565, ntsc_write_rgb565)
+NTSC_RENDER(ntsc_render_xrgb8888, uint32_t, ntsc_read_xrgb8888, ntsc_write_xrgb8888)
+
+const softfilter_implementation_t softfilter_ntsc = {
+   ntsc_render_rgb565,
+   ntsc_render_xrgb8888,
+   2, 1,
+   NTSC_MAX_WIDTH,
+   "ntsc",
+};
+
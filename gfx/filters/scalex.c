@@ -0,0 +1,369 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Scale2x and Scale3x (AdvanceMAME). Every output pixel is picked from the input,
+// so the kernels only compare and select, which maps directly to SIMD.
+//
+// Neighbourhood of E, with border pixels repeated at the edges:
+//    A B C
+//    D E F
+//    G H I
+
+#include "softfilter.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALEX_SIMD
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SCALEX_SIMD
+#endif
+
+#define SCALEX_LINE(ptr, stride, y) ((const void*)((const uint8_t*)(ptr) + (size_t)(y) * (stride)))
+#define SCALEX_OUT_LINE(ptr, stride, y) ((void*)((uint8_t*)(ptr) + (size_t)(y) * (stride)))
+
+#define SCALE2X_LINE_C(type) \
+static void scale2x_line_c_##type(type *out0, type *out1, \
+      const type *above, const type *line, const type *below, \
+      unsigned width, unsigned x0, unsigned x1) \
+{ \
+   unsigned x; \
+   for (x = x0; x < x1; x++) \
+   { \
+      type B = above[x], E = line[x], H = below[x]; \
+      type D = line[x ? x - 1 : 0]; \
+      type F = line[x + 1 < width ? x + 1 : x]; \
+      type E0 = E, E1 = E, E2 = E, E3 = E; \
+      if (B != H && D != F) \
+      { \
+         if (D == B) E0 = D; \
+         if (B == F) E1 = F; \
+         if (D == H) E2 = D; \
+         if (H == F) E3 = F; \
+      } \
+      out0[2 * x + 0] = E0; \
+      out0[2 * x + 1] = E1; \
+      out1[2 * x + 0] = E2; \
+      out1[2 * x + 1] = E3; \
+   } \
+}
+
+#define SCALE3X_LINE_C(type) \
+static void scale3x_line_c_##type(type *out0, type *out1, type *out2, \
+      const type *above, const type *line, const type *below, \
+      unsigned width, unsigned x0, unsigned x1) \
+{ \
+   unsigned x; \
+   for (x = x0; x < x1; x++) \
+   { \
+      unsigned xl = x ? x - 1 : 0; \
+      unsigned xr = x + 1 < width ? x + 1 : x; \
+      type A = above[xl], B = above[x], C = above[xr]; \
+      type D = line[xl],  E = line[x],  F = line[xr]; \
+      type G = below[xl], H = below[x], I = below[xr]; \
+      type E0 = E, E1 = E, E2 = E, E3 = E, E5 = E, E6 = E, E7 = E, E8 = E; \
+      if (B != H && D != F) \
+      { \
+         if (D == B) E0 = D; \
+         if ((D == B && E != C) || (B == F && E != A)) E1 = B; \
+         if (B == F) E2 = F; \
+         if ((D == B && E != G) || (D == H && E != A)) E3 = D; \
+         if ((B == F && E != I) || (H == F && E != C)) E5 = F; \
+         if (D == H) E6 = D; \
+         if ((D == H && E != I) || (H == F && E != G)) E7 = H; \
+         if (H == F) E8 = F; \
+      } \
+      out0[3 * x + 0] = E0; \
+      out0[3 * x + 1] = E1; \
+      out0[3 * x + 2] = E2; \
+      out1[3 * x + 0] = E3; \
+      out1[3 * x + 1] = E; \
+      out1[3 * x + 2] = E5; \
+      out2[3 * x + 0] = E6; \
+      out2[3 * x + 1] = E7; \
+      out2[3 * x + 2] = E8; \
+   } \
+}
+
+SCALE2X_LINE_C(uint16_t)
+SCALE2X_LINE_C(uint32_t)
+SCALE3X_LINE_C(uint16_t)
+SCALE3X_LINE_C(uint32_t)
+
+// The SIMD lines work on bytes, so one function covers both pixel sizes.
+// rgb32 is always a constant at the call site.
+// They cover x from 1 up to the last full vector that does not touch the right edge,
+// and return where the C version has to take over.
+#if defined(__SSE2__)
+typedef __m128i scalex_vec_t;
+#define SCALEX_VEC_BYTES 16
+#define scalex_load(ptr) _mm_loadu_si128((const __m128i*)(ptr))
+
+static inline __m128i scalex_eq(__m128i a, __m128i b, bool rgb32)
+{
+   return rgb32 ? _mm_cmpeq_epi32(a, b) : _mm_cmpeq_epi16(a, b);
+}
+
+#define scalex_and(a, b) _mm_and_si128(a, b)
+#define scalex_or(a, b) _mm_or_si128(a, b)
+#define scalex_andnot(a, b) _mm_andnot_si128(b, a) // a & ~b
+#define scalex_select(mask, a, b) _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
+
+static inline void scalex_store2(uint8_t *out, __m128i a, __m128i b, bool rgb32)
+{
+   _mm_storeu_si128((__m128i*)out + 0, rgb32 ? _mm_unpacklo_epi32(a, b) : _mm_unpacklo_epi16(a, b));
+   _mm_storeu_si128((__m128i*)out + 1, rgb32 ? _mm_unpackhi_epi32(a, b) : _mm_unpackhi_epi16(a, b));
+}
+
+// SSE2 has no three-way interleave, so go through memory.
+static inline void scalex_store3(uint8_t *out, __m128i a, __m128i b, __m128i c, bool rgb32)
+{
+   unsigned i;
+   union
+   {
+      __m128i v[3];
+      uint16_t h[24];
+      uint32_t w[12];
+   } tmp;
+   tmp.v[0] = a;
+   tmp.v[1] = b;
+   tmp.v[2] = c;
+
+   if (rgb32)
+   {
+      uint32_t *out32 = (uint32_t*)out;
+      for (i = 0; i < 4; i++)
+      {
+         out32[3 * i + 0] = tmp.w[i];
+         out32[3 * i + 1] = tmp.w[4 + i];
+         out32[3 * i + 2] = tmp.w[8 + i];
+      }
+   }
+   else
+   {
+      uint16_t *out16 = (uint16_t*)out;
+      for (i = 0; i < 8; i++)
+      {
+         out16[3 * i + 0] = tmp.h[i];
+         out16[3 * i + 1] = tmp.h[8 + i];
+         out16[3 * i + 2] = tmp.h[16 + i];
+      }
+   }
+}
+#elif defined(__ARM_NEON__)
+typedef uint8x16_t scalex_vec_t;
+#define SCALEX_VEC_BYTES 16
+#define scalex_load(ptr) vld1q_u8((const uint8_t*)(ptr))
+
+static inline uint8x16_t scalex_eq(uint8x16_t a, uint8x16_t b, bool rgb32)
+{
+   if (rgb32)
+      return vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+   return vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+
+#define scalex_and(a, b) vandq_u8(a, b)
+#define scalex_or(a, b) vorrq_u8(a, b)
+#define scalex_andnot(a, b) vbicq_u8(a, b) // a & ~b
+#define scalex_select(mask, a, b) vbslq_u8(mask, a, b)
+
+static inline void scalex_store2(uint8_t *out, uint8x16_t a, uint8x16_t b, bool rgb32)
+{
+   if (rgb32)
+   {
+      uint32x4x2_t v = {{ vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b) }};
+      vst2q_u32((uint32_t*)out, v);
+   }
+   else
+   {
+      uint16x8x2_t v = {{ vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b) }};
+      vst2q_u16((uint16_t*)out, v);
+   }
+}
+
+static inline void scalex_store3(uint8_t *out, uint8x16_t a, uint8x16_t b, uint8x16_t c, bool rgb32)
+{
+   if (rgb32)
+   {
+      uint32x4x3_t v = {{ vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b), vreinterpretq_u32_u8(c) }};
+      vst3q_u32((uint32_t*)out, v);
+   }
+   else
+   {
+      uint16x8x3_t v = {{ vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b), vreinterpretq_u16_u8(c) }};
+      vst3q_u16((uint16_t*)out, v);
+   }
+}
+#endif
+
+#ifdef SCALEX_SIMD
+static inline unsigned scale2x_line_simd(uint8_t *out0, uint8_t *out1,
+      const uint8_t *above, const uint8_t *line, const uint8_t *below,
+      unsigned width, bool rgb32)
+{
+   unsigned bpp   = rgb32 ? 4 : 2;
+   unsigned lanes = SCALEX_VEC_BYTES / bpp;
+   unsigned x;
+
+   for (x = 1; x + lanes < width; x += lanes)
+   {
+      scalex_vec_t B = scalex_load(above + x * bpp);
+      scalex_vec_t D = scalex_load(line + (x - 1) * bpp);
+      scalex_vec_t E = scalex_load(line + x * bpp);
+      scalex_vec_t F = scalex_load(line + (x + 1) * bpp);
+      scalex_vec_t H = scalex_load(below + x * bpp);
+
+      scalex_vec_t cond = scalex_andnot(scalex_andnot(scalex_eq(E, E, rgb32), scalex_eq(B, H, rgb32)),
+            scalex_eq(D, F, rgb32));
+
+      scalex_vec_t E0 = scalex_select(scalex_and(cond, scalex_eq(D, B, rgb32)), D, E);
+      scalex_vec_t E1 = scalex_select(scalex_and(cond, scalex_eq(B, F, rgb32)), F, E);
+      scalex_vec_t E2 = scalex_select(scalex_and(cond, scalex_eq(D, H, rgb32)), D, E);
+      scalex_vec_t E3 = scalex_select(scalex_and(cond, scalex_eq(H, F, rgb32)), F, E);
+
+      scalex_store2(out0 + 2 * x * bpp, E0, E1, rgb32);
+      scalex_store2(out1 + 2 * x * bpp, E2, E3, rgb32);
+   }
+
+   return x;
+}
+
+static inline unsigned scale3x_line_simd(uint8_t *out0, uint8_t *out1, uint8_t *out2,
+      const uint8_t *above, const uint8_t *line, const uint8_t *below,
+      unsigned width, bool rgb32)
+{
+   unsigned bpp   = rgb32 ? 4 : 2;
+   unsigned lanes = SCALEX_VEC_BYTES / bpp;
+   unsigned x;
+
+   for (x = 1; x + lanes < width; x += lanes)
+   {
+      scalex_vec_t A = scalex_load(above + (x - 1) * bpp);
+      scalex_vec_t B = scalex_load(above + x * bpp);
+      scalex_vec_t C = scalex_load(above + (x + 1) * bpp);
+      scalex_vec_t D = scalex_load(line + (x - 1) * bpp);
+      scalex_vec_t E = scalex_load(line + x * bpp);
+      scalex_vec_t F = scalex_load(line + (x + 1) * bpp);
+      scalex_vec_t G = scalex_load(below + (x - 1) * bpp);
+      scalex_vec_t H = scalex_load(below + x * bpp);
+      scalex_vec_t I = scalex_load(below + (x + 1) * bpp);
+
+      scalex_vec_t cond = scalex_andnot(scalex_andnot(scalex_eq(E, E, rgb32), scalex_eq(B, H, rgb32)),
+            scalex_eq(D, F, rgb32));
+      scalex_vec_t db = scalex_and(cond, scalex_eq(D, B, rgb32));
+      scalex_vec_t bf = scalex_and(cond, scalex_eq(B, F, rgb32));
+      scalex_vec_t dh = scalex_and(cond, scalex_eq(D, H, rgb32));
+      scalex_vec_t hf = scalex_and(cond, scalex_eq(H, F, rgb32));
+      scalex_vec_t ea = scalex_eq(E, A, rgb32);
+      scalex_vec_t ec = scalex_eq(E, C, rgb32);
+      scalex_vec_t eg = scalex_eq(E, G, rgb32);
+      scalex_vec_t ei = scalex_eq(E, I, rgb32);
+
+      scalex_vec_t E0 = scalex_select(db, D, E);
+      scalex_vec_t E1 = scalex_select(scalex_or(scalex_andnot(db, ec), scalex_andnot(bf, ea)), B, E);
+      scalex_vec_t E2 = scalex_select(bf, F, E);
+      scalex_vec_t E3 = scalex_select(scalex_or(scalex_andnot(db, eg), scalex_andnot(dh, ea)), D, E);
+      scalex_vec_t E5 = scalex_select(scalex_or(scalex_andnot(bf, ei), scalex_andnot(hf, ec)), F, E);
+      scalex_vec_t E6 = scalex_select(dh, D, E);
+      scalex_vec_t E7 = scalex_select(scalex_or(scalex_andnot(dh, ei), scalex_andnot(hf, eg)), H, E);
+      scalex_vec_t E8 = scalex_select(hf, F, E);
+
+      scalex_store3(out0 + 3 * x * bpp, E0, E1, E2, rgb32);
+      scalex_store3(out1 + 3 * x * bpp, E3, E, E5, rgb32);
+      scalex_store3(out2 + 3 * x * bpp, E6, E7, E8, rgb32);
+   }
+
+   return x;
+}
+#endif
+
+#ifdef SCALEX_SIMD
+#define SCALE2X_SIMD_LINE(type, rgb32) \
+   if (width > 2) \
+   { \
+      scale2x_line_c_##type(out0, out1, above, line, below, width, 0, 1); \
+      x = scale2x_line_simd((uint8_t*)out0, (uint8_t*)out1, \
+            (const uint8_t*)above, (const uint8_t*)line, (const uint8_t*)below, width, rgb32); \
+   }
+#define SCALE3X_SIMD_LINE(type, rgb32) \
+   if (width > 2) \
+   { \
+      scale3x_line_c_##type(out0, out1, out2, above, line, below, width, 0, 1); \
+      x = scale3x_line_simd((uint8_t*)out0, (uint8_t*)out1, (uint8_t*)out2, \
+            (const uint8_t*)above, (const uint8_t*)line, (const uint8_t*)below, width, rgb32); \
+   }
+#else
+#define SCALE2X_SIMD_LINE(type, rgb32)
+#define SCALE3X_SIMD_LINE(type, rgb32)
+#endif
+
+#define SCALE2X_RENDER(name, type, rgb32) \
+static void name(type *out, size_t out_stride, const type *in, size_t in_stride, \
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line) \
+{ \
+   unsigned y; \
+   for (y = first_line; y < last_line; y++) \
+   { \
+      const type *line  = (const type*)SCALEX_LINE(in, in_stride, y); \
+      const type *above = y > 0 ? (const type*)SCALEX_LINE(in, in_stride, y - 1) : line; \
+      const type *below = y + 1 < height ? (const type*)SCALEX_LINE(in, in_stride, y + 1) : line; \
+      type *out0 = (type*)SCALEX_OUT_LINE(out, out_stride, 2 * y + 0); \
+      type *out1 = (type*)SCALEX_OUT_LINE(out, out_stride, 2 * y + 1); \
+      unsigned x = 0; \
+      SCALE2X_SIMD_LINE(type, rgb32) \
+      scale2x_line_c_##type(out0, out1, above, line, below, width, x, width); \
+   } \
+}
+
+#define SCALE3X_RENDER(name, type, rgb32) \
+static void name(type *out, size_t out_stride, const type *in, size_t in_stride, \
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line) \
+{ \
+   unsigned y; \
+   for (y = first_line; y < last_line; y++) \
+   { \
+      const type *line  = (const type*)SCALEX_LINE(in, in_stride, y); \
+      const type *above = y > 0 ? (const type*)SCALEX_LINE(in, in_stride, y - 1) : line; \
+      const type *below = y + 1 < height ? (const type*)SCALEX_LINE(in, in_stride, y + 1) : line; \
+      type *out0 = (type*)SCALEX_OUT_LINE(out, out_stride, 3 * y + 0); \
+      type *out1 = (type*)SCALEX_OUT_LINE(out, out_stride, 3 * y + 1); \
+      type *out2 = (type*)SCALEX_OUT_LINE(out, out_stride, 3 * y + 2); \
+      unsigned x = 0; \
+      SCALE3X_SIMD_LINE(type, rgb32) \
+      scale3x_line_c_##type(out0, out1, out2, above, line, below, width, x, width); \
+   } \
+}
+
+SCALE2X_RENDER(scale2x_render_rgb565, uint16_t, false)
+SCALE2X_RENDER(scale2x_render_xrgb8888, uint32_t, true)
+SCALE3X_RENDER(scale3x_render_rgb565, uint16_t, false)
+SCALE3X_RENDER(scale3x_render_xrgb8888, uint32_t, true)
+
+const softfilter_implementation_t softfilter_scale2x = {
+   scale2x_render_rgb565,
+   scale2x_render_xrgb8888,
+   2, 2,
+   0,
+   "scale2x",
+};
+
+const softfilter_implementation_t softfilter_scale3x = {
+   scale3x_render_rgb565,
+   scale3x_render_xrgb8888,
+   3, 3,
+   0,
+   "scale3x",
+};
+
@@ -0,0 +1,48 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "softfilter.h"
+#include <string.h>
+
+#define SOFTFILTER_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static const softfilter_implementation_t *softfilters[] = {
+   &softfilter_scale2x,
+   &softfilter_scale3x,
+   &softfilter_2xsai,
+   &softfilter_ntsc,
+};
+
+const softfilter_implementation_t *softfilter_find(const char *ident)
+{
+   unsigned i;
+   for (i = 0; i < SOFTFILTER_COUNT(softfilters); i++)
+      if (strcmp(softfilters[i]->ident, ident) == 0)
+         return softfilters[i];
+   return NULL;
+}
+
+void softfilter_render(const softfilter_implementation_t *impl, bool rgb32,
+      void *out, size_t out_stride, const void *in, size_t in_stride,
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line)
+{
+   if (rgb32)
+      impl->render_xrgb8888((uint32_t*)out, out_stride, (const uint32_t*)in, in_stride,
+            width, height, first_line, last_line);
+   else
+      impl->render_rgb565((uint16_t*)out, out_stride, (const uint16_t*)in, in_stride,
+            width, height, first_line, last_line);
+}
+
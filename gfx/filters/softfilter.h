@@ -0,0 +1,63 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_SOFTFILTER_H
+#define __RARCH_SOFTFILTER_H
+
+#ifdef HAVE_CONFIG_H
+#include "../../config.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "../../boolean.h"
+
+// Built-in CPU filters. Unlike bSNES filter plugins, these work on RGB565 and XRGB8888 natively,
+// and output the same format they take, so no conversion or colormap is involved.
+//
+// Renderers fill in the output for input lines [first_line, last_line).
+// in and out point to the whole frame, so lines outside the band may be read.
+// Bands can be rendered concurrently. Strides are in bytes.
+typedef void (*softfilter_render_rgb565_t)(uint16_t *out, size_t out_stride,
+      const uint16_t *in, size_t in_stride, unsigned width, unsigned height,
+      unsigned first_line, unsigned last_line);
+typedef void (*softfilter_render_xrgb8888_t)(uint32_t *out, size_t out_stride,
+      const uint32_t *in, size_t in_stride, unsigned width, unsigned height,
+      unsigned first_line, unsigned last_line);
+
+typedef struct softfilter_implementation
+{
+   softfilter_render_rgb565_t render_rgb565;
+   softfilter_render_xrgb8888_t render_xrgb8888;
+   unsigned scale_x;
+   unsigned scale_y;
+   unsigned max_width; // Widest input the filter takes. 0 if unlimited.
+   const char *ident;
+} softfilter_implementation_t;
+
+extern const softfilter_implementation_t softfilter_scale2x;
+extern const softfilter_implementation_t softfilter_scale3x;
+extern const softfilter_implementation_t softfilter_2xsai;
+extern const softfilter_implementation_t softfilter_ntsc;
+
+// Finds a built-in filter by ident, e.g. "scale2x". NULL if there is none.
+const softfilter_implementation_t *softfilter_find(const char *ident);
+
+void softfilter_render(const softfilter_implementation_t *impl, bool rgb32,
+      void *out, size_t out_stride, const void *in, size_t in_stride,
+      unsigned width, unsigned height, unsigned first_line, unsigned last_line);
+
+#endif
+
@@ -148,8 +148,9 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
       ctx->unscaled = true; // Only pixel format conversion ...
    else
    {
-      ctx->scaler_horiz = scaler_argb8888_horiz;
-      ctx->scaler_vert  = scaler_argb8888_vert;
+      const scaler_argb8888_backend_t *backend = scaler_argb8888_find_backend();
+      ctx->scaler_horiz = backend->horiz;
+      ctx->scaler_vert  = backend->vert;
       ctx->unscaled     = false;
    }
 
@@ -14,9 +14,13 @@
  */
 
 #include "scaler_int.h"
+#include "../../libretro.h"
+#include "../../performance.h"
+#include <string.h>
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef HAVE_NEON
 #endif
 
 #if defined(__SSE2__)
@@ -26,6 +30,34 @@
 #endif
 #endif
 
+// AVX2 kernels are built into a baseline binary, and are only used when the CPU has them.
+#if defined(__SSE2__) && defined(RARCH_HAVE_TARGET_AVX2)
+#define SCALER_HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(HAVE_NEON) && defined(__ARM_NEON__)
+#define SCALER_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef SCALER_TEST
+// Test programs are built for the machine they run on.
+static uint64_t scaler_cpu_features(void)
+{
+   uint64_t cpu = 0;
+#ifdef __AVX2__
+   cpu |= RETRO_SIMD_AVX2;
+#endif
+#ifdef HAVE_NEON
+   cpu |= RETRO_SIMD_NEON;
+#endif
+   return cpu;
+}
+#else
+#define scaler_cpu_features rarch_get_cpu_features
+#endif
+
 // ARGB8888 scaler is split in two:
 //
 // First, horizontal scaler is applied.
@@ -42,11 +74,19 @@
 // Scaling is now complete. Channels are shifted right by 3, and saturated into 8-bit values.
 //
 // The C version of scalers perform the exact same operations as the SIMD code for testing purposes.
+// Sums saturate, and taps are split in two, even taps in one accumulator and odd taps in another,
+// so every version saturates in the same places, and gives identical output.
 
-#if defined(__SSE2__)
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+// Saturating add, like SIMD adds.
+static inline int16_t scaler_adds16(int16_t a, int16_t b)
 {
-   int h, w, y;
+   int res = a + b;
+   return res > 0x7fff ? 0x7fff : (res < -0x8000 ? -0x8000 : res);
+}
+
+void scaler_argb8888_vert_C(const struct scaler_ctx *ctx, void *output_, int stride)
+{
+   int h, w, y, c;
    const uint64_t *input = ctx->scaled.frame;
    uint32_t *output = (uint32_t*)output_;
 
@@ -58,39 +98,107 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
 
       for (w = 0; w < ctx->out_width; w++)
       {
-         __m128i res = _mm_setzero_si128();
+         // Even and odd taps are summed apart, then together. Channels are b, g, r, a.
+         int16_t res[2][4] = {{0}};
 
          const uint64_t *input_base_y = input_base + w;
-
-         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += (ctx->scaled.stride >> 2))
+         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
          {
-            __m128i coeff = _mm_set_epi64x(filter_vert[y + 1] * 0x0001000100010001ll, filter_vert[y + 0] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(input_base_y[ctx->scaled.stride >> 3], input_base_y[0]);
+            uint64_t col = *input_base_y;
+            int16_t coeff = filter_vert[y];
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            for (c = 0; c < 4; c++)
+            {
+               int16_t v = (col >> (16 * c)) & 0xffff;
+               res[y & 1][c] = scaler_adds16(res[y & 1][c], (v * coeff) >> 16);
+            }
          }
 
-         for (; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
+         for (c = 0; c < 4; c++)
+            res[0][c] = scaler_adds16(res[0][c], res[1][c]) >> (7 - 2 - 2);
+
+         output[w] = ((uint32_t)clamp_8bit(res[0][3]) << 24) | (clamp_8bit(res[0][2]) << 16) | (clamp_8bit(res[0][1]) << 8) | (clamp_8bit(res[0][0]) << 0);
+      }
+   }
+}
+
+static inline uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t b)
+{
+   return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
+}
+
+void scaler_argb8888_horiz_C(const struct scaler_ctx *ctx, const void *input_, int stride)
+{
+   int h, w, x, c;
+   const uint32_t *input = (uint32_t*)input_;
+   uint64_t *output      = ctx->scaled.frame;
+
+   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+      {
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+
+         // Even and odd taps are summed apart, then together. Channels are b, g, r, a.
+         int16_t res[2][4] = {{0}};
+
+         for (x = 0; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_vert[y] * 0x0001000100010001ll);
-            __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+            uint32_t col = input_base_x[x];
+            int16_t coeff = filter_horiz[x];
 
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            for (c = 0; c < 4; c++)
+            {
+               int16_t v = ((col >> (8 * c)) & 0xff) << 7;
+               res[x & 1][c] = scaler_adds16(res[x & 1][c], (v * coeff) >> 16);
+            }
          }
 
-         res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
-         res = _mm_srai_epi16(res, (7 - 2 - 2));
+         for (c = 0; c < 4; c++)
+            res[0][c] = scaler_adds16(res[0][c], res[1][c]);
 
-         __m128i final = _mm_packus_epi16(res, res);
-
-         output[w] = _mm_cvtsi128_si32(final);
+         output[w] = build_argb64(res[0][3], res[0][2], res[0][1], res[0][0]);
       }
    }
 }
-#else
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int stride)
+
+#if defined(__SSE2__)
+// One output pixel of the vertical pass. Also does the leftover pixels of the AVX2 version.
+static inline uint32_t scaler_argb8888_vert_pixel_SSE2(const uint64_t *input_base_y,
+      const int16_t *filter_vert, int filter_len, int stride)
 {
-   int h, w, y;
+   int y;
+   __m128i res = _mm_setzero_si128();
+
+   for (y = 0; (y + 1) < filter_len; y += 2, input_base_y += stride << 1)
+   {
+      __m128i coeff = _mm_set_epi64x((uint16_t)filter_vert[y + 1] * 0x0001000100010001ull, (uint16_t)filter_vert[y + 0] * 0x0001000100010001ull);
+      __m128i col   = _mm_set_epi64x(input_base_y[stride], input_base_y[0]);
+
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; y < filter_len; y++, input_base_y += stride)
+   {
+      __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_vert[y] * 0x0001000100010001ull);
+      __m128i col   = _mm_set_epi64x(0, input_base_y[0]);
+
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+   res = _mm_srai_epi16(res, (7 - 2 - 2));
+
+   __m128i final = _mm_packus_epi16(res, res);
+
+   return _mm_cvtsi128_si32(final);
+}
+
+static void scaler_argb8888_vert_SSE2(const struct scaler_ctx *ctx, void *output_, int stride)
+{
+   int h, w;
    const uint64_t *input = ctx->scaled.frame;
    uint32_t *output = (uint32_t*)output_;
 
@@ -101,105 +209,254 @@ void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output_, int strid
       const uint64_t *input_base = input + ctx->vert.filter_pos[h] * (ctx->scaled.stride >> 3);
 
       for (w = 0; w < ctx->out_width; w++)
+         output[w] = scaler_argb8888_vert_pixel_SSE2(input_base + w,
+               filter_vert, ctx->vert.filter_len, ctx->scaled.stride >> 3);
+   }
+}
+
+// One output pixel of the horizontal pass. Also does the leftover pixel of the AVX2 version.
+static inline void scaler_argb8888_horiz_pixel_SSE2(uint64_t *output,
+      const uint32_t *input_base_x, const int16_t *filter_horiz, int filter_len)
+{
+   int x;
+   __m128i res = _mm_setzero_si128();
+
+   for (x = 0; (x + 1) < filter_len; x += 2)
+   {
+      __m128i coeff = _mm_set_epi64x((uint16_t)filter_horiz[x + 1] * 0x0001000100010001ull, (uint16_t)filter_horiz[x + 0] * 0x0001000100010001ull);
+
+      __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
+               ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   for (; x < filter_len; x++)
+   {
+      __m128i coeff = _mm_set_epi64x(0, (uint16_t)filter_horiz[x] * 0x0001000100010001ull);
+      __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
+
+      col = _mm_slli_epi16(col, 7);
+      res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+   }
+
+   res = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+
+#ifdef __x86_64__
+   *output = _mm_cvtsi128_si64(res);
+#else // 32-bit doesn't have si64. Do it in two steps.
+   union
+   {
+      uint32_t *u32;
+      uint64_t *u64;
+   } u;
+   u.u64 = output;
+   u.u32[0] = _mm_cvtsi128_si32(res);
+   u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
+#endif
+}
+
+static void scaler_argb8888_horiz_SSE2(const struct scaler_ctx *ctx, const void *input_, int stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint64_t *output      = ctx->scaled.frame;
+
+   for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
+   {
+      const int16_t *filter_horiz = ctx->horiz.filter;
+
+      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+         scaler_argb8888_horiz_pixel_SSE2(output + w, input + ctx->horiz.filter_pos[w],
+               filter_horiz, ctx->horiz.filter_len);
+   }
+}
+#endif
+
+#ifdef SCALER_HAVE_AVX2
+// Four output pixels at a time. They are next to each other in the scaled frame,
+// and share the coefficient, so every tap is a single 256-bit load.
+static RARCH_TARGET_AVX2 void scaler_argb8888_vert_AVX2(const struct scaler_ctx *ctx, void *output_, int stride)
+{
+   int h, w, y;
+   const uint64_t *input = ctx->scaled.frame;
+   uint32_t *output = (uint32_t*)output_;
+   int scaled_stride = ctx->scaled.stride >> 3;
+
+   const int16_t *filter_vert = ctx->vert.filter;
+
+   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   {
+      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * scaled_stride;
+
+      for (w = 0; (w + 4) <= ctx->out_width; w += 4)
       {
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+         __m256i res_even = _mm256_setzero_si256();
+         __m256i res_odd  = _mm256_setzero_si256();
 
          const uint64_t *input_base_y = input_base + w;
-         for (y = 0; y < ctx->vert.filter_len; y++, input_base_y += (ctx->scaled.stride >> 3))
-         {
-            uint64_t col = *input_base_y;
 
-            int16_t a = (col >> 48) & 0xffff;
-            int16_t r = (col >> 32) & 0xffff;
-            int16_t g = (col >> 16) & 0xffff;
-            int16_t b = (col >>  0) & 0xffff;
+         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += scaled_stride << 1)
+         {
+            __m256i col_even = _mm256_loadu_si256((const __m256i*)input_base_y);
+            __m256i col_odd  = _mm256_loadu_si256((const __m256i*)(input_base_y + scaled_stride));
 
-            int16_t coeff = filter_vert[y];
+            res_even = _mm256_adds_epi16(_mm256_mulhi_epi16(col_even, _mm256_set1_epi16(filter_vert[y + 0])), res_even);
+            res_odd  = _mm256_adds_epi16(_mm256_mulhi_epi16(col_odd, _mm256_set1_epi16(filter_vert[y + 1])), res_odd);
+         }
 
-            res_a += (a * coeff) >> 16;
-            res_r += (r * coeff) >> 16;
-            res_g += (g * coeff) >> 16;
-            res_b += (b * coeff) >> 16;
+         for (; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
+         {
+            __m256i col = _mm256_loadu_si256((const __m256i*)input_base_y);
+            res_even = _mm256_adds_epi16(_mm256_mulhi_epi16(col, _mm256_set1_epi16(filter_vert[y])), res_even);
          }
 
-         res_a >>= (7 - 2 - 2);
-         res_r >>= (7 - 2 - 2);
-         res_g >>= (7 - 2 - 2);
-         res_b >>= (7 - 2 - 2);
+         __m256i res = _mm256_adds_epi16(res_odd, res_even);
+         res = _mm256_srai_epi16(res, (7 - 2 - 2));
 
-         output[w] = (clamp_8bit(res_a) << 24) | (clamp_8bit(res_r) << 16) | (clamp_8bit(res_g) << 8) | (clamp_8bit(res_b) << 0);
+         // Packing works within 128-bit lanes, so pixels end up in the low quadword of each lane.
+         res = _mm256_permute4x64_epi64(_mm256_packus_epi16(res, res), _MM_SHUFFLE(3, 1, 2, 0));
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
       }
+
+      for (; w < ctx->out_width; w++)
+         output[w] = scaler_argb8888_vert_pixel_SSE2(input_base + w,
+               filter_vert, ctx->vert.filter_len, scaled_stride);
    }
 }
-#endif
 
-#if defined(__SSE2__)
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+// Two output pixels at a time, one in each 128-bit lane.
+// A lane is laid out as in the SSE2 version, two taps per iteration.
+static RARCH_TARGET_AVX2 void scaler_argb8888_horiz_AVX2(const struct scaler_ctx *ctx, const void *input_, int stride)
 {
    int h, w, x;
    const uint32_t *input = (const uint32_t*)input_;
    uint64_t *output      = ctx->scaled.frame;
+   int filter_stride     = ctx->horiz.filter_stride;
 
    for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
    {
       const int16_t *filter_horiz = ctx->horiz.filter;
 
-      for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
+      for (w = 0; (w + 2) <= ctx->scaled.width; w += 2, filter_horiz += filter_stride << 1)
       {
-         __m128i res = _mm_setzero_si128();
+         __m256i res = _mm256_setzero_si256();
 
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         const uint32_t *input_base_0 = input + ctx->horiz.filter_pos[w + 0];
+         const uint32_t *input_base_1 = input + ctx->horiz.filter_pos[w + 1];
+         const int16_t *filter_0      = filter_horiz;
+         const int16_t *filter_1      = filter_horiz + filter_stride;
 
          for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            __m128i coeff = _mm_set_epi64x(filter_horiz[x + 1] * 0x0001000100010001ll, filter_horiz[x + 0] * 0x0001000100010001ll);
+            int32_t coeff_0, coeff_1;
+            memcpy(&coeff_0, filter_0 + x, sizeof(coeff_0));
+            memcpy(&coeff_1, filter_1 + x, sizeof(coeff_1));
 
-            __m128i col = _mm_unpacklo_epi8(_mm_set_epi64x(0,
-                     ((uint64_t)input_base_x[x + 1] << 32) | input_base_x[x + 0]), _mm_setzero_si128());
+            // [c0 c1] in each lane, spread to [c0 c0 c0 c0 c1 c1 c1 c1].
+            __m256i coeff = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_cvtsi32_si128(coeff_0)),
+                  _mm_cvtsi32_si128(coeff_1), 1);
+            coeff = _mm256_unpacklo_epi16(coeff, coeff);
+            coeff = _mm256_unpacklo_epi32(coeff, coeff);
 
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
+            __m128i cols = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(input_base_0 + x)),
+                  _mm_loadl_epi64((const __m128i*)(input_base_1 + x)));
+            __m256i col  = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cols), 7);
+
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
          }
 
          for (; x < ctx->horiz.filter_len; x++)
          {
-            __m128i coeff = _mm_set_epi64x(0, filter_horiz[x] * 0x0001000100010001ll);
-            __m128i col   = _mm_unpacklo_epi8(_mm_set_epi32(0, 0, 0, input_base_x[x]), _mm_setzero_si128());
+            __m256i coeff = _mm256_inserti128_si256(
+                  _mm256_castsi128_si256(_mm_cvtsi32_si128((uint16_t)filter_0[x])),
+                  _mm_cvtsi32_si128((uint16_t)filter_1[x]), 1);
+            coeff = _mm256_unpacklo_epi16(coeff, coeff);
+            coeff = _mm256_unpacklo_epi32(coeff, coeff);
 
-            col = _mm_slli_epi16(col, 7);
-            res = _mm_adds_epi16(_mm_mulhi_epi16(col, coeff), res);
-         }
+            __m128i cols = _mm_unpacklo_epi64(_mm_cvtsi32_si128(input_base_0[x]),
+                  _mm_cvtsi32_si128(input_base_1[x]));
+            __m256i col  = _mm256_slli_epi16(_mm256_cvtepu8_epi16(cols), 7);
 
-         res       = _mm_adds_epi16(_mm_srli_si128(res, 8), res);
+            res = _mm256_adds_epi16(_mm256_mulhi_epi16(col, coeff), res);
+         }
 
-#ifdef __x86_64__
-         output[w] = _mm_cvtsi128_si64(res);
-#else // 32-bit doesn't have si64. Do it in two steps.
-         union
-         {
-            uint32_t *u32;
-            uint64_t *u64;
-         } u;
-         u.u64 = output + w;
-         u.u32[0] = _mm_cvtsi128_si32(res);
-         u.u32[1] = _mm_cvtsi128_si32(_mm_srli_si128(res, 4));
-#endif
+         res = _mm256_adds_epi16(_mm256_srli_si256(res, 8), res);
+         res = _mm256_permute4x64_epi64(res, _MM_SHUFFLE(3, 1, 2, 0));
+         _mm_storeu_si128((__m128i*)(output + w), _mm256_castsi256_si128(res));
       }
+
+      for (; w < ctx->scaled.width; w++, filter_horiz += filter_stride)
+         scaler_argb8888_horiz_pixel_SSE2(output + w, input + ctx->horiz.filter_pos[w],
+               filter_horiz, ctx->horiz.filter_len);
    }
 }
-#else
-static inline uint64_t build_argb64(uint16_t a, uint16_t r, uint16_t g, uint16_t b)
+#endif
+
+#ifdef SCALER_HAVE_NEON
+// NEON has no mulhi. A widening multiply, then a narrowing shift by 16, gives the same result.
+static inline int16x8_t scaler_mulhi_neon(int16x8_t col, int16x4_t coeff_lo, int16x4_t coeff_hi)
 {
-   return ((uint64_t)a << 48) | ((uint64_t)r << 32) | ((uint64_t)g << 16) | ((uint64_t)b << 0);
+   return vcombine_s16(vshrn_n_s32(vmull_s16(vget_low_s16(col), coeff_lo), 16),
+         vshrn_n_s32(vmull_s16(vget_high_s16(col), coeff_hi), 16));
+}
+
+// Two output pixels at a time. Like AVX2, they share the coefficient.
+static void scaler_argb8888_vert_neon(const struct scaler_ctx *ctx, void *output_, int stride)
+{
+   int h, w, y;
+   const uint64_t *input = ctx->scaled.frame;
+   uint32_t *output = (uint32_t*)output_;
+   int scaled_stride = ctx->scaled.stride >> 3;
+
+   const int16_t *filter_vert = ctx->vert.filter;
+
+   for (h = 0; h < ctx->out_height; h++, filter_vert += ctx->vert.filter_stride, output += stride >> 2)
+   {
+      const uint64_t *input_base = input + ctx->vert.filter_pos[h] * scaled_stride;
+
+      for (w = 0; w < ctx->out_width; w += 2)
+      {
+         int16x8_t res_even = vdupq_n_s16(0);
+         int16x8_t res_odd  = vdupq_n_s16(0);
+
+         const uint64_t *input_base_y = input_base + w;
+
+         // The scaled frame is padded to 8 pixels, so the last pixel can be read in pairs too.
+         for (y = 0; (y + 1) < ctx->vert.filter_len; y += 2, input_base_y += scaled_stride << 1)
+         {
+            int16x4_t coeff_even = vdup_n_s16(filter_vert[y + 0]);
+            int16x4_t coeff_odd  = vdup_n_s16(filter_vert[y + 1]);
+            int16x8_t col_even   = vld1q_s16((const int16_t*)input_base_y);
+            int16x8_t col_odd    = vld1q_s16((const int16_t*)(input_base_y + scaled_stride));
+
+            res_even = vqaddq_s16(scaler_mulhi_neon(col_even, coeff_even, coeff_even), res_even);
+            res_odd  = vqaddq_s16(scaler_mulhi_neon(col_odd, coeff_odd, coeff_odd), res_odd);
+         }
+
+         for (; y < ctx->vert.filter_len; y++, input_base_y += scaled_stride)
+         {
+            int16x4_t coeff = vdup_n_s16(filter_vert[y]);
+            int16x8_t col   = vld1q_s16((const int16_t*)input_base_y);
+            res_even = vqaddq_s16(scaler_mulhi_neon(col, coeff, coeff), res_even);
+         }
+
+         int16x8_t res = vshrq_n_s16(vqaddq_s16(res_odd, res_even), (7 - 2 - 2));
+         uint8x8_t final = vqmovun_s16(res);
+
+         if ((w + 1) < ctx->out_width)
+            vst1_u8((uint8_t*)(output + w), final);
+         else
+            output[w] = vget_lane_u32(vreinterpret_u32_u8(final), 0);
+      }
+   }
 }
 
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int stride)
+static void scaler_argb8888_horiz_neon(const struct scaler_ctx *ctx, const void *input_, int stride)
 {
    int h, w, x;
-   const uint32_t *input = (uint32_t*)input_;
+   const uint32_t *input = (const uint32_t*)input_;
    uint64_t *output      = ctx->scaled.frame;
 
    for (h = 0; h < ctx->scaled.height; h++, input += stride >> 2, output += ctx->scaled.stride >> 3)
@@ -208,36 +465,104 @@ void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input_, int
 
       for (w = 0; w < ctx->scaled.width; w++, filter_horiz += ctx->horiz.filter_stride)
       {
-         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
+         int16x8_t res = vdupq_n_s16(0);
 
-         int16_t res_a = 0;
-         int16_t res_r = 0;
-         int16_t res_g = 0;
-         int16_t res_b = 0;
+         const uint32_t *input_base_x = input + ctx->horiz.filter_pos[w];
 
-         for (x = 0; x < ctx->horiz.filter_len; x++)
+         for (x = 0; (x + 1) < ctx->horiz.filter_len; x += 2)
          {
-            uint32_t col = input_base_x[x];
+            uint8x8_t cols = vreinterpret_u8_u32(vld1_u32(input_base_x + x));
+            int16x8_t col  = vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(cols), 7));
 
-            int16_t a = (col >> (24 - 7)) & (0xff << 7);
-            int16_t r = (col >> (16 - 7)) & (0xff << 7);
-            int16_t g = (col >> ( 8 - 7)) & (0xff << 7);
-            int16_t b = (col << ( 0 + 7)) & (0xff << 7);
+            res = vqaddq_s16(scaler_mulhi_neon(col,
+                     vdup_n_s16(filter_horiz[x + 0]), vdup_n_s16(filter_horiz[x + 1])), res);
+         }
 
-            int16_t coeff = filter_horiz[x];
+         for (; x < ctx->horiz.filter_len; x++)
+         {
+            uint8x8_t cols = vreinterpret_u8_u32(vdup_n_u32(input_base_x[x]));
+            int16x8_t col  = vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(cols), 7));
 
-            res_a += (a * coeff) >> 16;
-            res_r += (r * coeff) >> 16;
-            res_g += (g * coeff) >> 16;
-            res_b += (b * coeff) >> 16;
+            res = vqaddq_s16(scaler_mulhi_neon(col, vdup_n_s16(filter_horiz[x]), vdup_n_s16(0)), res);
          }
 
-         output[w] = build_argb64(res_a, res_r, res_g, res_b);
+         vst1_s16((int16_t*)(output + w), vqadd_s16(vget_high_s16(res), vget_low_s16(res)));
       }
    }
 }
 #endif
 
+static const scaler_argb8888_backend_t scaler_argb8888_C = {
+   scaler_argb8888_horiz_C,
+   scaler_argb8888_vert_C,
+   0,
+   "C",
+};
+
+#if defined(__SSE2__)
+static const scaler_argb8888_backend_t scaler_argb8888_SSE2 = {
+   scaler_argb8888_horiz_SSE2,
+   scaler_argb8888_vert_SSE2,
+   0,
+   "SSE2",
+};
+#endif
+
+#ifdef SCALER_HAVE_AVX2
+static const scaler_argb8888_backend_t scaler_argb8888_AVX2 = {
+   scaler_argb8888_horiz_AVX2,
+   scaler_argb8888_vert_AVX2,
+   RETRO_SIMD_AVX2,
+   "AVX2",
+};
+#endif
+
+#ifdef SCALER_HAVE_NEON
+static const scaler_argb8888_backend_t scaler_argb8888_neon = {
+   scaler_argb8888_horiz_neon,
+   scaler_argb8888_vert_neon,
+   RETRO_SIMD_NEON,
+   "NEON",
+};
+#endif
+
+const scaler_argb8888_backend_t *scaler_argb8888_backends[] = {
+#ifdef SCALER_HAVE_AVX2
+   &scaler_argb8888_AVX2,
+#endif
+#if defined(__SSE2__)
+   &scaler_argb8888_SSE2,
+#endif
+#ifdef SCALER_HAVE_NEON
+   &scaler_argb8888_neon,
+#endif
+   &scaler_argb8888_C,
+   NULL,
+};
+
+const scaler_argb8888_backend_t *scaler_argb8888_find_backend(void)
+{
+   // Scalers are set up on every resize and by several drivers, so only ask for CPU features once.
+   // Every thread would pick the same backend, so the race is harmless.
+   static const scaler_argb8888_backend_t *backend;
+   unsigned i;
+
+   if (backend)
+      return backend;
+
+   uint64_t cpu = scaler_cpu_features();
+   for (i = 0; scaler_argb8888_backends[i]; i++)
+   {
+      if ((scaler_argb8888_backends[i]->simd & cpu) == scaler_argb8888_backends[i]->simd)
+      {
+         backend = scaler_argb8888_backends[i];
+         break;
+      }
+   }
+
+   return backend;
+}
+
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       void *output_, const void *input_,
       int out_width, int out_height,
@@ -18,8 +18,24 @@
 
 #include "scaler.h"
 
-void scaler_argb8888_vert(const struct scaler_ctx *ctx, void *output, int stride);
-void scaler_argb8888_horiz(const struct scaler_ctx *ctx, const void *input, int stride);
+void scaler_argb8888_vert_C(const struct scaler_ctx *ctx, void *output, int stride);
+void scaler_argb8888_horiz_C(const struct scaler_ctx *ctx, const void *input, int stride);
+
+// Horizontal and vertical ARGB8888 passes for an instruction set.
+// All of them give the same output as the C version.
+typedef struct scaler_argb8888_backend
+{
+   void (*horiz)(const struct scaler_ctx *ctx, const void *input, int stride);
+   void (*vert)(const struct scaler_ctx *ctx, void *output, int stride);
+   uint64_t simd; // RETRO_SIMD_* flags the CPU needs, beyond what the build targets.
+   const char *ident;
+} scaler_argb8888_backend_t;
+
+// Every backend built in, in order of preference. NULL terminated.
+extern const scaler_argb8888_backend_t *scaler_argb8888_backends[];
+
+// Best backend the CPU supports.
+const scaler_argb8888_backend_t *scaler_argb8888_find_backend(void);
 
 void scaler_argb8888_point_special(const struct scaler_ctx *ctx,
       void *output, const void *input,
@@ -0,0 +1,307 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Checks every ARGB8888 scaler backend the CPU supports against the C version,
+// and measures throughput in output megapixels/s for each scaler type and format pair.
+// With --check, only verifies. Returns nonzero if any backend disagrees with C.
+// Tests build with -march=native, so the C version is likely auto-vectorized here.
+
+#include "../scaler.h"
+#include "../scaler_int.h"
+#include "../../../libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SCALER_BENCH_SECONDS 0.25
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static bool backend_available(const scaler_argb8888_backend_t *backend)
+{
+   if ((backend->simd & RETRO_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+      return false;
+   return true;
+}
+
+static const char *type_name(enum scaler_type type)
+{
+   switch (type)
+   {
+      case SCALER_TYPE_POINT:
+         return "point";
+      case SCALER_TYPE_BILINEAR:
+         return "bilinear";
+      case SCALER_TYPE_SINC:
+         return "sinc";
+      default:
+         return "?";
+   }
+}
+
+static const char *fmt_name(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_ARGB8888:
+         return "ARGB8888";
+      case SCALER_FMT_0RGB1555:
+         return "0RGB1555";
+      case SCALER_FMT_RGB565:
+         return "RGB565";
+      case SCALER_FMT_BGR24:
+         return "BGR24";
+      default:
+         return "?";
+   }
+}
+
+static unsigned fmt_size(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_ARGB8888:
+         return 4;
+      case SCALER_FMT_BGR24:
+         return 3;
+      default:
+         return 2;
+   }
+}
+
+static bool scaler_init(struct scaler_ctx *ctx, enum scaler_type type,
+      enum scaler_pix_fmt in_fmt, enum scaler_pix_fmt out_fmt,
+      int in_width, int in_height, int out_width, int out_height,
+      const scaler_argb8888_backend_t *backend)
+{
+   memset(ctx, 0, sizeof(*ctx));
+   ctx->scaler_type = type;
+   ctx->in_fmt      = in_fmt;
+   ctx->out_fmt     = out_fmt;
+   ctx->in_width    = in_width;
+   ctx->in_height   = in_height;
+   ctx->in_stride   = in_width * fmt_size(in_fmt);
+   ctx->out_width   = out_width;
+   ctx->out_height  = out_height;
+   ctx->out_stride  = out_width * fmt_size(out_fmt);
+
+   if (!scaler_ctx_gen_filter(ctx))
+      return false;
+
+   ctx->scaler_horiz = backend->horiz;
+   ctx->scaler_vert  = backend->vert;
+   return true;
+}
+
+static void fill_random(void *data, size_t size)
+{
+   size_t i;
+   uint8_t *bytes = (uint8_t*)data;
+   for (i = 0; i < size; i++)
+      bytes[i] = rand();
+}
+
+// Odd sizes exercise the leftover pixels of the SIMD loops.
+static const int verify_sizes[][4] = {
+   { 320, 240, 1280, 960 },
+   { 317, 239, 641, 479 },
+   { 640, 480, 213, 161 },
+   { 7, 5, 9, 3 },
+   { 3, 9, 1, 13 },
+};
+
+static bool verify_backend(const scaler_argb8888_backend_t *backend,
+      const scaler_argb8888_backend_t *reference)
+{
+   unsigned i, t;
+   bool ok = true;
+   static const enum scaler_type types[] = { SCALER_TYPE_BILINEAR, SCALER_TYPE_SINC };
+
+   for (t = 0; t < sizeof(types) / sizeof(types[0]); t++)
+   {
+      for (i = 0; i < sizeof(verify_sizes) / sizeof(verify_sizes[0]); i++)
+      {
+         struct scaler_ctx ref_ctx, test_ctx;
+         const int *size = verify_sizes[i];
+         size_t in_size  = (size_t)size[0] * size[1];
+         size_t out_size = (size_t)size[2] * size[3];
+         size_t p;
+
+         uint32_t *input  = (uint32_t*)malloc(in_size * sizeof(uint32_t));
+         uint32_t *ref    = (uint32_t*)calloc(out_size, sizeof(uint32_t));
+         uint32_t *test   = (uint32_t*)calloc(out_size, sizeof(uint32_t));
+
+         fill_random(input, in_size * sizeof(uint32_t));
+
+         // Sinc needs a few pixels to work with. Sizes it does not take are skipped.
+         if (!scaler_init(&ref_ctx, types[t], SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888,
+                  size[0], size[1], size[2], size[3], reference))
+            memset(&test_ctx, 0, sizeof(test_ctx));
+         else if (!scaler_init(&test_ctx, types[t], SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888,
+                  size[0], size[1], size[2], size[3], backend))
+         {
+            printf("FAIL %s: cannot create %s scaler.\n", backend->ident, type_name(types[t]));
+            ok = false;
+         }
+         else
+         {
+            scaler_ctx_scale(&ref_ctx, ref, input);
+            scaler_ctx_scale(&test_ctx, test, input);
+
+            for (p = 0; p < out_size; p++)
+            {
+               if (ref[p] != test[p])
+               {
+                  printf("FAIL %s %s %dx%d -> %dx%d: pixel (%u, %u) is #%08x, expected #%08x.\n",
+                        backend->ident, type_name(types[t]), size[0], size[1], size[2], size[3],
+                        (unsigned)(p % size[2]), (unsigned)(p / size[2]),
+                        (unsigned)test[p], (unsigned)ref[p]);
+                  ok = false;
+                  break;
+               }
+            }
+         }
+
+         scaler_ctx_gen_reset(&ref_ctx);
+         scaler_ctx_gen_reset(&test_ctx);
+         free(input);
+         free(ref);
+         free(test);
+      }
+   }
+
+   return ok;
+}
+
+static double bench_scaler(struct scaler_ctx *ctx, void *output, const void *input)
+{
+   unsigned frames = 0;
+   double start = get_time(), elapsed;
+
+   do
+   {
+      scaler_ctx_scale(ctx, output, input);
+      frames++;
+      elapsed = get_time() - start;
+   } while (elapsed < SCALER_BENCH_SECONDS);
+
+   return (double)ctx->out_width * ctx->out_height * frames / elapsed / 1000000.0;
+}
+
+static const int bench_sizes[][4] = {
+   { 320, 240, 1280, 960 },
+   { 1920, 1080, 640, 360 },
+};
+
+static const enum scaler_pix_fmt bench_formats[][2] = {
+   { SCALER_FMT_ARGB8888, SCALER_FMT_ARGB8888 },
+   { SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888 },
+   { SCALER_FMT_0RGB1555, SCALER_FMT_ARGB8888 },
+   { SCALER_FMT_BGR24,    SCALER_FMT_ARGB8888 },
+   { SCALER_FMT_ARGB8888, SCALER_FMT_0RGB1555 },
+   { SCALER_FMT_ARGB8888, SCALER_FMT_BGR24 },
+};
+
+static void bench(const scaler_argb8888_backend_t **backends, unsigned count)
+{
+   unsigned s, t, f, b;
+
+   for (s = 0; s < sizeof(bench_sizes) / sizeof(bench_sizes[0]); s++)
+   {
+      const int *size = bench_sizes[s];
+      void *input  = malloc((size_t)size[0] * size[1] * 4);
+      void *output = malloc((size_t)size[2] * size[3] * 4);
+      fill_random(input, (size_t)size[0] * size[1] * 4);
+
+      printf("%dx%d -> %dx%d:\n", size[0], size[1], size[2], size[3]);
+
+      for (t = SCALER_TYPE_POINT; t <= SCALER_TYPE_SINC; t++)
+      {
+         for (f = 0; f < sizeof(bench_formats) / sizeof(bench_formats[0]); f++)
+         {
+            for (b = 0; b < count; b++)
+            {
+               struct scaler_ctx ctx;
+               if (!scaler_init(&ctx, (enum scaler_type)t, bench_formats[f][0], bench_formats[f][1],
+                        size[0], size[1], size[2], size[3], backends[b]))
+                  continue;
+
+               double mps = bench_scaler(&ctx, output, input);
+               bool special = ctx.scaler_special != NULL;
+               scaler_ctx_gen_reset(&ctx);
+
+               // Point scaling has its own path, which does not depend on the backend.
+               printf("   %-8s %8s -> %-8s %-6s %8.1f MP/s\n", type_name((enum scaler_type)t),
+                     fmt_name(bench_formats[f][0]), fmt_name(bench_formats[f][1]),
+                     special ? "-" : backends[b]->ident, mps);
+               if (special)
+                  break;
+            }
+         }
+      }
+
+      free(input);
+      free(output);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   const scaler_argb8888_backend_t *backends[16];
+   const scaler_argb8888_backend_t *reference = NULL;
+   unsigned i, count = 0;
+   bool check_only = argc > 1 && strcmp(argv[1], "--check") == 0;
+   int ret = 0;
+
+   for (i = 0; scaler_argb8888_backends[i]; i++)
+      if (strcmp(scaler_argb8888_backends[i]->ident, "C") == 0)
+         reference = scaler_argb8888_backends[i];
+
+   srand(0);
+   for (i = 0; scaler_argb8888_backends[i] && count < 16; i++)
+   {
+      const scaler_argb8888_backend_t *backend = scaler_argb8888_backends[i];
+      if (!backend_available(backend))
+      {
+         printf("SKIP %-6s not supported by CPU.\n", backend->ident);
+         continue;
+      }
+
+      if (backend != reference)
+      {
+         if (!verify_backend(backend, reference))
+         {
+            ret = 1;
+            continue;
+         }
+         printf("OK   %-6s matches C.\n", backend->ident);
+      }
+
+      backends[count++] = backend;
+   }
+
+   printf("Scaler picks %s.\n", scaler_argb8888_find_backend()->ident);
+
+   if (!check_only)
+      bench(backends, count);
+
+   return ret;
+}
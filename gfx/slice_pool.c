@@ -0,0 +1,211 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "slice_pool.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#ifdef HAVE_THREADS
+#include "../thread.h"
+#endif
+
+#define SLICE_POOL_MAX_THREADS 16
+
+struct slice_worker
+{
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   scond_t *cond;
+#endif
+   struct slice_pool *pool;
+   unsigned index;
+   unsigned generation; // Last job taken.
+};
+
+struct slice_pool
+{
+   unsigned threads;
+
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *done_cond;
+   struct slice_worker workers[SLICE_POOL_MAX_THREADS - 1];
+   unsigned pending;
+   unsigned generation; // Bumped for every job.
+   bool quit;
+#endif
+
+   slice_pool_func_t func;
+   void *userdata;
+   unsigned lines;
+};
+
+static void run_slice(struct slice_pool *pool, unsigned index)
+{
+   unsigned first = (unsigned)(((uint64_t)pool->lines * index) / pool->threads);
+   unsigned last  = (unsigned)(((uint64_t)pool->lines * (index + 1)) / pool->threads);
+   if (first < last)
+      pool->func(pool->userdata, first, last);
+}
+
+#ifdef HAVE_THREADS
+static void slice_worker_loop(void *data)
+{
+   struct slice_worker *worker = (struct slice_worker*)data;
+   struct slice_pool *pool = worker->pool;
+
+   for (;;)
+   {
+      slock_lock(pool->lock);
+      while (worker->generation == pool->generation && !pool->quit)
+         scond_wait(worker->cond, pool->lock);
+      if (pool->quit)
+      {
+         slock_unlock(pool->lock);
+         break;
+      }
+      worker->generation = pool->generation;
+      slock_unlock(pool->lock);
+
+      run_slice(pool, worker->index);
+
+      slock_lock(pool->lock);
+      if (--pool->pending == 0)
+         scond_signal(pool->done_cond);
+      slock_unlock(pool->lock);
+   }
+}
+#endif
+
+slice_pool_t *slice_pool_new(unsigned threads)
+{
+   struct slice_pool *pool = (struct slice_pool*)calloc(1, sizeof(*pool));
+   if (!pool)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   if (threads < 1)
+      threads = 1;
+   if (threads > SLICE_POOL_MAX_THREADS)
+      threads = SLICE_POOL_MAX_THREADS;
+
+   pool->threads = 1;
+   if (threads > 1)
+   {
+      pool->lock      = slock_new();
+      pool->done_cond = scond_new();
+      if (!pool->lock || !pool->done_cond)
+         goto error;
+
+      for (unsigned i = 0; i < threads - 1; i++)
+      {
+         struct slice_worker *worker = &pool->workers[i];
+         worker->pool  = pool;
+         worker->index = i + 1;
+         worker->cond  = scond_new();
+         if (!worker->cond)
+            goto error;
+         worker->thread = sthread_create(slice_worker_loop, worker);
+         if (!worker->thread)
+         {
+            scond_free(worker->cond);
+            worker->cond = NULL;
+            goto error;
+         }
+         pool->threads++;
+      }
+   }
+#else
+   (void)threads;
+   pool->threads = 1;
+#endif
+
+   return pool;
+
+#ifdef HAVE_THREADS
+error:
+   slice_pool_free(pool);
+   return NULL;
+#endif
+}
+
+void slice_pool_free(slice_pool_t *pool)
+{
+   if (!pool)
+      return;
+
+#ifdef HAVE_THREADS
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      for (unsigned i = 0; i < pool->threads - 1; i++)
+         scond_signal(pool->workers[i].cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (unsigned i = 0; i < pool->threads - 1; i++)
+   {
+      sthread_join(pool->workers[i].thread);
+      scond_free(pool->workers[i].cond);
+   }
+
+   if (pool->lock)
+      slock_free(pool->lock);
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+#endif
+
+   free(pool);
+}
+
+unsigned slice_pool_threads(const slice_pool_t *pool)
+{
+   return pool->threads;
+}
+
+void slice_pool_run(slice_pool_t *pool, slice_pool_func_t func, void *userdata, unsigned lines)
+{
+   pool->func     = func;
+   pool->userdata = userdata;
+   pool->lines    = lines;
+
+#ifdef HAVE_THREADS
+   if (pool->threads > 1)
+   {
+      slock_lock(pool->lock);
+      pool->pending = pool->threads - 1;
+      pool->generation++;
+      for (unsigned i = 0; i < pool->threads - 1; i++)
+         scond_signal(pool->workers[i].cond);
+      slock_unlock(pool->lock);
+
+      run_slice(pool, 0);
+
+      slock_lock(pool->lock);
+      while (pool->pending)
+         scond_wait(pool->done_cond, pool->lock);
+      slock_unlock(pool->lock);
+      return;
+   }
+#endif
+
+   run_slice(pool, 0);
+}
+
@@ -0,0 +1,40 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SLICE_POOL_H__
+#define SLICE_POOL_H__
+
+#include "../boolean.h"
+
+// Worker pool for running CPU video work in horizontal slices.
+// A frame of N lines is split in as many even bands as there are threads.
+// The calling thread works on the first band itself, so a pool of 1 thread has no workers.
+// Without HAVE_THREADS, every pool has 1 thread.
+
+typedef struct slice_pool slice_pool_t;
+
+// Processes lines [first_line, last_line). Called concurrently for disjoint bands.
+typedef void (*slice_pool_func_t)(void *userdata, unsigned first_line, unsigned last_line);
+
+slice_pool_t *slice_pool_new(unsigned threads);
+void slice_pool_free(slice_pool_t *pool);
+
+unsigned slice_pool_threads(const slice_pool_t *pool);
+
+// Runs func over lines [0, lines) and returns when all bands are done.
+void slice_pool_run(slice_pool_t *pool, slice_pool_func_t func, void *userdata, unsigned lines);
+
+#endif
+
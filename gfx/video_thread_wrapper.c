@@ -21,6 +21,92 @@
 #include <string.h>
 #include <limits.h>
 
+#if defined(_MSC_VER) && !defined(__GNUC__)
+#include <windows.h>
+#endif
+
+// Frames are handed to the video thread through a mailbox of three slots.
+// The main thread owns one slot to fill, the video thread owns the one it renders,
+// and the third is the mailbox: the latest frame which has been published.
+// Both sides swap their slot with the mailbox with an atomic exchange, so the handoff takes no lock.
+#define THREAD_FRAME_SLOTS 3
+#define THREAD_FRAME_INDEX_MASK 3
+#define THREAD_FRAME_FRESH 4 // Set in the mailbox index while the video thread has not taken it yet.
+
+// Sequentially consistent, as going to sleep relies on store-load ordering between the two threads.
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+static inline unsigned thread_atomic_load(const unsigned *ptr)
+{
+   return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void thread_atomic_store(unsigned *ptr, unsigned val)
+{
+   __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline unsigned thread_atomic_exchange(unsigned *ptr, unsigned val)
+{
+   return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+#elif defined(__GNUC__)
+static inline unsigned thread_atomic_load(const unsigned *ptr)
+{
+   __sync_synchronize();
+   unsigned val = *(const volatile unsigned*)ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static inline void thread_atomic_store(unsigned *ptr, unsigned val)
+{
+   __sync_synchronize();
+   *(volatile unsigned*)ptr = val;
+   __sync_synchronize();
+}
+
+// __sync_lock_test_and_set() is only an acquire barrier.
+static inline unsigned thread_atomic_exchange(unsigned *ptr, unsigned val)
+{
+   unsigned old;
+   do
+   {
+      old = *(volatile unsigned*)ptr;
+   } while (__sync_val_compare_and_swap(ptr, old, val) != old);
+   return old;
+}
+#elif defined(_MSC_VER)
+static inline unsigned thread_atomic_load(const unsigned *ptr)
+{
+   MemoryBarrier();
+   unsigned val = *(const volatile unsigned*)ptr;
+   MemoryBarrier();
+   return val;
+}
+
+static inline void thread_atomic_store(unsigned *ptr, unsigned val)
+{
+   InterlockedExchange((volatile LONG*)ptr, (LONG)val);
+}
+
+static inline unsigned thread_atomic_exchange(unsigned *ptr, unsigned val)
+{
+   return (unsigned)InterlockedExchange((volatile LONG*)ptr, (LONG)val);
+}
+#else
+#error "Threaded video needs atomics for this compiler."
+#endif
+
+struct thread_frame_slot
+{
+   uint8_t *buffer;
+   const uint8_t *data; // Either buffer, or NULL to dupe.
+   unsigned width;
+   unsigned height;
+   size_t pitch;
+   char msg[1024];
+};
+
 enum thread_cmd
 {
    CMD_NONE = 0,
@@ -93,6 +179,7 @@ typedef struct thread_video
    retro_time_t target_frame_time;
    unsigned hit_count;
    unsigned miss_count;
+   unsigned copy_count;
 
    enum thread_cmd send_cmd;
    enum thread_cmd reply_cmd;
@@ -140,13 +227,19 @@ typedef struct thread_video
 
    struct
    {
-      slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      bool updated;
-      char msg[1024];
+      slock_t *lock; // Held by the video thread while rendering. Guards menu texture and state changes.
+      size_t buffer_size;
+
+      struct thread_frame_slot slots[THREAD_FRAME_SLOTS];
+
+      unsigned mailbox; // Atomic.
+      unsigned write_index; // Main thread only.
+      unsigned read_index; // Video thread only.
+
+      // Atomic. Set while a thread sleeps on thr->lock waiting for the mailbox to change.
+      // The other side only takes the lock to wake it up if this is set.
+      unsigned thread_waiting;
+      unsigned main_waiting;
    } frame;
 
    video_driver_t video_thread;
@@ -178,16 +271,40 @@ static void thread_loop(void *data)
 
    for (;;)
    {
-      bool updated = false;
-      slock_lock(thr->lock);
-      while (thr->send_cmd == CMD_NONE && !thr->frame.updated)
-         scond_wait(thr->cond_thread, thr->lock);
-      if (thr->frame.updated)
-         updated = true;
-      slock_unlock(thr->lock);
+      bool updated = thread_atomic_load(&thr->frame.mailbox) & THREAD_FRAME_FRESH;
+      if (!updated)
+      {
+         slock_lock(thr->lock);
+         thread_atomic_store(&thr->frame.thread_waiting, 1);
+         while (thr->send_cmd == CMD_NONE &&
+               !(thread_atomic_load(&thr->frame.mailbox) & THREAD_FRAME_FRESH))
+            scond_wait(thr->cond_thread, thr->lock);
+         thread_atomic_store(&thr->frame.thread_waiting, 0);
+         slock_unlock(thr->lock);
+
+         updated = thread_atomic_load(&thr->frame.mailbox) & THREAD_FRAME_FRESH;
+      }
+
+      // Only the main thread sets the fresh bit, so it is still set here. Take the latest frame.
+      if (updated)
+      {
+         thr->frame.read_index = thread_atomic_exchange(&thr->frame.mailbox, thr->frame.read_index) &
+            THREAD_FRAME_INDEX_MASK;
+
+         if (thread_atomic_load(&thr->frame.main_waiting))
+         {
+            slock_lock(thr->lock);
+            scond_signal(thr->cond_cmd);
+            slock_unlock(thr->lock);
+         }
+      }
 
       switch (thr->send_cmd)
       {
+         // Woken up by a frame. Must not reply, or a command sent in the meantime would be lost.
+         case CMD_NONE:
+            break;
+
          case CMD_INIT:
             thr->driver_data = thr->driver->init(&thr->info, thr->input, thr->input_data);
             thr->cmd_data.b = thr->driver_data;
@@ -325,9 +442,10 @@ static void thread_loop(void *data)
             thr->apply_state_changes = false;
          }
 
+         const struct thread_frame_slot *slot = &thr->frame.slots[thr->frame.read_index];
          bool ret = thr->driver->frame(thr->driver_data,
-               thr->frame.buffer, thr->frame.width, thr->frame.height,
-               thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+               slot->data, slot->width, slot->height,
+               slot->pitch, *slot->msg ? slot->msg : NULL);
          slock_unlock(thr->frame.lock);
 
          bool alive = ret && thr->driver->alive(thr->driver_data);
@@ -339,7 +457,6 @@ static void thread_loop(void *data)
          slock_lock(thr->lock);
          thr->alive = alive;
          thr->focus = focus;
-         thr->frame.updated = false;
          thr->vp = vp;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
@@ -391,6 +508,38 @@ static bool thread_focus(void *data)
    return ret;
 }
 
+// Waits until the video thread has taken the last published frame, or until timeout (if not 0) has passed.
+static void thread_wait_frame_taken(thread_video_t *thr, retro_time_t timeout)
+{
+   if (!(thread_atomic_load(&thr->frame.mailbox) & THREAD_FRAME_FRESH))
+      return;
+
+   slock_lock(thr->lock);
+   thread_atomic_store(&thr->frame.main_waiting, 1);
+
+   while (thread_atomic_load(&thr->frame.mailbox) & THREAD_FRAME_FRESH)
+   {
+      if (!timeout)
+      {
+         scond_wait(thr->cond_cmd, thr->lock);
+         continue;
+      }
+
+      // scond_wait_timeout cannot be implemented on consoles.
+#ifndef RARCH_CONSOLE
+      // Ideally, use absolute time, but that is only a good idea on POSIX.
+      retro_time_t delta = timeout - rarch_get_time_usec();
+      if (delta <= 0 || !scond_wait_timeout(thr->cond_cmd, thr->lock, delta))
+         break;
+#else
+      break;
+#endif
+   }
+
+   thread_atomic_store(&thr->frame.main_waiting, 0);
+   slock_unlock(thr->lock);
+}
+
 static bool thread_frame(void *data, const void *frame_,
       unsigned width, unsigned height, unsigned pitch, const char *msg)
 {
@@ -398,68 +547,56 @@ static bool thread_frame(void *data, const void *frame_,
    RARCH_PERFORMANCE_START(thread_frame);
 
    thread_video_t *thr = (thread_video_t*)data;
-   unsigned copy_stride = width * (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
-
+   struct thread_frame_slot *slot = &thr->frame.slots[thr->frame.write_index];
    const uint8_t *src = (const uint8_t*)frame_;
-   uint8_t *dst = thr->frame.buffer;
 
-   slock_lock(thr->lock);
-
-   // scond_wait_timeout cannot be implemented on consoles.
-#ifndef RARCH_CONSOLE
-   if (!thr->nonblock)
+   // The slot is owned by this thread until it is published, so filling it needs no lock.
+   // If the core rendered into the slot handed out by thread_get_current_software_framebuffer(),
+   // the frame is already in place. Otherwise the core will reuse its buffer, so the frame must be copied.
+   if (src && src != slot->buffer)
    {
-      retro_time_t target = thr->last_time + thr->target_frame_time;
-      // Ideally, use absolute time, but that is only a good idea on POSIX.
-      while (thr->frame.updated)
-      {
-         retro_time_t current = rarch_get_time_usec();
-         retro_time_t delta = target - current;
-
-         if (delta <= 0)
-            break;
-
-         if (!scond_wait_timeout(thr->cond_cmd, thr->lock, delta))
-            break;
-      }
+      unsigned copy_stride = width * (thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t));
+      uint8_t *dst = slot->buffer;
+      unsigned h;
+      for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+         memcpy(dst, src, copy_stride);
+
+      pitch = copy_stride;
+      thr->copy_count++;
    }
-#endif
 
-   // Drop frame if updated flag is still set, as thread is still working on last frame.
-   if (!thr->frame.updated)
-   {
-      if (src)
-      {
-         unsigned h;
-         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
-            memcpy(dst, src, copy_stride);
-      }
+   slot->data   = frame_ ? slot->buffer : NULL;
+   slot->width  = width;
+   slot->height = height;
+   slot->pitch  = pitch;
 
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.pitch  = copy_stride;
+   if (msg)
+      strlcpy(slot->msg, msg, sizeof(slot->msg));
+   else
+      *slot->msg = '\0';
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   // Like vsync, block on the video thread while it is still busy with the last frame, but at most for a frame.
+   if (!thr->nonblock)
+      thread_wait_frame_taken(thr, thr->last_time + thr->target_frame_time);
 
+   // If the last frame has still not been taken, it is replaced, so the video thread always gets the latest one.
+   unsigned old = thread_atomic_exchange(&thr->frame.mailbox, thr->frame.write_index | THREAD_FRAME_FRESH);
+   thr->frame.write_index = old & THREAD_FRAME_INDEX_MASK;
+   if (old & THREAD_FRAME_FRESH)
+      thr->miss_count++;
+   thr->hit_count++;
+
+   if (thread_atomic_load(&thr->frame.thread_waiting))
+   {
+      slock_lock(thr->lock);
       scond_signal(thr->cond_thread);
+      slock_unlock(thr->lock);
+   }
 
 #if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
+   if (thr->texture.enable)
+      thread_wait_frame_taken(thr, 0);
 #endif
-      thr->hit_count++;
-   }
-   else
-      thr->miss_count++;
-
-   slock_unlock(thr->lock);
 
    RARCH_PERFORMANCE_STOP(thread_frame);
 
@@ -489,11 +626,20 @@ static bool thread_init(thread_video_t *thr, const video_info_t *info, const inp
    size_t max_size = info->input_scale * RARCH_SCALE_BASE;
    max_size *= max_size;
    max_size *= info->rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer = (uint8_t*)malloc(max_size);
-   if (!thr->frame.buffer)
-      return false;
+   thr->frame.buffer_size = max_size;
 
-   memset(thr->frame.buffer, 0x80, max_size);
+   unsigned i;
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+   {
+      thr->frame.slots[i].buffer = (uint8_t*)malloc(max_size);
+      if (!thr->frame.slots[i].buffer)
+         return false;
+      memset(thr->frame.slots[i].buffer, 0x80, max_size);
+   }
+
+   thr->frame.write_index = 0;
+   thr->frame.mailbox     = 1;
+   thr->frame.read_index  = 2;
 
    thr->target_frame_time = (retro_time_t)roundf(1000000LL / g_settings.video.refresh_rate);
    thr->last_time = rarch_get_time_usec();
@@ -560,14 +706,16 @@ static void thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   unsigned i;
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+      free(thr->frame.slots[i].buffer);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
    scond_free(thr->cond_thread);
 
-   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u, Frames copied: %u.\n",
+         thr->hit_count, thr->miss_count, thr->copy_count);
 
    free(thr);
 }
@@ -703,6 +851,21 @@ static void thread_set_texture_enable(void *data, bool state, bool full_screen)
 }
 #endif
 
+// Hands out the slot the next frame will be published from, so the core can render straight into it.
+static bool thread_get_current_software_framebuffer(void *data, struct retro_framebuffer *framebuffer)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+   size_t pitch = framebuffer->width *
+      (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ? sizeof(uint32_t) : sizeof(uint16_t));
+
+   if (pitch * framebuffer->height > thr->frame.buffer_size)
+      return false;
+
+   framebuffer->data  = thr->frame.slots[thr->frame.write_index].buffer;
+   framebuffer->pitch = pitch;
+   return true;
+}
+
 static void thread_apply_state_changes(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
@@ -723,6 +886,10 @@ static const video_poke_interface_t thread_poke = {
    thread_set_texture_frame,
    thread_set_texture_enable,
 #endif
+   NULL, // set_osd_msg
+   NULL, // show_mouse
+   NULL, // grab_mouse_toggle
+   thread_get_current_software_framebuffer,
 };
 
 static void thread_get_poke_interface(void *data, const video_poke_interface_t **iface)
@@ -352,6 +352,7 @@ AUDIO RESAMPLER
 ============================================================ */
 #include "../audio/resampler.c"
 #include "../audio/sinc.c"
+#include "../audio/dsp_filter.c"
 
 /*============================================================
 CAMERA
@@ -456,6 +457,15 @@ SCALERS
 #include "../gfx/scaler/pixconv.c"
 #include "../gfx/scaler/scaler.c"
 #include "../gfx/scaler/scaler_int.c"
+#include "../gfx/slice_pool.c"
+
+/*============================================================
+CPU FILTERS
+============================================================ */
+#include "../gfx/filters/softfilter.c"
+#include "../gfx/filters/scalex.c"
+#include "../gfx/filters/2xsai.c"
+#include "../gfx/filters/ntsc.c"
 
 /*============================================================
 DYNAMIC
@@ -489,6 +499,11 @@ REWIND
 ============================================================ */
 #include "../rewind.c"
 
+/*============================================================
+FRAME SCHEDULER
+============================================================ */
+#include "../frame_scheduler.c"
+
 /*============================================================
 FRONTEND
 ============================================================ */
@@ -535,6 +550,7 @@ THREAD
 #include "../thread/xenon_sdl_threads.c"
 #elif defined(HAVE_THREADS)
 #include "../thread.c"
+#include "../spsc_fifo.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/thread_wrapper.c"
 #include "../autosave.c"
@@ -575,6 +575,30 @@ enum retro_mod
                                            // If so, no such directory is defined,
                                            // and it's up to the implementation to find a suitable directory.
                                            //
+#define RETRO_ENVIRONMENT_SET_AUDIO_CHANNELS (31 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+                                           // const unsigned * --
+                                           // Sets the number of interleaved channels in one audio frame, from 2 (the default) up to 8.
+                                           // Frames passed to retro_audio_sample_batch_t then hold this many samples each.
+                                           // Channels are ordered front left, front right, center, LFE, back left, back right,
+                                           // side left, side right, e.g. 6 channels are 5.1 and 8 channels are 7.1.
+                                           // retro_audio_sample_t keeps passing front left and front right only.
+                                           //
+                                           // Should be called in retro_load_game().
+                                           // Returns false if the frontend cannot handle the channel count,
+                                           // in which case the core should keep sending stereo.
+                                           //
+#define RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER (32 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+                                           // struct retro_framebuffer * --
+                                           // Gets memory owned by the frontend which the core can render the next frame into,
+                                           // saving the frontend a copy of the frame.
+                                           // Set width and height to the size of the coming frame. On success, data and pitch are set.
+                                           // The buffer uses the pixel format set with SET_PIXEL_FORMAT.
+                                           //
+                                           // Call in retro_run() before every frame, as the frontend may hand out a different buffer each time.
+                                           // The buffer is only valid until the next call to retro_video_refresh_t,
+                                           // which should be passed data as is (or NULL to dupe).
+                                           // Returns false if no buffer is available, in which case the core renders into its own memory as usual.
+                                           //
 
 enum retro_log_level
 {
@@ -606,6 +630,9 @@ struct retro_log_callback
 #define RETRO_SIMD_SSE3     (1 << 6)
 #define RETRO_SIMD_SSSE3    (1 << 7)
 #define RETRO_SIMD_MMX      (1 << 8)
+#define RETRO_SIMD_AVX2     (1 << 9)
+#define RETRO_SIMD_SSE4     (1 << 10) // SSE4.1
+#define RETRO_SIMD_SSE42    (1 << 11)
 
 typedef uint64_t retro_perf_tick_t;
 typedef int64_t retro_time_t;
@@ -837,6 +864,14 @@ struct retro_frame_time_callback
    retro_usec_t reference; // Represents the time of one frame. It is computed as 1000000 / fps, but the implementation will resolve the rounding to ensure that framestepping, etc is exact.
 };
 
+struct retro_framebuffer
+{
+   void *data;      // Set by frontend.
+   unsigned width;  // Set by core.
+   unsigned height; // Set by core.
+   size_t pitch;    // Set by frontend. Bytes between the start of two lines.
+};
+
 // Pass this to retro_video_refresh_t if rendering to hardware.
 // Passing NULL to retro_video_refresh_t is still a frame dupe as normal.
 #define RETRO_HW_FRAME_BUFFER_VALID ((void*)-1)
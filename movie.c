@@ -197,22 +197,27 @@ void bsv_movie_set_frame_end(bsv_movie_t *handle)
    handle->did_rewind = false;
 }
 
-void bsv_movie_frame_rewind(bsv_movie_t *handle)
+void bsv_movie_frame_rewind(bsv_movie_t *handle, unsigned frames)
 {
+   // First time rewind is performed, the old frame is simply replayed.
+   // However, playing back that frame caused us to read data, and push data to the ring buffer.
+   // Sucessively rewinding frames, we need to rewind past the read data, plus another.
+   // Jumping back several frames at once steps back past the extra ones as well.
+   size_t back = (handle->first_rewind ? 1 : 2) + (frames ? frames - 1 : 0);
+   if (back > handle->frame_mask)
+      back = handle->frame_mask;
+
    handle->did_rewind = true;
 
    // If we're at the beginning ... :)
-   if ((handle->frame_ptr <= 1) && (handle->frame_pos[0] == handle->min_file_pos))
+   if ((handle->frame_ptr <= back) && (handle->frame_pos[0] == handle->min_file_pos))
    {
       handle->frame_ptr = 0;
       fseek(handle->file, handle->min_file_pos, SEEK_SET);
    }
    else
    {
-      // First time rewind is performed, the old frame is simply replayed.
-      // However, playing back that frame caused us to read data, and push data to the ring buffer.
-      // Sucessively rewinding frames, we need to rewind past the read data, plus another.
-      handle->frame_ptr = (handle->frame_ptr - (handle->first_rewind ? 1 : 2)) & handle->frame_mask;
+      handle->frame_ptr = (handle->frame_ptr - back) & handle->frame_mask;
       fseek(handle->file, handle->frame_pos[handle->frame_ptr], SEEK_SET);
    }
 
@@ -46,7 +46,7 @@ void bsv_movie_set_input(bsv_movie_t *handle, int16_t input);
 // Used for rewinding while playback/record.
 void bsv_movie_set_frame_start(bsv_movie_t *handle); // Debugging purposes.
 void bsv_movie_set_frame_end(bsv_movie_t *handle);
-void bsv_movie_frame_rewind(bsv_movie_t *handle);
+void bsv_movie_frame_rewind(bsv_movie_t *handle, unsigned frames);
 
 void bsv_movie_free(bsv_movie_t *handle);
 
@@ -23,63 +23,222 @@
 #include "autosave.h"
 #include "dynamic.h"
 #include "message_queue.h"
+#include "hash.h"
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_ZLIB_DEFLATE
+#include <zlib.h>
+#endif
+
+#if defined(__linux__) && !defined(HAVE_SOCKET_LEGACY)
+#include <sys/epoll.h>
+#define HAVE_EPOLL
+#endif
 
 // Checks if input port/index is controlled by netplay or not.
 static bool netplay_is_alive(netplay_t *handle);
 
 static bool netplay_poll(netplay_t *handle);
-static int16_t netplay_input_state(netplay_t *handle, bool port, unsigned device, unsigned index, unsigned id);
+static int16_t netplay_input_state(netplay_t *handle, unsigned port, unsigned device, unsigned index, unsigned id);
 
 // If we're fast-forward replaying to resync, check if we should actually show frame.
 static bool netplay_should_skip(netplay_t *handle);
 static bool netplay_can_poll(netplay_t *handle);
 static void netplay_set_spectate_input(netplay_t *handle, int16_t input);
 
-static bool netplay_send_cmd(netplay_t *handle, uint32_t cmd, const void *data, size_t size);
-static bool netplay_get_cmd(netplay_t *handle);
+struct netplay_peer;
+static bool netplay_send_cmd(netplay_t *handle, struct netplay_peer *peer, uint32_t cmd, const void *data, size_t size);
+static bool netplay_get_cmd(netplay_t *handle, struct netplay_peer *peer);
 
 #define PREV_PTR(x) ((x) == 0 ? handle->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % handle->buffer_size)
 
+struct netplay_remote_crc
+{
+   uint32_t frame;
+   uint32_t crc;
+   uint32_t resyncs; // Number of state transfers the other side had seen at the time.
+   bool valid;
+};
+
 struct delta_frame
 {
    void *state;
 
-   uint16_t real_input_state;
-   uint16_t simulated_input_state;
-   uint16_t self_state;
+   // Input of every player. Ours is always real.
+   uint16_t real_input_state[MAX_PLAYERS];
+   uint16_t simulated_input_state[MAX_PLAYERS];
+
+   bool is_simulated[MAX_PLAYERS];
+   bool used_real[MAX_PLAYERS];
 
-   bool is_simulated;
-   bool used_real;
+   // Checksums of state, on frames we check for desyncs.
+   // Slots get reused, so the checksums are tagged with the frame they were taken on.
+   uint32_t crc_frame;
+   uint32_t crc;
+   bool has_crc;
+   struct netplay_remote_crc remote_crc[MAX_PLAYERS - 1]; // One for every peer.
 };
 
 #define UDP_FRAME_PACKETS 16
-#define MAX_SPECTATORS 16
+// Which player the input is from, and the token of the link it travels over,
+// followed by (frame, input) pairs for the last UDP_FRAME_PACKETS frames.
+#define UDP_PACKET_HEADER_WORDS 2
+#define UDP_PACKET_WORDS (UDP_PACKET_HEADER_WORDS + UDP_FRAME_PACKETS * 2)
+
+// Connections waiting to be accepted. There is no limit on how many spectators can be connected.
+#define MAX_PENDING_SPECTATORS 64
+// Bytes of input we queue for a spectator who does not keep up before disconnecting them.
+#define MAX_SPECTATOR_BACKLOG (1 << 20)
+
+// Input for the first frames is all sent in one packet, so the delay has to fit.
+#define MAX_INPUT_DELAY (UDP_FRAME_PACKETS - 1)
+
+// By the time a state from the host arrives, the client has usually run a few frames past it.
+// With desync checks, we keep input for this many more frames around to catch up from there.
+#define RESYNC_FRAMES UDP_FRAME_PACKETS
+
+// Input prediction.
+// Every frame we run ahead of another player's input uses a guess for it,
+// and every wrong guess costs a rollback. Predictors learn from the real input as it arrives.
+#define HOLD_BUCKETS 64 // Hold durations are tracked up to this many frames.
+#define HOLD_MIN_SAMPLES 4
+#define MARKOV_BITS 12
+#define MARKOV_MIN_COUNT 2
+
+struct netplay_markov_entry
+{
+   uint32_t context; // The two inputs before, packed.
+   uint16_t next[2]; // Most frequent successors of context, and how often they followed it.
+   uint16_t count[2];
+};
+
+// Input from one player, as it comes in.
+struct netplay_player
+{
+   unsigned input_delay; // Their input arrives that far ahead.
+   size_t read_ptr; // Where their next input goes. Generally, other_ptr <= read_ptr <= self_ptr + input_delay.
+   uint32_t read_frame_count;
+
+   uint16_t history[2]; // Newest real input from the player is history[1].
+
+   // For the hold predictor: how long every button has been in its current state,
+   // and how long it stayed in either state before.
+   uint16_t hold_run[16];
+   uint16_t hold_durations[16][2][HOLD_BUCKETS];
+
+   struct netplay_markov_entry *markov;
+};
+
+struct netplay_predictor
+{
+   const char *ident;
+   // Guesses the input of player frames frames after the newest real input we have from them.
+   uint16_t (*predict)(const struct netplay_player *player, unsigned frames);
+   bool needs_markov; // Needs the Markov table allocated.
+};
+
+static const struct netplay_predictor *find_predictor(const char *ident);
+
+// Someone we have a TCP connection to. The host has one to every other player, and clients one to the host.
+// All input goes through the host, which passes every packet on to the other clients.
+struct netplay_peer
+{
+   int fd; // Used for commands.
+   unsigned player;
+   char nick[32];
+
+   // Where we send UDP packets to. The host learns this from the first packet a client sends.
+   struct sockaddr_storage addr;
+   socklen_t addr_len;
+   bool has_addr;
+
+   // UDP is not authenticated. The host hands every client a random token over TCP,
+   // and packets between the two only count if they carry it.
+   // The host also only takes packets from the address the client connected from.
+   uint32_t token;
+   struct sockaddr_storage tcp_addr;
+
+   bool can_inflate;
+   uint32_t resyncs; // States sent by the host, or loaded by the client. Checksums are only compared within the same count.
+   bool desynced;
+};
+
+// Spectators are fed from the main loop, so their sockets never block.
+struct netplay_spectator
+{
+   int fd;
+   unsigned id;
+   size_t index; // In the spectator list.
+   struct sockaddr_storage addr;
+
+   // Nickname as it trickles in. The first byte is its size.
+   uint8_t nick[1 + 32];
+   size_t nick_size;
+   bool streaming; // Past the handshake, gets input every frame.
+
+   // Data the socket did not take yet. The save state comes first, input after that.
+   uint8_t *queue;
+   size_t queue_ptr;
+   size_t queue_size;
+   size_t queue_cap;
+   size_t backlog_limit;
+};
+
+// Sockets we wait on. With epoll, waiting costs the same no matter how many are connected.
+struct netplay_poller
+{
+#ifdef HAVE_EPOLL
+   int fd;
+#else
+   struct
+   {
+      int fd;
+      void *data;
+   } *entries;
+   size_t num_entries;
+   size_t cap;
+#endif
+};
 
 #define NETPLAY_CMD_ACK 0
 #define NETPLAY_CMD_NAK 1
 #define NETPLAY_CMD_FLIP_PLAYERS 2
+#define NETPLAY_CMD_CRC 3
+// Followed by the state itself, which is usually too large to fit in the command size.
+#define NETPLAY_CMD_LOAD_SAVESTATE 4
+
+// Set in the input delay the client sends on connect if it can take a compressed state.
+#define NETPLAY_INFO_INFLATE (1U << 31)
 
 struct netplay
 {
    char nick[32];
-   char other_nick[32];
-   struct sockaddr_storage other_addr;
+   char other_nick[32]; // Host nick, when spectating.
 
    struct retro_callbacks cbs;
-   int fd; // TCP connection for state sending, etc. Also used for commands.
+   int fd; // Listening socket on the host. Connection to the host when spectating.
    int udp_fd; // UDP connection for game state updates.
-   unsigned port; // Which port is governed by netplay (other player)?
    bool has_connection;
 
+   unsigned num_players;
+   unsigned self; // Which player we are. The host is player 1, i.e. 0.
+   struct netplay_player players[MAX_PLAYERS];
+   struct netplay_peer peers[MAX_PLAYERS - 1];
+   unsigned num_peers;
+
+   struct netplay_poller poller;
+
    struct delta_frame *buffer;
    size_t buffer_size;
 
+   unsigned sync_frames; // How many frames we may run ahead of the input of other players.
+   unsigned input_delay; // Our input is sampled this many frames before it is applied.
+
    size_t self_ptr; // Ptr where we are now.
    size_t other_ptr; // Points to the last reliable state that self ever had.
-   size_t read_ptr; // Ptr to where we are reading. Generally, other_ptr <= read_ptr <= self_ptr.
    size_t tmp_ptr; // A temporary pointer used on replay.
 
    size_t state_size;
@@ -87,21 +246,21 @@ struct netplay
    bool is_replay; // Are we replaying old frames?
    bool can_poll; // We don't want to poll several times on a frame.
 
-   uint32_t packet_buffer[UDP_FRAME_PACKETS * 2]; // To compat UDP packet loss we also send old data along with the packets.
+   uint32_t packet_buffer[UDP_PACKET_WORDS]; // To compat UDP packet loss we also send old data along with the packets.
    uint32_t frame_count;
-   uint32_t read_frame_count;
    uint32_t other_frame_count;
    uint32_t tmp_frame_count;
-   struct addrinfo *addr;
-   struct sockaddr_storage their_addr;
-   bool has_client_addr;
+   struct addrinfo *addr; // Of the host, on clients.
 
    unsigned timeout_cnt;
 
    // Spectating.
    bool spectate;
    bool spectate_client;
-   int spectate_fds[MAX_SPECTATORS];
+   struct netplay_spectator **spectators;
+   size_t num_spectators;
+   size_t spectators_cap;
+   unsigned spectator_ids;
    uint16_t *spectate_input;
    size_t spectate_input_ptr;
    size_t spectate_input_size;
@@ -110,9 +269,35 @@ struct netplay
    // Flipping state. If ptr >= flip_frame, we apply the flip.
    // If not, we apply the opposite, effectively creating a trigger point.
    // To avoid collition we need to make sure our client/host is synced up well after flip_frame
-   // before allowing another flip.
+   // before allowing another flip. Only with two players.
    bool flip;
    uint32_t flip_frame;
+
+   const struct netplay_predictor *predictor;
+
+   // Desync detection.
+   // Every check_frames frames, everyone checksums their state once it no longer depends on predicted input.
+   // When a client's checksum differs from the host's, the host sends its state over, which the client rewinds to.
+   unsigned check_frames; // 0 if disabled.
+   uint32_t check_frame; // We only checksum from this frame on.
+
+   void *resync_data; // State as it goes over the wire, possibly compressed.
+   void *resync_state; // State received from the host, waiting to be loaded.
+   uint32_t resync_frame;
+   uint32_t resync_count;
+   bool resync_pending;
+
+   struct
+   {
+      uint64_t rollbacks;
+      uint64_t replayed_frames;
+      uint64_t skipped_serializes;
+      uint64_t predictions;
+      uint64_t predictions_hit;
+      uint64_t checks;
+      uint64_t desyncs;
+      uint64_t resyncs;
+   } stats;
 };
 
 static bool send_all(int fd, const void *data_, size_t size)
@@ -147,6 +332,149 @@ static bool recv_all(int fd, void *data_, size_t size)
    return true;
 }
 
+static bool socket_nonblock(int fd)
+{
+#if defined(_WIN32)
+   u_long mode = 1;
+   return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#elif defined(__CELLOS_LV2__)
+   int i = 1;
+   setsockopt(fd, SOL_SOCKET, SO_NBIO, &i, sizeof(int));
+   return true;
+#else
+   return fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) == 0;
+#endif
+}
+
+// Makes blocking receives on fd give up after ms milliseconds. 0 waits forever again.
+static bool socket_recv_timeout(int fd, unsigned ms)
+{
+#if defined(_WIN32)
+   DWORD tv = ms;
+#else
+   struct timeval tv;
+   tv.tv_sec  = ms / 1000;
+   tv.tv_usec = (ms % 1000) * 1000;
+#endif
+   return setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, CONST_CAST &tv, sizeof(tv)) == 0;
+}
+
+// A non-blocking socket had nothing for us, or no room to take more.
+static bool socket_would_block(void)
+{
+#if defined(_WIN32)
+   return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+   return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static bool poller_init(struct netplay_poller *poller)
+{
+#ifdef HAVE_EPOLL
+   poller->fd = epoll_create(16);
+   return poller->fd >= 0;
+#else
+   (void)poller;
+   return true;
+#endif
+}
+
+static void poller_free(struct netplay_poller *poller)
+{
+#ifdef HAVE_EPOLL
+   if (poller->fd >= 0)
+      close(poller->fd);
+#else
+   free(poller->entries);
+#endif
+}
+
+// data is handed back from poller_wait() when fd has something to read.
+static bool poller_add(struct netplay_poller *poller, int fd, void *data)
+{
+#ifdef HAVE_EPOLL
+   struct epoll_event event = {0};
+   event.events = EPOLLIN;
+   event.data.ptr = data;
+   return epoll_ctl(poller->fd, EPOLL_CTL_ADD, fd, &event) == 0;
+#else
+   if (poller->num_entries >= poller->cap)
+   {
+      size_t cap = poller->cap ? poller->cap * 2 : 8;
+      void *entries = realloc(poller->entries, cap * sizeof(*poller->entries));
+      if (!entries)
+         return false;
+      poller->entries = entries;
+      poller->cap = cap;
+   }
+
+   poller->entries[poller->num_entries].fd = fd;
+   poller->entries[poller->num_entries].data = data;
+   poller->num_entries++;
+   return true;
+#endif
+}
+
+static void poller_remove(struct netplay_poller *poller, int fd)
+{
+#ifdef HAVE_EPOLL
+   struct epoll_event event = {0}; // Old kernels want one, even if it is ignored.
+   epoll_ctl(poller->fd, EPOLL_CTL_DEL, fd, &event);
+#else
+   size_t i;
+   for (i = 0; i < poller->num_entries; i++)
+   {
+      if (poller->entries[i].fd == fd)
+      {
+         poller->entries[i] = poller->entries[--poller->num_entries];
+         break;
+      }
+   }
+#endif
+}
+
+// Waits up to timeout_ms for any of our sockets to become readable.
+// Returns how many were put in ready, or -1 on error.
+static int poller_wait(struct netplay_poller *poller, unsigned timeout_ms, void **ready, unsigned max_ready)
+{
+   int i;
+#ifdef HAVE_EPOLL
+   struct epoll_event events[64];
+   if (max_ready > ARRAY_SIZE(events))
+      max_ready = ARRAY_SIZE(events);
+
+   int ret = epoll_wait(poller->fd, events, max_ready, timeout_ms);
+   for (i = 0; i < ret; i++)
+      ready[i] = events[i].data.ptr;
+   return ret < 0 ? -1 : ret;
+#else
+   int max_fd = -1;
+   unsigned count = 0;
+
+   fd_set fds;
+   FD_ZERO(&fds);
+   for (i = 0; i < (int)poller->num_entries; i++)
+   {
+      FD_SET(poller->entries[i].fd, &fds);
+      if (poller->entries[i].fd > max_fd)
+         max_fd = poller->entries[i].fd;
+   }
+
+   struct timeval tv = {0};
+   tv.tv_sec = timeout_ms / 1000;
+   tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+   if (select(max_fd + 1, &fds, NULL, NULL, &tv) < 0)
+      return -1;
+
+   for (i = 0; i < (int)poller->num_entries && count < max_ready; i++)
+      if (FD_ISSET(poller->entries[i].fd, &fds))
+         ready[count++] = poller->entries[i].data;
+   return count;
+#endif
+}
+
 static void warn_hangup(void)
 {
    RARCH_WARN("Netplay has disconnected. Will continue without connection ...\n");
@@ -188,6 +516,32 @@ int16_t input_state_net(unsigned port, unsigned device, unsigned index, unsigned
       return g_extern.netplay->cbs.state_cb(port, device, index, id);
 }
 
+// Same host, and if port is set, the same port too.
+static bool sockaddr_equal(const struct sockaddr *a, const struct sockaddr *b, bool port)
+{
+   if (a->sa_family != b->sa_family)
+      return false;
+
+   if (a->sa_family == AF_INET)
+   {
+      const struct sockaddr_in *a4 = (const struct sockaddr_in*)a;
+      const struct sockaddr_in *b4 = (const struct sockaddr_in*)b;
+      return a4->sin_addr.s_addr == b4->sin_addr.s_addr &&
+         (!port || a4->sin_port == b4->sin_port);
+   }
+#ifndef HAVE_SOCKET_LEGACY
+   else if (a->sa_family == AF_INET6)
+   {
+      const struct sockaddr_in6 *a6 = (const struct sockaddr_in6*)a;
+      const struct sockaddr_in6 *b6 = (const struct sockaddr_in6*)b;
+      return memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr)) == 0 &&
+         (!port || a6->sin6_port == b6->sin6_port);
+   }
+#endif
+
+   return false;
+}
+
 #ifndef HAVE_SOCKET_LEGACY
 // Custom inet_ntop. Win32 doesn't seem to support this ...
 static void log_connection(const struct sockaddr_storage *their_addr,
@@ -238,8 +592,8 @@ static void log_connection(const struct sockaddr_storage *their_addr,
 }
 #endif
 
-static int init_tcp_connection(const struct addrinfo *res, bool server, bool spectate,
-      struct sockaddr *other_addr, socklen_t addr_size)
+// Connects to the host, or as the host, returns the socket we listen on.
+static int init_tcp_connection(const struct addrinfo *res, bool server, bool spectate)
 {
    bool ret = true;
    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
@@ -257,39 +611,17 @@ static int init_tcp_connection(const struct addrinfo *res, bool server, bool spe
          goto end;
       }
    }
-   else if (spectate)
-   {
-      int yes = 1;
-      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, CONST_CAST &yes, sizeof(int));
-
-      if (bind(fd, res->ai_addr, res->ai_addrlen) < 0 ||
-            listen(fd, MAX_SPECTATORS) < 0)
-      {
-         ret = false;
-         goto end;
-      }
-   }
    else
    {
       int yes = 1;
       setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, CONST_CAST &yes, sizeof(int));
 
       if (bind(fd, res->ai_addr, res->ai_addrlen) < 0 ||
-            listen(fd, 1) < 0)
-      {
-         ret = false;
-         goto end;
-      }
-
-      int new_fd = accept(fd, other_addr, &addr_size);
-      if (new_fd < 0)
+            listen(fd, spectate ? MAX_PENDING_SPECTATORS : MAX_PLAYERS) < 0)
       {
          ret = false;
          goto end;
       }
-
-      close(fd);
-      fd = new_fd;
    }
 
 end:
@@ -331,8 +663,7 @@ static bool init_tcp_socket(netplay_t *handle, const char *server, uint16_t port
    while (tmp_info)
    {
       int fd;
-      if ((fd = init_tcp_connection(tmp_info, server, handle->spectate,
-               (struct sockaddr*)&handle->other_addr, sizeof(handle->other_addr))) >= 0)
+      if ((fd = init_tcp_connection(tmp_info, server, spectate)) >= 0)
       {
          ret = true;
          handle->fd = fd;
@@ -490,7 +821,7 @@ static bool send_nickname(netplay_t *handle, int fd)
    return true;
 }
 
-static bool get_nickname(netplay_t *handle, int fd)
+static bool get_nickname(int fd, char *nick, size_t size)
 {
    uint8_t nick_size;
 
@@ -500,33 +831,43 @@ static bool get_nickname(netplay_t *handle, int fd)
       return false;
    }
 
-   if (nick_size >= sizeof(handle->other_nick))
+   if (nick_size >= size)
    {
       RARCH_ERR("Invalid nick size.\n");
       return false;
    }
 
-   if (!recv_all(fd, handle->other_nick, nick_size))
+   if (!recv_all(fd, nick, nick_size))
    {
       RARCH_ERR("Failed to receive nick.\n");
       return false;
    }
 
+   nick[nick_size] = '\0';
    return true;
 }
 
+// Client only. Sends what the host needs to check that we can play together,
+// and gets which player we are.
 static bool send_info(netplay_t *handle)
 {
-   uint32_t header[3] = {
+   unsigned i;
+   struct netplay_peer *host = &handle->peers[0];
+   uint32_t header[4] = {
       htonl(g_extern.cart_crc),
       htonl(implementation_magic_value()),
-      htonl(pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM))
+      htonl(pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM)),
+#ifdef HAVE_ZLIB_DEFLATE
+      htonl(handle->input_delay | NETPLAY_INFO_INFLATE)
+#else
+      htonl(handle->input_delay)
+#endif
    };
 
-   if (!send_all(handle->fd, header, sizeof(header)))
+   if (!send_all(host->fd, header, sizeof(header)))
       return false;
 
-   if (!send_nickname(handle, handle->fd))
+   if (!send_nickname(handle, host->fd))
    {
       RARCH_ERR("Failed to send nick to host.\n");
       return false;
@@ -536,31 +877,63 @@ static bool send_info(netplay_t *handle)
    void *sram = pretro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
    unsigned sram_size = pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
 
-   if (!recv_all(handle->fd, sram, sram_size))
+   if (!recv_all(host->fd, sram, sram_size))
    {
       RARCH_ERR("Failed to receive SRAM data from host.\n");
       return false;
    }
 
-   if (!get_nickname(handle, handle->fd))
+   // Number of players, which one we are, our UDP token, and everyone's input delay.
+   uint32_t session[3 + MAX_PLAYERS];
+   if (!recv_all(host->fd, session, sizeof(session)))
+   {
+      RARCH_ERR("Failed to receive session info from host.\n");
+      return false;
+   }
+
+   handle->num_players = ntohl(session[0]);
+   handle->self = ntohl(session[1]);
+   host->token = ntohl(session[2]);
+   if (handle->num_players < 2 || handle->num_players > MAX_PLAYERS ||
+         handle->self == 0 || handle->self >= handle->num_players)
+   {
+      RARCH_ERR("Host sent invalid session info.\n");
+      return false;
+   }
+
+   for (i = 0; i < handle->num_players; i++)
+   {
+      handle->players[i].input_delay = ntohl(session[3 + i]);
+      if (handle->players[i].input_delay > MAX_INPUT_DELAY)
+      {
+         RARCH_ERR("Host sent an invalid input delay.\n");
+         return false;
+      }
+   }
+
+   if (!get_nickname(host->fd, host->nick, sizeof(host->nick)))
    {
       RARCH_ERR("Failed to receive nick from host.\n");
       return false;
    }
 
    char msg[512];
-   snprintf(msg, sizeof(msg), "Connected to: \"%s\"", handle->other_nick);
+   snprintf(msg, sizeof(msg), "Connected to: \"%s\"", host->nick);
    RARCH_LOG("%s\n", msg);
    msg_queue_push(g_extern.msg_queue, msg, 1, 180);
 
+   if (handle->num_players > 2)
+      RARCH_LOG("Netplay: Playing as player %u of %u.\n", handle->self + 1, handle->num_players);
+
    return true;
 }
 
-static bool get_info(netplay_t *handle)
+// Host only. Checks that a client can play with us.
+static bool get_info(netplay_t *handle, struct netplay_peer *peer)
 {
-   uint32_t header[3];
+   uint32_t header[4];
 
-   if (!recv_all(handle->fd, header, sizeof(header)))
+   if (!recv_all(peer->fd, header, sizeof(header)))
    {
       RARCH_ERR("Failed to receive header from client.\n");
       return false;
@@ -584,34 +957,178 @@ static bool get_info(netplay_t *handle)
       return false;
    }
 
-   if (!get_nickname(handle, handle->fd))
+   handle->players[peer->player].input_delay = ntohl(header[3]) & ~NETPLAY_INFO_INFLATE;
+   peer->can_inflate = ntohl(header[3]) & NETPLAY_INFO_INFLATE;
+   if (handle->players[peer->player].input_delay > MAX_INPUT_DELAY)
+   {
+      RARCH_ERR("Client uses an invalid input delay.\n");
+      return false;
+   }
+
+   if (!get_nickname(peer->fd, peer->nick, sizeof(peer->nick)))
    {
       RARCH_ERR("Failed to get nickname from client.\n");
       return false;
    }
 
-   // Send SRAM data to our Player 2.
+   return true;
+}
+
+// Host only. Sends a client what it needs to join, once everyone is connected.
+static bool send_session(netplay_t *handle, const struct netplay_peer *peer)
+{
+   unsigned i;
+
+   // Send SRAM data to the other player.
    const void *sram = pretro_get_memory_data(RETRO_MEMORY_SAVE_RAM);
    unsigned sram_size = pretro_get_memory_size(RETRO_MEMORY_SAVE_RAM);
-   if (!send_all(handle->fd, sram, sram_size))
+   if (!send_all(peer->fd, sram, sram_size))
    {
       RARCH_ERR("Failed to send SRAM data to client.\n");
       return false;
    }
 
-   if (!send_nickname(handle, handle->fd))
+   uint32_t session[3 + MAX_PLAYERS] = {0};
+   session[0] = htonl(handle->num_players);
+   session[1] = htonl(peer->player);
+   session[2] = htonl(peer->token);
+   for (i = 0; i < handle->num_players; i++)
+      session[3 + i] = htonl(handle->players[i].input_delay);
+
+   if (!send_all(peer->fd, session, sizeof(session)))
+   {
+      RARCH_ERR("Failed to send session info to client.\n");
+      return false;
+   }
+
+   if (!send_nickname(handle, peer->fd))
    {
       RARCH_ERR("Failed to send nickname to client.\n");
       return false;
    }
 
+   return true;
+}
+
+// Hard to guess for anyone who does not see our TCP traffic.
+static uint32_t new_token(void)
+{
+   uint32_t token = 0;
+#if !defined(_WIN32) && !defined(HAVE_SOCKET_LEGACY)
+   FILE *file = fopen("/dev/urandom", "rb");
+   if (file)
+   {
+      if (fread(&token, sizeof(token), 1, file) != 1)
+         token = 0;
+      fclose(file);
+   }
+#endif
+   // Without urandom, this is the best we can do.
+   token ^= (uint32_t)rarch_get_time_usec() * 2654435761u;
+   token ^= (uint32_t)rand() << 16 ^ (uint32_t)rand();
+   return token;
+}
+
+#define ACCEPT_POLL_MS 500
+
+// Host only. Waits for every player to connect before the game starts.
+// Gives up after netplay_accept_timeout seconds, unless that is 0.
+// The deadline covers the handshake too. A client that fails it is dropped, and its slot stays open.
+static bool accept_players(netplay_t *handle)
+{
+   unsigned i;
+   unsigned timeout = g_settings.input.netplay_accept_timeout;
+   retro_time_t deadline = rarch_get_time_usec() + (retro_time_t)timeout * 1000000;
+
+   handle->num_peers = handle->num_players - 1;
+   for (i = 0; i < handle->num_peers; )
+   {
+      struct netplay_peer *peer = &handle->peers[i];
+      socklen_t addr_size = sizeof(peer->tcp_addr);
+      retro_time_t now;
+
+      if (handle->num_peers > 1)
+         RARCH_LOG("Netplay: Waiting for player %u of %u to connect ...\n", i + 2, handle->num_players);
+
+      for (;;)
+      {
+         fd_set fds;
+         struct timeval tv = {0};
+         tv.tv_usec = ACCEPT_POLL_MS * 1000;
+         FD_ZERO(&fds);
+         FD_SET(handle->fd, &fds);
+
+         int ret = select(handle->fd + 1, &fds, NULL, NULL, &tv);
+         if (ret < 0)
+         {
+            RARCH_ERR("Failed to wait for players.\n");
+            return false;
+         }
+         else if (ret > 0)
+            break;
+
+         if (timeout && rarch_get_time_usec() >= deadline)
+         {
+            RARCH_ERR("Netplay: Timed out waiting for players to connect.\n");
+            return false;
+         }
+      }
+
+      peer->fd = accept(handle->fd, (struct sockaddr*)&peer->tcp_addr, &addr_size);
+      if (peer->fd < 0)
+      {
+         RARCH_WARN("Failed to accept player.\n");
+         continue;
+      }
+
+      now = rarch_get_time_usec();
+      if (timeout && now >= deadline)
+      {
+         RARCH_ERR("Netplay: Timed out waiting for players to connect.\n");
+         close(peer->fd);
+         peer->fd = -1;
+         return false;
+      }
+
+      // Rounded up, since 0 would mean no timeout at all.
+      if (timeout && !socket_recv_timeout(peer->fd, (unsigned)((deadline - now + 999) / 1000)))
+         RARCH_WARN("Netplay: Failed to set a handshake timeout.\n");
+
+      peer->player = i + 1;
+      peer->token  = new_token();
+      if (!get_info(handle, peer))
+      {
+         RARCH_WARN("Netplay: Dropping player that failed to join.\n");
+         close(peer->fd);
+         peer->fd = -1;
+         continue;
+      }
+
+      if (timeout)
+         socket_recv_timeout(peer->fd, 0);
+
 #ifndef HAVE_SOCKET_LEGACY
-   log_connection(&handle->other_addr, 0, handle->other_nick);
+      log_connection(&peer->tcp_addr, i, peer->nick);
 #endif
+      i++;
+   }
+
+   for (i = 0; i < handle->num_peers; i++)
+      if (!send_session(handle, &handle->peers[i]))
+         return false;
 
+   close(handle->fd);
+   handle->fd = -1;
    return true;
 }
 
+#define MAGIC_INDEX 0
+#define SERIALIZER_INDEX 1
+#define CRC_INDEX 2
+#define STATE_SIZE_INDEX 3
+
+#define BSV_MAGIC 0x42535631
+
 static uint32_t *bsv_header_generate(size_t *size, uint32_t magic)
 {
    uint32_t bsv_header[4] = {0};
@@ -681,7 +1198,7 @@ static bool get_info_spectate(netplay_t *handle)
       return false;
    }
 
-   if (!get_nickname(handle, handle->fd))
+   if (!get_nickname(handle->fd, handle->other_nick, sizeof(handle->other_nick)))
    {
       RARCH_ERR("Failed to receive nickname from host.\n");
       return false;
@@ -730,24 +1247,75 @@ static bool get_info_spectate(netplay_t *handle)
 
 static void init_buffers(netplay_t *handle)
 {
-   unsigned i;
+   unsigned i, p;
    handle->buffer = (struct delta_frame*)calloc(handle->buffer_size, sizeof(*handle->buffer));
    handle->state_size = pretro_serialize_size();
    for (i = 0; i < handle->buffer_size; i++)
    {
       handle->buffer[i].state = malloc(handle->state_size);
-      handle->buffer[i].is_simulated = true;
+      for (p = 0; p < MAX_PLAYERS; p++)
+         handle->buffer[i].is_simulated[p] = true;
+   }
+}
+
+// Closes everything a handle owns, which may be partially set up.
+static void netplay_close_handle(netplay_t *handle)
+{
+   unsigned i;
+
+   if (handle->fd >= 0)
+      close(handle->fd);
+   if (handle->udp_fd >= 0)
+      close(handle->udp_fd);
+
+   for (i = 0; i < ARRAY_SIZE(handle->peers); i++)
+      if (handle->peers[i].fd >= 0)
+         close(handle->peers[i].fd);
+
+   for (i = 0; i < handle->num_spectators; i++)
+   {
+      close(handle->spectators[i]->fd);
+      free(handle->spectators[i]->queue);
+      free(handle->spectators[i]);
+   }
+   free(handle->spectators);
+   free(handle->spectate_input);
+
+   if (handle->buffer)
+   {
+      for (i = 0; i < handle->buffer_size; i++)
+         free(handle->buffer[i].state);
+      free(handle->buffer);
    }
+
+   for (i = 0; i < MAX_PLAYERS; i++)
+      free(handle->players[i].markov);
+
+   free(handle->resync_data);
+   free(handle->resync_state);
+
+   poller_free(&handle->poller);
+
+   if (handle->addr)
+      freeaddrinfo(handle->addr);
+
+   free(handle);
 }
 
 netplay_t *netplay_new(const char *server, uint16_t port,
-      unsigned frames, const struct retro_callbacks *cb,
-      bool spectate,
+      unsigned frames, unsigned input_delay, unsigned players,
+      const struct retro_callbacks *cb, bool spectate,
       const char *nick)
 {
    unsigned i;
    if (frames > UDP_FRAME_PACKETS)
       frames = UDP_FRAME_PACKETS;
+   if (input_delay > MAX_INPUT_DELAY)
+      input_delay = MAX_INPUT_DELAY;
+   if (players < 2)
+      players = 2;
+   if (players > MAX_PLAYERS)
+      players = MAX_PLAYERS;
 
    netplay_t *handle = (netplay_t*)calloc(1, sizeof(*handle));
    if (!handle)
@@ -755,18 +1323,31 @@ netplay_t *netplay_new(const char *server, uint16_t port,
 
    handle->fd = -1;
    handle->udp_fd = -1;
+   for (i = 0; i < ARRAY_SIZE(handle->peers); i++)
+      handle->peers[i].fd = -1;
+#ifdef HAVE_EPOLL
+   handle->poller.fd = -1;
+#endif
+
    handle->cbs = *cb;
-   handle->port = server ? 0 : 1;
+   handle->num_players = players; // Clients learn this from the host.
    handle->spectate = spectate;
    handle->spectate_client = server != NULL;
+   handle->sync_frames = frames;
+   handle->input_delay = input_delay;
+   handle->check_frames = g_settings.input.netplay_check_frames;
+   handle->check_frame = 1; // Nothing to check on the very first frame.
    strlcpy(handle->nick, nick, sizeof(handle->nick));
 
-   if (!init_socket(handle, server, port))
+   if (!poller_init(&handle->poller))
    {
-      free(handle);
-      return NULL;
+      RARCH_ERR("Failed to set up netplay socket polling.\n");
+      goto error;
    }
 
+   if (!init_socket(handle, server, port))
+      goto error;
+
    if (spectate)
    {
       if (server)
@@ -774,38 +1355,83 @@ netplay_t *netplay_new(const char *server, uint16_t port,
          if (!get_info_spectate(handle))
             goto error;
       }
-
-      for (i = 0; i < MAX_SPECTATORS; i++)
-         handle->spectate_fds[i] = -1;
+      else if (!socket_nonblock(handle->fd) ||
+            !poller_add(&handle->poller, handle->fd, &handle->fd))
+      {
+         RARCH_ERR("Failed to set up spectator socket.\n");
+         goto error;
+      }
    }
    else
    {
       if (server)
       {
+         handle->num_peers = 1;
+         handle->peers[0].fd = handle->fd;
+         handle->peers[0].player = 0;
+         handle->fd = -1;
+
          if (!send_info(handle))
             goto error;
       }
       else
       {
-         if (!get_info(handle))
+         handle->players[0].input_delay = input_delay;
+         if (!accept_players(handle))
             goto error;
       }
 
-      handle->buffer_size = frames + 1;
+      if (!poller_add(&handle->poller, handle->udp_fd, &handle->udp_fd))
+         goto error;
+      for (i = 0; i < handle->num_peers; i++)
+         if (!poller_add(&handle->poller, handle->peers[i].fd, &handle->peers[i]))
+            goto error;
+
+      handle->predictor = find_predictor(g_settings.input.netplay_predictor);
+      if (handle->predictor->needs_markov)
+      {
+         for (i = 0; i < handle->num_players; i++)
+         {
+            if (i == handle->self)
+               continue;
+
+            handle->players[i].markov = (struct netplay_markov_entry*)
+               calloc(1 << MARKOV_BITS, sizeof(*handle->players[i].markov));
+            if (!handle->players[i].markov)
+               goto error;
+         }
+      }
+      RARCH_LOG("Netplay input predictor: %s.\n", handle->predictor->ident);
+
+      // Besides the frames we may have to roll back, input from any player
+      // can be known up to its input delay ahead of the frame being run.
+      unsigned max_delay = 0;
+      for (i = 0; i < handle->num_players; i++)
+      {
+         if (handle->players[i].input_delay > max_delay)
+            max_delay = handle->players[i].input_delay;
+
+         if (handle->players[i].input_delay)
+         {
+            RARCH_LOG("Netplay input delay of player %u%s: %u frames.\n", i + 1,
+                  i == handle->self ? " (local)" : "", handle->players[i].input_delay);
+         }
+      }
+
+      handle->buffer_size = frames + 1 + max_delay;
+      if (handle->check_frames)
+         handle->buffer_size += RESYNC_FRAMES;
 
       init_buffers(handle);
+      handle->packet_buffer[0] = htonl(handle->self);
+      handle->packet_buffer[1] = htonl(handle->peers[0].token); // Clients only talk to the host.
       handle->has_connection = true;
    }
 
    return handle;
 
 error:
-   if (handle->fd >= 0)
-      close(handle->fd);
-   if (handle->udp_fd >= 0)
-      close(handle->udp_fd);
-
-   free(handle);
+   netplay_close_handle(handle);
    return NULL;
 }
 
@@ -815,64 +1441,108 @@ static bool netplay_is_alive(netplay_t *handle)
    return handle->has_connection;
 }
 
-static bool send_chunk(netplay_t *handle)
+// Oldest frame we lack input from some player for.
+static uint32_t netplay_read_frame_count(netplay_t *handle)
 {
-   const struct sockaddr *addr = NULL;
+   unsigned p;
+   uint32_t frame_count = UINT32_MAX;
+
+   for (p = 0; p < handle->num_players; p++)
+   {
+      if (p != handle->self && handle->players[p].read_frame_count < frame_count)
+         frame_count = handle->players[p].read_frame_count;
+   }
+
+   return frame_count;
+}
+
+// We cannot run further ahead of the last frame we have reliable input for.
+static bool netplay_buffer_full(netplay_t *handle)
+{
+   return handle->frame_count - handle->other_frame_count >= handle->sync_frames;
+}
+
+// Newest frame we accept input from a player for.
+static uint32_t netplay_read_limit(netplay_t *handle, unsigned p)
+{
+   return handle->frame_count + handle->players[p].input_delay;
+}
+
+// Some player has input we could take.
+static bool netplay_wants_input(netplay_t *handle)
+{
+   unsigned p;
+   for (p = 0; p < handle->num_players; p++)
+   {
+      if (p != handle->self && handle->players[p].read_frame_count <= netplay_read_limit(handle, p))
+         return true;
+   }
+
+   return false;
+}
+
+// Clients send input packets to the host. The host sends to every client, except skip,
+// each with the token of that client.
+static bool send_chunk(netplay_t *handle, const uint32_t *packet, const struct netplay_peer *skip)
+{
+   unsigned i;
+   const ssize_t size = UDP_PACKET_WORDS * sizeof(uint32_t);
+   uint32_t stamped[UDP_PACKET_WORDS];
+
    if (handle->addr)
-      addr = handle->addr->ai_addr;
-   else if (handle->has_client_addr)
-      addr = (const struct sockaddr*)&handle->their_addr;
+   {
+      return sendto(handle->udp_fd, CONST_CAST packet, size, 0,
+            handle->addr->ai_addr, handle->addr->ai_addrlen) == size;
+   }
 
-   if (addr)
+   for (i = 0; i < handle->num_peers; i++)
    {
-      if (sendto(handle->udp_fd, CONST_CAST handle->packet_buffer,
-               sizeof(handle->packet_buffer), 0, addr,
-               sizeof(struct sockaddr)) != sizeof(handle->packet_buffer))
-      {
-         warn_hangup();
-         handle->has_connection = false;
+      const struct netplay_peer *peer = &handle->peers[i];
+      if (peer == skip || !peer->has_addr)
+         continue;
+
+      memcpy(stamped, packet, sizeof(stamped));
+      stamped[1] = htonl(peer->token);
+      if (sendto(handle->udp_fd, CONST_CAST stamped, size, 0,
+               (const struct sockaddr*)&peer->addr, peer->addr_len) != size)
          return false;
-      }
    }
+
    return true;
 }
 
 #define MAX_RETRIES 16
 #define RETRY_MS 500
 
+// Returns 1 if an input packet is waiting, 0 if not, and -1 if the connection is gone.
 static int poll_input(netplay_t *handle, bool block)
 {
-   int max_fd = (handle->fd > handle->udp_fd ? handle->fd : handle->udp_fd) + 1;
-
-   struct timeval tv = {0};
-   tv.tv_sec = 0;
-   tv.tv_usec = block ? (RETRY_MS * 1000) : 0;
-
    do
-   { 
-      handle->timeout_cnt++;
-
-      // select() does not take pointer to const struct timeval.
-      // Technically possible for select() to modify tmp_tv, so we go paranoia mode.
-      struct timeval tmp_tv = tv;
+   {
+      int i;
+      void *ready[MAX_PLAYERS];
+      bool has_input = false;
 
-      fd_set fds;
-      FD_ZERO(&fds);
-      FD_SET(handle->udp_fd, &fds);
-      FD_SET(handle->fd, &fds);
+      handle->timeout_cnt++;
 
-      if (select(max_fd, &fds, NULL, NULL, &tmp_tv) < 0)
+      int count = poller_wait(&handle->poller, block ? RETRY_MS : 0, ready, ARRAY_SIZE(ready));
+      if (count < 0)
          return -1;
 
-      // Somewhat hacky,
-      // but we aren't using the TCP connection for anything useful atm.
-      if (FD_ISSET(handle->fd, &fds) && !netplay_get_cmd(handle))
-         return -1; 
+      for (i = 0; i < count; i++)
+      {
+         if (ready[i] == &handle->udp_fd)
+            has_input = true;
+         // Somewhat hacky,
+         // but we only use the TCP connections for the occasional command.
+         else if (!netplay_get_cmd(handle, (struct netplay_peer*)ready[i]))
+            return -1;
+      }
 
-      if (FD_ISSET(handle->udp_fd, &fds))
+      if (has_input)
          return 1;
 
-      if (block && !send_chunk(handle))
+      if (block && !send_chunk(handle, handle->packet_buffer, NULL))
       {
          warn_hangup();
          handle->has_connection = false;
@@ -891,11 +1561,23 @@ static int poll_input(netplay_t *handle, bool block)
    return 0;
 }
 
+// Adds our input for a frame to the packet we send, and to the frame it applies to.
+static void queue_self_input(netplay_t *handle, uint32_t frame, uint32_t state)
+{
+   uint32_t *frames = handle->packet_buffer + UDP_PACKET_HEADER_WORDS;
+   memmove(frames, frames + 2, (UDP_FRAME_PACKETS - 1) * 2 * sizeof(uint32_t));
+   frames[(UDP_FRAME_PACKETS - 1) * 2] = htonl(frame);
+   frames[(UDP_FRAME_PACKETS - 1) * 2 + 1] = htonl(state);
+
+   handle->buffer[(handle->self_ptr + (frame - handle->frame_count)) % handle->buffer_size].real_input_state[handle->self] = state;
+}
+
 // Grab our own input state and send this over the network.
+// With an input delay, it is applied input_delay frames from now, which gives it
+// that much more time to reach the other players before they have to predict it.
 static bool get_self_input_state(netplay_t *handle)
 {
    unsigned i;
-   struct delta_frame *ptr = &handle->buffer[handle->self_ptr];
 
    uint32_t state = 0;
    if (handle->frame_count > 0) // First frame we always give zero input since relying on input from first frame screws up when we use -F 0.
@@ -903,74 +1585,325 @@ static bool get_self_input_state(netplay_t *handle)
       retro_input_state_t cb = handle->cbs.state_cb;
       for (i = 0; i < RARCH_FIRST_META_KEY; i++)
       {
-         int16_t tmp = cb(g_settings.input.netplay_client_swap_input ? 0 : !handle->port,
+         int16_t tmp = cb(g_settings.input.netplay_client_swap_input ? 0 : handle->self,
                RETRO_DEVICE_JOYPAD, 0, i);
          state |= tmp ? 1 << i : 0;
       }
    }
+   else
+   {
+      // Nothing was sampled for the frames before our first input kicks in.
+      for (i = 0; i < handle->input_delay; i++)
+         queue_self_input(handle, i, 0);
+   }
 
-   memmove(handle->packet_buffer, handle->packet_buffer + 2,
-         sizeof (handle->packet_buffer) - 2 * sizeof(uint32_t));
-   handle->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2] = htonl(handle->frame_count); 
-   handle->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2 + 1] = htonl(state);
+   queue_self_input(handle, handle->frame_count + handle->input_delay, state);
 
-   if (!send_chunk(handle))
+   if (!send_chunk(handle, handle->packet_buffer, NULL))
    {
       warn_hangup();
       handle->has_connection = false;
       return false;
    }
 
-   ptr->self_state = state;
    handle->self_ptr = NEXT_PTR(handle->self_ptr);
    return true;
 }
 
-// TODO: Somewhat better prediction. :P
-static void simulate_input(netplay_t *handle)
+static uint16_t predict_last(const struct netplay_player *player, unsigned frames)
 {
-   size_t ptr = PREV_PTR(handle->self_ptr);
-   size_t prev = PREV_PTR(handle->read_ptr);
+   (void)frames;
+   return player->history[1];
+}
 
-   handle->buffer[ptr].simulated_input_state = handle->buffer[prev].real_input_state;
-   handle->buffer[ptr].is_simulated = true;
-   handle->buffer[ptr].used_real = false;
+// Number of past holds (or releases) of a button that lasted at least frames.
+static unsigned hold_survivors(const uint16_t *durations, unsigned frames)
+{
+   unsigned i, count = 0;
+   for (i = frames < HOLD_BUCKETS ? frames : HOLD_BUCKETS - 1; i < HOLD_BUCKETS; i++)
+      count += durations[i];
+   return count;
 }
 
-static void parse_packet(netplay_t *handle, uint32_t *buffer, unsigned size)
+// Flips a button when, judging by how long it usually stays that way,
+// it has more likely than not flipped by the frame we are guessing.
+static uint16_t predict_hold(const struct netplay_player *player, unsigned frames)
 {
    unsigned i;
-   for (i = 0; i < size * 2; i++)
-      buffer[i] = ntohl(buffer[i]);
+   uint16_t input = player->history[1];
+
+   for (i = 0; i < 16; i++)
+   {
+      bool down = input & (1 << i);
+      const uint16_t *durations = player->hold_durations[i][down];
+      unsigned lasted = hold_survivors(durations, player->hold_run[i]);
+
+      if (lasted >= HOLD_MIN_SAMPLES &&
+            2 * hold_survivors(durations, player->hold_run[i] + frames) < lasted)
+         input ^= 1 << i;
+   }
+
+   return input;
+}
+
+static struct netplay_markov_entry *markov_lookup(const struct netplay_player *player, uint16_t prev, uint16_t cur)
+{
+   uint32_t context = ((uint32_t)prev << 16) | cur;
+   return &player->markov[((context * 0x9e3779b1u) >> (32 - MARKOV_BITS))];
+}
+
+// Follows the most likely successor of the last two inputs, one frame at a time.
+static uint16_t predict_markov(const struct netplay_player *player, unsigned frames)
+{
+   uint16_t prev = player->history[0];
+   uint16_t cur = player->history[1];
 
-   for (i = 0; i < size && handle->read_frame_count <= handle->frame_count; i++)
+   while (frames--)
    {
-      uint32_t frame = buffer[2 * i + 0];
-      uint32_t state = buffer[2 * i + 1];
+      const struct netplay_markov_entry *entry = markov_lookup(player, prev, cur);
+      uint16_t next = cur;
 
-      if (frame == handle->read_frame_count)
+      if (entry->context == (((uint32_t)prev << 16) | cur) && entry->count[0] >= MARKOV_MIN_COUNT)
+         next = entry->next[0];
+
+      prev = cur;
+      cur = next;
+   }
+
+   return cur;
+}
+
+static const struct netplay_predictor predictors[] = {
+   { "last", predict_last, false },
+   { "hold", predict_hold, false },
+   { "markov", predict_markov, true },
+};
+
+static const struct netplay_predictor *find_predictor(const char *ident)
+{
+   unsigned i;
+   for (i = 0; i < ARRAY_SIZE(predictors); i++)
+      if (strcmp(predictors[i].ident, ident) == 0)
+         return &predictors[i];
+
+   RARCH_WARN("Couldn't find netplay predictor named \"%s\". Using \"%s\".\n",
+         ident, predictors[0].ident);
+   return &predictors[0];
+}
+
+// Counts a hold (or release) that lasted frames.
+// A full bucket halves all of them, which keeps their ratios, and lets old habits fade.
+static void record_hold(uint16_t *durations, unsigned frames)
+{
+   unsigned i;
+   uint16_t *bucket = &durations[frames < HOLD_BUCKETS ? frames : HOLD_BUCKETS - 1];
+
+   if (*bucket == UINT16_MAX)
+   {
+      for (i = 0; i < HOLD_BUCKETS; i++)
+         durations[i] >>= 1;
+   }
+
+   (*bucket)++;
+}
+
+// Feeds real input from another player, in frame order, to every model.
+static void observe_input(struct netplay_player *player, uint16_t input)
+{
+   unsigned i;
+   uint16_t prev = player->history[0];
+   uint16_t cur = player->history[1];
+
+   for (i = 0; i < 16; i++)
+   {
+      bool down = cur & (1 << i);
+      if (((input ^ cur) & (1 << i)) == 0)
       {
-         handle->buffer[handle->read_ptr].is_simulated = false;
-         handle->buffer[handle->read_ptr].real_input_state = state;
-         handle->read_ptr = NEXT_PTR(handle->read_ptr);
-         handle->read_frame_count++;
+         if (player->hold_run[i] < UINT16_MAX)
+            player->hold_run[i]++;
+         continue;
+      }
+
+      record_hold(player->hold_durations[i][down], player->hold_run[i]);
+      player->hold_run[i] = 1;
+   }
+
+   if (player->markov)
+   {
+      struct netplay_markov_entry *entry = markov_lookup(player, prev, cur);
+      uint32_t context = ((uint32_t)prev << 16) | cur;
+
+      if (entry->context != context)
+      {
+         memset(entry, 0, sizeof(*entry));
+         entry->context = context;
+      }
+
+      if (entry->count[0] && entry->next[0] == input)
+         entry->count[0]++;
+      else if (entry->count[1] && entry->next[1] == input)
+         entry->count[1]++;
+      else
+      {
+         entry->next[1] = input;
+         entry->count[1] = 1;
+      }
+
+      if (entry->count[1] > entry->count[0])
+      {
+         uint16_t tmp_next = entry->next[0];
+         uint16_t tmp_count = entry->count[0];
+         entry->next[0] = entry->next[1];
+         entry->count[0] = entry->count[1];
+         entry->next[1] = tmp_next;
+         entry->count[1] = tmp_count;
+      }
+
+      // Keep counts adaptive, and clear of overflow.
+      if (entry->count[0] == UINT16_MAX)
+      {
+         entry->count[0] >>= 1;
+         entry->count[1] >>= 1;
+      }
+   }
+
+   player->history[0] = cur;
+   player->history[1] = input;
+}
+
+// Guess the input of player p for the frame at ptr, which is frame_count.
+static void simulate_input(netplay_t *handle, unsigned p, size_t ptr, uint32_t frame_count)
+{
+   const struct netplay_player *player = &handle->players[p];
+   unsigned frames = frame_count + 1 - player->read_frame_count;
+   struct delta_frame *delta = &handle->buffer[ptr];
+
+   delta->simulated_input_state[p] = handle->predictor->predict(player, frames);
+   delta->is_simulated[p] = true;
+   delta->used_real[p] = false;
+}
+
+// Frame frame_count at ptr is about to run. Guess the input we do not have yet.
+static void netplay_prepare_input(netplay_t *handle, size_t ptr, uint32_t frame_count)
+{
+   unsigned p;
+   for (p = 0; p < handle->num_players; p++)
+   {
+      if (p == handle->self)
+         continue;
+
+      if (handle->players[p].read_frame_count <= frame_count)
+         simulate_input(handle, p, ptr, frame_count);
+      else
+         handle->buffer[ptr].used_real[p] = true;
+   }
+}
+
+// Some input for frame at delta was guessed, and guessed wrong.
+static bool netplay_mispredicted(netplay_t *handle, const struct delta_frame *delta)
+{
+   unsigned p;
+   for (p = 0; p < handle->num_players; p++)
+   {
+      if (p != handle->self && !delta->used_real[p] &&
+            delta->simulated_input_state[p] != delta->real_input_state[p])
+         return true;
+   }
+
+   return false;
+}
+
+// Takes the (frame, input) pairs of player p. The packet stays in network order, as the host passes it on.
+static void parse_packet(netplay_t *handle, unsigned p, const uint32_t *buffer)
+{
+   unsigned i;
+   struct netplay_player *player = &handle->players[p];
+
+   for (i = 0; i < UDP_FRAME_PACKETS && player->read_frame_count <= netplay_read_limit(handle, p); i++)
+   {
+      uint32_t frame = ntohl(buffer[2 * i + 0]);
+      uint32_t state = ntohl(buffer[2 * i + 1]);
+
+      if (frame == player->read_frame_count)
+      {
+         struct delta_frame *delta = &handle->buffer[player->read_ptr];
+
+         // Real input for a frame we had to guess for.
+         if (frame < handle->frame_count)
+         {
+            handle->stats.predictions++;
+            handle->stats.predictions_hit += delta->simulated_input_state[p] == state;
+         }
+         observe_input(player, state);
+
+         delta->is_simulated[p] = false;
+         delta->real_input_state[p] = state;
+         player->read_ptr = NEXT_PTR(player->read_ptr);
+         player->read_frame_count++;
          handle->timeout_cnt = 0;
       }
    }
 }
 
-static bool receive_data(netplay_t *handle, uint32_t *buffer, size_t size)
+// Reads one input packet. The host passes it on to the clients besides the one it came from.
+static bool receive_packet(netplay_t *handle)
 {
-   socklen_t addrlen = sizeof(handle->their_addr);
-   if (recvfrom(handle->udp_fd, NONCONST_CAST buffer, size, 0, (struct sockaddr*)&handle->their_addr, &addrlen) != (ssize_t)size)
+   uint32_t packet[UDP_PACKET_WORDS];
+   struct sockaddr_storage addr;
+   socklen_t addr_len = sizeof(addr);
+
+   if (recvfrom(handle->udp_fd, NONCONST_CAST packet, sizeof(packet), 0,
+            (struct sockaddr*)&addr, &addr_len) != sizeof(packet))
       return false;
-   handle->has_client_addr = true;
+
+   unsigned p = ntohl(packet[0]);
+   uint32_t token = ntohl(packet[1]);
+   if (p >= handle->num_players || p == handle->self)
+   {
+      RARCH_WARN("Netplay: Ignoring input packet for invalid player %u.\n", p);
+      return true;
+   }
+
+   // Anyone can send us UDP packets. Ones which do not come over a link we set up are dropped.
+   if (handle->self != 0)
+   {
+      if (token != handle->peers[0].token ||
+            !sockaddr_equal((const struct sockaddr*)&addr, handle->addr->ai_addr, true))
+         return true;
+   }
+   else
+   {
+      struct netplay_peer *peer = &handle->peers[p - 1];
+      if (token != peer->token)
+         return true;
+
+      // The client's UDP port can differ from its TCP port, so it is learned from the first packet.
+      if (peer->has_addr ?
+            !sockaddr_equal((const struct sockaddr*)&addr, (const struct sockaddr*)&peer->addr, true) :
+            !sockaddr_equal((const struct sockaddr*)&addr, (const struct sockaddr*)&peer->tcp_addr, false))
+         return true;
+
+      if (!peer->has_addr)
+      {
+         memcpy(&peer->addr, &addr, addr_len);
+         peer->addr_len = addr_len;
+         peer->has_addr = true;
+      }
+
+      // Clients only hear from each other through us.
+      if (handle->num_players > 2 && !send_chunk(handle, packet, peer))
+         return false;
+   }
+
+   parse_packet(handle, p, packet + UDP_PACKET_HEADER_WORDS);
    return true;
 }
 
 // Poll network to see if we have anything new. If our network buffer is full, we simply have to block for new input data.
 static bool netplay_poll(netplay_t *handle)
 {
+   unsigned p;
+
    if (!handle->has_connection)
       return false;
 
@@ -982,16 +1915,24 @@ static bool netplay_poll(netplay_t *handle)
    // We skip reading the first frame so the host has a chance to grab our host info so we don't block forever :')
    if (handle->frame_count == 0)
    {
-      handle->buffer[0].used_real = true;
-      handle->buffer[0].is_simulated = false;
-      handle->buffer[0].real_input_state = 0;
-      handle->read_ptr = NEXT_PTR(handle->read_ptr);
-      handle->read_frame_count++;
+      for (p = 0; p < handle->num_players; p++)
+      {
+         struct netplay_player *player = &handle->players[p];
+         if (p == handle->self)
+            continue;
+
+         handle->buffer[0].used_real[p] = true;
+         handle->buffer[0].is_simulated[p] = false;
+         handle->buffer[0].real_input_state[p] = 0;
+         observe_input(player, 0);
+         player->read_ptr = NEXT_PTR(player->read_ptr);
+         player->read_frame_count++;
+      }
       return true;
    }
 
    // We might have reached the end of the buffer, where we simply have to block.
-   int res = poll_input(handle, handle->other_ptr == handle->self_ptr);
+   int res = poll_input(handle, netplay_buffer_full(handle));
    if (res == -1)
    {
       handle->has_connection = false;
@@ -1001,83 +1942,264 @@ static bool netplay_poll(netplay_t *handle)
 
    if (res == 1)
    {
-      uint32_t first_read = handle->read_frame_count;
-      do 
+      // The host drains every packet, as other clients wait for it to pass them on.
+      uint32_t first_read = netplay_read_frame_count(handle);
+      do
       {
-         uint32_t buffer[UDP_FRAME_PACKETS * 2];
-         if (!receive_data(handle, buffer, sizeof(buffer)))
+         if (!receive_packet(handle))
          {
             warn_hangup();
             handle->has_connection = false;
             return false;
          }
-         parse_packet(handle, buffer, UDP_FRAME_PACKETS);
-
-      } while ((handle->read_frame_count <= handle->frame_count) && 
-            poll_input(handle, (handle->other_ptr == handle->self_ptr) && 
-               (first_read == handle->read_frame_count)) == 1);
+      } while ((handle->self == 0 || netplay_wants_input(handle)) &&
+            poll_input(handle, netplay_buffer_full(handle) &&
+               (first_read == netplay_read_frame_count(handle))) == 1);
    }
    else
    {
       // Cannot allow this. Should not happen though.
-      if (handle->self_ptr == handle->other_ptr)
+      if (netplay_buffer_full(handle))
       {
          warn_hangup();
          return false;
       }
    }
 
-   if (handle->read_ptr != handle->self_ptr)
-      simulate_input(handle);
-   else
-      handle->buffer[PREV_PTR(handle->self_ptr)].used_real = true;
-
+   netplay_prepare_input(handle, PREV_PTR(handle->self_ptr), handle->frame_count);
    return true;
 }
 
-static bool netplay_send_cmd(netplay_t *handle, uint32_t cmd, const void *data, size_t size)
+static bool netplay_send_cmd(netplay_t *handle, struct netplay_peer *peer, uint32_t cmd, const void *data, size_t size)
 {
+   (void)handle;
    cmd = (cmd << 16) | (size & 0xffff);
    cmd = htonl(cmd);
 
-   if (!send_all(handle->fd, &cmd, sizeof(cmd)))
+   if (!send_all(peer->fd, &cmd, sizeof(cmd)))
       return false;
 
-   if (!send_all(handle->fd, data, size))
+   if (!send_all(peer->fd, data, size))
       return false;
 
    return true;
 }
 
-static bool netplay_cmd_ack(netplay_t *handle)
+// Buffers for state transfers, which only happen on a desync.
+static bool alloc_resync(netplay_t *handle)
+{
+   if (!handle->resync_data)
+   {
+#ifdef HAVE_ZLIB_DEFLATE
+      handle->resync_data = malloc(compressBound(handle->state_size));
+#else
+      handle->resync_data = malloc(handle->state_size);
+#endif
+   }
+
+   if (!handle->resync_state)
+      handle->resync_state = malloc(handle->state_size);
+
+   return handle->resync_data && handle->resync_state;
+}
+
+// Both checksums of a frame are in. The host compares with every client, clients only with the host.
+static void netplay_compare_crc(netplay_t *handle, unsigned index, const struct delta_frame *delta)
+{
+   const struct netplay_remote_crc *remote = &delta->remote_crc[index];
+   struct netplay_peer *peer = &handle->peers[index];
+
+   if (!delta->has_crc || !remote->valid || delta->crc_frame != remote->frame)
+      return;
+
+   // A checksum from before the last state transfer tells us nothing about the states now.
+   if (remote->resyncs != peer->resyncs)
+      return;
+
+   if (delta->crc == remote->crc || peer->desynced)
+      return;
+
+   peer->desynced = true;
+   handle->stats.desyncs++;
+
+   if (handle->self == 0)
+   {
+      RARCH_WARN("Netplay desync with player %u detected on frame %u.\n", peer->player + 1, delta->crc_frame);
+      msg_queue_push(g_extern.msg_queue, "Netplay desync detected. Sending state to client.", 1, 180);
+   }
+   else
+   {
+      RARCH_WARN("Netplay desync detected on frame %u.\n", delta->crc_frame);
+      msg_queue_push(g_extern.msg_queue, "Netplay desync detected. Waiting for state from host.", 1, 180);
+   }
+}
+
+static bool netplay_wants_check(netplay_t *handle, uint32_t frame)
+{
+   return handle->check_frames && frame >= handle->check_frame && frame % handle->check_frames == 0;
+}
+
+// State for frame is in the slot at ptr, and is final, i.e. every input before it is confirmed.
+static void netplay_check_state(netplay_t *handle, size_t ptr, uint32_t frame)
+{
+   unsigned i;
+   struct delta_frame *delta = &handle->buffer[ptr];
+
+   if (!handle->has_connection || !netplay_wants_check(handle, frame))
+      return;
+
+   handle->check_frame = frame + 1;
+   handle->stats.checks++;
+
+   delta->crc = crc32_calculate((const uint8_t*)delta->state, handle->state_size);
+   delta->crc_frame = frame;
+   delta->has_crc = true;
+
+   for (i = 0; i < handle->num_peers; i++)
+   {
+      struct netplay_peer *peer = &handle->peers[i];
+      uint32_t payload[3] = { htonl(frame), htonl(delta->crc), htonl(peer->resyncs) };
+      if (!netplay_send_cmd(handle, peer, NETPLAY_CMD_CRC, payload, sizeof(payload)))
+      {
+         warn_hangup();
+         handle->has_connection = false;
+         return;
+      }
+
+      netplay_compare_crc(handle, i, delta);
+   }
+}
+
+// Host only. Sends the newest state which no longer depends on predicted input.
+static void netplay_send_resync(netplay_t *handle, struct netplay_peer *peer)
+{
+   const void *state = handle->buffer[handle->other_ptr].state;
+   const void *payload = state;
+   uint32_t size = handle->state_size;
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (peer->can_inflate && alloc_resync(handle))
+   {
+      uLongf len = compressBound(handle->state_size);
+      if (compress2((Bytef*)handle->resync_data, &len, (const Bytef*)state, handle->state_size, Z_BEST_SPEED) == Z_OK &&
+            len < handle->state_size)
+      {
+         payload = handle->resync_data;
+         size = len;
+      }
+   }
+#endif
+
+   uint32_t header[4] = {
+      htonl(handle->other_frame_count),
+      htonl(peer->resyncs + 1),
+      htonl(handle->state_size),
+      htonl(size),
+   };
+
+   if (!netplay_send_cmd(handle, peer, NETPLAY_CMD_LOAD_SAVESTATE, header, sizeof(header)) ||
+         !send_all(peer->fd, payload, size))
+   {
+      warn_hangup();
+      handle->has_connection = false;
+      return;
+   }
+
+   peer->resyncs++;
+   peer->desynced = false;
+   handle->stats.resyncs++;
+
+   RARCH_LOG("Netplay: Sent state of frame %u to player %u (%u of %u bytes).\n",
+         handle->other_frame_count, peer->player + 1, size, (unsigned)handle->state_size);
+}
+
+// Client only. Takes a state from the host once we have run up to its frame, and rewinds to it.
+// Returns true if the frames since then have to be replayed.
+static bool netplay_apply_resync(netplay_t *handle)
+{
+   struct netplay_peer *host = &handle->peers[0];
+
+   if (!handle->resync_pending || handle->resync_frame > handle->frame_count)
+      return false;
+
+   handle->resync_pending = false;
+   // Even if we cannot use this state, the host will not look at our checksums from before it.
+   host->resyncs = handle->resync_count;
+
+   // We no longer have the input needed to catch up from it. The next check will ask for another one.
+   if (handle->frame_count - handle->resync_frame > handle->sync_frames + RESYNC_FRAMES)
+   {
+      RARCH_WARN("Netplay: State of frame %u from host arrived too late to be used.\n", handle->resync_frame);
+      return false;
+   }
+
+   size_t ptr = handle->resync_frame % handle->buffer_size;
+   memcpy(handle->buffer[ptr].state, handle->resync_state, handle->state_size);
+   handle->other_ptr = ptr;
+   handle->other_frame_count = handle->resync_frame;
+   handle->check_frame = handle->resync_frame;
+   host->desynced = false;
+   handle->stats.resyncs++;
+
+   RARCH_LOG("Netplay: Loaded state of frame %u from host.\n", handle->resync_frame);
+   msg_queue_push(g_extern.msg_queue, "Netplay state is back in sync with host.", 1, 180);
+
+   if (handle->resync_frame == handle->frame_count)
+   {
+      pretro_unserialize(handle->resync_state, handle->state_size);
+      return false;
+   }
+
+   return true;
+}
+
+static bool netplay_cmd_ack(struct netplay_peer *peer)
 {
    uint32_t cmd = htonl(NETPLAY_CMD_ACK);
-   return send_all(handle->fd, &cmd, sizeof(cmd));
+   return send_all(peer->fd, &cmd, sizeof(cmd));
 }
 
-static bool netplay_cmd_nak(netplay_t *handle)
+static bool netplay_cmd_nak(struct netplay_peer *peer)
 {
    uint32_t cmd = htonl(NETPLAY_CMD_NAK);
-   return send_all(handle->fd, &cmd, sizeof(cmd));
+   return send_all(peer->fd, &cmd, sizeof(cmd));
 }
 
-static bool netplay_get_response(netplay_t *handle)
+static bool netplay_handle_cmd(netplay_t *handle, struct netplay_peer *peer, uint32_t cmd);
+
+static bool netplay_get_response(netplay_t *handle, struct netplay_peer *peer)
 {
-   uint32_t response;
-   if (!recv_all(handle->fd, &response, sizeof(response)))
-      return false;
+   for (;;)
+   {
+      uint32_t response;
+      if (!recv_all(peer->fd, &response, sizeof(response)))
+         return false;
 
-   return ntohl(response) == NETPLAY_CMD_ACK;
+      response = ntohl(response);
+
+      // The other side may have sent a command of its own (e.g. a checksum) before responding.
+      if (response >> 16)
+      {
+         if (!netplay_handle_cmd(handle, peer, response))
+            return false;
+         continue;
+      }
+
+      return response == NETPLAY_CMD_ACK;
+   }
 }
 
-static bool netplay_get_cmd(netplay_t *handle)
+static bool netplay_get_cmd(netplay_t *handle, struct netplay_peer *peer)
 {
    uint32_t cmd;
-   if (!recv_all(handle->fd, &cmd, sizeof(cmd)))
+   if (!recv_all(peer->fd, &cmd, sizeof(cmd)))
       return false;
 
-   cmd = ntohl(cmd);
+   return netplay_handle_cmd(handle, peer, ntohl(cmd));
+}
 
+static bool netplay_handle_cmd(netplay_t *handle, struct netplay_peer *peer, uint32_t cmd)
+{
    size_t cmd_size = cmd & 0xffff;
    cmd = cmd >> 16;
 
@@ -1085,24 +2207,24 @@ static bool netplay_get_cmd(netplay_t *handle)
    {
       case NETPLAY_CMD_FLIP_PLAYERS:
       {
-         if (cmd_size != sizeof(uint32_t))
+         if (cmd_size != sizeof(uint32_t) || handle->num_players != 2)
          {
-            RARCH_ERR("CMD_FLIP_PLAYERS has unexpected command size.\n");
-            return netplay_cmd_nak(handle);
+            RARCH_ERR("Unexpected CMD_FLIP_PLAYERS.\n");
+            return netplay_cmd_nak(peer);
          }
 
          uint32_t flip_frame;
-         if (!recv_all(handle->fd, &flip_frame, sizeof(flip_frame)))
+         if (!recv_all(peer->fd, &flip_frame, sizeof(flip_frame)))
          {
             RARCH_ERR("Failed to receive CMD_FLIP_PLAYERS argument.\n");
-            return netplay_cmd_nak(handle);
+            return netplay_cmd_nak(peer);
          }
 
          flip_frame = ntohl(flip_frame);
          if (flip_frame < handle->flip_frame)
          {
             RARCH_ERR("Host asked us to flip players in the past. Not possible ...\n");
-            return netplay_cmd_nak(handle);
+            return netplay_cmd_nak(peer);
          }
 
          handle->flip ^= true;
@@ -1111,12 +2233,102 @@ static bool netplay_get_cmd(netplay_t *handle)
          RARCH_LOG("Netplay players are flipped.\n");
          msg_queue_push(g_extern.msg_queue, "Netplay players are flipped.", 1, 180);
 
-         return netplay_cmd_ack(handle);
+         return netplay_cmd_ack(peer);
+      }
+
+      // Checksum commands are not answered, as both sides send them at will.
+      case NETPLAY_CMD_CRC:
+      {
+         uint32_t payload[3];
+         if (cmd_size != sizeof(payload))
+         {
+            RARCH_ERR("CMD_CRC has unexpected command size.\n");
+            return false;
+         }
+
+         if (!recv_all(peer->fd, payload, sizeof(payload)))
+         {
+            RARCH_ERR("Failed to receive CMD_CRC argument.\n");
+            return false;
+         }
+
+         uint32_t frame = ntohl(payload[0]);
+         unsigned index = peer - handle->peers;
+         struct delta_frame *delta = &handle->buffer[frame % handle->buffer_size];
+         struct netplay_remote_crc *remote = &delta->remote_crc[index];
+         remote->frame = frame;
+         remote->crc = ntohl(payload[1]);
+         remote->resyncs = ntohl(payload[2]);
+         remote->valid = true;
+
+         netplay_compare_crc(handle, index, delta);
+         return true;
+      }
+
+      case NETPLAY_CMD_LOAD_SAVESTATE:
+      {
+         uint32_t header[4];
+         if (cmd_size != sizeof(header) || handle->self == 0)
+         {
+            RARCH_ERR("Unexpected CMD_LOAD_SAVESTATE.\n");
+            return false;
+         }
+
+         if (!recv_all(peer->fd, header, sizeof(header)))
+         {
+            RARCH_ERR("Failed to receive CMD_LOAD_SAVESTATE argument.\n");
+            return false;
+         }
+
+         uint32_t state_size = ntohl(header[2]);
+         uint32_t size = ntohl(header[3]);
+#ifdef HAVE_ZLIB_DEFLATE
+         uint32_t max_size = compressBound(handle->state_size);
+#else
+         uint32_t max_size = handle->state_size;
+#endif
+         if (state_size != handle->state_size || size > max_size)
+         {
+            RARCH_ERR("State from host does not fit.\n");
+            return false;
+         }
+
+         if (!alloc_resync(handle))
+         {
+            RARCH_ERR("Failed to allocate state from host.\n");
+            return false;
+         }
+
+         // Uncompressed states go straight into place.
+         if (!recv_all(peer->fd, size == state_size ? handle->resync_state : handle->resync_data, size))
+         {
+            RARCH_ERR("Failed to receive state from host.\n");
+            return false;
+         }
+
+#ifdef HAVE_ZLIB_DEFLATE
+         if (size != state_size)
+         {
+            uLongf len = state_size;
+            if (uncompress((Bytef*)handle->resync_state, &len, (const Bytef*)handle->resync_data, size) != Z_OK ||
+                  len != state_size)
+            {
+               RARCH_ERR("Failed to decompress state from host.\n");
+               return false;
+            }
+         }
+#endif
+
+         // Loaded once the frame is done, so it never happens in the middle of one.
+         handle->resync_frame = ntohl(header[0]);
+         handle->resync_count = ntohl(header[1]);
+         handle->resync_pending = true;
+         return true;
       }
 
       default:
          RARCH_ERR("Unknown netplay command received.\n");
-         return netplay_cmd_nak(handle);
+         return netplay_cmd_nak(peer);
    }
 }
 
@@ -1132,12 +2344,18 @@ void netplay_flip_players(netplay_t *handle)
       goto error;
    }
 
-   if (handle->port == 0)
+   if (handle->self != 0)
    {
       msg = "Cannot flip players if you're not the host.";
       goto error;
    }
 
+   if (handle->num_players != 2)
+   {
+      msg = "Cannot flip players with more than two players.";
+      goto error;
+   }
+
    // Make sure both clients are definitely synced up.
    if (handle->frame_count < (handle->flip_frame + 2 * UDP_FRAME_PACKETS))
    {
@@ -1145,8 +2363,8 @@ void netplay_flip_players(netplay_t *handle)
       goto error;
    }
 
-   if (netplay_send_cmd(handle, NETPLAY_CMD_FLIP_PLAYERS, &flip_frame_net, sizeof(flip_frame_net))
-         && netplay_get_response(handle))
+   if (netplay_send_cmd(handle, &handle->peers[0], NETPLAY_CMD_FLIP_PLAYERS, &flip_frame_net, sizeof(flip_frame_net))
+         && netplay_get_response(handle, &handle->peers[0]))
    {
       RARCH_LOG("Netplay players are flipped.\n");
       msg_queue_push(g_extern.msg_queue, "Netplay players are flipped.", 1, 180);
@@ -1168,9 +2386,9 @@ error:
    msg_queue_push(g_extern.msg_queue, msg, 1, 180);
 }
 
-static bool netplay_flip_port(netplay_t *handle, bool port)
+static unsigned netplay_flip_port(netplay_t *handle, unsigned port)
 {
-   if (handle->flip_frame == 0)
+   if (handle->flip_frame == 0 || port > 1)
       return port;
 
    size_t frame = handle->is_replay ? handle->tmp_frame_count : handle->frame_count;
@@ -1178,53 +2396,52 @@ static bool netplay_flip_port(netplay_t *handle, bool port)
    return port ^ handle->flip ^ (frame < handle->flip_frame);
 }
 
-int16_t netplay_input_state(netplay_t *handle, bool port, unsigned device, unsigned index, unsigned id)
+int16_t netplay_input_state(netplay_t *handle, unsigned port, unsigned device, unsigned index, unsigned id)
 {
    uint16_t input_state = 0;
    size_t ptr = handle->is_replay ? handle->tmp_ptr : PREV_PTR(handle->self_ptr);
+   const struct delta_frame *delta = &handle->buffer[ptr];
 
    port = netplay_flip_port(handle, port);
+   if (port >= handle->num_players)
+      return 0;
 
-   if ((port ? 1 : 0) == handle->port)
-   {
-      if (handle->buffer[ptr].is_simulated)
-         input_state = handle->buffer[ptr].simulated_input_state;
-      else
-         input_state = handle->buffer[ptr].real_input_state;
-   }
+   if (port != handle->self && delta->is_simulated[port])
+      input_state = delta->simulated_input_state[port];
    else
-      input_state = handle->buffer[ptr].self_state;
+      input_state = delta->real_input_state[port];
 
    return ((1 << id) & input_state) ? 1 : 0;
 }
 
 void netplay_free(netplay_t *handle)
 {
-   unsigned i;
-   close(handle->fd);
-
-   if (handle->spectate)
+   if (!handle->spectate)
    {
-      for (i = 0; i < MAX_SPECTATORS; i++)
-         if (handle->spectate_fds[i] >= 0)
-            close(handle->spectate_fds[i]);
-
-      free(handle->spectate_input);
-   }
-   else
-   {
-      close(handle->udp_fd);
+      RARCH_LOG("Netplay: %llu rollbacks, %llu frames replayed, %llu savestates skipped during replay.\n",
+            (unsigned long long)handle->stats.rollbacks,
+            (unsigned long long)handle->stats.replayed_frames,
+            (unsigned long long)handle->stats.skipped_serializes);
 
-      for (i = 0; i < handle->buffer_size; i++)
-         free(handle->buffer[i].state);
+      if (handle->stats.predictions)
+      {
+         RARCH_LOG("Netplay input prediction (%s): %.1f%% of %llu guesses were right.\n",
+               handle->predictor->ident,
+               100.0 * handle->stats.predictions_hit / handle->stats.predictions,
+               (unsigned long long)handle->stats.predictions);
+      }
 
-      free(handle->buffer);
+      if (handle->check_frames)
+      {
+         RARCH_LOG("Netplay: %llu state checks, %llu desyncs detected, %llu states %s.\n",
+               (unsigned long long)handle->stats.checks,
+               (unsigned long long)handle->stats.desyncs,
+               (unsigned long long)handle->stats.resyncs,
+               handle->self == 0 ? "sent" : "loaded");
+      }
    }
 
-   if (handle->addr)
-      freeaddrinfo(handle->addr);
-
-   free(handle);
+   netplay_close_handle(handle);
 }
 
 static bool netplay_should_skip(netplay_t *handle)
@@ -1234,7 +2451,16 @@ static bool netplay_should_skip(netplay_t *handle)
 
 static void netplay_pre_frame_net(netplay_t *handle)
 {
+   unsigned i;
    pretro_serialize(handle->buffer[handle->self_ptr].state, handle->state_size);
+
+   if (handle->self == 0)
+   {
+      for (i = 0; i < handle->num_peers && handle->has_connection; i++)
+         if (handle->peers[i].desynced)
+            netplay_send_resync(handle, &handle->peers[i]);
+   }
+
    handle->can_poll = true;
 
    input_poll_net();
@@ -1281,89 +2507,221 @@ int16_t input_state_spectate_client(unsigned port, unsigned device, unsigned ind
    return netplay_get_spectate_input(g_extern.netplay, port, device, index, id);
 }
 
-static void netplay_pre_frame_spectate(netplay_t *handle)
+// Appends data to what we still have to send a spectator.
+static bool spectator_queue(struct netplay_spectator *spectator, const void *data, size_t size)
 {
-   unsigned i;
-   if (handle->spectate_client)
-      return;
+   if (spectator->queue_size + size > spectator->queue_cap && spectator->queue_ptr)
+   {
+      memmove(spectator->queue, spectator->queue + spectator->queue_ptr,
+            spectator->queue_size - spectator->queue_ptr);
+      spectator->queue_size -= spectator->queue_ptr;
+      spectator->queue_ptr = 0;
+   }
 
-   fd_set fds;
-   FD_ZERO(&fds);
-   FD_SET(handle->fd, &fds);
+   if (spectator->queue_size + size > spectator->queue_cap)
+   {
+      size_t cap = spectator->queue_cap * 2;
+      if (cap < spectator->queue_size + size)
+         cap = spectator->queue_size + size;
 
-   struct timeval tmp_tv = {0};
-   if (select(handle->fd + 1, &fds, NULL, NULL, &tmp_tv) <= 0)
-      return;
+      uint8_t *queue = (uint8_t*)realloc(spectator->queue, cap);
+      if (!queue)
+         return false;
 
-   if (!FD_ISSET(handle->fd, &fds))
-      return;
+      spectator->queue = queue;
+      spectator->queue_cap = cap;
+   }
 
-   struct sockaddr_storage their_addr;
-   socklen_t addr_size = sizeof(their_addr);
-   int new_fd = accept(handle->fd, (struct sockaddr*)&their_addr, &addr_size);
-   if (new_fd < 0)
+   memcpy(spectator->queue + spectator->queue_size, data, size);
+   spectator->queue_size += size;
+   return true;
+}
+
+// Sends as much of the queue as the socket takes right now. Returns false if the spectator is gone.
+static bool spectator_flush(struct netplay_spectator *spectator)
+{
+   while (spectator->queue_ptr < spectator->queue_size)
    {
-      RARCH_ERR("Failed to accept incoming spectator.\n");
-      return;
+      ssize_t ret = send(spectator->fd, CONST_CAST (spectator->queue + spectator->queue_ptr),
+            spectator->queue_size - spectator->queue_ptr, 0);
+      if (ret < 0)
+         return socket_would_block();
+      if (ret == 0)
+         return false;
+
+      spectator->queue_ptr += ret;
    }
 
-   int index = -1;
-   for (i = 0; i < MAX_SPECTATORS; i++)
+   spectator->queue_ptr = spectator->queue_size = 0;
+   return true;
+}
+
+static void remove_spectator(netplay_t *handle, struct netplay_spectator *spectator, const char *reason)
+{
+   RARCH_LOG("Client (#%u) %s ...\n", spectator->id, reason);
+
+   char msg[512];
+   snprintf(msg, sizeof(msg), "Client (#%u) %s.", spectator->id, reason);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+
+   poller_remove(&handle->poller, spectator->fd);
+   close(spectator->fd);
+
+   handle->spectators[spectator->index] = handle->spectators[--handle->num_spectators];
+   handle->spectators[spectator->index]->index = spectator->index;
+
+   free(spectator->queue);
+   free(spectator);
+}
+
+static void accept_spectators(netplay_t *handle)
+{
+   for (;;)
    {
-      if (handle->spectate_fds[i] == -1)
+      struct sockaddr_storage their_addr;
+      socklen_t addr_size = sizeof(their_addr);
+      int new_fd = accept(handle->fd, (struct sockaddr*)&their_addr, &addr_size);
+      if (new_fd < 0)
       {
-         index = i;
-         break;
+         if (!socket_would_block())
+            RARCH_ERR("Failed to accept incoming spectator.\n");
+         return;
       }
-   }
 
-   // No vacant client streams :(
-   if (index == -1)
-   {
-      close(new_fd);
-      return;
+      if (handle->num_spectators >= handle->spectators_cap)
+      {
+         size_t cap = handle->spectators_cap ? handle->spectators_cap * 2 : 16;
+         struct netplay_spectator **spectators = (struct netplay_spectator**)
+            realloc(handle->spectators, cap * sizeof(*spectators));
+         if (!spectators)
+         {
+            close(new_fd);
+            return;
+         }
+
+         handle->spectators = spectators;
+         handle->spectators_cap = cap;
+      }
+
+      struct netplay_spectator *spectator = (struct netplay_spectator*)calloc(1, sizeof(*spectator));
+      if (!spectator || !socket_nonblock(new_fd) ||
+            !poller_add(&handle->poller, new_fd, spectator))
+      {
+         RARCH_ERR("Failed to set up incoming spectator.\n");
+         free(spectator);
+         close(new_fd);
+         return;
+      }
+
+      spectator->fd = new_fd;
+      spectator->id = handle->spectator_ids++;
+      spectator->index = handle->num_spectators;
+      spectator->addr = their_addr;
+      handle->spectators[handle->num_spectators++] = spectator;
    }
+}
 
-   if (!get_nickname(handle, new_fd))
+// Reads the nickname of a new spectator as far as it arrived.
+// Once all of it is in, the spectator gets our nickname and a save state to start from.
+// The save state is generated once for everyone who joins on this frame.
+static bool spectator_read_nick(netplay_t *handle, struct netplay_spectator *spectator,
+      uint32_t **header, size_t *header_size)
+{
+   for (;;)
    {
-      RARCH_ERR("Failed to get nickname from client.\n");
-      close(new_fd);
-      return;
+      size_t want = 1;
+      if (spectator->nick_size)
+      {
+         if (spectator->nick[0] >= sizeof(spectator->nick) - 1)
+         {
+            RARCH_ERR("Invalid nick size.\n");
+            return false;
+         }
+         want += spectator->nick[0];
+      }
+
+      if (spectator->nick_size == want)
+         break;
+
+      ssize_t ret = recv(spectator->fd, NONCONST_CAST (spectator->nick + spectator->nick_size),
+            want - spectator->nick_size, 0);
+      if (ret < 0)
+         return socket_would_block();
+      if (ret == 0)
+         return false;
+
+      spectator->nick_size += ret;
    }
 
-   if (!send_nickname(handle, new_fd))
+   char nick[sizeof(spectator->nick)];
+   memcpy(nick, spectator->nick + 1, spectator->nick[0]);
+   nick[spectator->nick[0]] = '\0';
+
+   if (!*header)
    {
-      RARCH_ERR("Failed to send nickname to client.\n");
-      close(new_fd);
-      return;
+      *header = bsv_header_generate(header_size, implementation_magic_value());
+      if (!*header)
+      {
+         RARCH_ERR("Failed to generate BSV header.\n");
+         return false;
+      }
    }
 
-   size_t header_size;
-   uint32_t *header = bsv_header_generate(&header_size, implementation_magic_value());
-   if (!header)
+   uint8_t nick_size = strlen(handle->nick);
+   if (!spectator_queue(spectator, &nick_size, sizeof(nick_size)) ||
+         !spectator_queue(spectator, handle->nick, nick_size) ||
+         !spectator_queue(spectator, *header, *header_size))
    {
-      RARCH_ERR("Failed to generate BSV header.\n");
-      close(new_fd);
-      return;
+      RARCH_ERR("Failed to queue header for client.\n");
+      return false;
    }
 
-   int bufsize = header_size;
-   setsockopt(new_fd, SOL_SOCKET, SO_SNDBUF, CONST_CAST &bufsize, sizeof(int));
+   int bufsize = *header_size;
+   setsockopt(spectator->fd, SOL_SOCKET, SO_SNDBUF, CONST_CAST &bufsize, sizeof(int));
 
-   if (!send_all(new_fd, header, header_size))
-   {
-      RARCH_ERR("Failed to send header to client.\n");
-      close(new_fd);
-      free(header);
+   spectator->streaming = true;
+   spectator->backlog_limit = spectator->queue_size + MAX_SPECTATOR_BACKLOG;
+
+#ifndef HAVE_SOCKET_LEGACY
+   log_connection(&spectator->addr, spectator->id, nick);
+#endif
+
+   return spectator_flush(spectator);
+}
+
+static void netplay_pre_frame_spectate(netplay_t *handle)
+{
+   int i;
+   void *ready[64];
+   uint32_t *header = NULL;
+   size_t header_size = 0;
+
+   if (handle->spectate_client)
       return;
+
+   int count = poller_wait(&handle->poller, 0, ready, ARRAY_SIZE(ready));
+   for (i = 0; i < count; i++)
+   {
+      if (ready[i] == &handle->fd)
+      {
+         accept_spectators(handle);
+         continue;
+      }
+
+      struct netplay_spectator *spectator = (struct netplay_spectator*)ready[i];
+      if (spectator->streaming)
+      {
+         // Spectators have nothing more to say, so this is them hanging up.
+         char buf[64];
+         ssize_t ret = recv(spectator->fd, NONCONST_CAST buf, sizeof(buf), 0);
+         if (ret == 0 || (ret < 0 && !socket_would_block()))
+            remove_spectator(handle, spectator, "disconnected");
+      }
+      else if (!spectator_read_nick(handle, spectator, &header, &header_size))
+         remove_spectator(handle, spectator, "disconnected");
    }
 
    free(header);
-   handle->spectate_fds[index] = new_fd;
-
-#ifndef HAVE_SOCKET_LEGACY
-   log_connection(&their_addr, index, handle->other_nick);
-#endif
 }
 
 void netplay_pre_frame(netplay_t *handle)
@@ -1378,32 +2736,64 @@ static void netplay_post_frame_net(netplay_t *handle)
 {
    handle->frame_count++;
 
+   // Input that arrived ahead of time, for frames we have yet to run, confirms nothing yet.
+   uint32_t confirmed = netplay_read_frame_count(handle);
+   if (confirmed > handle->frame_count)
+      confirmed = handle->frame_count;
+
+   bool resync = netplay_apply_resync(handle);
+
    // Nothing to do...
-   if (handle->other_frame_count == handle->read_frame_count)
+   if (!resync && handle->other_frame_count == confirmed)
       return;
 
    // Skip ahead if we predicted correctly. Skip until our simulation failed.
-   while (handle->other_frame_count < handle->read_frame_count)
+   while (!resync && handle->other_frame_count < confirmed)
    {
-      const struct delta_frame *ptr = &handle->buffer[handle->other_ptr];
-      if ((ptr->simulated_input_state != ptr->real_input_state) && !ptr->used_real)
+      netplay_check_state(handle, handle->other_ptr, handle->other_frame_count);
+      if (netplay_mispredicted(handle, &handle->buffer[handle->other_ptr]))
          break;
       handle->other_ptr = NEXT_PTR(handle->other_ptr);
       handle->other_frame_count++;
    }
 
-   if (handle->other_frame_count < handle->read_frame_count)
+   if (resync || handle->other_frame_count < confirmed)
    {
+      // A state from the host may be ahead of the input we have confirmed.
+      if (handle->other_frame_count > confirmed)
+         confirmed = handle->other_frame_count;
+
       // Replay frames
+      size_t confirmed_ptr = handle->self_ptr;
       handle->is_replay = true;
       handle->tmp_ptr = handle->other_ptr;
       handle->tmp_frame_count = handle->other_frame_count;
+      handle->stats.rollbacks++;
 
       pretro_unserialize(handle->buffer[handle->other_ptr].state, handle->state_size);
       bool first = true;
       while (first || (handle->tmp_ptr != handle->self_ptr))
       {
-         pretro_serialize(handle->buffer[handle->tmp_ptr].state, handle->state_size);
+         // We will never roll back to a frame before the first one still predicted,
+         // so there is no point in saving state for those, unless we are to checksum it.
+         bool check = handle->tmp_frame_count <= confirmed &&
+            netplay_wants_check(handle, handle->tmp_frame_count);
+
+         if (handle->tmp_frame_count >= confirmed || check)
+         {
+            if (handle->tmp_frame_count == confirmed)
+               confirmed_ptr = handle->tmp_ptr;
+            pretro_serialize(handle->buffer[handle->tmp_ptr].state, handle->state_size);
+         }
+         else
+            handle->stats.skipped_serializes++;
+
+         if (check)
+            netplay_check_state(handle, handle->tmp_ptr, handle->tmp_frame_count);
+
+         // Frames still to be confirmed get a fresh guess, now that we know more.
+         netplay_prepare_input(handle, handle->tmp_ptr, handle->tmp_frame_count);
+
 #if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
          lock_autosave();
 #endif
@@ -1413,39 +2803,47 @@ static void netplay_post_frame_net(netplay_t *handle)
 #endif
          handle->tmp_ptr = NEXT_PTR(handle->tmp_ptr);
          handle->tmp_frame_count++;
+         handle->stats.replayed_frames++;
          first = false;
       }
 
-      handle->other_ptr = handle->read_ptr;
-      handle->other_frame_count = handle->read_frame_count;
+      handle->other_ptr = confirmed_ptr;
+      handle->other_frame_count = confirmed;
       handle->is_replay = false;
    }
 }
 
 static void netplay_post_frame_spectate(netplay_t *handle)
 {
-   unsigned i;
+   size_t i;
    if (handle->spectate_client)
       return;
 
-   for (i = 0; i < MAX_SPECTATORS; i++)
+   for (i = 0; i < handle->num_spectators; )
    {
-      if (handle->spectate_fds[i] == -1)
-         continue;
+      struct netplay_spectator *spectator = handle->spectators[i];
 
-      if (!send_all(handle->spectate_fds[i],
+      if (spectator->streaming && !spectator_queue(spectator,
                handle->spectate_input, handle->spectate_input_ptr * sizeof(int16_t)))
       {
-         RARCH_LOG("Client (#%u) disconnected ...\n", i);
+         remove_spectator(handle, spectator, "disconnected");
+         continue;
+      }
 
-         char msg[512];
-         snprintf(msg, sizeof(msg), "Client (#%u) disconnected.", i);
-         msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+      if (!spectator_flush(spectator))
+      {
+         remove_spectator(handle, spectator, "disconnected");
+         continue;
+      }
 
-         close(handle->spectate_fds[i]);
-         handle->spectate_fds[i] = -1;
-         break;
+      // Rather than stall everyone else, we drop those who cannot keep up.
+      if (spectator->queue_size - spectator->queue_ptr > spectator->backlog_limit)
+      {
+         remove_spectator(handle, spectator, "fell too far behind and was disconnected");
+         continue;
       }
+
+      i++;
    }
 
    handle->spectate_input_ptr = 0;
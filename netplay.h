@@ -44,8 +44,11 @@ struct retro_callbacks
 bool netplay_init_network(void);
 
 // Creates a new netplay handle. A NULL host means we're hosting (player 1). :)
+// frames is how far we may run ahead of the other player's input, rolling back when we guessed it wrong.
+// input_delay holds back local input for that many frames, so it is mispredicted less often on the other end.
+// players is how many players (2 to MAX_PLAYERS) the host waits for. Clients get it from the host.
 netplay_t *netplay_new(const char *server,
-      uint16_t port, unsigned frames,
+      uint16_t port, unsigned frames, unsigned input_delay, unsigned players,
       const struct retro_callbacks *cb, bool spectate,
       const char *nick);
 void netplay_free(netplay_t *handle);
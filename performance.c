@@ -68,6 +68,7 @@
 #endif
 
 #include <string.h>
+#include <errno.h>
 
 #define MAX_COUNTERS 64
 static const struct retro_perf_counter *perf_counters_rarch[MAX_COUNTERS];
@@ -203,6 +204,27 @@ retro_time_t rarch_get_time_usec(void)
 #endif
 }
 
+#if defined(_POSIX_MONOTONIC_CLOCK) && defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0) && \
+   !defined(_WIN32) && !defined(__CELLOS_LV2__) && !defined(GEKKO) && !defined(__MACH__) && \
+   !defined(EMSCRIPTEN) && !defined(ANDROID)
+#define HAVE_CLOCK_NANOSLEEP
+#endif
+
+void rarch_sleep_until_usec(retro_time_t target)
+{
+#ifdef HAVE_CLOCK_NANOSLEEP
+   // Same clock as rarch_get_time_usec(), so the target can be passed on as is.
+   struct timespec tv;
+   tv.tv_sec = target / 1000000;
+   tv.tv_nsec = (target % 1000000) * 1000;
+   while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tv, NULL) == EINTR);
+#else
+   retro_time_t to_sleep_ms = (target - rarch_get_time_usec()) / 1000;
+   if (to_sleep_ms > 0)
+      rarch_sleep((unsigned)to_sleep_ms);
+#endif
+}
+
 #if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
 #define CPU_X86
 #endif
@@ -225,14 +247,15 @@ static void x86_cpuid(int func, int flags[4])
 #endif
 
 #if defined(__GNUC__)
+   // Sub-leaf (ecx) is always 0. Leaf 7 (extended features) needs it set explicitly.
    asm volatile (
          "mov %%" REG_b ", %%" REG_S "\n"
          "cpuid\n"
          "xchg %%" REG_b ", %%" REG_S "\n"
          : "=a"(flags[0]), "=S"(flags[1]), "=c"(flags[2]), "=d"(flags[3])
-         : "a"(func));
+         : "a"(func), "c"(0));
 #elif defined(_MSC_VER)
-   __cpuid(flags, func);
+   __cpuidex(flags, func, 0);
 #else
    RARCH_WARN("Unknown compiler. Cannot check CPUID with inline assembly.\n");
    memset(flags, 0, 4 * sizeof(int));
@@ -277,6 +300,20 @@ static void arm_enable_runfast_mode(void)
 }
 #endif
 
+unsigned rarch_get_cpu_cores(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   SYSTEM_INFO sysinfo;
+   GetSystemInfo(&sysinfo);
+   return sysinfo.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   return cores > 0 ? (unsigned)cores : 1;
+#else
+   return 1;
+#endif
+}
+
 uint64_t rarch_get_cpu_features(void)
 {
    uint64_t cpu = 0;
@@ -284,6 +321,7 @@ uint64_t rarch_get_cpu_features(void)
 #if defined(CPU_X86)
    int flags[4];
    x86_cpuid(0, flags);
+   int max_flag = flags[0];
 
    char vendor[13] = {0};
    const int vendor_shuffle[3] = { flags[1], flags[3], flags[2] };
@@ -310,17 +348,34 @@ uint64_t rarch_get_cpu_features(void)
    if (flags[2] & (1 << 9))
       cpu |= RETRO_SIMD_SSSE3;
 
+   if (flags[2] & (1 << 19))
+      cpu |= RETRO_SIMD_SSE4;
+
+   if (flags[2] & (1 << 20))
+      cpu |= RETRO_SIMD_SSE42;
+
    const int avx_flags = (1 << 27) | (1 << 28);
    // Must only perform xgetbv check if we have AVX CPU support (guaranteed to have at least i686).
    if (((flags[2] & avx_flags) == avx_flags) && ((xgetbv_x86(0) & 0x6) == 0x6))
       cpu |= RETRO_SIMD_AVX;
 
+   // AVX2 lives in extended features (leaf 7), and needs the same OS support as AVX.
+   if ((cpu & RETRO_SIMD_AVX) && max_flag >= 7)
+   {
+      x86_cpuid(7, flags);
+      if (flags[1] & (1 << 5))
+         cpu |= RETRO_SIMD_AVX2;
+   }
+
    RARCH_LOG("[CPUID]: MMX:   %u\n", !!(cpu & RETRO_SIMD_MMX));
    RARCH_LOG("[CPUID]: SSE:   %u\n", !!(cpu & RETRO_SIMD_SSE));
    RARCH_LOG("[CPUID]: SSE2:  %u\n", !!(cpu & RETRO_SIMD_SSE2));
    RARCH_LOG("[CPUID]: SSE3:  %u\n", !!(cpu & RETRO_SIMD_SSE3));
    RARCH_LOG("[CPUID]: SSSE3: %u\n", !!(cpu & RETRO_SIMD_SSSE3));
+   RARCH_LOG("[CPUID]: SSE4:  %u\n", !!(cpu & RETRO_SIMD_SSE4));
+   RARCH_LOG("[CPUID]: SSE42: %u\n", !!(cpu & RETRO_SIMD_SSE42));
    RARCH_LOG("[CPUID]: AVX:   %u\n", !!(cpu & RETRO_SIMD_AVX));
+   RARCH_LOG("[CPUID]: AVX2:  %u\n", !!(cpu & RETRO_SIMD_AVX2));
 #elif defined(ANDROID) && defined(ANDROID_ARM)
    uint64_t cpu_flags = android_getCpuFeatures();
    (void)cpu_flags;
@@ -35,6 +35,9 @@ extern "C" {
 
 retro_perf_tick_t rarch_get_perf_counter(void);
 retro_time_t rarch_get_time_usec(void);
+// Sleeps until rarch_get_time_usec() reaches target.
+// Sub-millisecond where the platform has an absolute monotonic sleep, whole milliseconds otherwise.
+void rarch_sleep_until_usec(retro_time_t target);
 void rarch_perf_register(struct retro_perf_counter *perf);
 void retro_perf_register(struct retro_perf_counter *perf); // Same as rarch_perf_register, just for libretro cores.
 void retro_perf_clear(void);
@@ -53,6 +56,20 @@ static inline void rarch_perf_stop(struct retro_perf_counter *perf)
 }
 
 uint64_t rarch_get_cpu_features(void);
+// Number of CPU cores online. 1 if it cannot be determined.
+unsigned rarch_get_cpu_cores(void);
+
+// Lets x86 kernels for newer instruction sets be built into a baseline binary,
+// and be picked at runtime based on rarch_get_cpu_features().
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+   (defined(__clang__) || (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define RARCH_HAVE_TARGET_SSE4
+#define RARCH_TARGET_SSE4 __attribute__((target("sse4.1")))
+#define RARCH_HAVE_TARGET_AVX
+#define RARCH_TARGET_AVX __attribute__((target("avx")))
+#define RARCH_HAVE_TARGET_AVX2
+#define RARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 // Used internally by RetroArch.
 #if defined(PERF_TEST) || !defined(RARCH_INTERNAL)
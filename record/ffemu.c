@@ -36,7 +36,7 @@ extern "C" {
 #include <stdio.h>
 #include <stdlib.h>
 #include "../boolean.h"
-#include "../fifo_buffer.h"
+#include "../spsc_fifo.h"
 #include "../thread.h"
 #include "../general.h"
 #include "../gfx/scaler/scaler.h"
@@ -159,16 +159,13 @@ struct ffemu
    
    struct ffemu_params params;
 
-   scond_t *cond;
-   slock_t *cond_lock;
-   slock_t *lock;
-   fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
+   // All fifos share their wait state, so the encoder thread can sleep until either audio or video arrives.
+   spsc_fifo_t *audio_fifo;
+   spsc_fifo_t *video_fifo;
+   spsc_fifo_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
-   volatile bool can_sleep;
 };
 
 static bool ffemu_codec_has_sample_format(enum AVSampleFormat fmt, const enum AVSampleFormat *fmts)
@@ -252,6 +249,24 @@ static void ffemu_audio_resolve_sample_rate(ffemu_t *handle, const AVCodec *code
    }
 }
 
+// Channels past stereo follow the libretro order (FL, FR, C, LFE, BL, BR, SL, SR).
+static uint64_t ffemu_channel_layout(unsigned channels)
+{
+   static const uint64_t layout[] = {
+      AV_CH_FRONT_LEFT, AV_CH_FRONT_RIGHT, AV_CH_FRONT_CENTER, AV_CH_LOW_FREQUENCY,
+      AV_CH_BACK_LEFT, AV_CH_BACK_RIGHT, AV_CH_SIDE_LEFT, AV_CH_SIDE_RIGHT,
+   };
+
+   if (channels < 2)
+      return AV_CH_LAYOUT_MONO;
+
+   uint64_t ret = 0;
+   unsigned i;
+   for (i = 0; i < channels && i < sizeof(layout) / sizeof(layout[0]); i++)
+      ret |= layout[i];
+   return ret;
+}
+
 static bool ffemu_init_audio(ffemu_t *handle)
 {
    struct ff_config_param *params = &handle->config;
@@ -271,7 +286,7 @@ static bool ffemu_init_audio(ffemu_t *handle)
 
    audio->codec->codec_type     = AVMEDIA_TYPE_AUDIO;
    audio->codec->channels       = param->channels;
-   audio->codec->channel_layout = param->channels > 1 ? AV_CH_LAYOUT_STEREO : AV_CH_LAYOUT_MONO;
+   audio->codec->channel_layout = ffemu_channel_layout(param->channels);
 
    ffemu_audio_resolve_format(audio, codec);
    ffemu_audio_resolve_sample_rate(handle, codec);
@@ -285,7 +300,7 @@ static bool ffemu_init_audio(ffemu_t *handle)
       rarch_resampler_realloc(&audio->resampler_data,
             &audio->resampler,
             *g_settings.audio.resampler ? g_settings.audio.resampler : NULL,
-            audio->ratio);
+            audio->ratio, param->channels);
    }
    else
    {
@@ -558,21 +573,16 @@ static void ffemu_thread(void *data);
 
 static bool init_thread(ffemu_t *handle)
 {
-   handle->lock = slock_new();
-   handle->cond_lock = slock_new();
-   handle->cond = scond_new();
-   handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) * handle->params.channels * MAX_FRAMES / 60); // Some arbitrary max size.
-   handle->attr_fifo = fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+   handle->audio_fifo = spsc_fifo_new(32000 * sizeof(int16_t) * handle->params.channels * MAX_FRAMES / 60, NULL); // Some arbitrary max size.
+   assert(handle->audio_fifo);
+   handle->attr_fifo = spsc_fifo_new(sizeof(struct ffemu_video_data) * MAX_FRAMES, handle->audio_fifo);
+   handle->video_fifo = spsc_fifo_new(handle->params.fb_width * handle->params.fb_height *
+            handle->video.pix_size * MAX_FRAMES, handle->audio_fifo);
 
    handle->alive = true;
-   handle->can_sleep = true;
    handle->thread = sthread_create(ffemu_thread, handle);
 
-   assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   assert(handle->attr_fifo && handle->video_fifo && handle->thread);
 
    return true;
 }
@@ -582,18 +592,10 @@ static void deinit_thread(ffemu_t *handle)
    if (!handle->thread)
       return;
 
-   slock_lock(handle->cond_lock);
    handle->alive = false;
-   handle->can_sleep = false;
-   slock_unlock(handle->cond_lock);
-
-   scond_signal(handle->cond);
+   spsc_fifo_shutdown(handle->audio_fifo);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
-
    handle->thread = NULL;
 }
 
@@ -601,19 +603,19 @@ static void deinit_thread_buf(ffemu_t *handle)
 {
    if (handle->audio_fifo)
    {
-      fifo_free(handle->audio_fifo);
+      spsc_fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
    
    if (handle->attr_fifo)
    {
-      fifo_free(handle->attr_fifo);
+      spsc_fifo_free(handle->attr_fifo);
       handle->attr_fifo = NULL;
    }
 
    if (handle->video_fifo)
    {
-      fifo_free(handle->video_fifo);
+      spsc_fifo_free(handle->video_fifo);
       handle->video_fifo = NULL;
    }
 }
@@ -710,32 +712,8 @@ bool ffemu_push_video(ffemu_t *handle, const struct ffemu_video_data *data)
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      slock_lock(handle->lock);
-      unsigned avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
-
-      if (!handle->alive)
-         return false;
-
-      if (avail >= sizeof(*data))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
-   }
-
-   slock_lock(handle->lock);
+   if (!spsc_fifo_wait_write_avail(handle->attr_fifo, sizeof(*data)) || !handle->alive)
+      return false;
 
    // Tightly pack our frame to conserve memory. libretro tends to use a very large pitch.
    struct ffemu_video_data attr_data = *data;
@@ -745,49 +723,23 @@ bool ffemu_push_video(ffemu_t *handle, const struct ffemu_video_data *data)
    else
       attr_data.pitch = attr_data.width * handle->video.pix_size;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
-
+   // Video data must be in place before the encoder thread can see its attributes.
    int offset = 0;
    for (y = 0; y < attr_data.height; y++, offset += data->pitch)
-      fifo_write(handle->video_fifo, (const uint8_t*)data->data + offset, attr_data.pitch);
+      spsc_fifo_write(handle->video_fifo, (const uint8_t*)data->data + offset, attr_data.pitch);
 
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   spsc_fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
 
    return true;
 }
 
 bool ffemu_push_audio(ffemu_t *handle, const struct ffemu_audio_data *data)
 {
-   for (;;)
-   {
-      slock_lock(handle->lock);
-      unsigned avail = fifo_write_avail(handle->audio_fifo);
-      slock_unlock(handle->lock);
-
-      if (!handle->alive)
-         return false;
-
-      if (avail >= data->frames * handle->params.channels * sizeof(int16_t))
-         break;
-
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
-      {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
-      }
-      else
-         scond_signal(handle->cond);
-
-      slock_unlock(handle->cond_lock);
-   }
+   size_t size = data->frames * handle->params.channels * sizeof(int16_t);
+   if (!spsc_fifo_wait_write_avail(handle->audio_fifo, size) || !handle->alive)
+      return false;
 
-   slock_lock(handle->lock);
-   fifo_write(handle->audio_fifo, data->data, data->frames * handle->params.channels * sizeof(int16_t));
-   slock_unlock(handle->lock);
-   scond_signal(handle->cond);
+   spsc_fifo_write(handle->audio_fifo, data->data, size);
 
    return true;
 }
@@ -883,24 +835,22 @@ static bool ffemu_push_video_thread(ffemu_t *handle, const struct ffemu_video_da
    return true;
 }
 
-static void planarize_float(float *out, const float *in, size_t frames)
+static void planarize_float(float *out, const float *in, size_t frames, unsigned channels)
 {
    size_t i;
+   unsigned c;
    for (i = 0; i < frames; i++)
-   {
-      out[i] = in[2 * i + 0];
-      out[i + frames] = in[2 * i + 1];
-   }
+      for (c = 0; c < channels; c++)
+         out[i + c * frames] = in[channels * i + c];
 }
 
-static void planarize_s16(int16_t *out, const int16_t *in, size_t frames)
+static void planarize_s16(int16_t *out, const int16_t *in, size_t frames, unsigned channels)
 {
    size_t i;
+   unsigned c;
    for (i = 0; i < frames; i++)
-   {
-      out[i] = in[2 * i + 0];
-      out[i + frames] = in[2 * i + 1];
-   }
+      for (c = 0; c < channels; c++)
+         out[i + c * frames] = in[channels * i + c];
 }
 
 static void planarize_audio(ffemu_t *handle)
@@ -920,10 +870,10 @@ static void planarize_audio(ffemu_t *handle)
 
    if (handle->audio.use_float)
       planarize_float((float*)handle->audio.planar_buf,
-            (const float*)handle->audio.buffer, handle->audio.frames_in_buffer);
+            (const float*)handle->audio.buffer, handle->audio.frames_in_buffer, handle->params.channels);
    else
       planarize_s16((int16_t*)handle->audio.planar_buf,
-            (const int16_t*)handle->audio.buffer, handle->audio.frames_in_buffer);
+            (const int16_t*)handle->audio.buffer, handle->audio.frames_in_buffer, handle->params.channels);
 }
 
 static bool encode_audio(ffemu_t *handle, AVPacket *pkt, bool dry)
@@ -1027,7 +977,6 @@ static void ffemu_audio_resample(ffemu_t *handle, struct ffemu_audio_data *data)
 
    if (handle->audio.resampler)
    {
-      // It's always two channels ...
       struct resampler_data info = {0};
       info.data_in      = (const float*)data->data;
       info.data_out     = handle->audio.resample_out;
@@ -1091,10 +1040,10 @@ static bool ffemu_push_audio_thread(ffemu_t *handle, struct ffemu_audio_data *da
 
 static void ffemu_flush_audio(ffemu_t *handle, void *audio_buf, size_t audio_buf_size)
 {
-   size_t avail = fifo_read_avail(handle->audio_fifo);
+   size_t avail = spsc_fifo_read_avail(handle->audio_fifo);
    if (avail)
    {
-      fifo_read(handle->audio_fifo, audio_buf, avail);
+      spsc_fifo_read(handle->audio_fifo, audio_buf, avail);
 
       struct ffemu_audio_data aud = {0};
       aud.frames = avail / (sizeof(int16_t) * handle->params.channels);
@@ -1135,9 +1084,9 @@ static void ffemu_flush_buffers(ffemu_t *handle)
    {
       did_work = false;
 
-      if (fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
+      if (spsc_fifo_read_avail(handle->audio_fifo) >= audio_buf_size)
       {
-         fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
+         spsc_fifo_read(handle->audio_fifo, audio_buf, audio_buf_size);
 
          struct ffemu_audio_data aud = {0};
          aud.frames = handle->audio.codec->frame_size;
@@ -1148,10 +1097,10 @@ static void ffemu_flush_buffers(ffemu_t *handle)
       }
 
       struct ffemu_video_data attr_buf;
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
+      if (spsc_fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
       {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf, attr_buf.height * attr_buf.pitch);
+         spsc_fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_fifo_read(handle->video_fifo, video_buf, attr_buf.height * attr_buf.pitch);
          attr_buf.data = video_buf;
          ffemu_push_video_thread(handle, &attr_buf);
 
@@ -1184,6 +1133,22 @@ bool ffemu_finalize(ffemu_t *handle)
    return true;
 }
 
+struct ffemu_thread_wait
+{
+   ffemu_t *ff;
+   size_t audio_buf_size;
+};
+
+static bool ffemu_thread_ready(void *data)
+{
+   struct ffemu_thread_wait *wait = (struct ffemu_thread_wait*)data;
+   ffemu_t *ff = wait->ff;
+
+   return !ff->alive ||
+      spsc_fifo_read_avail(ff->attr_fifo) >= sizeof(struct ffemu_video_data) ||
+      spsc_fifo_read_avail(ff->audio_fifo) >= wait->audio_buf_size;
+}
+
 static void ffemu_thread(void *data)
 {
    ffemu_t *ff = (ffemu_t*)data;
@@ -1195,43 +1160,22 @@ static void ffemu_thread(void *data)
    size_t audio_buf_size = ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t);
    void *audio_buf = av_malloc(audio_buf_size);
 
+   struct ffemu_thread_wait wait = { ff, audio_buf_size };
+
    while (ff->alive)
    {
       struct ffemu_video_data attr_buf;
 
-      bool avail_video = false;
-      bool avail_audio = false;
-
-      slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
-
-      if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
-         avail_audio = true;
-      slock_unlock(ff->lock);
-
-      if (!avail_video && !avail_audio)
-      {
-         slock_lock(ff->cond_lock);
-         if (ff->can_sleep)
-         {
-            ff->can_sleep = false;
-            scond_wait(ff->cond, ff->cond_lock);
-            ff->can_sleep = true;
-         }
-         else
-            scond_signal(ff->cond);
+      if (!spsc_fifo_wait_read(ff->audio_fifo, ffemu_thread_ready, &wait))
+         break;
 
-         slock_unlock(ff->cond_lock);
-      }
+      bool avail_video = spsc_fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf);
+      bool avail_audio = spsc_fifo_read_avail(ff->audio_fifo) >= audio_buf_size;
 
       if (avail_video)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf, attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+         spsc_fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
+         spsc_fifo_read(ff->video_fifo, video_buf, attr_buf.height * attr_buf.pitch);
 
          attr_buf.data = video_buf;
          ffemu_push_video_thread(ff, &attr_buf);
@@ -1239,10 +1183,7 @@ static void ffemu_thread(void *data)
 
       if (avail_audio)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
+         spsc_fifo_read(ff->audio_fifo, audio_buf, audio_buf_size);
 
          struct ffemu_audio_data aud = {0};
          aud.frames = ff->audio.codec->frame_size;
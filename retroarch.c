@@ -188,7 +188,8 @@ void rarch_take_screenshot(void)
 }
 #endif
 
-static void readjust_audio_input_rate(void)
+// PI controller on the audio buffer fill level. frames is the amount of input about to be written.
+static void readjust_audio_input_rate(size_t frames)
 {
    int avail = audio_write_avail_func();
    //RARCH_LOG_OUTPUT("Audio buffer is %u%% full\n",
@@ -197,10 +198,33 @@ static void readjust_audio_input_rate(void)
    unsigned write_index = g_extern.measure_data.buffer_free_samples_count++ & (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
    g_extern.measure_data.buffer_free_samples[write_index] = avail;
 
-   int half_size = g_extern.audio_data.driver_buffer_size / 2;
-   int delta_mid = avail - half_size;
-   double direction = (double)delta_mid / half_size;
+   // Count how often the buffer ran dry, not for how long.
+   bool underrun = avail >= (int)g_extern.audio_data.driver_buffer_size;
+   if (underrun && !g_extern.audio_data.underrun)
+      g_extern.audio_data.underruns++;
+   g_extern.audio_data.underrun = underrun;
 
+   float fill = 1.0f - (float)avail / g_extern.audio_data.driver_buffer_size;
+   double dt = frames / g_settings.audio.in_rate;
+
+   double alpha = 1.0;
+   if (g_settings.audio.rate_control_filter > 0.0f)
+      alpha = dt / (g_settings.audio.rate_control_filter + dt);
+   g_extern.audio_data.rate_control_fill += alpha * (fill - g_extern.audio_data.rate_control_fill);
+
+   // 1.0 with an empty buffer, -1.0 with a full one.
+   double error = 1.0 - 2.0 * g_extern.audio_data.rate_control_fill;
+
+   double integral = 0.0;
+   if (g_settings.audio.rate_control_integral > 0.0f)
+   {
+      // Clamped, so time spent saturated (e.g. fast-forward) doesn't wind it up.
+      integral = g_extern.audio_data.rate_control_integral + error * dt / g_settings.audio.rate_control_integral;
+      integral = max(min(integral, 1.0), -1.0);
+   }
+   g_extern.audio_data.rate_control_integral = integral;
+
+   double direction = max(min(error + integral, 1.0), -1.0);
    double adjust = 1.0 + g_settings.audio.rate_control_delta * direction;
 
    g_extern.audio_data.src_ratio = g_extern.audio_data.orig_src_ratio * adjust;
@@ -269,6 +293,62 @@ static void recording_dump_frame(const void *data, unsigned width, unsigned heig
 }
 #endif
 
+// Output size of the CPU filter for a given input size.
+static void filter_size(unsigned *width, unsigned *height)
+{
+   if (g_extern.filter.softfilter)
+   {
+      *width  *= g_extern.filter.softfilter->scale_x;
+      *height *= g_extern.filter.softfilter->scale_y;
+   }
+#ifdef HAVE_DYLIB
+   else
+      g_extern.filter.psize(width, height);
+#endif
+}
+
+struct softfilter_frame
+{
+   const void *data;
+   size_t pitch;
+   unsigned width;
+   unsigned height;
+};
+
+static void softfilter_slice(void *data, unsigned first_line, unsigned last_line)
+{
+   const struct softfilter_frame *frame = (const struct softfilter_frame*)data;
+   softfilter_render(g_extern.filter.softfilter, g_extern.filter.rgb32,
+         g_extern.filter.buffer, g_extern.filter.pitch, frame->data, frame->pitch,
+         frame->width, frame->height, first_line, last_line);
+}
+
+#ifdef HAVE_DYLIB
+// Only unscaled pixel conversion, which is safe to run on several slices at once.
+static void filter_convert_slice(void *data, unsigned first_line, unsigned last_line)
+{
+   const struct scaler_ctx *scaler = &g_extern.filter.scaler;
+   scaler->direct_pixconv((uint8_t*)g_extern.filter.scaler_out + first_line * scaler->out_stride,
+         (const uint8_t*)data + first_line * scaler->in_stride,
+         scaler->in_width, last_line - first_line, scaler->out_stride, scaler->in_stride);
+}
+
+static void filter_render_slice(void *data, unsigned first_line, unsigned last_line)
+{
+   const struct scaler_ctx *scaler = &g_extern.filter.scaler;
+   (void)data;
+
+   if (g_extern.filter.prender_slice)
+      g_extern.filter.prender_slice(g_extern.filter.colormap, g_extern.filter.buffer,
+            g_extern.filter.pitch, g_extern.filter.scaler_out, scaler->out_stride,
+            scaler->in_width, scaler->in_height, first_line, last_line);
+   else // Pool is single threaded, so this is the whole frame.
+      g_extern.filter.prender(g_extern.filter.colormap, g_extern.filter.buffer,
+            g_extern.filter.pitch, g_extern.filter.scaler_out, scaler->out_stride,
+            scaler->in_width, scaler->in_height);
+}
+#endif
+
 static void video_frame(const void *data, unsigned width, unsigned height, size_t pitch)
 {
    if (!g_extern.video_active)
@@ -306,37 +386,56 @@ static void video_frame(const void *data, unsigned width, unsigned height, size_
    const char *msg = msg_queue_pull(g_extern.msg_queue);
    driver.current_msg = msg;
 
-#ifdef HAVE_DYLIB
    if (g_extern.filter.active && data)
    {
-      struct scaler_ctx *scaler = &g_extern.filter.scaler;
-      scaler->in_width   = scaler->out_width = width;
-      scaler->in_height  = scaler->out_height = height;
-      scaler->in_stride  = pitch;
-      scaler->out_stride = width * sizeof(uint16_t);
-
-      scaler_ctx_scale(scaler, g_extern.filter.scaler_out, data);
+      RARCH_PERFORMANCE_INIT(video_filter);
+      RARCH_PERFORMANCE_START(video_filter);
+      if (g_extern.filter.softfilter)
+      {
+         struct softfilter_frame frame = { data, pitch, width, height };
+         slice_pool_run(g_extern.filter.pool, softfilter_slice, &frame, height);
+      }
+#ifdef HAVE_DYLIB
+      else
+      {
+         struct scaler_ctx *scaler = &g_extern.filter.scaler;
+         scaler->in_width   = scaler->out_width = width;
+         scaler->in_height  = scaler->out_height = height;
+         scaler->in_stride  = pitch;
+         scaler->out_stride = width * sizeof(uint16_t);
+
+         // Filters read neighbouring lines, so the whole frame is converted before any slice is rendered.
+         slice_pool_run(g_extern.filter.pool, filter_convert_slice, (void*)data, height);
+         slice_pool_run(g_extern.filter.pool, filter_render_slice, NULL, height);
+      }
+#endif
+      RARCH_PERFORMANCE_STOP(video_filter);
 
       unsigned owidth = width;
       unsigned oheight = height;
-      g_extern.filter.psize(&owidth, &oheight);
-      g_extern.filter.prender(g_extern.filter.colormap, g_extern.filter.buffer, 
-            g_extern.filter.pitch, g_extern.filter.scaler_out, scaler->out_stride, width, height);
+      filter_size(&owidth, &oheight);
 
 #ifdef HAVE_FFMPEG
       if (g_extern.recording && g_settings.video.post_filter_record)
          recording_dump_frame(g_extern.filter.buffer, owidth, oheight, g_extern.filter.pitch);
 #endif
 
+      // Conversion, recording and filtering above are part of the frame's profile.
+      if (g_extern.frame_scheduler)
+         frame_scheduler_present_begin(g_extern.frame_scheduler);
       if (!video_frame_func(g_extern.filter.buffer, owidth, oheight, g_extern.filter.pitch, msg))
          g_extern.video_active = false;
    }
-   else if (!video_frame_func(data, width, height, pitch, msg))
-      g_extern.video_active = false;
-#else
-   if (!video_frame_func(data, width, height, pitch, msg))
-      g_extern.video_active = false;
-#endif
+   else
+   {
+      if (g_extern.frame_scheduler)
+         frame_scheduler_present_begin(g_extern.frame_scheduler);
+      if (!video_frame_func(data, width, height, pitch, msg))
+         g_extern.video_active = false;
+   }
+
+   if (g_extern.frame_scheduler)
+      frame_scheduler_present_end(g_extern.frame_scheduler);
 }
 
 void rarch_render_cached_frame(void)
@@ -364,14 +463,17 @@ void rarch_render_cached_frame(void)
 #endif
 }
 
-static bool audio_flush(const int16_t *data, size_t samples)
+// Frames have g_extern.audio_data.channels interleaved samples each.
+static bool audio_flush(const int16_t *data, size_t frames)
 {
+   unsigned channels = g_extern.audio_data.channels;
+
 #ifdef HAVE_FFMPEG
    if (g_extern.recording)
    {
       struct ffemu_audio_data ffemu_data = {0};
       ffemu_data.data                    = data;
-      ffemu_data.frames                  = samples / 2;
+      ffemu_data.frames                  = frames;
 
       ffemu_push_audio(g_extern.rec, &ffemu_data);
    }
@@ -382,53 +484,109 @@ static bool audio_flush(const int16_t *data, size_t samples)
    if (!g_extern.audio_active)
       return false;
 
-   const float *output_data = NULL;
-   unsigned output_frames      = 0;
+   if (g_extern.audio_data.rate_control)
+      readjust_audio_input_rate(frames);
+
+   double ratio = g_extern.audio_data.src_ratio;
+   if (g_extern.is_slowmotion)
+      ratio *= g_settings.slowmotion_ratio;
+
+   // Input goes through every stage in blocks, so intermediate data stays in L1
+   // instead of making a full pass over a large buffer per stage.
+   // audio_sample() accumulates in conv_outsamples, so s16 output must go behind its input.
+   int16_t *conv_out = g_extern.audio_data.conv_outsamples;
+   if (data == conv_out)
+      conv_out += frames * channels;
+
+   float *out = g_extern.audio_data.outsamples;
+   size_t output_frames = 0;
+   size_t i;
 
-   struct resampler_data src_data = {0};
    RARCH_PERFORMANCE_INIT(audio_convert_s16);
-   RARCH_PERFORMANCE_START(audio_convert_s16);
-   audio_convert_s16_to_float(g_extern.audio_data.data, data, samples,
-         g_extern.audio_data.volume_gain);
-   RARCH_PERFORMANCE_STOP(audio_convert_s16);
+   RARCH_PERFORMANCE_INIT(audio_dsp_filter);
+   RARCH_PERFORMANCE_INIT(resampler_proc);
+   RARCH_PERFORMANCE_INIT(audio_downmix);
+   RARCH_PERFORMANCE_INIT(audio_convert_float);
+
+   for (i = 0; i < frames; i += AUDIO_FLUSH_BLOCK_FRAMES)
+   {
+      size_t block_frames = frames - i;
+      if (block_frames > AUDIO_FLUSH_BLOCK_FRAMES)
+         block_frames = AUDIO_FLUSH_BLOCK_FRAMES;
+
+      struct resampler_data src_data = {0};
+
+      // Volume is folded into the conversion scale, so gain costs nothing extra.
+      RARCH_PERFORMANCE_START(audio_convert_s16);
+      audio_convert_s16_to_float(g_extern.audio_data.data, data + i * channels, block_frames * channels,
+            g_extern.audio_data.volume_gain);
+      RARCH_PERFORMANCE_STOP(audio_convert_s16);
+
+      if (g_extern.audio_data.dsp_filter)
+      {
+         RARCH_PERFORMANCE_START(audio_dsp_filter);
+         rarch_dsp_filter_process(g_extern.audio_data.dsp_filter, g_extern.audio_data.data, block_frames);
+         RARCH_PERFORMANCE_STOP(audio_dsp_filter);
+      }
 
 #if defined(HAVE_DYLIB)
-   rarch_dsp_output_t dsp_output = {0};
-   rarch_dsp_input_t dsp_input   = {0};
-   dsp_input.samples             = g_extern.audio_data.data;
-   dsp_input.frames              = samples >> 1;
+      rarch_dsp_output_t dsp_output = {0};
+      rarch_dsp_input_t dsp_input   = {0};
+      dsp_input.samples             = g_extern.audio_data.data;
+      dsp_input.frames              = block_frames;
+
+      if (g_extern.audio_data.dsp_plugin)
+      {
+         // Plugins which only take stereo.
+         if (g_extern.audio_data.dsp_plugin_channels != channels)
+         {
+            RARCH_PERFORMANCE_START(audio_downmix);
+            audio_convert_downmix_float(g_extern.audio_data.data, g_extern.audio_data.data,
+                  block_frames, channels);
+            RARCH_PERFORMANCE_STOP(audio_downmix);
+         }
 
-   if (g_extern.audio_data.dsp_plugin)
-      g_extern.audio_data.dsp_plugin->process(g_extern.audio_data.dsp_handle, &dsp_output, &dsp_input);
+         g_extern.audio_data.dsp_plugin->process(g_extern.audio_data.dsp_handle, &dsp_output, &dsp_input);
+      }
 
-   src_data.data_in      = dsp_output.samples ? dsp_output.samples : g_extern.audio_data.data;
-   src_data.input_frames = dsp_output.samples ? dsp_output.frames : (samples >> 1);
+      src_data.data_in      = dsp_output.samples ? dsp_output.samples : g_extern.audio_data.data;
+      src_data.input_frames = dsp_output.samples ? dsp_output.frames : block_frames;
 #else
-   src_data.data_in      = g_extern.audio_data.data;
-   src_data.input_frames = samples >> 1;
+      src_data.data_in      = g_extern.audio_data.data;
+      src_data.input_frames = block_frames;
 #endif
 
-   src_data.data_out = g_extern.audio_data.outsamples;
+      src_data.data_out = out + output_frames * 2;
+      src_data.ratio    = ratio;
 
-   if (g_extern.audio_data.rate_control)
-      readjust_audio_input_rate();
+      RARCH_PERFORMANCE_START(resampler_proc);
+      rarch_resampler_process(g_extern.audio_data.resampler,
+            g_extern.audio_data.resampler_data, &src_data);
+      RARCH_PERFORMANCE_STOP(resampler_proc);
 
-   src_data.ratio = g_extern.audio_data.src_ratio;
-   if (g_extern.is_slowmotion)
-      src_data.ratio *= g_settings.slowmotion_ratio;
+      // Audio drivers take stereo. Folding down last leaves the whole chain to work on every channel.
+      if (g_extern.audio_data.resampler_channels != 2)
+      {
+         RARCH_PERFORMANCE_START(audio_downmix);
+         audio_convert_downmix_float(src_data.data_out, src_data.data_out,
+               src_data.output_frames, g_extern.audio_data.resampler_channels);
+         RARCH_PERFORMANCE_STOP(audio_downmix);
+      }
 
-   RARCH_PERFORMANCE_INIT(resampler_proc);
-   RARCH_PERFORMANCE_START(resampler_proc);
-   rarch_resampler_process(g_extern.audio_data.resampler,
-         g_extern.audio_data.resampler_data, &src_data);
-   RARCH_PERFORMANCE_STOP(resampler_proc);
+      if (!g_extern.audio_data.use_float)
+      {
+         RARCH_PERFORMANCE_START(audio_convert_float);
+         audio_convert_float_to_s16(conv_out + output_frames * 2,
+               src_data.data_out, src_data.output_frames * 2);
+         RARCH_PERFORMANCE_STOP(audio_convert_float);
+      }
 
-   output_data   = g_extern.audio_data.outsamples;
-   output_frames = src_data.output_frames;
+      output_frames += src_data.output_frames;
+   }
 
    if (g_extern.audio_data.use_float)
    {
-      if (audio_write_func(output_data, output_frames * sizeof(float) * 2) < 0)
+      if (audio_write_func(out, output_frames * sizeof(float) * 2) < 0)
       {
          RARCH_ERR("Audio backend failed to write. Will continue without sound.\n");
          return false;
@@ -436,13 +594,7 @@ static bool audio_flush(const int16_t *data, size_t samples)
    }
    else
    {
-      RARCH_PERFORMANCE_INIT(audio_convert_float);
-      RARCH_PERFORMANCE_START(audio_convert_float);
-      audio_convert_float_to_s16(g_extern.audio_data.conv_outsamples,
-            output_data, output_frames * 2);
-      RARCH_PERFORMANCE_STOP(audio_convert_float);
-
-      if (audio_write_func(g_extern.audio_data.conv_outsamples, output_frames * sizeof(int16_t) * 2) < 0)
+      if (audio_write_func(conv_out, output_frames * sizeof(int16_t) * 2) < 0)
       {
          RARCH_ERR("Audio backend failed to write. Will continue without sound.\n");
          return false;
@@ -452,33 +604,45 @@ static bool audio_flush(const int16_t *data, size_t samples)
    return true;
 }
 
+// Rewind audio is pushed backwards, frame by frame.
 static void audio_sample_rewind(int16_t left, int16_t right)
 {
+   unsigned c;
+   for (c = 2; c < g_extern.audio_data.channels; c++)
+      g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] = 0;
    g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] = right;
    g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] = left;
 }
 
 size_t audio_sample_batch_rewind(const int16_t *data, size_t frames)
 {
-   size_t i, samples;
+   size_t i;
+   unsigned channels = g_extern.audio_data.channels;
 
-   samples = frames << 1;
-   for (i = 0; i < samples; i++)
-      g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] = data[i];
+   for (i = 0; i < frames; i++, data += channels)
+   {
+      g_extern.audio_data.rewind_ptr -= channels;
+      memcpy(g_extern.audio_data.rewind_buf + g_extern.audio_data.rewind_ptr, data,
+            channels * sizeof(int16_t));
+   }
 
    return frames;
 }
 
+// Only carries front left and right. Other channels are silent.
 static void audio_sample(int16_t left, int16_t right)
 {
+   unsigned c;
    g_extern.audio_data.conv_outsamples[g_extern.audio_data.data_ptr++] = left;
    g_extern.audio_data.conv_outsamples[g_extern.audio_data.data_ptr++] = right;
+   for (c = 2; c < g_extern.audio_data.channels; c++)
+      g_extern.audio_data.conv_outsamples[g_extern.audio_data.data_ptr++] = 0;
 
    if (g_extern.audio_data.data_ptr < g_extern.audio_data.chunk_size)
       return;
 
    g_extern.audio_active = audio_flush(g_extern.audio_data.conv_outsamples,
-         g_extern.audio_data.data_ptr) && g_extern.audio_active;
+         g_extern.audio_data.data_ptr / g_extern.audio_data.channels) && g_extern.audio_active;
 
    g_extern.audio_data.data_ptr = 0;
 }
@@ -488,7 +652,7 @@ size_t audio_sample_batch(const int16_t *data, size_t frames)
    if (frames > (AUDIO_CHUNK_SIZE_NONBLOCKING >> 1))
       frames = AUDIO_CHUNK_SIZE_NONBLOCKING >> 1;
 
-   g_extern.audio_active = audio_flush(data, frames << 1) && g_extern.audio_active;
+   g_extern.audio_active = audio_flush(data, frames) && g_extern.audio_active;
    return frames;
 }
 
@@ -797,9 +961,12 @@ static void print_help(void)
 
 #ifdef HAVE_NETPLAY
    puts("\t-H/--host: Host netplay as player 1.");
-   puts("\t-C/--connect: Connect to netplay as player 2.");
+   puts("\t-C/--connect: Connect to netplay. The host tells which player you are.");
+   puts("\t--players: Number of players the host waits for before starting netplay. Default is 2.");
    puts("\t--port: Port used to netplay. Default is 55435.");
    puts("\t-F/--frames: Sync frames when using netplay.");
+   puts("\t--delay: Delays local input by this many frames when using netplay.");
+   puts("\t\tThe other player then has to predict it less often, which means fewer rollbacks.");
    puts("\t--spectate: Netplay will become spectating mode.");
    puts("\t\tHost can live stream the game content to players that connect.");
    puts("\t\tHowever, the client will not be able to play. Multiple clients can connect to the host.");
@@ -916,6 +1083,8 @@ static void parse_input(int argc, char *argv[])
       { "host", 0, NULL, 'H' },
       { "connect", 1, NULL, 'C' },
       { "frames", 1, NULL, 'F' },
+      { "delay", 1, &val, 'd' },
+      { "players", 1, &val, 'P' },
       { "port", 1, &val, 'p' },
       { "spectate", 0, &val, 'S' },
       { "nick", 1, &val, 'N' },
@@ -1161,6 +1330,14 @@ static void parse_input(int argc, char *argv[])
                   g_extern.netplay_is_spectate = true;
                   break;
 
+               case 'd':
+                  g_extern.netplay_input_delay = strtoul(optarg, NULL, 0);
+                  break;
+
+               case 'P':
+                  g_extern.netplay_players = strtoul(optarg, NULL, 0);
+                  break;
+
                case 'N':
                   strlcpy(g_extern.netplay_nick, optarg, sizeof(g_extern.netplay_nick));
                   break;
@@ -1405,7 +1582,7 @@ static void init_recording(void)
    params.out_height = info->geometry.base_height;
    params.fb_width   = info->geometry.max_width;
    params.fb_height  = info->geometry.max_height;
-   params.channels   = 2;
+   params.channels   = g_extern.audio_data.channels;
    params.filename   = g_extern.record_path;
    params.fps        = fps;
    params.samplerate = samplerate;
@@ -1465,12 +1642,12 @@ static void init_recording(void)
 
       if (g_settings.video.post_filter_record && g_extern.filter.active)
       {
-         g_extern.filter.psize(&params.out_width, &params.out_height);
-         params.pix_fmt = FFEMU_PIX_ARGB8888;
+         filter_size(&params.out_width, &params.out_height);
+         params.pix_fmt = (!g_extern.filter.softfilter || g_extern.filter.rgb32) ? FFEMU_PIX_ARGB8888 : FFEMU_PIX_RGB565;
 
          unsigned max_width  = params.fb_width;
          unsigned max_height = params.fb_height;
-         g_extern.filter.psize(&max_width, &max_height);
+         filter_size(&max_width, &max_height);
          params.fb_width  = next_pow2(max_width);
          params.fb_height = next_pow2(max_height);
       }
@@ -1573,7 +1750,9 @@ void rarch_init_rewind(void)
    }
 
    RARCH_LOG("Initing rewind buffer with size: %u MB\n", (unsigned)(g_settings.rewind_buffer_size / 1000000));
-   g_extern.state_manager = state_manager_new(aligned_state_size, g_settings.rewind_buffer_size, g_extern.state_buf);
+   g_extern.state_manager = state_manager_new(aligned_state_size, g_settings.rewind_buffer_size, g_extern.state_buf,
+         g_settings.rewind_compress, g_settings.rewind_threaded, g_settings.rewind_keyframe_interval,
+         g_settings.rewind_dirty_blocks);
 
    if (!g_extern.state_manager)
       RARCH_WARN("Failed to init rewind buffer. Rewinding will be disabled.\n");
@@ -1582,7 +1761,12 @@ void rarch_init_rewind(void)
 void rarch_deinit_rewind(void)
 {
    if (g_extern.state_manager)
+   {
+      double fps = g_extern.system.av_info.timing.fps;
+      state_manager_log_stats(g_extern.state_manager,
+            fps > 0.0 ? (g_settings.rewind_granularity ? g_settings.rewind_granularity : 1) / fps : 0.0);
       state_manager_free(g_extern.state_manager);
+   }
    g_extern.state_manager = NULL;
 
    free(g_extern.state_buf);
@@ -1662,11 +1846,12 @@ static void init_netplay(void)
       g_extern.netplay_is_client = true;
    }
    else
-      RARCH_LOG("Waiting for client...\n");
+      RARCH_LOG("Waiting for clients...\n");
 
    g_extern.netplay = netplay_new(g_extern.netplay_is_client ? g_extern.netplay_server : NULL,
          g_extern.netplay_port ? g_extern.netplay_port : RARCH_DEFAULT_PORT,
-         g_extern.netplay_sync_frames, &cbs, g_extern.netplay_is_spectate,
+         g_extern.netplay_sync_frames, g_extern.netplay_input_delay,
+         g_extern.netplay_players ? g_extern.netplay_players : 2, &cbs, g_extern.netplay_is_spectate,
          g_extern.netplay_nick);
 
    if (!g_extern.netplay)
@@ -1687,6 +1872,7 @@ static void deinit_netplay(void)
 {
    if (g_extern.netplay)
       netplay_free(g_extern.netplay);
+   g_extern.netplay = NULL;
 }
 #endif
 
@@ -2149,22 +2335,26 @@ static inline void flush_rewind_audio(void)
    if (g_extern.frame_is_reverse) // We just rewound. Flush rewind audio buffer.
    {
       g_extern.audio_active = audio_flush(g_extern.audio_data.rewind_buf + g_extern.audio_data.rewind_ptr,
-            g_extern.audio_data.rewind_size - g_extern.audio_data.rewind_ptr) && g_extern.audio_active;
+            (g_extern.audio_data.rewind_size - g_extern.audio_data.rewind_ptr) / g_extern.audio_data.channels) &&
+         g_extern.audio_active;
    }
 }
 
-static inline void setup_rewind_audio(void)
+static inline void setup_rewind_audio(unsigned frames)
 {
    unsigned i;
+   unsigned channels = g_extern.audio_data.channels;
    // Push audio ready to be played.
    g_extern.audio_data.rewind_ptr = g_extern.audio_data.rewind_size;
-   for (i = 0; i < g_extern.audio_data.data_ptr; i += 2)
+   // Only the last frame's audio is kept around. After jumping back several frames,
+   // playing it reversed would not match the state we landed on, so it is dropped.
+   if (frames > 1)
+      g_extern.audio_data.data_ptr = 0;
+   for (i = 0; i < g_extern.audio_data.data_ptr; i += channels)
    {
-      g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] =
-         g_extern.audio_data.conv_outsamples[i + 1];
-
-      g_extern.audio_data.rewind_buf[--g_extern.audio_data.rewind_ptr] =
-         g_extern.audio_data.conv_outsamples[i + 0];
+      g_extern.audio_data.rewind_ptr -= channels;
+      memcpy(g_extern.audio_data.rewind_buf + g_extern.audio_data.rewind_ptr,
+            g_extern.audio_data.conv_outsamples + i, channels * sizeof(int16_t));
    }
 
    g_extern.audio_data.data_ptr = 0;
@@ -2189,17 +2379,18 @@ static void check_rewind(void)
    {
       msg_queue_clear(g_extern.msg_queue);
       void *buf;
-      if (state_manager_pop(g_extern.state_manager, &buf))
+      unsigned frames_back;
+      if (state_manager_pop(g_extern.state_manager, &buf, &frames_back))
       {
          g_extern.frame_is_reverse = true;
-         setup_rewind_audio();
+         setup_rewind_audio(frames_back);
 
          msg_queue_push(g_extern.msg_queue, "Rewinding.", 0, g_extern.is_paused ? 1 : 30);
          pretro_unserialize(buf, g_extern.state_size);
 
 #ifdef HAVE_BSV_MOVIE
          if (g_extern.bsv.movie)
-            bsv_movie_frame_rewind(g_extern.bsv.movie);
+            bsv_movie_frame_rewind(g_extern.bsv.movie, frames_back); // One push per frame while a movie is active.
 #endif
       }
       else
@@ -2215,8 +2406,10 @@ static void check_rewind(void)
       if (cnt == 0)
 #endif
       {
-         pretro_serialize(g_extern.state_buf, g_extern.state_size);
-         state_manager_push(g_extern.state_manager, g_extern.state_buf);
+         void *state = NULL;
+         state_manager_push_where(g_extern.state_manager, &state);
+         pretro_serialize(state, g_extern.state_size);
+         state_manager_push_do(g_extern.state_manager);
       }
    }
 
@@ -2226,6 +2419,40 @@ static void check_rewind(void)
          audio_sample_batch_rewind : audio_sample_batch);
 }
 
+bool rarch_rewind_seek(unsigned frames)
+{
+   void *buf;
+   unsigned states_back = 0;
+   unsigned granularity = g_settings.rewind_granularity ? g_settings.rewind_granularity : 1;
+   char msg[64];
+
+   if (!g_extern.state_manager)
+   {
+      RARCH_ERR("Rewind is not enabled.\n");
+      return false;
+   }
+
+#ifdef HAVE_BSV_MOVIE
+   if (g_extern.bsv.movie)
+   {
+      RARCH_ERR("Cannot seek in rewind buffer while a movie is active.\n");
+      return false;
+   }
+#endif
+
+   // Rounds up, without overflowing for counts near UINT_MAX.
+   if (!state_manager_seek(g_extern.state_manager, frames / granularity + (frames % granularity != 0), &buf, &states_back))
+      return false;
+
+   pretro_unserialize(buf, g_extern.state_size);
+
+   snprintf(msg, sizeof(msg), "Rewound %u frames.", states_back * granularity);
+   msg_queue_clear(g_extern.msg_queue);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+   RARCH_LOG("%s\n", msg);
+   return true;
+}
+
 static void check_slowmotion(void)
 {
    g_extern.is_slowmotion = input_key_pressed_func(RARCH_SLOWMOTION);
@@ -2938,6 +3165,35 @@ static void init_system_av_info(void)
    g_extern.frame_limit.minimum_frame_time = (retro_time_t)roundf(1000000.0f / (g_extern.system.av_info.timing.fps * g_settings.fastforward_ratio));
 }
 
+static void init_frame_scheduler(void)
+{
+   bool want_delay = g_settings.video.frame_delay || g_settings.video.frame_delay_auto;
+   if (!want_delay && !*g_settings.video.frame_histogram_path)
+      return;
+
+   if (want_delay && g_settings.video.threaded)
+      RARCH_WARN("Frame delay does not apply to threaded video.\n");
+
+   g_extern.frame_scheduler = frame_scheduler_new(g_settings.video.refresh_rate / g_settings.video.swap_interval,
+         g_settings.video.frame_delay, g_settings.video.frame_delay_auto);
+   if (!g_extern.frame_scheduler)
+      RARCH_ERR("Failed to initialize frame scheduler.\n");
+}
+
+static void deinit_frame_scheduler(void)
+{
+   if (!g_extern.frame_scheduler)
+      return;
+
+   frame_scheduler_log(g_extern.frame_scheduler);
+   if (*g_settings.video.frame_histogram_path &&
+         frame_scheduler_write_histogram(g_extern.frame_scheduler, g_settings.video.frame_histogram_path))
+      RARCH_LOG("Wrote frame time histogram to %s.\n", g_settings.video.frame_histogram_path);
+
+   frame_scheduler_free(g_extern.frame_scheduler);
+   g_extern.frame_scheduler = NULL;
+}
+
 static void verify_api_version(void)
 {
    RARCH_LOG("Version of libretro API: %u\n", pretro_api_version());
@@ -3073,6 +3329,8 @@ int rarch_main_init(int argc, char *argv[])
    if (g_extern.use_sram)
       rarch_init_autosave();
 #endif
+
+   init_frame_scheduler();
       
 #ifdef HAVE_NETPLAY
    allow_cheats &= !g_extern.netplay;
@@ -3149,10 +3407,9 @@ static inline void limit_frame_time(void)
 
    retro_time_t current = rarch_get_time_usec();
    retro_time_t target = g_extern.frame_limit.last_frame_time + g_extern.frame_limit.minimum_frame_time;
-   retro_time_t to_sleep_ms = (target - current) / 1000;
-   if (to_sleep_ms > 0)
+   if (target > current)
    {
-      rarch_sleep((unsigned int)to_sleep_ms);
+      rarch_sleep_until_usec(target);
       g_extern.frame_limit.last_frame_time += g_extern.frame_limit.minimum_frame_time; // Combat jitter a bit.
    }
    else
@@ -3221,8 +3478,16 @@ bool rarch_main_iterate(void)
       input_push_analog_dpad(g_settings.input.autoconf_binds[i], g_settings.input.analog_dpad_mode[i]);
    }
 
+   // Frame delay only lines up with vsync if presenting blocks on it.
+   if (g_extern.frame_scheduler)
+      frame_scheduler_run_begin(g_extern.frame_scheduler, g_settings.video.vsync && !driver.nonblock_state &&
+            !g_settings.video.threaded && !g_extern.is_slowmotion);
+
    update_frame_time();
    pretro_run();
+
+   if (g_extern.frame_scheduler)
+      frame_scheduler_run_end(g_extern.frame_scheduler);
    limit_frame_time();
 
    for (i = 0; i < MAX_PLAYERS; i++)
@@ -3266,6 +3531,8 @@ void rarch_main_deinit(void)
    deinit_recording();
 #endif
 
+   deinit_frame_scheduler();
+
    if (g_extern.use_sram)
       save_files();
 
@@ -19,48 +19,987 @@
 #include "boolean.h"
 #include <string.h>
 #include <limits.h>
+#include "performance.h"
+
+#ifdef HAVE_ZLIB_DEFLATE
+#include <zlib.h>
+#endif
+
+#ifdef HAVE_THREADS
+#include "thread.h"
+#endif
+
+#ifndef REWIND_TEST
 #include "general.h"
+#else
+#include <stdio.h>
+#include <assert.h>
+#define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
+#define RARCH_ERR(...) fprintf(stderr, __VA_ARGS__)
+#define RARCH_WARN(...) fprintf(stderr, __VA_ARGS__)
+#define rarch_assert(cond) assert(cond)
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef RARCH_HAVE_TARGET_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(HAVE_NEON) && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REWIND_NEON
+#endif
+
+// Returns index of first word in [i, size) where old_state and new_state differ, or size if none do.
+typedef size_t (*state_manager_find_change_t)(const uint32_t *old_state,
+      const uint32_t *new_state, size_t i, size_t size);
+
+// Fingerprints a block of BLOCK_WORDS words. All kernels give the same result as block_hash_C.
+typedef uint64_t (*state_manager_block_hash_t)(const uint32_t *block, const uint64_t *key);
+
+// Rewind history lives in rings of variable-sized entries, newest at head, oldest at tail.
+// An entry never wraps around the end of a ring, so it can be decoded in place.
+//
+// Entry layout (uint32_t fields, every entry is 4-byte aligned):
+// [entry size] [inflated size, 0 if stored uncompressed] [sequence] [base sequence]
+// [RLE records ...] [entry size]
+//
+// An RLE record is [start word] [length in words] [length XOR words].
+// An entry size of 0 marks where the writer wrapped back to the start of the ring.
+//
+// History is kept in three tiers:
+// - deltas: one entry per push. XORing it into a state yields the previous state.
+// - keyframes: every keyframe_interval pushes, the state XOR the snapshot it is based on.
+// - snapshots: every SNAPSHOT_KEYFRAMES keyframes, the whole state (XOR zero).
+// Deltas cover the last few seconds. Keyframes and snapshots are kept for longer,
+// and let older history be restored with at most two decodes instead of one per push.
+#define ENTRY_HEADER_WORDS 4
+#define ENTRY_HEADER_SIZE (ENTRY_HEADER_WORDS * sizeof(uint32_t))
+#define ENTRY_FOOTER_SIZE (sizeof(uint32_t))
+#define ENTRY_OVERHEAD (ENTRY_HEADER_SIZE + ENTRY_FOOTER_SIZE)
+#define RECORD_HEADER_WORDS 2
+
+// Unchanged words between two changed ones are folded into the same record
+// as long as that is no larger than starting a new record.
+#define RECORD_MERGE_GAP RECORD_HEADER_WORDS
+
+#define SNAPSHOT_KEYFRAMES 8
+
+// With dirty block tracking, states are fingerprinted in blocks of this many words (256 bytes).
+// Only blocks that changed since the last push are diffed and copied.
+#define BLOCK_WORDS 64
+#define BLOCK_LANES 8 // 64-bit accumulators per fingerprint.
+
+// Share of the rewind buffer given to each tier when keyframes are enabled, in 1/8ths.
+#define DELTA_SHARE 4
+#define KEYFRAME_SHARE 2
+#define SNAPSHOT_SHARE 2
+
+struct state_ring
+{
+   uint8_t *buffer;
+   size_t capacity;
+   size_t head;
+   size_t tail;
+   size_t wrap; // End of the used region before it wraps around, if it does.
+   unsigned entries;
+};
 
 struct state_manager
 {
-   uint64_t *buffer;
-   size_t buf_size;
-   size_t buf_size_mask;
+   struct state_ring deltas;
+   struct state_ring keyframes;
+   struct state_ring snapshots;
+   size_t max_entry_size;
+
    uint32_t *tmp_state;
-   size_t top_ptr;
-   size_t bottom_ptr;
-   size_t state_size;
+   size_t state_size; // In words.
+   uint32_t seq; // Number of pushes leading up to tmp_state.
    bool first_pop;
+
+   unsigned keyframe_interval;
+   uint32_t *base_state; // Latest snapshot, which new keyframes are based on.
+   uint32_t base_seq;
+   bool base_valid;
+   uint32_t *zero_state;
+
+   state_manager_find_change_t find_change;
+
+   // Dirty block tracking, if enabled. Fingerprints describe the last pushed state,
+   // and are recomputed from scratch after popping, which changes tmp_state behind their back.
+   state_manager_block_hash_t block_hash;
+   uint64_t block_key[BLOCK_WORDS / 2];
+   uint64_t *block_hashes;
+   uint8_t *dirty;
+   size_t blocks;
+   bool hashes_valid;
+
+   bool compress;
+   uint32_t *scratch;
+   uint32_t *packed; // Compressed delta, before it is copied into its ring.
+#ifdef HAVE_ZLIB_DEFLATE
+   z_stream deflate_stream;
+   z_stream inflate_stream;
+   bool deflate_inited;
+   bool inflate_inited;
+#endif
+
+   // Buffers handed out by state_manager_push_where().
+   // Threaded, the main thread serializes into one while the worker turns the other one into a delta.
+   uint32_t *push_buffer[2];
+   unsigned push_index;
+   bool threaded;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+   bool pending[2];
+   unsigned work_index;
+   bool quit;
+#endif
+
+   // What the deltas pushed so far cost in every format, for logging.
+   struct
+   {
+      uint64_t pushes;
+      uint64_t xor_bytes;
+      uint64_t rle_bytes;
+      uint64_t stored_bytes;
+   } stats;
 };
 
-static inline size_t nearest_pow2_size(size_t v)
+static size_t find_change_C(const uint32_t *old_state,
+      const uint32_t *new_state, size_t i, size_t size)
+{
+   for (; i < size; i++)
+      if (old_state[i] != new_state[i])
+         break;
+   return i;
+}
+
+#if defined(__SSE2__)
+static size_t find_change_SSE2(const uint32_t *old_state,
+      const uint32_t *new_state, size_t i, size_t size)
+{
+   // Equal spans are skipped 8 words at a time.
+   // Only when a block has a difference do we care about where exactly it is.
+   for (; i + 8 <= size; i += 8)
+   {
+      __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(old_state + i + 0)),
+            _mm_loadu_si128((const __m128i*)(new_state + i + 0)));
+      __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(old_state + i + 4)),
+            _mm_loadu_si128((const __m128i*)(new_state + i + 4)));
+
+      unsigned mask = (unsigned)_mm_movemask_epi8(eq0) | ((unsigned)_mm_movemask_epi8(eq1) << 16);
+      if (mask != 0xffffffffu)
+         return i + (__builtin_ctz(~mask) >> 2);
+   }
+
+   return find_change_C(old_state, new_state, i, size);
+}
+#endif
+
+#ifdef RARCH_HAVE_TARGET_AVX2
+static RARCH_TARGET_AVX2 size_t find_change_AVX2(const uint32_t *old_state,
+      const uint32_t *new_state, size_t i, size_t size)
+{
+   for (; i + 16 <= size; i += 16)
+   {
+      __m256i eq0 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(old_state + i + 0)),
+            _mm256_loadu_si256((const __m256i*)(new_state + i + 0)));
+      __m256i eq1 = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(old_state + i + 8)),
+            _mm256_loadu_si256((const __m256i*)(new_state + i + 8)));
+
+      if (!_mm256_testc_si256(_mm256_and_si256(eq0, eq1), _mm256_set1_epi32(-1)))
+      {
+         uint64_t mask = (uint32_t)_mm256_movemask_epi8(eq0) |
+            ((uint64_t)(uint32_t)_mm256_movemask_epi8(eq1) << 32);
+         return i + (__builtin_ctzll(~mask) >> 2);
+      }
+   }
+
+   return find_change_C(old_state, new_state, i, size);
+}
+#endif
+
+#ifdef REWIND_NEON
+static size_t find_change_NEON(const uint32_t *old_state,
+      const uint32_t *new_state, size_t i, size_t size)
+{
+   for (; i + 8 <= size; i += 8)
+   {
+      uint32x4_t eq = vandq_u32(
+            vceqq_u32(vld1q_u32(old_state + i + 0), vld1q_u32(new_state + i + 0)),
+            vceqq_u32(vld1q_u32(old_state + i + 4), vld1q_u32(new_state + i + 4)));
+      uint32x2_t eq2 = vand_u32(vget_low_u32(eq), vget_high_u32(eq));
+
+      if ((vget_lane_u32(eq2, 0) & vget_lane_u32(eq2, 1)) != 0xffffffffu)
+         return find_change_C(old_state, new_state, i, i + 8);
+   }
+
+   return find_change_C(old_state, new_state, i, size);
+}
+#endif
+
+static state_manager_find_change_t find_change_select(void)
 {
-   size_t orig = v;
-   v--;
-   v |= v >> 1;
-   v |= v >> 2;
-   v |= v >> 4;
-#if SIZE_MAX >= UINT16_C(0xffff)
-      v |= v >> 8;
+   uint64_t cpu = rarch_get_cpu_features();
+   (void)cpu;
+
+#ifdef RARCH_HAVE_TARGET_AVX2
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      RARCH_LOG("Rewind delta kernel [AVX2]\n");
+      return find_change_AVX2;
+   }
 #endif
-#if SIZE_MAX >= UINT32_C(0xffffffff)
-      v |= v >> 16;
+#if defined(__SSE2__)
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      RARCH_LOG("Rewind delta kernel [SSE2]\n");
+      return find_change_SSE2;
+   }
+#elif defined(REWIND_NEON)
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      RARCH_LOG("Rewind delta kernel [NEON]\n");
+      return find_change_NEON;
+   }
 #endif
-#if SIZE_MAX >= UINT64_C(0xffffffffffffffff)
-      v |= v >> 32;
+
+   RARCH_LOG("Rewind delta kernel [C]\n");
+   return find_change_C;
+}
+
+static inline uint64_t block_hash_finish(const uint64_t *acc, size_t words)
+{
+   unsigned i;
+   uint64_t h = words * 0x9e3779b97f4a7c15ull;
+
+   for (i = 0; i < BLOCK_LANES; i++)
+   {
+      h ^= acc[i];
+      h *= 0xc2b2ae3d27d4eb4full;
+      h ^= h >> 31;
+   }
+
+   h ^= h >> 29;
+   h *= 0x165667b19e3779f9ull;
+   h ^= h >> 32;
+   return h;
+}
+
+// Each 64-bit word is XORed with a key and its halves multiplied into one accumulator,
+// while the word itself is added to the neighbouring one. Lanes are independent,
+// so this vectorizes, and reads every word once rather than the compare's twice.
+static uint64_t block_hash_words(const uint32_t *block, size_t words, const uint64_t *key)
+{
+   size_t i;
+   uint64_t acc[BLOCK_LANES] = {0};
+
+   for (i = 0; i < words / 2; i++)
+   {
+      uint64_t d;
+      memcpy(&d, block + 2 * i, sizeof(d));
+      uint64_t k = d ^ key[i];
+      acc[i % BLOCK_LANES] += (k & 0xffffffffu) * (k >> 32);
+      acc[(i % BLOCK_LANES) ^ 1] += d;
+   }
+
+   if (words & 1)
+   {
+      uint64_t d = block[words - 1];
+      uint64_t k = d ^ key[i];
+      acc[i % BLOCK_LANES] += (k & 0xffffffffu) * (k >> 32);
+      acc[(i % BLOCK_LANES) ^ 1] += d;
+   }
+
+   return block_hash_finish(acc, words);
+}
+
+static uint64_t block_hash_C(const uint32_t *block, const uint64_t *key)
+{
+   return block_hash_words(block, BLOCK_WORDS, key);
+}
+
+#if defined(__SSE2__)
+static uint64_t block_hash_SSE2(const uint32_t *block, const uint64_t *key)
+{
+   unsigned i, j;
+   uint64_t acc[BLOCK_LANES];
+   __m128i vacc[BLOCK_LANES / 2];
+
+   for (j = 0; j < BLOCK_LANES / 2; j++)
+      vacc[j] = _mm_setzero_si128();
+
+   for (i = 0; i < BLOCK_WORDS; i += 2 * BLOCK_LANES)
+   {
+      for (j = 0; j < BLOCK_LANES / 2; j++)
+      {
+         __m128i d = _mm_loadu_si128((const __m128i*)(block + i + 4 * j));
+         __m128i k = _mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(key + i / 2 + 2 * j)));
+         vacc[j] = _mm_add_epi64(vacc[j], _mm_mul_epu32(k, _mm_srli_epi64(k, 32)));
+         vacc[j] = _mm_add_epi64(vacc[j], _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+      }
+   }
+
+   for (j = 0; j < BLOCK_LANES / 2; j++)
+      _mm_storeu_si128((__m128i*)(acc + 2 * j), vacc[j]);
+   return block_hash_finish(acc, BLOCK_WORDS);
+}
 #endif
-   v++;
 
-   size_t next = v;
-   size_t prev = v >> 1;
+#ifdef RARCH_HAVE_TARGET_AVX2
+static RARCH_TARGET_AVX2 uint64_t block_hash_AVX2(const uint32_t *block, const uint64_t *key)
+{
+   unsigned i;
+   uint64_t acc[BLOCK_LANES];
+   __m256i acc0 = _mm256_setzero_si256();
+   __m256i acc1 = _mm256_setzero_si256();
+
+   for (i = 0; i < BLOCK_WORDS; i += 2 * BLOCK_LANES)
+   {
+      __m256i d0 = _mm256_loadu_si256((const __m256i*)(block + i + 0));
+      __m256i d1 = _mm256_loadu_si256((const __m256i*)(block + i + 8));
+      __m256i k0 = _mm256_xor_si256(d0, _mm256_loadu_si256((const __m256i*)(key + i / 2 + 0)));
+      __m256i k1 = _mm256_xor_si256(d1, _mm256_loadu_si256((const __m256i*)(key + i / 2 + 4)));
+
+      acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(k0, _mm256_srli_epi64(k0, 32)));
+      acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(k1, _mm256_srli_epi64(k1, 32)));
+      acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2)));
+      acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2)));
+   }
+
+   _mm256_storeu_si256((__m256i*)(acc + 0), acc0);
+   _mm256_storeu_si256((__m256i*)(acc + 4), acc1);
+   return block_hash_finish(acc, BLOCK_WORDS);
+}
+#endif
+
+#ifdef REWIND_NEON
+static uint64_t block_hash_NEON(const uint32_t *block, const uint64_t *key)
+{
+   unsigned i, j;
+   uint64_t acc[BLOCK_LANES];
+   uint64x2_t vacc[BLOCK_LANES / 2];
+
+   for (j = 0; j < BLOCK_LANES / 2; j++)
+      vacc[j] = vdupq_n_u64(0);
 
-   if ((next - orig) < (orig - prev))
-      return next;
+   for (i = 0; i < BLOCK_WORDS; i += 2 * BLOCK_LANES)
+   {
+      for (j = 0; j < BLOCK_LANES / 2; j++)
+      {
+         uint64x2_t d = vreinterpretq_u64_u32(vld1q_u32(block + i + 4 * j));
+         uint64x2_t k = veorq_u64(d, vld1q_u64(key + i / 2 + 2 * j));
+         vacc[j] = vaddq_u64(vacc[j], vmull_u32(vmovn_u64(k), vshrn_n_u64(k, 32)));
+         vacc[j] = vaddq_u64(vacc[j], vextq_u64(d, d, 1));
+      }
+   }
+
+   for (j = 0; j < BLOCK_LANES / 2; j++)
+      vst1q_u64(acc + 2 * j, vacc[j]);
+   return block_hash_finish(acc, BLOCK_WORDS);
+}
+#endif
+
+static state_manager_block_hash_t block_hash_select(void)
+{
+   uint64_t cpu = rarch_get_cpu_features();
+   (void)cpu;
+
+#ifdef RARCH_HAVE_TARGET_AVX2
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      RARCH_LOG("Rewind block hash kernel [AVX2]\n");
+      return block_hash_AVX2;
+   }
+#endif
+#if defined(__SSE2__)
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      RARCH_LOG("Rewind block hash kernel [SSE2]\n");
+      return block_hash_SSE2;
+   }
+#elif defined(REWIND_NEON)
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      RARCH_LOG("Rewind block hash kernel [NEON]\n");
+      return block_hash_NEON;
+   }
+#endif
+
+   RARCH_LOG("Rewind block hash kernel [C]\n");
+   return block_hash_C;
+}
+
+// Fingerprints every block of new_state, and flags the ones that differ from the previous push.
+// Blocks whose fingerprint did not change are confirmed against tmp_state, which holds the previous push,
+// so a collision cannot hide a change. Only the diffing is skipped for clean blocks.
+static void update_dirty_blocks(state_manager_t *state, const uint32_t *new_state)
+{
+   size_t b;
+   size_t full = state->state_size / BLOCK_WORDS;
+
+   for (b = 0; b < state->blocks; b++)
+   {
+      const uint32_t *block = new_state + b * BLOCK_WORDS;
+      size_t words = b < full ? BLOCK_WORDS : state->state_size - b * BLOCK_WORDS;
+      uint64_t hash = b < full ? state->block_hash(block, state->block_key) :
+         block_hash_words(block, words, state->block_key);
+
+      state->dirty[b] = !state->hashes_valid || hash != state->block_hashes[b] ||
+         memcmp(block, state->tmp_state + b * BLOCK_WORDS, words * sizeof(uint32_t));
+      state->block_hashes[b] = hash;
+   }
+
+   state->hashes_valid = true;
+}
+
+static void copy_dirty_blocks(state_manager_t *state, uint32_t *dst, const uint32_t *src)
+{
+   size_t b = 0;
+   while (b < state->blocks)
+   {
+      size_t end, words;
+      if (!state->dirty[b])
+      {
+         b++;
+         continue;
+      }
+
+      for (end = b; end < state->blocks && state->dirty[end]; end++);
+
+      words = end * BLOCK_WORDS < state->state_size ? end * BLOCK_WORDS : state->state_size;
+      memcpy(dst + b * BLOCK_WORDS, src + b * BLOCK_WORDS, (words - b * BLOCK_WORDS) * sizeof(uint32_t));
+      b = end;
+   }
+}
+
+static inline uint32_t *entry_word(const struct state_ring *ring, size_t offset)
+{
+   return (uint32_t*)(ring->buffer + offset);
+}
+
+static bool ring_init(struct state_ring *ring, size_t capacity)
+{
+   ring->capacity = capacity & ~(size_t)3;
+   ring->buffer = (uint8_t*)malloc(ring->capacity);
+   return ring->buffer;
+}
+
+static void ring_drop_oldest(struct state_ring *ring)
+{
+   if (ring->tail == ring->capacity || *entry_word(ring, ring->tail) == 0)
+      ring->tail = 0;
+
+   ring->tail += *entry_word(ring, ring->tail);
+   ring->entries--;
+}
+
+// Finds room for an entry of up to size bytes at head, dropping old entries as needed.
+static uint32_t *ring_reserve(struct state_ring *ring, size_t size)
+{
+   for (;;)
+   {
+      if (!ring->entries)
+      {
+         ring->head = ring->tail = 0;
+         break;
+      }
+
+      if (ring->head > ring->tail)
+      {
+         if (ring->capacity - ring->head >= size)
+            break;
+
+         // Wrap around once there is room at the start.
+         // Strict inequalities make sure head never catches up with tail.
+         if (ring->tail > size)
+         {
+            if (ring->head < ring->capacity)
+               *entry_word(ring, ring->head) = 0;
+            ring->wrap = ring->head;
+            ring->head = 0;
+            break;
+         }
+      }
+      else if (ring->tail - ring->head > size)
+         break;
+
+      ring_drop_oldest(ring);
+   }
+
+   return entry_word(ring, ring->head);
+}
+
+static void ring_commit(struct state_ring *ring, size_t size)
+{
+   *entry_word(ring, ring->head) = size;
+   *entry_word(ring, ring->head + size - ENTRY_FOOTER_SIZE) = size;
+   ring->head += size;
+   ring->entries++;
+}
+
+// Returns the newest entry, or NULL if the ring is empty.
+static uint32_t *ring_newest(struct state_ring *ring)
+{
+   if (!ring->entries)
+      return NULL;
+
+   if (ring->head == 0)
+      ring->head = ring->wrap;
+
+   return entry_word(ring, ring->head - *entry_word(ring, ring->head - ENTRY_FOOTER_SIZE));
+}
+
+static uint32_t *ring_oldest(struct state_ring *ring)
+{
+   if (!ring->entries)
+      return NULL;
+
+   if (ring->tail == ring->capacity || *entry_word(ring, ring->tail) == 0)
+      ring->tail = 0;
+
+   return entry_word(ring, ring->tail);
+}
+
+static void ring_drop_newest(struct state_ring *ring)
+{
+   ring->head -= ring_newest(ring)[0];
+   ring->entries--;
+}
+
+// Steps from an entry to the one before it. Returns NULL when entry is the oldest.
+static uint32_t *ring_older(struct state_ring *ring, const uint32_t *entry)
+{
+   size_t offset = (const uint8_t*)entry - ring->buffer;
+   if (entry == ring_oldest(ring))
+      return NULL;
+
+   if (offset == 0)
+      offset = ring->wrap;
+
+   return entry_word(ring, offset - *entry_word(ring, offset - ENTRY_FOOTER_SIZE));
+}
+
+// Writes RLE records for words [i, size) of the transition from new_state back to old_state.
+// Returns number of words written. Output never exceeds size - i + RECORD_HEADER_WORDS words.
+static size_t encode_range(state_manager_t *state, uint32_t *out,
+      const uint32_t *old_state, const uint32_t *new_state, size_t i, size_t size, size_t *changed_words)
+{
+   uint32_t *out_start = out;
+   size_t changed = 0;
+   i = state->find_change(old_state, new_state, i, size);
+
+   while (i < size)
+   {
+      size_t j, next;
+      size_t end = i + 1;
+
+      for (;;)
+      {
+         next = state->find_change(old_state, new_state, end, size);
+         if (next < size && next - end <= RECORD_MERGE_GAP)
+            end = next + 1;
+         else
+            break;
+      }
+
+      *out++ = i;
+      *out++ = end - i;
+      for (j = i; j < end; j++)
+      {
+         uint32_t xor_ = old_state[j] ^ new_state[j];
+         changed += xor_ != 0;
+         *out++ = xor_;
+      }
+
+      i = next;
+   }
+
+   *changed_words += changed;
+   return out - out_start;
+}
+
+// Encodes the whole state, or only runs of dirty blocks if dirty is set.
+// Runs are separated by at least one clean block, which pays for the extra record headers,
+// so output never exceeds state_size + RECORD_HEADER_WORDS words either way.
+static size_t encode_delta(state_manager_t *state, uint32_t *out,
+      const uint32_t *old_state, const uint32_t *new_state, const uint8_t *dirty, size_t *changed_words)
+{
+   size_t b = 0, words = 0;
+   *changed_words = 0;
+
+   if (!dirty)
+      return encode_range(state, out, old_state, new_state, 0, state->state_size, changed_words);
+
+   while (b < state->blocks)
+   {
+      size_t end, size;
+      if (!dirty[b])
+      {
+         b++;
+         continue;
+      }
+
+      for (end = b; end < state->blocks && dirty[end]; end++);
+
+      size = end * BLOCK_WORDS < state->state_size ? end * BLOCK_WORDS : state->state_size;
+      words += encode_range(state, out + words, old_state, new_state, b * BLOCK_WORDS, size, changed_words);
+      b = end;
+   }
+
+   return words;
+}
+
+static void apply_delta(uint32_t *state, const uint32_t *delta, size_t words)
+{
+   const uint32_t *end = delta + words;
+
+   while (delta < end)
+   {
+      size_t i;
+      uint32_t *out = state + delta[0];
+      size_t len = delta[1];
+      delta += RECORD_HEADER_WORDS;
+
+      for (i = 0; i < len; i++)
+         out[i] ^= delta[i];
+      delta += len;
+   }
+}
+
+#ifdef HAVE_ZLIB_DEFLATE
+// Returns compressed size, or 0 if compression did not make the entry smaller.
+static size_t compress_delta(state_manager_t *state, uint8_t *out, const uint32_t *delta, size_t size)
+{
+   z_stream *stream = &state->deflate_stream;
+   if (size <= sizeof(uint32_t) || deflateReset(stream) != Z_OK)
+      return 0;
+
+   stream->next_in = (Bytef*)delta;
+   stream->avail_in = size;
+   stream->next_out = out;
+   stream->avail_out = size - sizeof(uint32_t);
+
+   if (deflate(stream, Z_FINISH) != Z_STREAM_END)
+      return 0;
+
+   return stream->total_out;
+}
+
+static bool decompress_delta(state_manager_t *state, uint32_t *out, size_t out_size,
+      const uint8_t *in, size_t in_size)
+{
+   z_stream *stream = &state->inflate_stream;
+   if (inflateReset(stream) != Z_OK)
+      return false;
+
+   stream->next_in = (Bytef*)in;
+   stream->avail_in = in_size;
+   stream->next_out = (Bytef*)out;
+   stream->avail_out = out_size;
+
+   return inflate(stream, Z_FINISH) == Z_STREAM_END && stream->total_out == out_size;
+}
+#endif
+
+// Encodes new_state XOR old_state as an entry of ring. Returns the raw (uncompressed) entry size.
+// The delta is built in scratch space first, so the ring only gives up the bytes the entry really needs.
+static size_t write_entry(state_manager_t *state, struct state_ring *ring,
+      const uint32_t *old_state, const uint32_t *new_state, const uint8_t *dirty,
+      uint32_t seq, uint32_t base_seq, size_t *changed)
+{
+   uint32_t *entry;
+   const void *stored = state->scratch;
+   size_t delta_size = encode_delta(state, state->scratch, old_state, new_state, dirty, changed) * sizeof(uint32_t);
+   size_t stored_size = delta_size;
+   uint32_t inflated_size = 0;
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (state->compress)
+   {
+      size_t compressed_size = compress_delta(state, (uint8_t*)state->packed, state->scratch, delta_size);
+      if (compressed_size)
+      {
+         inflated_size = delta_size;
+         stored = state->packed;
+         stored_size = (compressed_size + 3) & ~(size_t)3;
+      }
+   }
+#endif
+
+   entry = ring_reserve(ring, stored_size + ENTRY_OVERHEAD);
+   entry[1] = inflated_size;
+   entry[2] = seq;
+   entry[3] = base_seq;
+   memcpy(entry + ENTRY_HEADER_WORDS, stored, stored_size);
+
+   ring_commit(ring, stored_size + ENTRY_OVERHEAD);
+   return delta_size + ENTRY_OVERHEAD;
+}
+
+static bool apply_entry(state_manager_t *state, uint32_t *target, const uint32_t *entry)
+{
+   uint32_t inflated_size = entry[1];
+   const uint32_t *delta = entry + ENTRY_HEADER_WORDS;
+   size_t delta_size = entry[0] - ENTRY_OVERHEAD;
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (inflated_size)
+   {
+      if (!decompress_delta(state, state->scratch, inflated_size, (const uint8_t*)delta, delta_size))
+      {
+         RARCH_ERR("Failed to decompress rewind delta.\n");
+         return false;
+      }
+
+      delta = state->scratch;
+      delta_size = inflated_size;
+   }
+#endif
+
+   apply_delta(target, delta, delta_size / sizeof(uint32_t));
+   return true;
+}
+
+// Keyframes and snapshots newer than the current state belong to a future we just left.
+static void drop_newer_keyframes(state_manager_t *state)
+{
+   uint32_t *entry;
+
+   while ((entry = ring_newest(&state->keyframes)) && entry[2] > state->seq)
+      ring_drop_newest(&state->keyframes);
+
+   while ((entry = ring_newest(&state->snapshots)) && entry[2] > state->seq)
+   {
+      if (entry[2] == state->base_seq)
+         state->base_valid = false;
+      ring_drop_newest(&state->snapshots);
+   }
+}
+
+static uint32_t *find_snapshot(state_manager_t *state, uint32_t seq)
+{
+   uint32_t *entry;
+   for (entry = ring_newest(&state->snapshots); entry; entry = ring_older(&state->snapshots, entry))
+   {
+      if (entry[2] == seq)
+         return entry;
+      if (entry[2] < seq)
+         break;
+   }
+
+   return NULL;
+}
+
+// Restores a snapshot into tmp_state, and makes it the base for future keyframes.
+static bool restore_snapshot(state_manager_t *state, const uint32_t *snapshot)
+{
+   memset(state->tmp_state, 0, state->state_size * sizeof(uint32_t));
+   if (!apply_entry(state, state->tmp_state, snapshot))
+      return false;
+
+   memcpy(state->base_state, state->tmp_state, state->state_size * sizeof(uint32_t));
+   state->base_seq = snapshot[2];
+   state->base_valid = true;
+   state->seq = snapshot[2];
+   return true;
+}
+
+// Restores a keyframe or snapshot into tmp_state. A keyframe needs its base snapshot restored first.
+static bool restore_checkpoint(state_manager_t *state, const uint32_t *entry, bool snapshot)
+{
+   const uint32_t *base;
+   if (snapshot)
+      return restore_snapshot(state, entry);
+
+   base = find_snapshot(state, entry[3]);
+   if (!base || !restore_snapshot(state, base) || !apply_entry(state, state->tmp_state, entry))
+      return false;
+
+   state->seq = entry[2];
+   return true;
+}
+
+// Restores the newest keyframe or snapshot older than the current state,
+// for when there are no deltas left to step back with.
+static bool restore_keyframe(state_manager_t *state)
+{
+   if (!state->seq)
+      return false;
+
+   for (;;)
+   {
+      uint32_t *keyframe, *snapshot;
+
+      // An entry equal to the current state gets us nowhere.
+      state->seq--;
+      drop_newer_keyframes(state);
+      state->seq++;
+
+      keyframe = ring_newest(&state->keyframes);
+      snapshot = ring_newest(&state->snapshots);
+
+      if (!keyframe && !snapshot)
+         return false;
+
+      if (!keyframe || (snapshot && snapshot[2] >= keyframe[2]))
+         return restore_snapshot(state, snapshot);
+
+      if (!find_snapshot(state, keyframe[3]))
+      {
+         // Snapshot this keyframe is based on has been dropped already.
+         ring_drop_newest(&state->keyframes);
+         continue;
+      }
+
+      return restore_checkpoint(state, keyframe, false);
+   }
+}
+
+struct checkpoint
+{
+   const uint32_t *entry;
+   bool snapshot;
+   uint32_t cost; // Entries decoded to reach target through this checkpoint.
+};
+
+// Finds the restorable keyframe or snapshot to seek to target from.
+// With above set, the cheapest one at or after target, whose remaining distance is covered by deltas.
+// Otherwise, the newest one at or before target.
+static bool find_checkpoint(state_manager_t *state, uint32_t target, bool above, struct checkpoint *out)
+{
+   unsigned i;
+   out->entry = NULL;
+
+   for (i = 0; i < 2; i++)
+   {
+      bool snapshot = i == 1;
+      struct state_ring *ring = snapshot ? &state->snapshots : &state->keyframes;
+      const uint32_t *entry;
+
+      for (entry = ring_newest(ring); entry; entry = ring_older(ring, entry))
+      {
+         uint32_t cost;
+         if (above && entry[2] < target)
+            break;
+         if (!above && entry[2] > target)
+            continue;
+         if (!snapshot && !find_snapshot(state, entry[3]))
+            continue;
+
+         cost = (snapshot ? 1 : 2) + (above ? entry[2] - target : 0);
+         if (!out->entry || (above ? cost < out->cost :
+                  entry[2] > out->entry[2] || (entry[2] == out->entry[2] && cost < out->cost)))
+         {
+            out->entry = entry;
+            out->snapshot = snapshot;
+            out->cost = cost;
+         }
+
+         if (!above)
+            break;
+      }
+   }
+
+   return out->entry;
+}
+
+static void push_state(state_manager_t *state, const void *data);
+
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   for (;;)
+   {
+      slock_lock(state->lock);
+      while (!state->quit && !state->pending[state->work_index])
+         scond_wait(state->work_cond, state->lock);
+      if (state->quit)
+      {
+         slock_unlock(state->lock);
+         break;
+      }
+      slock_unlock(state->lock);
+
+      // The main thread does not touch the buffer or tmp_state while a push is pending.
+      push_state(state, state->push_buffer[state->work_index]);
+
+      slock_lock(state->lock);
+      state->pending[state->work_index] = false;
+      state->work_index ^= 1;
+      scond_signal(state->done_cond);
+      slock_unlock(state->lock);
+   }
+}
+
+// Waits until the worker has finished everything, or only until buffer index is free.
+static void wait_pending(state_manager_t *state, int index)
+{
+   if (!state->threaded)
+      return;
+
+   slock_lock(state->lock);
+   if (index < 0)
+   {
+      while (state->pending[0] || state->pending[1])
+         scond_wait(state->done_cond, state->lock);
+   }
    else
-      return prev;
+   {
+      while (state->pending[index])
+         scond_wait(state->done_cond, state->lock);
+   }
+   slock_unlock(state->lock);
+}
+
+static bool init_thread(state_manager_t *state)
+{
+   if (!(state->push_buffer[1] = (uint32_t*)calloc(state->state_size, sizeof(uint32_t))))
+      return false;
+
+   state->lock = slock_new();
+   state->work_cond = scond_new();
+   state->done_cond = scond_new();
+   if (!state->lock || !state->work_cond || !state->done_cond)
+      return false;
+
+   state->thread = sthread_create(state_manager_thread, state);
+   return state->thread;
 }
 
-state_manager_t *state_manager_new(size_t state_size, size_t buffer_size, void *init_buffer)
+static void deinit_thread(state_manager_t *state)
+{
+   if (state->thread)
+   {
+      slock_lock(state->lock);
+      state->quit = true;
+      scond_signal(state->work_cond);
+      slock_unlock(state->lock);
+      sthread_join(state->thread);
+   }
+
+   if (state->lock)
+      slock_free(state->lock);
+   if (state->work_cond)
+      scond_free(state->work_cond);
+   if (state->done_cond)
+      scond_free(state->done_cond);
+}
+#else
+#define wait_pending(state, index) ((void)0)
+#endif
+
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size, void *init_buffer,
+      bool compress, bool threaded, unsigned keyframe_interval, bool dirty_blocks)
 {
    if (buffer_size <= state_size * 4) // Need a sufficient buffer size.
       return NULL;
@@ -71,124 +1010,355 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size, void *
 
    // We need 4-byte aligned state_size to avoid having to enforce this with unneeded memcpy's!
    rarch_assert(state_size % 4 == 0);
-   state->top_ptr = 1;
 
    state->state_size = state_size / sizeof(uint32_t); // Works in multiple of 4.
-   state->buf_size = nearest_pow2_size(buffer_size) / sizeof(uint64_t); // Works in multiple of 8.
-   state->buf_size_mask = state->buf_size - 1;
-   RARCH_LOG("Readjusted rewind buffer size to %u MiB\n", (unsigned)(sizeof(uint64_t) * (state->buf_size >> 20)));
+   state->max_entry_size = ENTRY_OVERHEAD + (state->state_size + RECORD_HEADER_WORDS) * sizeof(uint32_t);
 
-   if (!(state->buffer = (uint64_t*)calloc(1, state->buf_size * sizeof(uint64_t))))
+   // Every tier should be able to hold a couple of worst case entries.
+   if (keyframe_interval && buffer_size / 8 * KEYFRAME_SHARE < 2 * state->max_entry_size)
+   {
+      RARCH_WARN("Rewind buffer is too small for keyframes. Only keeping deltas.\n");
+      keyframe_interval = 0;
+   }
+   state->keyframe_interval = keyframe_interval;
+
+   if (keyframe_interval)
+   {
+      if (!ring_init(&state->deltas, buffer_size / 8 * DELTA_SHARE))
+         goto error;
+      if (!ring_init(&state->keyframes, buffer_size / 8 * KEYFRAME_SHARE))
+         goto error;
+      if (!ring_init(&state->snapshots, buffer_size / 8 * SNAPSHOT_SHARE))
+         goto error;
+      if (!(state->base_state = (uint32_t*)malloc(state->state_size * sizeof(uint32_t))))
+         goto error;
+      if (!(state->zero_state = (uint32_t*)calloc(state->state_size, sizeof(uint32_t))))
+         goto error;
+   }
+   else if (!ring_init(&state->deltas, buffer_size))
       goto error;
+
    if (!(state->tmp_state = (uint32_t*)calloc(1, state->state_size * sizeof(uint32_t))))
       goto error;
+   if (!(state->scratch = (uint32_t*)malloc(state->max_entry_size)))
+      goto error;
+   if (!(state->push_buffer[0] = (uint32_t*)calloc(state->state_size, sizeof(uint32_t))))
+      goto error;
 
    memcpy(state->tmp_state, init_buffer, state_size);
+   state->find_change = find_change_select();
 
-   return state;
+   if (dirty_blocks)
+   {
+      unsigned i;
+      uint64_t seed = 0;
 
-error:
-   if (state)
+      state->blocks = (state->state_size + BLOCK_WORDS - 1) / BLOCK_WORDS;
+      if (!(state->block_hashes = (uint64_t*)calloc(state->blocks, sizeof(uint64_t))))
+         goto error;
+      if (!(state->dirty = (uint8_t*)calloc(state->blocks, sizeof(uint8_t))))
+         goto error;
+
+      // splitmix64, so that the keys are well mixed but the same on every run.
+      for (i = 0; i < BLOCK_WORDS / 2; i++)
+      {
+         uint64_t z = (seed += 0x9e3779b97f4a7c15ull);
+         z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+         z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+         state->block_key[i] = z ^ (z >> 31);
+      }
+
+      state->block_hash = block_hash_select();
+      RARCH_LOG("Rewind only diffs %u-byte blocks that changed since the last push.\n",
+            (unsigned)(BLOCK_WORDS * sizeof(uint32_t)));
+   }
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (compress)
+   {
+      // Deltas are pushed every frame, so favor speed.
+      state->deflate_inited = deflateInit(&state->deflate_stream, Z_BEST_SPEED) == Z_OK;
+      state->inflate_inited = inflateInit(&state->inflate_stream) == Z_OK;
+      state->compress = state->deflate_inited && state->inflate_inited;
+      if (state->compress && !(state->packed = (uint32_t*)malloc(state->max_entry_size)))
+         goto error;
+   }
+#endif
+   if (compress && !state->compress)
+      RARCH_LOG("Rewind compression is not available. Storing deltas uncompressed.\n");
+
+   RARCH_LOG("Rewind buffer format: RLE%s.\n", state->compress ? " + zlib" : "");
+   if (keyframe_interval)
+   {
+      RARCH_LOG("Rewind keyframe every %u pushes, snapshot every %u pushes.\n",
+            keyframe_interval, keyframe_interval * SNAPSHOT_KEYFRAMES);
+   }
+
+#ifdef HAVE_THREADS
+   if (threaded)
    {
-      free(state->buffer);
-      free(state->tmp_state);
-      free(state);
+      if (!init_thread(state))
+         goto error;
+      state->threaded = true;
+      RARCH_LOG("Rewind deltas are generated on a separate thread.\n");
    }
+#else
+   if (threaded)
+      RARCH_WARN("Threaded rewind is not supported in this build.\n");
+#endif
+
+   return state;
+
+error:
+   state_manager_free(state);
    return NULL;
 }
 
 void state_manager_free(state_manager_t *state)
 {
-   free(state->buffer);
+   if (!state)
+      return;
+
+#ifdef HAVE_THREADS
+   deinit_thread(state);
+#endif
+
+#ifdef HAVE_ZLIB_DEFLATE
+   if (state->deflate_inited)
+      deflateEnd(&state->deflate_stream);
+   if (state->inflate_inited)
+      inflateEnd(&state->inflate_stream);
+#endif
+
+   free(state->deltas.buffer);
+   free(state->keyframes.buffer);
+   free(state->snapshots.buffer);
+   free(state->base_state);
+   free(state->zero_state);
    free(state->tmp_state);
+   free(state->scratch);
+   free(state->packed);
+   free(state->push_buffer[0]);
+   free(state->push_buffer[1]);
+   free(state->block_hashes);
+   free(state->dirty);
    free(state);
 }
 
-bool state_manager_pop(state_manager_t *state, void **data)
+bool state_manager_pop(state_manager_t *state, void **data, unsigned *frames_back)
 { 
+   uint32_t seq;
+
+   // Pushes still in flight must land before we can step back.
+   wait_pending(state, -1);
+   seq = state->seq;
+
    *data = state->tmp_state;
+   *frames_back = 1;
+   state->hashes_valid = false;
    if (state->first_pop)
    {
       state->first_pop = false;
       return true;
    }
 
-   state->top_ptr = (state->top_ptr - 1) & state->buf_size_mask;
-
-   if (state->top_ptr == state->bottom_ptr) // Our stack is completely empty... :v
+   const uint32_t *entry = ring_newest(&state->deltas);
+   if (!entry) // Out of deltas. Keyframes are all we have left.
    {
-      state->top_ptr = (state->top_ptr + 1) & state->buf_size_mask;
-      return false;
+      if (!restore_keyframe(state))
+         return false;
+      *frames_back = seq - state->seq;
+      return true;
    }
 
-   while (state->buffer[state->top_ptr])
+   if (!apply_entry(state, state->tmp_state, entry))
+      return false;
+
+   ring_drop_newest(&state->deltas);
+   state->seq--;
+   drop_newer_keyframes(state);
+
+   return true;
+}
+
+bool state_manager_seek(state_manager_t *state, unsigned frames, void **data, unsigned *frames_back)
+{
+   uint32_t start, target, floor, from;
+   const uint32_t *entry;
+   struct checkpoint checkpoint;
+
+   wait_pending(state, -1);
+
+   *data = state->tmp_state;
+   *frames_back = 0;
+   state->hashes_valid = false;
+   state->first_pop = false;
+
+   start = state->seq;
+   target = frames < start ? start - frames : 0;
+   entry = ring_oldest(&state->deltas);
+   floor = entry ? entry[2] : start;
+   from = start;
+
+   if (target < floor)
    {
-      // Apply the xor patch.
-      uint32_t addr = state->buffer[state->top_ptr] >> 32;
-      uint32_t xor_ = state->buffer[state->top_ptr] & 0xFFFFFFFFU;
-      state->tmp_state[addr] ^= xor_;
+      // Past what the deltas reach, only keyframes and snapshots are left.
+      // Land on the nearest one at or before target, or failing that, the oldest state held.
+      if (find_checkpoint(state, target, false, &checkpoint) ||
+            (find_checkpoint(state, target, true, &checkpoint) && checkpoint.entry[2] < floor))
+         target = checkpoint.entry[2];
+      else
+      {
+         target = floor;
+         checkpoint.entry = NULL;
+      }
+   }
+   else if (!find_checkpoint(state, target, true, &checkpoint) || checkpoint.cost >= start - target)
+      checkpoint.entry = NULL;
 
-      state->top_ptr = (state->top_ptr - 1) & state->buf_size_mask;
+   if (checkpoint.entry)
+   {
+      if (!restore_checkpoint(state, checkpoint.entry, checkpoint.snapshot))
+         return false;
+      from = checkpoint.entry[2];
    }
 
-   if (state->top_ptr == state->bottom_ptr) // Our stack is completely empty... :v
+   // Deltas newer than where we restored from are dropped without being decoded.
+   while ((entry = ring_newest(&state->deltas)) && entry[2] >= target)
    {
-      state->top_ptr = (state->top_ptr + 1) & state->buf_size_mask;
-      return true;
+      if (entry[2] < from && !apply_entry(state, state->tmp_state, entry))
+         return false;
+      ring_drop_newest(&state->deltas);
    }
 
-   return true;
-}
+   state->seq = target;
+   drop_newer_keyframes(state);
 
-static void reassign_bottom(state_manager_t *state)
-{
-   state->bottom_ptr = (state->top_ptr + 1) & state->buf_size_mask;
-   while (state->buffer[state->bottom_ptr]) // Skip ahead until we find the first 0 (boundary for state delta).
-      state->bottom_ptr = (state->bottom_ptr + 1) & state->buf_size_mask;
+   *frames_back = start - target;
+   return *frames_back || !frames;
 }
 
-static void generate_delta(state_manager_t *state, const void *data)
+static void push_keyframe(state_manager_t *state)
 {
-   uint64_t i;
-   bool crossed = false;
-   const uint32_t *old_state = state->tmp_state;
-   const uint32_t *new_state = (const uint32_t*)data;
+   size_t changed;
+   uint32_t index = state->seq / state->keyframe_interval;
 
-   state->buffer[state->top_ptr++] = 0; // For each separate delta, we have a 0 value sentinel in between.
-   state->top_ptr &= state->buf_size_mask;
-
-   // Check if top_ptr and bottom_ptr crossed each other, which means we need to delete old cruft.
-   if (state->top_ptr == state->bottom_ptr)
-      crossed = true;
+   if (!state->base_valid || index % SNAPSHOT_KEYFRAMES == 0)
+   {
+      write_entry(state, &state->snapshots, state->zero_state, state->tmp_state, NULL,
+            state->seq, state->seq, &changed);
 
-   for (i = 0; i < state->state_size; i++)
+      memcpy(state->base_state, state->tmp_state, state->state_size * sizeof(uint32_t));
+      state->base_seq = state->seq;
+      state->base_valid = true;
+   }
+   else
    {
-      uint64_t xor_ = old_state[i] ^ new_state[i];
+      write_entry(state, &state->keyframes, state->base_state, state->tmp_state, NULL,
+            state->seq, state->base_seq, &changed);
+   }
+}
 
-      // If the data differs (xor != 0), we push that xor on the stack with index and xor.
-      // This can be reversed by reapplying the xor.
-      // This, if states don't really differ much, we'll save lots of space :)
-      // Hopefully this will work really well with save states.
-      if (xor_)
-      {
-         state->buffer[state->top_ptr] = (i << 32) | xor_;
-         state->top_ptr = (state->top_ptr + 1) & state->buf_size_mask;
+static void push_state(state_manager_t *state, const void *data)
+{
+   size_t changed = 0, raw_size;
+   const uint8_t *dirty = NULL;
 
-         if (state->top_ptr == state->bottom_ptr)
-            crossed = true;
-      }
+   if (state->block_hash)
+   {
+      update_dirty_blocks(state, (const uint32_t*)data);
+      dirty = state->dirty;
    }
 
-   if (crossed)
-      reassign_bottom(state);
+   raw_size = write_entry(state, &state->deltas, state->tmp_state, (const uint32_t*)data, dirty,
+         state->seq, 0, &changed);
+
+   state->stats.pushes++;
+   state->stats.xor_bytes += (changed + 1) * sizeof(uint64_t);
+   state->stats.rle_bytes += raw_size;
+   state->stats.stored_bytes += ring_newest(&state->deltas)[0];
+
+   if (dirty)
+      copy_dirty_blocks(state, state->tmp_state, (const uint32_t*)data);
+   else
+      memcpy(state->tmp_state, data, state->state_size * sizeof(uint32_t));
+   state->seq++;
+   state->first_pop = true;
+
+   if (state->keyframe_interval && state->seq % state->keyframe_interval == 0)
+      push_keyframe(state);
 }
 
 bool state_manager_push(state_manager_t *state, const void *data)
 {
-   generate_delta(state, data);
-   memcpy(state->tmp_state, data, state->state_size * sizeof(uint32_t));
-   state->first_pop = true;
-
+   wait_pending(state, -1);
+   push_state(state, data);
    return true;
 }
 
+void state_manager_push_where(state_manager_t *state, void **data)
+{
+   wait_pending(state, state->push_index);
+   *data = state->push_buffer[state->push_index];
+}
+
+void state_manager_push_do(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (state->threaded)
+   {
+      slock_lock(state->lock);
+      state->pending[state->push_index] = true;
+      scond_signal(state->work_cond);
+      slock_unlock(state->lock);
+
+      state->push_index ^= 1;
+      return;
+   }
+#endif
+
+   push_state(state, state->push_buffer[state->push_index]);
+}
+
+void state_manager_log_stats(state_manager_t *state, double seconds_per_state)
+{
+   wait_pending(state, -1);
+
+   if (!state->stats.pushes)
+      return;
+
+   double pushes = (double)state->stats.pushes;
+   double capacity = (double)state->deltas.capacity;
+   double xor_avg = state->stats.xor_bytes / pushes;
+   double rle_avg = state->stats.rle_bytes / pushes;
+   double stored_avg = state->stats.stored_bytes / pushes;
+
+   RARCH_LOG("Rewind buffer holds %u states (%.1f seconds) in %u MiB.\n",
+         state->deltas.entries, state->deltas.entries * seconds_per_state,
+         (unsigned)(state->deltas.capacity >> 20));
+   RARCH_LOG("Average rewind delta: XOR pairs %.0f bytes, RLE %.0f bytes%s.\n",
+         xor_avg, rle_avg, state->compress ? "" : " (stored)");
+   RARCH_LOG("Rewind capacity per format: XOR pairs %.1f s, RLE %.1f s.\n",
+         capacity / xor_avg * seconds_per_state, capacity / rle_avg * seconds_per_state);
+
+   if (state->compress)
+   {
+      RARCH_LOG("Average rewind delta (RLE + zlib, stored): %.0f bytes, capacity %.1f s.\n",
+            stored_avg, capacity / stored_avg * seconds_per_state);
+   }
+
+   if (state->keyframe_interval)
+   {
+      const uint32_t *keyframe = ring_oldest(&state->keyframes);
+      const uint32_t *snapshot = ring_oldest(&state->snapshots);
+      uint32_t oldest = state->seq;
+      if (keyframe && keyframe[2] < oldest)
+         oldest = keyframe[2];
+      if (snapshot && snapshot[2] < oldest)
+         oldest = snapshot[2];
+
+      RARCH_LOG("Rewind keyframes reach back %.1f seconds (%u keyframes, %u snapshots).\n",
+            (state->seq - oldest) * seconds_per_state,
+            state->keyframes.entries, state->snapshots.entries);
+   }
+}
@@ -23,9 +23,33 @@ typedef struct state_manager state_manager_t;
 
 // Always pass in at least 4-byte aligned data and sizes!
 
-state_manager_t *state_manager_new(size_t state_size, size_t buffer_size, void *init_buffer);
+// If compress is set, deltas are additionally deflated when zlib is available.
+// If threaded is set, deltas are generated on a worker thread (requires HAVE_THREADS).
+// If keyframe_interval is non-zero, a keyframe is stored every keyframe_interval pushes,
+// and a full snapshot every few keyframes. These outlive the per-push deltas,
+// so popping past the oldest delta steps back one keyframe at a time.
+// If dirty_blocks is set, states are fingerprinted in small blocks, and only blocks
+// that changed are diffed. Blocks with an unchanged fingerprint are still compared exactly.
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size, void *init_buffer,
+      bool compress, bool threaded, unsigned keyframe_interval, bool dirty_blocks);
 void state_manager_free(state_manager_t *state);
-bool state_manager_pop(state_manager_t *state, void **data);
+// frames_back receives how many pushes it stepped back. That is one, unless it ran out of deltas
+// and had to jump back to a keyframe.
+bool state_manager_pop(state_manager_t *state, void **data, unsigned *frames_back);
 bool state_manager_push(state_manager_t *state, const void *data);
 
+// Steps back up to frames pushed states at once, and discards the history after it.
+// Rebuilds the state from the closest keyframe or snapshot when that decodes fewer entries than walking the deltas.
+// Beyond the deltas, lands on the nearest keyframe at or before the target, or the oldest state held.
+// frames_back receives how far it actually went. Returns false if it could not step back at all.
+bool state_manager_seek(state_manager_t *state, unsigned frames, void **data, unsigned *frames_back);
+
+// Pushes without an extra copy: serialize into the buffer returned by push_where, then call push_do.
+// In threaded mode, push_do returns immediately and the delta is generated in the background.
+void state_manager_push_where(state_manager_t *state, void **data);
+void state_manager_push_do(state_manager_t *state);
+
+// Logs how much rewind the buffer holds, and would hold with the other delta formats.
+void state_manager_log_stats(state_manager_t *state, double seconds_per_state);
+
 #endif
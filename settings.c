@@ -246,9 +246,12 @@ void config_set_defaults(void)
    g_settings.video.vsync = vsync;
    g_settings.video.hard_sync = hard_sync;
    g_settings.video.hard_sync_frames = hard_sync_frames;
+   g_settings.video.frame_delay = frame_delay;
+   g_settings.video.frame_delay_auto = frame_delay_auto;
    g_settings.video.black_frame_insertion = black_frame_insertion;
    g_settings.video.swap_interval = swap_interval;
    g_settings.video.threaded = video_threaded;
+   g_settings.video.filter_threads = video_filter_threads;
    g_settings.video.smooth = video_smooth;
    g_settings.video.force_aspect = force_aspect;
    g_settings.video.scale_integer = scale_integer;
@@ -283,13 +286,20 @@ void config_set_defaults(void)
       strlcpy(g_settings.audio.device, audio_device, sizeof(g_settings.audio.device));
    g_settings.audio.latency = out_latency;
    g_settings.audio.sync = audio_sync;
+   g_settings.audio.threaded = audio_threaded;
    g_settings.audio.rate_control = rate_control;
    g_settings.audio.rate_control_delta = rate_control_delta;
+   g_settings.audio.rate_control_filter = rate_control_filter;
+   g_settings.audio.rate_control_integral = rate_control_integral;
    g_settings.audio.volume = audio_volume;
 
    g_settings.rewind_enable = rewind_enable;
    g_settings.rewind_buffer_size = rewind_buffer_size;
    g_settings.rewind_granularity = rewind_granularity;
+   g_settings.rewind_compress = rewind_compress;
+   g_settings.rewind_threaded = rewind_threaded;
+   g_settings.rewind_keyframe_interval = rewind_keyframe_interval;
+   g_settings.rewind_dirty_blocks = rewind_dirty_blocks;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
    g_settings.pause_nonactive = pause_nonactive;
@@ -333,6 +343,9 @@ void config_set_defaults(void)
 
    g_settings.input.axis_threshold = axis_threshold;
    g_settings.input.netplay_client_swap_input = netplay_client_swap_input;
+   strlcpy(g_settings.input.netplay_predictor, netplay_predictor, sizeof(g_settings.input.netplay_predictor));
+   g_settings.input.netplay_check_frames = netplay_check_frames;
+   g_settings.input.netplay_accept_timeout = netplay_accept_timeout;
    g_settings.input.turbo_period = turbo_period;
    g_settings.input.turbo_duty_cycle = turbo_duty_cycle;
    g_settings.input.overlay_opacity = 0.7f;
@@ -745,6 +758,12 @@ bool config_load_file(const char *path, bool set_defaults)
    if (g_settings.video.hard_sync_frames > 3)
       g_settings.video.hard_sync_frames = 3;
 
+   CONFIG_GET_INT(video.frame_delay, "video_frame_delay");
+   if (g_settings.video.frame_delay > 15)
+      g_settings.video.frame_delay = 15;
+   CONFIG_GET_BOOL(video.frame_delay_auto, "video_frame_delay_auto");
+   CONFIG_GET_PATH(video.frame_histogram_path, "video_frame_histogram_path");
+
    CONFIG_GET_BOOL(video.black_frame_insertion, "video_black_frame_insertion");
    CONFIG_GET_INT(video.swap_interval, "video_swap_interval");
    g_settings.video.swap_interval = max(g_settings.video.swap_interval, 1);
@@ -847,9 +866,8 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(video.gpu_record, "video_gpu_record");
    CONFIG_GET_BOOL(video.gpu_screenshot, "video_gpu_screenshot");
 
-#ifdef HAVE_DYLIB
    CONFIG_GET_PATH(video.filter_path, "video_filter");
-#endif
+   CONFIG_GET_INT(video.filter_threads, "video_filter_threads");
 
    CONFIG_GET_PATH(video.shader_dir, "video_shader_dir");
    if (!strcmp(g_settings.video.shader_dir, "default"))
@@ -857,6 +875,9 @@ bool config_load_file(const char *path, bool set_defaults)
 
    CONFIG_GET_FLOAT(input.axis_threshold, "input_axis_threshold");
    CONFIG_GET_BOOL(input.netplay_client_swap_input, "netplay_client_swap_input");
+   CONFIG_GET_STRING(input.netplay_predictor, "netplay_predictor");
+   CONFIG_GET_INT(input.netplay_check_frames, "netplay_check_frames");
+   CONFIG_GET_INT(input.netplay_accept_timeout, "netplay_accept_timeout");
 
    for (i = 0; i < MAX_PLAYERS; i++)
    {
@@ -881,8 +902,11 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_STRING(audio.device, "audio_device");
    CONFIG_GET_INT(audio.latency, "audio_latency");
    CONFIG_GET_BOOL(audio.sync, "audio_sync");
+   CONFIG_GET_BOOL(audio.threaded, "audio_threaded");
    CONFIG_GET_BOOL(audio.rate_control, "audio_rate_control");
    CONFIG_GET_FLOAT(audio.rate_control_delta, "audio_rate_control_delta");
+   CONFIG_GET_FLOAT(audio.rate_control_filter, "audio_rate_control_filter");
+   CONFIG_GET_FLOAT(audio.rate_control_integral, "audio_rate_control_integral");
    CONFIG_GET_FLOAT(audio.volume, "audio_volume");
 
 #ifdef HAVE_CAMERA
@@ -892,7 +916,9 @@ bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_STRING(video.driver, "video_driver");
    CONFIG_GET_STRING(video.gl_context, "video_gl_context");
    CONFIG_GET_STRING(audio.driver, "audio_driver");
+   CONFIG_GET_STRING(audio.resampler, "audio_resampler");
    CONFIG_GET_PATH(audio.dsp_plugin, "audio_dsp_plugin");
+   CONFIG_GET_PATH(audio.dsp_filter, "audio_dsp_filter");
    CONFIG_GET_STRING(input.driver, "input_driver");
    CONFIG_GET_STRING(input.joypad_driver, "input_joypad_driver");
    CONFIG_GET_STRING(input.keyboard_layout, "input_keyboard_layout");
@@ -947,6 +973,10 @@ bool config_load_file(const char *path, bool set_defaults)
       g_settings.rewind_buffer_size = buffer_size * UINT64_C(1000000);
 
    CONFIG_GET_INT(rewind_granularity, "rewind_granularity");
+   CONFIG_GET_BOOL(rewind_compress, "rewind_compress");
+   CONFIG_GET_BOOL(rewind_threaded, "rewind_threaded");
+   CONFIG_GET_INT(rewind_keyframe_interval, "rewind_keyframe_interval");
+   CONFIG_GET_BOOL(rewind_dirty_blocks, "rewind_dirty_blocks");
    CONFIG_GET_FLOAT(slowmotion_ratio, "slowmotion_ratio");
    if (g_settings.slowmotion_ratio < 1.0f)
       g_settings.slowmotion_ratio = 1.0f;
@@ -1229,6 +1259,10 @@ bool config_save_file(const char *path)
    config_set_path(conf, "cheat_database_path", g_settings.cheat_database);
    config_set_bool(conf, "rewind_enable", g_settings.rewind_enable);
    config_set_int(conf, "rewind_granularity", g_settings.rewind_granularity);
+   config_set_bool(conf, "rewind_compress", g_settings.rewind_compress);
+   config_set_bool(conf, "rewind_threaded", g_settings.rewind_threaded);
+   config_set_int(conf, "rewind_keyframe_interval", g_settings.rewind_keyframe_interval);
+   config_set_bool(conf, "rewind_dirty_blocks", g_settings.rewind_dirty_blocks);
    config_set_path(conf, "video_shader", g_settings.video.shader_path);
    config_set_bool(conf, "video_shader_enable", g_settings.video.shader_enable);
    config_set_float(conf, "video_aspect_ratio", g_settings.video.aspect_ratio);
@@ -1245,6 +1279,8 @@ bool config_save_file(const char *path)
    config_set_bool(conf, "video_vsync", g_settings.video.vsync);
    config_set_bool(conf, "video_hard_sync", g_settings.video.hard_sync);
    config_set_int(conf, "video_hard_sync_frames", g_settings.video.hard_sync_frames);
+   config_set_int(conf, "video_frame_delay", g_settings.video.frame_delay);
+   config_set_bool(conf, "video_frame_delay_auto", g_settings.video.frame_delay_auto);
    config_set_bool(conf, "video_black_frame_insertion", g_settings.video.black_frame_insertion);
    config_set_int(conf, "video_swap_interval", g_settings.video.swap_interval);
    config_set_bool(conf, "video_gpu_screenshot", g_settings.video.gpu_screenshot);
@@ -1255,9 +1291,13 @@ bool config_save_file(const char *path)
 #ifdef HAVE_CAMERA
    config_set_string(conf, "camera_device", g_settings.camera.device);
 #endif
+   config_set_bool(conf, "audio_threaded", g_settings.audio.threaded);
    config_set_bool(conf, "audio_rate_control", g_settings.audio.rate_control);
    config_set_float(conf, "audio_rate_control_delta", g_settings.audio.rate_control_delta);
+   config_set_float(conf, "audio_rate_control_filter", g_settings.audio.rate_control_filter);
+   config_set_float(conf, "audio_rate_control_integral", g_settings.audio.rate_control_integral);
    config_set_string(conf, "audio_driver", g_settings.audio.driver);
+   config_set_string(conf, "audio_resampler", g_settings.audio.resampler);
    config_set_int(conf, "audio_out_rate", g_settings.audio.out_rate);
 
    config_set_path(conf, "system_directory", *g_settings.system_directory ? g_settings.system_directory : "default");
@@ -0,0 +1,328 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spsc_fifo.h"
+#include "thread.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && !defined(__GNUC__)
+#include <windows.h>
+#endif
+
+#ifdef _MSC_VER
+#include "msvc/msvc_compat.h"
+#endif
+
+// Keeps the producer and consumer indices apart, so the two threads don't bounce one cache line.
+#define SPSC_CACHE_LINE 64
+
+// The indices are published with release stores and picked up with acquire loads.
+// Going to sleep additionally needs a full fence, see spsc_wait().
+#if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+static inline size_t load_acquire(const size_t *ptr)
+{
+   return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release(size_t *ptr, size_t val)
+{
+   __atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+}
+
+static inline void fence_full(void)
+{
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+#elif defined(__GNUC__)
+// Older GCC only has full barriers.
+static inline size_t load_acquire(const size_t *ptr)
+{
+   size_t val = *(const volatile size_t*)ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static inline void store_release(size_t *ptr, size_t val)
+{
+   __sync_synchronize();
+   *(volatile size_t*)ptr = val;
+}
+
+static inline void fence_full(void)
+{
+   __sync_synchronize();
+}
+#elif defined(_MSC_VER)
+static inline size_t load_acquire(const size_t *ptr)
+{
+   size_t val = *(const volatile size_t*)ptr;
+   MemoryBarrier();
+   return val;
+}
+
+static inline void store_release(size_t *ptr, size_t val)
+{
+   MemoryBarrier();
+   *(volatile size_t*)ptr = val;
+}
+
+static inline void fence_full(void)
+{
+   MemoryBarrier();
+}
+#else
+#error "spsc_fifo needs atomics for this compiler."
+#endif
+
+// Only used when a thread needs to sleep. Can be shared between fifos.
+struct spsc_wait
+{
+   slock_t *lock;
+   scond_t *read_cond;
+   scond_t *write_cond;
+
+   size_t read_waiting;
+   size_t write_waiting;
+   size_t shutdown;
+
+   unsigned refcount;
+};
+
+struct spsc_fifo
+{
+   // Written by the producer only.
+   size_t end;
+   uint8_t pad_end[SPSC_CACHE_LINE - sizeof(size_t)];
+
+   // Written by the consumer only.
+   size_t first;
+   uint8_t pad_first[SPSC_CACHE_LINE - sizeof(size_t)];
+
+   uint8_t *buffer;
+   size_t bufsize;
+   struct spsc_wait *wait;
+};
+
+static void spsc_wait_free(struct spsc_wait *wait)
+{
+   if (!wait || --wait->refcount)
+      return;
+
+   if (wait->lock)
+      slock_free(wait->lock);
+   if (wait->read_cond)
+      scond_free(wait->read_cond);
+   if (wait->write_cond)
+      scond_free(wait->write_cond);
+   free(wait);
+}
+
+static struct spsc_wait *spsc_wait_new(void)
+{
+   struct spsc_wait *wait = (struct spsc_wait*)calloc(1, sizeof(*wait));
+   if (!wait)
+      return NULL;
+
+   wait->refcount = 1;
+   wait->lock = slock_new();
+   wait->read_cond = scond_new();
+   wait->write_cond = scond_new();
+
+   if (!wait->lock || !wait->read_cond || !wait->write_cond)
+   {
+      spsc_wait_free(wait);
+      return NULL;
+   }
+
+   return wait;
+}
+
+spsc_fifo_t *spsc_fifo_new(size_t size, spsc_fifo_t *share_wait)
+{
+   spsc_fifo_t *fifo = (spsc_fifo_t*)calloc(1, sizeof(*fifo));
+   if (!fifo)
+      return NULL;
+
+   fifo->buffer = (uint8_t*)calloc(1, size + 1);
+   if (!fifo->buffer)
+      goto error;
+   fifo->bufsize = size + 1;
+
+   if (share_wait)
+   {
+      fifo->wait = share_wait->wait;
+      fifo->wait->refcount++;
+   }
+   else if (!(fifo->wait = spsc_wait_new()))
+      goto error;
+
+   return fifo;
+
+error:
+   spsc_fifo_free(fifo);
+   return NULL;
+}
+
+void spsc_fifo_free(spsc_fifo_t *fifo)
+{
+   if (!fifo)
+      return;
+
+   spsc_wait_free(fifo->wait);
+   free(fifo->buffer);
+   free(fifo);
+}
+
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo)
+{
+   size_t first = fifo->first;
+   size_t end = load_acquire(&fifo->end);
+   if (end < first)
+      end += fifo->bufsize;
+   return end - first;
+}
+
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo)
+{
+   size_t first = load_acquire(&fifo->first);
+   size_t end = fifo->end;
+   if (end < first)
+      end += fifo->bufsize;
+
+   return (fifo->bufsize - 1) - (end - first);
+}
+
+// Wakes up the other side if it sleeps.
+// The fence pairs with the one in spsc_wait(): either the sleeper sees our update
+// when it re-checks, or we see that it is waiting.
+static void spsc_wake(struct spsc_wait *wait, size_t *waiting, scond_t *cond)
+{
+   fence_full();
+   if (!load_acquire(waiting))
+      return;
+
+   slock_lock(wait->lock);
+   scond_signal(cond);
+   slock_unlock(wait->lock);
+}
+
+static bool spsc_wait(struct spsc_wait *wait, size_t *waiting, scond_t *cond,
+      bool (*ready)(void *userdata), void *userdata)
+{
+   bool ret;
+   while (!(ret = ready(userdata)) && !load_acquire(&wait->shutdown))
+   {
+      slock_lock(wait->lock);
+      store_release(waiting, 1);
+      fence_full();
+
+      if (!ready(userdata) && !load_acquire(&wait->shutdown))
+         scond_wait(cond, wait->lock);
+
+      store_release(waiting, 0);
+      slock_unlock(wait->lock);
+   }
+
+   return ret;
+}
+
+void spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size)
+{
+   size_t end = fifo->end;
+   size_t first_write = size;
+   size_t rest_write = 0;
+   if (end + size > fifo->bufsize)
+   {
+      first_write = fifo->bufsize - end;
+      rest_write = size - first_write;
+   }
+
+   memcpy(fifo->buffer + end, in_buf, first_write);
+   memcpy(fifo->buffer, (const uint8_t*)in_buf + first_write, rest_write);
+
+   store_release(&fifo->end, (end + size) % fifo->bufsize);
+   spsc_wake(fifo->wait, &fifo->wait->read_waiting, fifo->wait->read_cond);
+}
+
+void spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size)
+{
+   size_t first = fifo->first;
+   size_t first_read = size;
+   size_t rest_read = 0;
+   if (first + size > fifo->bufsize)
+   {
+      first_read = fifo->bufsize - first;
+      rest_read = size - first_read;
+   }
+
+   memcpy(out_buf, fifo->buffer + first, first_read);
+   memcpy((uint8_t*)out_buf + first_read, fifo->buffer, rest_read);
+
+   store_release(&fifo->first, (first + size) % fifo->bufsize);
+   spsc_wake(fifo->wait, &fifo->wait->write_waiting, fifo->wait->write_cond);
+}
+
+bool spsc_fifo_wait_read(spsc_fifo_t *fifo, bool (*ready)(void *userdata), void *userdata)
+{
+   return spsc_wait(fifo->wait, &fifo->wait->read_waiting, fifo->wait->read_cond, ready, userdata);
+}
+
+bool spsc_fifo_wait_write(spsc_fifo_t *fifo, bool (*ready)(void *userdata), void *userdata)
+{
+   return spsc_wait(fifo->wait, &fifo->wait->write_waiting, fifo->wait->write_cond, ready, userdata);
+}
+
+struct spsc_avail
+{
+   spsc_fifo_t *fifo;
+   size_t size;
+};
+
+static bool spsc_read_ready(void *data)
+{
+   struct spsc_avail *avail = (struct spsc_avail*)data;
+   return spsc_fifo_read_avail(avail->fifo) >= avail->size;
+}
+
+static bool spsc_write_ready(void *data)
+{
+   struct spsc_avail *avail = (struct spsc_avail*)data;
+   return spsc_fifo_write_avail(avail->fifo) >= avail->size;
+}
+
+bool spsc_fifo_wait_read_avail(spsc_fifo_t *fifo, size_t size)
+{
+   struct spsc_avail avail = { fifo, size };
+   return spsc_fifo_wait_read(fifo, spsc_read_ready, &avail);
+}
+
+bool spsc_fifo_wait_write_avail(spsc_fifo_t *fifo, size_t size)
+{
+   struct spsc_avail avail = { fifo, size };
+   return spsc_fifo_wait_write(fifo, spsc_write_ready, &avail);
+}
+
+void spsc_fifo_shutdown(spsc_fifo_t *fifo)
+{
+   struct spsc_wait *wait = fifo->wait;
+   store_release(&wait->shutdown, 1);
+
+   slock_lock(wait->lock);
+   scond_signal(wait->read_cond);
+   scond_signal(wait->write_cond);
+   slock_unlock(wait->lock);
+}
@@ -0,0 +1,61 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPSC_FIFO_H__
+#define SPSC_FIFO_H__
+
+#include <stddef.h>
+#include "boolean.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free variant of fifo_buffer for exactly one producer thread and one consumer thread.
+// Reads and writes never take a lock. The wait functions only do so when they actually have to sleep.
+//
+// Only the producer may call spsc_fifo_write(), spsc_fifo_write_avail() and spsc_fifo_wait_write().
+// Only the consumer may call spsc_fifo_read(), spsc_fifo_read_avail() and spsc_fifo_wait_read().
+typedef struct spsc_fifo spsc_fifo_t;
+
+// Fifos which have the same producer and consumer can share their wait state with share_wait,
+// so a thread can wait for a condition spanning all of them. NULL creates new wait state.
+spsc_fifo_t *spsc_fifo_new(size_t size, spsc_fifo_t *share_wait);
+void spsc_fifo_free(spsc_fifo_t *fifo);
+
+void spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size);
+void spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size);
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo);
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo);
+
+// Blocks until ready(userdata) returns true, or spsc_fifo_shutdown() is called.
+// ready is re-evaluated every time the other side reads or writes any fifo sharing the wait state.
+// Returns the last result of ready.
+bool spsc_fifo_wait_read(spsc_fifo_t *fifo, bool (*ready)(void *userdata), void *userdata);
+bool spsc_fifo_wait_write(spsc_fifo_t *fifo, bool (*ready)(void *userdata), void *userdata);
+
+// Convenience waits for an amount of data or space in a single fifo.
+bool spsc_fifo_wait_read_avail(spsc_fifo_t *fifo, size_t size);
+bool spsc_fifo_wait_write_avail(spsc_fifo_t *fifo, size_t size);
+
+// Wakes up both sides, and makes all further waits return immediately.
+// Can be called from any thread.
+void spsc_fifo_shutdown(spsc_fifo_t *fifo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,261 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ * 
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Pushes a sequence of save states through the rewind state manager with every
+// delta kernel this machine can run, then pops them all back and verifies the result.
+// Usage: rewind-bench [state0 state1 ...]
+// States should be consecutive dumps of the same core (e.g. one per frame).
+// Without arguments, a synthetic 2 MiB state with sparse changes is used.
+// Buffer statistics for each delta format are logged to stderr.
+// For the threaded run, push time is what the main thread spends, i.e. copying in the state.
+
+#include "../../rewind.h"
+#include "../../libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#define SYNTH_STATE_SIZE (2 << 20)
+#define SYNTH_FRAMES 120
+#define PASSES 4
+// Emulated frame time between pushes, which a threaded push can hide its work behind.
+#define FRAME_WORK_US 1500
+
+static uint64_t bench_cpu_mask;
+
+// Overrides the frontend implementation so we can force each kernel in turn.
+uint64_t rarch_get_cpu_features(void)
+{
+   return bench_cpu_mask;
+}
+
+static uint64_t detect_cpu(void)
+{
+   uint64_t cpu = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("sse2"))
+      cpu |= RETRO_SIMD_SSE2;
+   if (__builtin_cpu_supports("avx2"))
+      cpu |= RETRO_SIMD_AVX2;
+#elif defined(__ARM_NEON__)
+   cpu |= RETRO_SIMD_NEON;
+#endif
+   return cpu;
+}
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static uint8_t *load_state(const char *path, size_t *size)
+{
+   FILE *file = fopen(path, "rb");
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   long len = ftell(file);
+   rewind(file);
+
+   // State manager works in multiples of 4.
+   size_t aligned = (len + 3) & ~3;
+   uint8_t *buf = (uint8_t*)calloc(1, aligned);
+   if (buf && fread(buf, 1, len, file) != (size_t)len)
+   {
+      free(buf);
+      buf = NULL;
+   }
+
+   fclose(file);
+   *size = aligned;
+   return buf;
+}
+
+static uint8_t **synth_states(unsigned frames, size_t size)
+{
+   unsigned i, j;
+   uint8_t **states = (uint8_t**)calloc(frames, sizeof(*states));
+   srand(0);
+
+   for (i = 0; i < frames; i++)
+   {
+      states[i] = (uint8_t*)malloc(size);
+      if (i == 0)
+      {
+         for (j = 0; j < size; j++)
+            states[i][j] = rand();
+         continue;
+      }
+
+      // Roughly what a 16-bit core does per frame: a few hot spots and a scattering of single bytes.
+      memcpy(states[i], states[i - 1], size);
+      for (j = 0; j < 8; j++)
+         memset(states[i] + (rand() % (size - 512)), rand(), rand() % 512);
+      for (j = 0; j < 1024; j++)
+         states[i][rand() % size] ^= 1 + (rand() & 0x7f);
+   }
+
+   return states;
+}
+
+static bool run(const char *name, uint8_t **states, unsigned frames, size_t size,
+      bool compress, bool threaded, bool dirty_blocks)
+{
+   unsigned i, pass;
+   double push_time = 0.0, pop_time = 0.0;
+   bool ok = true;
+
+   for (pass = 0; pass < PASSES; pass++)
+   {
+      // Make the buffer large enough that nothing gets dropped, so every pop can be verified.
+      state_manager_t *state = state_manager_new(size, size * (frames + 8) * 2, states[0],
+            compress, threaded, 0, dirty_blocks);
+      if (!state)
+      {
+         fprintf(stderr, "Failed to create state manager.\n");
+         return false;
+      }
+
+      for (i = 1; i < frames; i++)
+      {
+         void *data;
+         double start = get_time();
+         state_manager_push_where(state, &data);
+         memcpy(data, states[i], size); // Stands in for retro_serialize().
+         state_manager_push_do(state);
+         double end = get_time();
+         push_time += end - start;
+
+         while (get_time() < end + FRAME_WORK_US / 1000000.0);
+      }
+
+      double start = get_time();
+      void *data;
+      unsigned back;
+      // First pop returns the top state itself.
+      state_manager_pop(state, &data, &back);
+
+      start = get_time();
+      for (i = frames - 1; i-- > 0; )
+      {
+         if (!state_manager_pop(state, &data, &back) || back != 1 || memcmp(data, states[i], size))
+         {
+            fprintf(stderr, "[%s] Mismatch when popping frame %u.\n", name, i);
+            ok = false;
+            break;
+         }
+      }
+      pop_time += get_time() - start;
+
+      if (pass == 0)
+      {
+         fprintf(stderr, "[%s%s%s%s]\n", name, compress ? " + zlib" : "", threaded ? " threaded" : "",
+               dirty_blocks ? " dirty blocks" : "");
+         state_manager_log_stats(state, 1.0 / 60.0);
+      }
+      state_manager_free(state);
+   }
+
+   double pushes = (double)PASSES * (frames - 1);
+   printf("%-6s%s%s%s push: %8.1f us/frame (%7.1f MB/s), pop: %8.1f us/frame\n", name,
+         compress ? " + zlib" : "       ", threaded ? " threaded" : "         ",
+         dirty_blocks ? " dirty" : "      ", 1000000.0 * push_time / pushes,
+         pushes * size / (push_time * 1000000.0),
+         1000000.0 * pop_time / pushes);
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   uint8_t **states = NULL;
+   unsigned frames = 0;
+   size_t size = 0;
+
+   if (argc > 2)
+   {
+      frames = argc - 1;
+      states = (uint8_t**)calloc(frames, sizeof(*states));
+      for (i = 0; i < frames; i++)
+      {
+         size_t len = 0;
+         states[i] = load_state(argv[i + 1], &len);
+         if (!states[i] || (size && len != size))
+         {
+            fprintf(stderr, "Failed to load \"%s\", or size differs from first state.\n", argv[i + 1]);
+            return 1;
+         }
+         size = len;
+      }
+   }
+   else if (argc == 1)
+   {
+      frames = SYNTH_FRAMES;
+      size = SYNTH_STATE_SIZE;
+      states = synth_states(frames, size);
+   }
+   else
+   {
+      fprintf(stderr, "Usage: %s [state0 state1 ...] (at least two states)\n", argv[0]);
+      return 1;
+   }
+
+   printf("%u states, %u bytes each.\n", frames, (unsigned)size);
+
+   uint64_t cpu = detect_cpu();
+   bool ok = true;
+
+   bench_cpu_mask = 0;
+   ok &= run("C", states, frames, size, false, false, false);
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      bench_cpu_mask = RETRO_SIMD_SSE2;
+      ok &= run("SSE2", states, frames, size, false, false, false);
+   }
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      bench_cpu_mask = RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2;
+      ok &= run("AVX2", states, frames, size, false, false, false);
+   }
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      bench_cpu_mask = RETRO_SIMD_NEON;
+      ok &= run("NEON", states, frames, size, false, false, false);
+   }
+
+   // Compression cost on top of the best kernel.
+   bench_cpu_mask = cpu;
+   ok &= run("best", states, frames, size, true, false, false);
+   ok &= run("best", states, frames, size, false, true, false);
+
+   // Dirty block tracking, with every hash kernel.
+   bench_cpu_mask = 0;
+   ok &= run("C", states, frames, size, false, false, true);
+   bench_cpu_mask = cpu;
+   ok &= run("best", states, frames, size, false, false, true);
+
+   for (i = 0; i < frames; i++)
+      free(states[i]);
+   free(states);
+
+   return ok ? 0 : 1;
+}